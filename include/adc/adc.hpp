@@ -90,6 +90,35 @@ extern char SENSOR_NAMES[NUM_SENSORS][20];
 // 	"TC3"
 // };
 
+/**
+ * @brief Where an adc_reader gets its samples from. The real implementation
+ * 	  talks to the MCP3204s over SPI; the others stand in for the hardware
+ * 	  so the rest of the pipeline can be run and load-tested off the Pi.
+ * 	  See adc/adc_backend.hpp.
+ *
+ * Calls are always made with the ADC lock held, so implementations only ever
+ * see one caller at a time.
+ */
+class adc_backend {
+	public:
+		virtual ~adc_backend() {};
+
+		/**
+		 * @brief Prepares for a batch of conversions.
+		 */
+		virtual void begin() {};
+
+		/**
+		 * @brief Takes one sample.
+		 *
+		 * @param sensor_index The sensor to sample, based on the SENSOR enum.
+		 * @param info Where the sensor is wired.
+		 *
+		 * @return The 12-bit reading.
+		 */
+		virtual uint16_t convert(uint8_t sensor_index, const adc_info &info) = 0;
+};
+
 class adc_reader {
 	private:
 		/** 
@@ -98,14 +127,26 @@ class adc_reader {
 		 */
 		struct adc_info adc_infos[SENSOR::NUM_SENSORS];
 
+		/**
+		 * @brief Where the samples come from. Not owned by the reader.
+		 */
+		adc_backend *backend;
+
 	public:
 		/**
-		 * @brief The constructor for an adc_reader.
-		 *
-		 * TODO provide configs in constructor?
+		 * @brief The constructor for an adc_reader that reads the ADCs
+		 * 	  over SPI.
 		 */
 		adc_reader();
 
+		/**
+		 * @brief The constructor for an adc_reader that takes its samples
+		 * 	  from the given backend.
+		 *
+		 * @param backend The backend to sample. Must outlive the reader.
+		 */
+		adc_reader(adc_backend *backend);
+
 		/**
 		 * @brief Reads the specified sensor.
 		 *
@@ -117,11 +158,22 @@ class adc_reader {
 		uint16_t read_item(uint8_t sensor_index);
 
 		/**
-		 * @brief Counts up (used for debugging).
+		 * @brief Reads several sensors, normally all the channels behind
+		 * 	  one chip select, in a single locked bus transaction.
+		 *
+		 * Cheaper than calling read_item() for each sensor: the bus lock
+		 * and the SPI chip select setup are done once for the batch.
+		 *
+		 * @param sensor_indexes The sensors to read, based on the SENSOR
+		 * 	  enum.
+		 * @param num The number of sensors to read.
+		 * @param readings An array of at least num entries that is filled
+		 * 	  with the readings, in the same order as sensor_indexes.
 		 *
-		 * @return An integer that is incremented on each call.
+		 * @return The number of sensors read: num on success and 0 if any
+		 * 	   of the sensor indexes is invalid.
 		 */
-		uint16_t count_up();
+		uint8_t read_items(const uint8_t *sensor_indexes, uint8_t num, uint16_t *readings);
 
 		/**
 		 * @brief Registers an adc_info in the internal array.
@@ -0,0 +1,181 @@
+/**
+ * @file adc_backend.hpp
+ * @brief Sources of samples for the adc_reader.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#ifndef __ADC_BACKEND_HPP
+#define __ADC_BACKEND_HPP
+
+#include <stdint.h>
+#include <vector>
+
+#include "adc/adc.hpp"
+#include "config/config.hpp"
+
+// Largest reading a 12-bit ADC can produce
+#define ADC_MAX_READING 4095
+
+/**
+ * @brief Reads the MCP3204 ADCs over SPI using bcm2835. In the mock build the
+ * 	  SPI bus is stubbed out and every reading is the channel number.
+ */
+class bcm2835_backend : public adc_backend {
+	public:
+		void begin() override;
+
+		uint16_t convert(uint8_t sensor_index, const adc_info &info) override;
+};
+
+/**
+ * @brief The shapes the synthetic backend can generate.
+ *
+ * CONSTANT: always min.
+ * RAMP:     rises linearly from min to max once per period, then wraps.
+ * SINE:     a sine wave between min and max with the given period.
+ * NOISE:    uniformly random between min and max.
+ * PRESSURE: a burn-like profile, repeated every period: idle at min, a fast
+ * 	     rise to max, a slowly decaying plateau, then a tail-off to min.
+ */
+enum class WAVEFORM {
+	CONSTANT = 0,
+	RAMP,
+	SINE,
+	NOISE,
+	PRESSURE
+};
+
+/**
+ * @brief The configuration of one synthetic channel.
+ */
+struct waveform {
+	WAVEFORM type;
+
+	/* @brief The range of the wave, in raw ADC counts */
+	double min;
+	double max;
+
+	/* @brief The time it takes the wave to repeat, in microseconds */
+	uint64_t period_us;
+
+	/* @brief The amplitude of uniform noise added on top, in raw counts */
+	double noise;
+};
+
+/**
+ * @brief Generates readings from configurable waveforms. The waves are a
+ * 	  function of time rather than of the number of reads, so they look the
+ * 	  same at any sampling rate.
+ *
+ * Each sensor is configured by a key named after it in the [Mock] section:
+ *
+ * 	LC1=<type>,<min>,<max>,<period_ms>,<noise>
+ *
+ * where type is one of constant, ramp, sine, noise or pressure. Sensors that
+ * are not configured ramp over the whole ADC range once a second.
+ */
+class synthetic_backend : public adc_backend {
+	private:
+		/**
+		 * @brief The wave generated for each sensor.
+		 */
+		waveform waves[SENSOR::NUM_SENSORS];
+
+		/**
+		 * @brief State of the xorshift noise generator.
+		 */
+		uint32_t rng;
+
+		/**
+		 * @brief Monotonic time at construction, the start of every wave.
+		 */
+		uint64_t start_us;
+
+	public:
+		/**
+		 * @brief The constructor for a synthetic_backend.
+		 *
+		 * @param config The configuration holding the [Mock] section.
+		 */
+		synthetic_backend(ConfigMapping& config);
+
+		/**
+		 * @brief Sets the wave generated for one sensor.
+		 */
+		void setWaveform(uint8_t sensor_index, const waveform &wave);
+
+		uint16_t convert(uint8_t sensor_index, const adc_info &info) override;
+};
+
+/**
+ * @brief Plays back readings recorded in data logs (the legacy or compact
+ * 	  packets written for each sensor), one recorded sample per read, looping
+ * 	  at the end of the file.
+ *
+ * The file for each sensor is given in the [Mock] section by a key such as
+ *
+ * 	replay_LC1=logs/<time>/Recording_<time>.rec
+ *
+ * The file may be a recording of every sensor, from which the sensor's own
+ * channel is played, or an older log of one sensor's packets.
+ *
+ * Sensors without a file always read 0.
+ */
+class replay_backend : public adc_backend {
+	private:
+		/**
+		 * @brief The recorded readings of each sensor.
+		 */
+		std::vector<uint16_t> samples[SENSOR::NUM_SENSORS];
+
+		/**
+		 * @brief The position of the next reading to play for each sensor.
+		 */
+		size_t positions[SENSOR::NUM_SENSORS];
+
+	public:
+		/**
+		 * @brief The constructor for a replay_backend. Loads all the
+		 * 	  configured files up front.
+		 *
+		 * @param config The configuration holding the [Mock] section.
+		 */
+		replay_backend(ConfigMapping& config);
+
+		/**
+		 * @brief Loads a data log as the recording for one sensor.
+		 *
+		 * @return The number of readings loaded, or -1 if the file could
+		 * 	   not be read.
+		 */
+		int load(uint8_t sensor_index, const char *filename);
+
+		/**
+		 * @brief Loads one sensor's channel of a recording.
+		 *
+		 * @return The number of readings loaded, or -1 if the file could
+		 * 	   not be read or has no channel for the sensor.
+		 */
+		int loadRecording(uint8_t sensor_index, const char *filename);
+
+		uint16_t convert(uint8_t sensor_index, const adc_info &info) override;
+};
+
+/**
+ * @brief Gets the shared bcm2835_backend used by default-constructed
+ * 	  adc_readers.
+ */
+adc_backend *default_backend();
+
+/**
+ * @brief Creates the backend named by the backend key of the [Mock] section:
+ * 	  bus (bcm2835_backend), synthetic (the default) or replay.
+ *
+ * @return A new backend, owned by the caller.
+ */
+adc_backend *make_mock_backend(ConfigMapping& config);
+
+#endif
@@ -0,0 +1,100 @@
+/**
+ * @file calibration.hpp
+ * @brief Conversion of raw ADC readings to engineering units.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#ifndef __CALIBRATION_HPP
+#define __CALIBRATION_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "adc/adc.hpp"
+#include "config/config.hpp"
+
+// Calibration of the PTs when neither [Calibration] nor [Pressure] gives one
+#define CALIBRATION_DEFAULT_PT_SLOPE -0.3
+#define CALIBRATION_DEFAULT_PT_YINT 1108.1
+
+/*
+ * Format of Calibration in Config Files
+ * 	The [Calibration] section has a line per sensor,
+ *
+ * 	<sensor>=<slope>,<yint>
+ *
+ * 	e.g. PT1=0.378,-250.33, so a reading converts to reading * slope + yint.
+ * 	PTs without a line use pressure_slope and pressure_yint from [Pressure],
+ * 	and other sensors are left in raw ADC counts (slope 1, yint 0).
+ */
+
+/**
+ * @brief Converts a block of one sensor's raw readings with a linear
+ * 	  calibration, out[i] = raw[i] * slope + yint, with whichever of
+ * 	  calibrate_kernel() the build supports.
+ */
+void calibrate_block(const uint16_t *raw, float *out, size_t n, float slope,
+    float yint);
+
+/**
+ * @brief The plain C++ version of calibrate_block(), which the vector ones
+ * 	  must match.
+ */
+void calibrate_block_scalar(const uint16_t *raw, float *out, size_t n,
+    float slope, float yint);
+
+/**
+ * @brief Gets the name of the kernel behind calibrate_block(): "neon",
+ * 	  "avx2", "sse2" or "scalar". Chosen when compiling, e.g. AVX2 needs
+ * 	  -mavx2 and NEON on 32-bit ARM needs -mfpu=neon.
+ */
+const char *calibrate_kernel();
+
+/**
+ * @brief The calibration of every sensor.
+ */
+class calibration_table {
+	private:
+		float slopes[SENSOR::NUM_SENSORS];
+		float yints[SENSOR::NUM_SENSORS];
+
+	public:
+		/**
+		 * @brief The constructor for a table leaving every sensor in raw
+		 * 	  counts.
+		 */
+		calibration_table();
+
+		/**
+		 * @brief Sets the calibration of a sensor.
+		 */
+		void set(SENSOR sensor, float slope, float yint);
+
+		float getSlope(SENSOR sensor) const;
+
+		float getYint(SENSOR sensor) const;
+
+		/**
+		 * @brief Replaces the table with the one in the config (see the
+		 * 	  format above). Problems are printed.
+		 *
+		 * @return 0 on success, 1 if a line is malformed; the other
+		 * 	   sensors are still loaded.
+		 */
+		int load(ConfigMapping &config);
+
+		/**
+		 * @brief Converts one reading.
+		 */
+		float convert(SENSOR sensor, uint16_t raw) const;
+
+		/**
+		 * @brief Converts a block of one sensor's readings.
+		 */
+		void convert(SENSOR sensor, const uint16_t *raw, float *out, size_t n) const;
+};
+
+#endif
@@ -15,19 +15,19 @@
 #include <stdint.h>
 #include "time/time.hpp"
 #include "adc/adc.hpp"
+#include "circular_buffer/ring_buffer.hpp"
 
 /**
  * @brief The header of a packet that describes the type of
  * 	  sensor and number of following data_items.
  *
- * The valid field is 0 if the resulting bytes are valid and
- * -1 (all 1s in 2s complement) otherwise. It isn't super
- *  necessary but we have extra space anyways due to struct
- *  field padding.
+ * The seq field counts the packets of each sensor, wrapping at 256, so
+ * that a receiver can spot lost packets. It used to be a valid flag that
+ * was always 0.
  */
 struct data_header {
 	SENSOR sensor;
-	uint8_t valid;
+	uint8_t seq;
 	uint16_t length;
 };
 
@@ -35,12 +35,14 @@ struct data_header {
  * @brief A combination of an ADC reading and a timestamp of
  * 	  when the reading was taken.
  *
- * TODO use the pad for something useful. Maybe package multiple
- * readings into one data_item.
+ * seq counts the samples of each sensor. Consecutive samples have
+ * consecutive numbers, so a receiver can tell data lost on the way (a gap
+ * in seq) from a gap in sampling (a jump in timestamp).
  */
 struct data_item {
 	uint16_t reading;
-	uint8_t pad[6];
+	uint8_t pad[2];
+	uint32_t seq;
 	timestamp_t timestamp;
 };
 
@@ -54,30 +56,51 @@ enum class BUFF_STATUS {
 };
 
 /**
- * @brief A simple circular buffer for data_item structs. Intended only for a
- * 		  single thread--it is NOT thread-safe.
+ * @brief The packet layouts that can be produced.
+ *
+ * LEGACY:  a data_header followed by 16-byte data_items.
+ * COMPACT: a compact_header followed by the sample times and 12-bit readings
+ * 	    packed two to three bytes. See packet.hpp.
  */
-class circular_buffer {
+enum class PACKET_FORMAT {
+	LEGACY = 0,
+	COMPACT
+};
+
+/**
+ * @brief A circular buffer of data_item structs for one sensor, which packs
+ * 	  them into packets. Backed by a ring_buffer, so one thread can push
+ * 	  while another takes packets out, without locks.
+ */
+class circular_buffer : public cache_aligned {
 	private:
+		/** 
+		 * @brief The data_items this circular buffer stores.
+		 */
+		ring_buffer<data_item> items;
+
 		/**
-		 * @brief A pointer to the end of this circular buffer
+		 * @brief The layout of the packets made by get_data.
 		 */
-		struct data_item *end;
+		PACKET_FORMAT format;
 
-		/** 
-		 * @brief The array of data_items this circular buffer stores
+		/**
+		 * @brief Scratch space for the items of a compact packet.
 		 */
-		struct data_item *data;
+		struct data_item *staged;
 
 		/**
-		 * @brief A pointer to the head of this circular buffer.
+		 * @brief The longest an item may wait before the buffer is due to
+		 * 	  be flushed, in microseconds. 0 means only when full.
 		 */
-		struct data_item *head;
+		timestamp_t max_latency_us;
 
 		/**
-		 * @brief A pointer to the tail of this circular buffer.
+		 * @brief The number of the next packet and sample made by this
+		 * 	  buffer.
 		 */
-		struct data_item *tail;
+		uint32_t packet_seq;
+		uint32_t sample_seq;
 
 	public:
 		/* @brief The sensor type this circular buffer stores data for */
@@ -86,17 +109,24 @@ class circular_buffer {
 		/**
 		 * @brief The constructor for a circular buffer (one for each sensor).
 		 *
-		 * @param start_time_us The starting time offset in microseconds.
 		 * @param sensor The sensor associated with this circular buffer.
-		 * @param num_items The number of data_items this circular buffer should hold.
+		 * @param num_items The number of data_items this circular buffer
+		 * 	  should hold. Rounded up to a power of two.
+		 * @param format The layout of the packets made by get_data.
 		 */
-		circular_buffer(SENSOR sensor, uint16_t num_items);
+		circular_buffer(SENSOR sensor, uint16_t num_items,
+		    PACKET_FORMAT format = PACKET_FORMAT::LEGACY);
+
+		~circular_buffer();
 
 		/**
-		 * @brief Copies a header and new data into the provided buffer.
+		 * @brief Copies a header and new data into the provided buffer,
+		 * 	  in this buffer's packet format. Takes as many items as
+		 * 	  are guaranteed to fit.
 		 *
 		 * @param bufptr A pointer to a byte array that will be populated
 		 * 	         withd a new header and data.
+		 * @param size The size of the byte array.
 		 *
 		 * @return The number of bytes written to the buffer.
 		 */
@@ -107,15 +137,50 @@ class circular_buffer {
 		 *
 		 * @param reading The reading of the new data_item.
 		 * @param timestamp The timestamp of the new data_item.
+		 *
+		 * @return FULL if there was no room and the item was not stored,
+		 * 	   JUSTRIGHT otherwise.
 		 */
 		BUFF_STATUS push_data_item(uint16_t reading, timestamp_t timestamp);
 
 		/**
 		 * @brief Pops the next available item in the buffer.
 		 *
-		 * @return The item pointed to by the tail pointer.
+		 * @param item Where to copy the item to.
+		 *
+		 * @return EMPTY if there was no item to pop, JUSTRIGHT otherwise.
 		 */
 		BUFF_STATUS pop_data_item(uint8_t *item);
+
+		/**
+		 * @brief Sets how long an item may wait in the buffer before a
+		 * 	  partial packet should be sent, see due().
+		 *
+		 * @param max_latency_us The latency in microseconds, or 0 to only
+		 * 	  send full packets.
+		 */
+		void setMaxLatency(timestamp_t max_latency_us);
+
+		/**
+		 * @brief Checks whether the oldest item has waited out the maximum
+		 * 	  latency, so the buffer should be flushed even though it
+		 * 	  is not full. Must be called from the thread that takes
+		 * 	  packets out.
+		 *
+		 * @param now The current time, on the same clock as the item
+		 * 	  timestamps.
+		 */
+		bool due(timestamp_t now);
+
+		/**
+		 * @brief Gets the number of items waiting in the buffer.
+		 */
+		uint32_t size();
+
+		/**
+		 * @brief Gets the number of items the buffer can hold.
+		 */
+		uint32_t capacity();
 };
 
 #endif
@@ -0,0 +1,304 @@
+/**
+ * @file packet.hpp
+ * @brief Encoders and decoders for the packets of sensor data that are sent
+ * 	  and logged.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#ifndef __PACKET_HPP
+#define __PACKET_HPP
+
+#include <stdint.h>
+
+#include "adc/adc.hpp"
+#include "circular_buffer/circular_buffer.hpp"
+#include "time/time.hpp"
+
+// First byte of every compact packet. Never a valid SENSOR, which is the first
+// byte of a legacy packet.
+#define COMPACT_MAGIC 0xA5
+
+// Version of the compact layout written by this code
+#define COMPACT_VERSION 2
+
+// First byte of every calibrated packet, see calibrated_header
+#define CALIBRATED_MAGIC 0xA7
+
+// Version of the calibrated layout written by this code
+#define CALIBRATED_VERSION 1
+
+// First byte of every filtered packet, see filtered_header
+#define FILTERED_MAGIC 0xA8
+
+// Version of the filtered layout written by this code
+#define FILTERED_VERSION 1
+
+// First byte of every multi-sensor datagram, see frame_header
+#define FRAME_MAGIC 0xF5
+
+// Version of the datagram framing written by this code
+#define FRAME_VERSION 1
+
+// Largest UDP payload that fits in one Ethernet frame
+#define FRAME_ETHERNET_PAYLOAD 1472
+
+// Flags of a compact packet
+#define COMPACT_IMPLICIT_PERIOD	0x01	/* one u32 period instead of deltas */
+#define COMPACT_WIDE_DELTAS	0x02	/* s32 deltas instead of u16 */
+
+/**
+ * @brief The header of a compact packet.
+ *
+ * The header is followed by the time of every sample after the first, then
+ * the readings:
+ *
+ * 	- If COMPACT_IMPLICIT_PERIOD is set, one uint32_t period in
+ * 	  microseconds, and sample i was taken at base + i * period.
+ * 	- Otherwise count - 1 deltas from the previous sample, as uint16_t, or
+ * 	  as int32_t if COMPACT_WIDE_DELTAS is set (for long gaps, or when the
+ * 	  clock steps backwards).
+ * 	- The readings, 12 bits each, packed little-endian two per three bytes
+ * 	  (the last byte is half used when count is odd).
+ *
+ * length covers the whole packet, so packets can be written back to back in a
+ * log and read out again.
+ *
+ * seq counts the packets of each sensor and first_seq is the number of the
+ * first sample (see data_item). Version 1 packets end the header before seq,
+ * and are still read with both taken as 0.
+ */
+struct compact_header {
+	uint8_t magic;
+	uint8_t version;
+	uint8_t sensor;
+	uint8_t flags;
+	uint16_t length;
+	uint16_t count;
+	timestamp_t base;
+	uint32_t seq;
+	uint32_t first_seq;
+};
+
+/**
+ * @brief The header of a calibrated packet, which carries the readings of a
+ * 	  sensor's packet in engineering units.
+ *
+ * The header is followed by count readings as floats, converted with the
+ * calibration_table on board. Their times are in the legacy or compact packet
+ * with the same sensor and first_seq, which is sent just before.
+ */
+struct calibrated_header {
+	uint8_t magic;
+	uint8_t version;
+	uint8_t sensor;
+	uint8_t reserved;
+	uint16_t length;
+	uint16_t count;
+	uint32_t first_seq;
+};
+
+/**
+ * @brief The header of a filtered packet, which carries the outputs of a
+ * 	  sensor's filter_bank cascade.
+ *
+ * The header is followed by count outputs as floats, in engineering units.
+ * Output i came out of the filters at base + i * 1e6 / rate us, where base is
+ * the time of the reading that produced the first one. first_seq counts the
+ * sensor's outputs, so gaps show where packets were lost.
+ */
+struct filtered_header {
+	uint8_t magic;
+	uint8_t version;
+	uint8_t sensor;
+	uint8_t reserved;
+	uint16_t length;
+	uint16_t count;
+	timestamp_t base;
+	uint32_t first_seq;
+	float rate;
+};
+
+/**
+ * @brief The header of a datagram that carries packets from several sensors.
+ *
+ * The header is followed by num_sections sections, each a section_header and
+ * then one legacy or compact packet of length bytes.
+ */
+struct frame_header {
+	uint8_t magic;
+	uint8_t version;
+	uint16_t num_sections;
+};
+
+/**
+ * @brief The header of one sensor's section of a datagram.
+ */
+struct section_header {
+	SENSOR sensor;
+	uint8_t reserved;
+	uint16_t length;
+};
+
+/**
+ * @brief Packs packets from any number of sensors into a datagram of bounded
+ * 	  size.
+ */
+class frame_writer {
+	private:
+		/* @brief The datagram being written */
+		uint8_t *buf;
+
+		/* @brief The largest the datagram may grow, in bytes */
+		uint16_t size;
+
+		/* @brief The bytes written so far */
+		uint16_t used;
+
+	public:
+		/**
+		 * @brief Starts a new, empty datagram.
+		 *
+		 * @param buf Where to write the datagram.
+		 * @param size The size of buf, and so the largest datagram.
+		 */
+		void reset(uint8_t *buf, uint16_t size);
+
+		/**
+		 * @brief Appends a packet as a new section.
+		 *
+		 * @return false if the datagram has no room left for it.
+		 */
+		bool add(SENSOR sensor, const uint8_t *packet, uint16_t length);
+
+		/**
+		 * @brief Gets the number of sections in the datagram.
+		 */
+		uint16_t sections();
+
+		/**
+		 * @brief Gets the length of the datagram so far.
+		 */
+		uint16_t length();
+};
+
+/**
+ * @brief Splits a received datagram back into its sensors' packets. A datagram
+ * 	  holding a single packet of any kind is read as one section; one that
+ * 	  is not a sensor's, such as a valve state, has a sensor past
+ * 	  NUM_SENSORS.
+ */
+class frame_reader {
+	private:
+		const uint8_t *buf;
+		uint32_t size;
+		uint32_t offset;
+		uint16_t remaining;
+
+	public:
+		/**
+		 * @brief Starts reading a datagram.
+		 *
+		 * @return false if the datagram is malformed.
+		 */
+		bool reset(const uint8_t *buf, uint32_t size);
+
+		/**
+		 * @brief Gets the next section of the datagram.
+		 *
+		 * @param sensor Set to the sensor of the section.
+		 * @param packet Set to the start of the section's packet.
+		 * @param length Set to the length of the packet.
+		 *
+		 * @return false if there are no more sections, or the rest of the
+		 * 	   datagram is malformed.
+		 */
+		bool next(SENSOR *sensor, const uint8_t **packet, uint16_t *length);
+};
+
+/**
+ * @brief Parses a packet name from the config (legacy or compact).
+ *
+ * @return 0 on success, 1 if the name is not a known format.
+ */
+int parse_packet_format(const char *name, PACKET_FORMAT *format);
+
+/**
+ * @brief Gets the largest number of samples that are guaranteed to fit in a
+ * 	  packet of the given size, whatever their timestamps.
+ */
+uint16_t packet_capacity(PACKET_FORMAT format, uint16_t size);
+
+/**
+ * @brief Encodes samples of one sensor as a compact packet.
+ *
+ * @param sensor The sensor the samples were read from.
+ * @param seq The number of this packet among the sensor's packets.
+ * @param items The samples, oldest first, with consecutive seq numbers.
+ * @param count The number of samples. At most packet_capacity(COMPACT, size).
+ * @param buf Where to write the packet.
+ * @param size The size of buf.
+ *
+ * @return The length of the packet, or 0 if it did not fit or two samples
+ * 	   were too far apart in time to be encoded.
+ */
+uint16_t encode_compact(SENSOR sensor, uint32_t seq,
+    const struct data_item *items, uint16_t count, uint8_t *buf, uint16_t size);
+
+/**
+ * @brief Encodes a sensor's readings, already converted to engineering
+ * 	  units, as a calibrated packet.
+ *
+ * @param first_seq The number of the first sample.
+ *
+ * @return The length of the packet, or 0 if it did not fit.
+ */
+uint16_t encode_calibrated(SENSOR sensor, uint32_t first_seq,
+    const float *values, uint16_t count, uint8_t *buf, uint16_t size);
+
+/**
+ * @brief Encodes the outputs of a sensor's filters as a filtered packet.
+ *
+ * @param base The time of the reading that produced the first output.
+ * @param first_seq The number of the first output.
+ * @param rate The rate of the outputs, in Hz.
+ *
+ * @return The length of the packet, or 0 if it did not fit.
+ */
+uint16_t encode_filtered(SENSOR sensor, timestamp_t base, uint32_t first_seq,
+    float rate, const float *values, uint16_t count, uint8_t *buf, uint16_t size);
+
+/**
+ * @brief Decodes one legacy or compact packet.
+ *
+ * @param buf The start of the packet.
+ * @param size The number of bytes available at buf.
+ * @param sensor Set to the sensor of the packet.
+ * @param items Set to the samples in the packet, including their seq numbers.
+ * @param max_items The room in items.
+ * @param count Set to the number of samples decoded.
+ * @param seq If not NULL, set to the number of the packet. Legacy packets
+ * 	  only carry the low 8 bits.
+ *
+ * @return The length of the packet, or 0 if it is malformed, truncated or
+ * 	   holds more than max_items samples.
+ */
+uint16_t decode_packet(const uint8_t *buf, uint32_t size, SENSOR *sensor,
+    struct data_item *items, uint16_t max_items, uint16_t *count,
+    uint32_t *seq = NULL);
+
+/**
+ * @brief Gets the sample numbers a legacy or compact packet covers, without
+ * 	  decoding it.
+ *
+ * @param first Set to the number of the first sample.
+ * @param count Set to the number of samples.
+ *
+ * @return false if the packet is malformed or has no samples.
+ */
+bool packet_range(const uint8_t *buf, uint32_t size, uint32_t *first,
+    uint16_t *count);
+
+#endif
@@ -0,0 +1,302 @@
+/**
+ * @file ring_buffer.hpp
+ * @brief Lock-free single-producer/single-consumer ring buffer.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#ifndef __RING_BUFFER_HPP
+#define __RING_BUFFER_HPP
+
+#include <atomic>
+#include <new>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <type_traits>
+
+// Size of a cache line on the platforms we run on
+#define CACHE_LINE_SIZE 64
+
+/**
+ * @brief A base for classes with cache line aligned members, so that new
+ * 	  places them on a cache line boundary.
+ *
+ * Under C++11 the global operator new only aligns to 16 bytes, which would
+ * leave alignas(CACHE_LINE_SIZE) members sharing lines after all.
+ */
+struct cache_aligned {
+	static void *operator new(size_t size) {
+		void *mem;
+
+		if (posix_memalign(&mem, CACHE_LINE_SIZE, size) != 0)
+			throw std::bad_alloc();
+		return mem;
+	}
+
+	static void operator delete(void *mem) {
+		free(mem);
+	}
+};
+
+/**
+ * @brief A bounded ring buffer that hands items from exactly one producer
+ * 	  thread to exactly one consumer thread without locks.
+ *
+ * The capacity is rounded up to a power of two, so indexes are free-running
+ * 32-bit counters that are wrapped with a mask. The producer only writes
+ * head and the consumer only writes tail, and each lives on its own cache
+ * line, as does the storage.
+ *
+ * Items can be moved in bulk with push() and pop(), which copy a span with at
+ * most two memcpy calls, or one at a time in place with claim()/commit() on the
+ * producer side and peek()/release() on the consumer side. Neither side ever
+ * blocks: when the buffer is full the producer's write fails and is counted
+ * as a drop.
+ *
+ * T must be trivially copyable, since items are moved with memcpy.
+ */
+template <typename T>
+class ring_buffer : public cache_aligned {
+	static_assert(std::is_trivially_copyable<T>::value,
+		      "ring_buffer items are copied with memcpy");
+
+	private:
+		/**
+		 * @brief The storage for the items, aligned to a cache line.
+		 */
+		T *data;
+
+		/**
+		 * @brief The number of slots minus one, used to wrap indexes.
+		 */
+		uint32_t mask;
+
+		/**
+		 * @brief The total number of items ever pushed. Only written by
+		 * 	  the producer.
+		 */
+		alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> head;
+
+		/**
+		 * @brief The number of items the producer could not fit.
+		 */
+		std::atomic<uint64_t> drops;
+
+		/**
+		 * @brief The largest number of items ever waiting at once.
+		 */
+		std::atomic<uint32_t> max_depth;
+
+		/**
+		 * @brief The total number of items ever popped. Only written by
+		 * 	  the consumer.
+		 */
+		alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> tail;
+
+		/* Keep whatever follows off the consumer's cache line */
+		char pad[CACHE_LINE_SIZE - sizeof(std::atomic<uint32_t>)];
+
+		void note_depth(uint32_t depth) {
+			/* Only the producer writes max_depth */
+			if (depth > max_depth.load(std::memory_order_relaxed))
+				max_depth.store(depth, std::memory_order_relaxed);
+		}
+
+		ring_buffer(const ring_buffer&) = delete;
+		ring_buffer& operator=(const ring_buffer&) = delete;
+
+	public:
+		/**
+		 * @brief The constructor for a ring_buffer.
+		 *
+		 * @param capacity The minimum number of items the buffer can hold.
+		 */
+		ring_buffer(uint32_t capacity)
+			: head(0)
+			, drops(0)
+			, max_depth(0)
+			, tail(0)
+		{
+			uint32_t size = 1;
+			void *mem;
+
+			while (size < capacity)
+				size <<= 1;
+
+			if (posix_memalign(&mem, CACHE_LINE_SIZE, size * sizeof(T)) != 0)
+				throw std::bad_alloc();
+
+			data = (T *)mem;
+			mask = size - 1;
+		}
+
+		~ring_buffer() {
+			free(data);
+		}
+
+		/**
+		 * @brief Copies up to n items into the buffer. Producer only.
+		 *
+		 * @param items The items to push.
+		 * @param n The number of items.
+		 *
+		 * @return The number of items pushed. Any that did not fit are
+		 * 	   counted as drops.
+		 */
+		uint32_t push(const T *items, uint32_t n) {
+			uint32_t h = head.load(std::memory_order_relaxed);
+			uint32_t space = capacity() - (h - tail.load(std::memory_order_acquire));
+			uint32_t first, start = h & mask;
+
+			if (n > space) {
+				drops.fetch_add(n - space, std::memory_order_relaxed);
+				n = space;
+			}
+
+			/* Copy up to the end of the storage, then wrap to the start */
+			first = n < capacity() - start ? n : capacity() - start;
+			memcpy(data + start, items, first * sizeof(T));
+			memcpy(data, items + first, (n - first) * sizeof(T));
+
+			head.store(h + n, std::memory_order_release);
+			note_depth(capacity() - space + n);
+
+			return n;
+		}
+
+		/**
+		 * @brief Copies one item into the buffer. Producer only.
+		 *
+		 * @return true if the item was pushed, false (and a counted drop) if
+		 * 	   the buffer was full.
+		 */
+		bool push(const T &item) {
+			T *slot = claim();
+
+			if (slot == NULL)
+				return false;
+
+			*slot = item;
+			commit();
+			return true;
+		}
+
+		/**
+		 * @brief Copies up to n of the oldest items out of the buffer.
+		 * 	  Consumer only.
+		 *
+		 * @param items Where to copy the items; room for at least n.
+		 * @param n The largest number of items to pop.
+		 *
+		 * @return The number of items popped.
+		 */
+		uint32_t pop(T *items, uint32_t n) {
+			uint32_t t = tail.load(std::memory_order_relaxed);
+			uint32_t available = head.load(std::memory_order_acquire) - t;
+			uint32_t first, start = t & mask;
+
+			if (n > available)
+				n = available;
+
+			/* Copy up to the end of the storage, then wrap to the start */
+			first = n < capacity() - start ? n : capacity() - start;
+			memcpy(items, data + start, first * sizeof(T));
+			memcpy(items + first, data, (n - first) * sizeof(T));
+
+			tail.store(t + n, std::memory_order_release);
+
+			return n;
+		}
+
+		/**
+		 * @brief Claims the next free slot for the producer to fill in
+		 * 	  place.
+		 *
+		 * @return A pointer to the slot, or NULL (and a counted drop) if
+		 * 	   the buffer is full.
+		 */
+		T *claim() {
+			uint32_t h = head.load(std::memory_order_relaxed);
+			uint32_t depth = h - tail.load(std::memory_order_acquire);
+
+			if (depth > mask) {
+				drops.fetch_add(1, std::memory_order_relaxed);
+				return NULL;
+			}
+
+			note_depth(depth + 1);
+			return &data[h & mask];
+		}
+
+		/**
+		 * @brief Publishes the slot returned by the last claim() to the
+		 * 	  consumer.
+		 */
+		void commit() {
+			head.store(head.load(std::memory_order_relaxed) + 1,
+				   std::memory_order_release);
+		}
+
+		/**
+		 * @brief Gets a waiting item for the consumer to use in place.
+		 *
+		 * @param offset Which item to get, 0 being the oldest.
+		 *
+		 * @return A pointer to the item, or NULL if fewer than offset + 1
+		 * 	   items are waiting.
+		 */
+		T *peek(uint32_t offset = 0) {
+			uint32_t t = tail.load(std::memory_order_relaxed);
+
+			if (head.load(std::memory_order_acquire) - t <= offset)
+				return NULL;
+
+			return &data[(t + offset) & mask];
+		}
+
+		/**
+		 * @brief Frees the oldest n slots, which the consumer got from
+		 * 	  peek(), so the producer can reuse them.
+		 */
+		void release(uint32_t n = 1) {
+			tail.store(tail.load(std::memory_order_relaxed) + n,
+				   std::memory_order_release);
+		}
+
+		/**
+		 * @brief Gets the number of items currently waiting. Exact from the
+		 * 	  producer or consumer thread, approximate from any other.
+		 */
+		uint32_t size() {
+			return head.load(std::memory_order_acquire) -
+			       tail.load(std::memory_order_acquire);
+		}
+
+		/**
+		 * @brief Gets the number of slots in the buffer.
+		 */
+		uint32_t capacity() {
+			return mask + 1;
+		}
+
+		/**
+		 * @brief Gets the number of items dropped because the buffer was
+		 * 	  full.
+		 */
+		uint64_t getDrops() {
+			return drops.load(std::memory_order_relaxed);
+		}
+
+		/**
+		 * @brief Gets the largest number of items that have been waiting at
+		 * 	  once.
+		 */
+		uint32_t getMaxDepth() {
+			return max_depth.load(std::memory_order_relaxed);
+		}
+};
+
+#endif
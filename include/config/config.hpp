@@ -153,6 +153,17 @@ class ConfigMapping {
 		 * @return 1 on error (i.e. if the key is not found), 0 otherwise
 		 */
 		uint8_t getVector(const char* section, const char* key, std::vector<uint32_t>* dest);
+
+		/**
+		 * @brief Get every value of a key that is given more than once, as
+		 * 		  strings, in the order they appear in the file.
+		 * 
+		 * @param section the section from which to get the values
+		 * @param key 	  the key corresponding to the desired values
+		 * @param dest 	  a vector address onto which to append the values
+		 * @return 1 on error (i.e. if the key is not found), 0 otherwise
+		 */
+		uint8_t getStrings(const char* section, const char* key, std::vector<std::string>* dest);
 };
 
 #endif
@@ -0,0 +1,206 @@
+/**
+ * @file decoder.hpp
+ * @brief Decodes recorded data for analysis after a test.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#ifndef __DECODER_HPP
+#define __DECODER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+#include "adc/adc.hpp"
+#include "recorder/recorder.hpp"
+#include "time/time.hpp"
+
+class calibration_table;
+
+// First word and version of a columnar export
+#define DECODE_COLUMNS_MAGIC 0x4C4F4352		/* "RCOL" */
+#define DECODE_COLUMNS_VERSION 1
+
+// The sensor of a row decoded from a valve state packet
+#define DECODE_VALVES 0xFF
+
+// Longest a packet may be recorded after its first sample, in us. A packet
+// fills over its sensor's period times its samples, or its max latency, then
+// waits for the I/O thread's batch window, so a block recorded up to this
+// long after a window may still hold samples from inside it.
+#define DECODE_LATE_US 10000000
+
+// Most samples in one packet
+#define DECODE_MAX_ITEMS 1024
+
+/*
+ * Layout of a Columnar Export
+ * 	A decode_columns_header, then each column of num_rows values one after
+ * 	another, in the order of the header's fields: sensor (u8), seq (u32),
+ * 	time_us (u64), raw (u32), value (f32). Little endian, with no padding,
+ * 	so e.g. numpy.fromfile() can read each column at its offset.
+ */
+
+/**
+ * @brief The start of a columnar export.
+ */
+struct decode_columns_header {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t num_rows;
+};
+
+/**
+ * @brief One decoded sample.
+ *
+ * Rows from valve state packets have sensor DECODE_VALVES, the number of
+ * valve updates as seq, when they were last changed as time_us, and the
+ * levels of every pin as raw and value.
+ */
+struct decoded_sample {
+	timestamp_t time_us;
+	uint32_t seq;
+	uint32_t raw;
+	float value;
+	uint8_t sensor;
+};
+
+/**
+ * @brief Where one block of a recording is, and what it covers.
+ */
+struct decode_block {
+	uint64_t offset;
+	uint32_t length;
+	uint32_t channels;
+	timestamp_t first_us;
+	timestamp_t last_us;
+};
+
+/**
+ * @brief What to decode and how.
+ */
+struct decode_options {
+	/* @brief The window of sample times to keep, in us since start */
+	timestamp_t from_us;
+	timestamp_t to_us;
+
+	/* @brief Bit n is set to keep sensor n */
+	uint32_t sensors;
+
+	/* @brief Whether to keep the valve states too */
+	bool valves;
+
+	/* @brief The threads to decode with, or 0 for one per core */
+	unsigned threads;
+
+	/* @brief How to convert readings, or NULL to leave them raw */
+	const calibration_table *calibration;
+
+	decode_options();
+};
+
+/**
+ * @brief A recording, or an older log of one sensor's packets, mapped into
+ * 	  memory.
+ *
+ * The blocks of a recording are found from its index if it was closed, or
+ * by walking the block headers otherwise. Either way only the headers are
+ * touched, so opening a long recording is quick. An older log has no blocks
+ * or times and is decoded whole.
+ */
+class recorded_log {
+	private:
+		int fd;
+
+		const uint8_t *data;
+		size_t size;
+
+		/* @brief The header, or NULL for an older log */
+		const recording_header *header;
+
+		std::vector<decode_block> blocks;
+
+		/* @brief The sensor carried by each channel, or DECODE_VALVES, or
+		 * 	  NUM_SENSORS for one that is not known */
+		uint8_t channel_sensors[RECORDER_MAX_CHANNELS];
+
+		recorded_log(const recorded_log&) = delete;
+		recorded_log& operator=(const recorded_log&) = delete;
+
+		/**
+		 * @brief Decodes the records of some blocks, skipping blocks
+		 * 	  and records of channels not wanted.
+		 *
+		 * @param wanted bit n set if channel n is to be decoded
+		 */
+		void decodeBlocks(size_t first, size_t last, uint32_t wanted,
+		    const decode_options &options, std::vector<decoded_sample> *out) const;
+
+		/**
+		 * @brief Decodes an older log, a packet at a time.
+		 */
+		void decodeLegacy(const decode_options &options,
+		    std::vector<decoded_sample> *out) const;
+
+	public:
+		recorded_log();
+
+		~recorded_log();
+
+		/**
+		 * @brief Maps a recording or older log.
+		 *
+		 * @return 0 on success, -1 if the file cannot be read or is not
+		 * 	   a recording and does not start with a packet.
+		 */
+		int open(const char *path);
+
+		/**
+		 * @brief Checks whether the file is a recording rather than an
+		 * 	  older log.
+		 */
+		bool isRecording() const;
+
+		/**
+		 * @brief Gets the blocks of a recording, in order.
+		 */
+		const std::vector<decode_block> &getBlocks() const;
+
+		/**
+		 * @brief Finds the first block that may hold samples from time_us
+		 * 	  on, by binary search of the blocks' times.
+		 *
+		 * @return Its position in getBlocks(), or the number of blocks if
+		 * 	   none can.
+		 */
+		size_t seek(timestamp_t time_us) const;
+
+		/**
+		 * @brief Decodes the samples in the options' window, splitting the
+		 * 	  blocks between threads. Each sensor's samples come out in
+		 * 	  order.
+		 *
+		 * @return The number of samples decoded.
+		 */
+		size_t decode(const decode_options &options, std::vector<decoded_sample> *out) const;
+};
+
+/**
+ * @brief Writes samples as CSV, a header line and then one line per sample.
+ *
+ * @return 0 on success, -1 if the file could not be written.
+ */
+int write_csv(FILE *file, const std::vector<decoded_sample> &samples);
+
+/**
+ * @brief Writes samples in the columnar layout above.
+ *
+ * @return 0 on success, -1 if the file could not be written.
+ */
+int write_columns(FILE *file, const std::vector<decoded_sample> &samples);
+
+#endif
@@ -0,0 +1,268 @@
+/**
+ * @file filter_bank.hpp
+ * @brief Per-sensor cascades of digital filters run on every sample.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#ifndef __FILTER_BANK_HPP
+#define __FILTER_BANK_HPP
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "adc/adc.hpp"
+#include "calibration/calibration.hpp"
+#include "config/config.hpp"
+
+// Most stages in one sensor's cascade
+#define FILTER_MAX_STAGES 8
+
+// Longest median window; the median is kept sorted, so a sample costs
+// O(window)
+#define FILTER_MAX_MEDIAN 31
+
+// Longest moving average window and FIR filter
+#define FILTER_MAX_WINDOW 1024
+
+// Largest decimation of one FIR stage
+#define FILTER_MAX_DECIMATION 64
+
+// Q of a lowpass stage that does not give one, a Butterworth response
+#define FILTER_DEFAULT_Q 0.7071
+
+/*
+ * Format of Filters in Config Files
+ * 	The [Filter] section has a line per filtered sensor, listing its
+ * 	stages in the order they run,
+ *
+ * 	<sensor>=<stage>[,<stage>...]
+ *
+ * 	where a stage is one of
+ *
+ * 	median:<n>		median of the last n samples (n odd), which
+ * 				rejects spikes up to n / 2 samples long
+ * 	average:<n>		mean of the last n samples
+ * 	lowpass:<hz>[:<q>]	second order IIR (biquad) lowpass at hz
+ * 	fir:<taps>:<m>		windowed-sinc FIR lowpass keeping every m-th
+ * 				output, so later stages run at rate / m
+ *
+ * 	e.g. PT1=median:5,lowpass:50. Cutoffs are in Hz and designed for the
+ * 	sensor's rate in SENSOR_FREQS (after any [Rates] override and earlier
+ * 	decimation), so changing a rate does not change a filter's response.
+ *
+ * 	Every stage has unity gain at DC, so the output is converted with the
+ * 	sensor's calibration (see calibration.hpp) like a single reading.
+ */
+
+/**
+ * @brief The kinds of stage.
+ */
+enum FILTER_TYPE: uint8_t {
+	FILTER_MEDIAN = 0,
+	FILTER_AVERAGE,
+	FILTER_LOWPASS,
+	FILTER_FIR
+};
+
+/**
+ * @brief One stage of a cascade. Its window and coefficients live in the
+ * 	  bank's shared arrays, so a sensor's whole cascade sits in a few
+ * 	  adjacent cache lines.
+ */
+struct filter_stage {
+	/* @brief The running sum of a moving average */
+	double sum;
+
+	/* @brief Where the stage's state and coefficients start in
+	 * 	  filter_bank::state and filter_bank::coeffs */
+	uint32_t state;
+	uint32_t coeffs;
+
+	/* @brief The window or number of taps */
+	uint16_t length;
+
+	/* @brief The next slot of the window to write */
+	uint16_t pos;
+
+	/* @brief Samples in the window so far, until it is full, or 1 once a
+	 * 	  lowpass or FIR has been primed with its first sample */
+	uint16_t filled;
+
+	/* @brief A FIR keeps one output every decimation inputs, counted by
+	 * 	  phase */
+	uint8_t decimation;
+	uint8_t phase;
+
+	uint8_t sensor;
+	uint8_t type;
+};
+
+/**
+ * @brief The filters of every sensor.
+ *
+ * Stages are kept in one table sorted by sensor, like the interlock terms, and
+ * all their sample windows in one array of floats, so filtering a sample only
+ * walks its own sensor's stages and state. Windows are filled from the first
+ * sample instead of starting at zero, so outputs are valid from the start.
+ */
+class filter_bank {
+	private:
+		std::vector<filter_stage> stages;
+
+		/**
+		 * @brief The stages of sensor s are [first[s], first[s + 1]).
+		 */
+		uint16_t first[SENSOR::NUM_SENSORS + 1];
+
+		/**
+		 * @brief The windows and delay lines of every stage.
+		 */
+		std::vector<float> state;
+
+		/**
+		 * @brief The taps of every FIR stage and the coefficients of every
+		 * 	  lowpass.
+		 */
+		std::vector<float> coeffs;
+
+		/**
+		 * @brief The rate the next stage added to a sensor runs at.
+		 */
+		double rates[SENSOR::NUM_SENSORS];
+
+		/**
+		 * @brief The inputs per output of each sensor's whole cascade.
+		 */
+		uint32_t decimations[SENSOR::NUM_SENSORS];
+
+		/**
+		 * @brief The calibration the outputs are converted with.
+		 */
+		float slopes[SENSOR::NUM_SENSORS];
+		float yints[SENSOR::NUM_SENSORS];
+
+		/**
+		 * @brief What each sensor's cascade does, for the log.
+		 */
+		std::string descriptions[SENSOR::NUM_SENSORS];
+
+		/**
+		 * @brief Adds a stage to the end of a sensor's cascade, with room
+		 * 	  for its state and coefficients.
+		 *
+		 * @return The stage, or NULL if the cascade is full.
+		 */
+		filter_stage *push(SENSOR sensor, FILTER_TYPE type, uint16_t length,
+		    uint32_t num_state, uint32_t num_coeffs);
+
+		/**
+		 * @brief Removes every stage of a sensor.
+		 */
+		void clear(SENSOR sensor);
+
+		/**
+		 * @brief Parses and adds one stage.
+		 *
+		 * @return 0 on success, 1 if it is malformed.
+		 */
+		int parse(SENSOR sensor, const char *stage);
+
+	public:
+		/**
+		 * @brief The constructor for a bank that passes every sensor
+		 * 	  through unfiltered, in raw counts.
+		 */
+		filter_bank();
+
+		/**
+		 * @brief Sets the calibration the outputs of a sensor are
+		 * 	  converted with.
+		 */
+		void setCalibration(SENSOR sensor, float slope, float yint);
+
+		/**
+		 * @brief Adds a median stage to a sensor's cascade.
+		 *
+		 * @return 0 on success, 1 if the window is not odd and at most
+		 * 	   FILTER_MAX_MEDIAN, or the cascade is full.
+		 */
+		int addMedian(SENSOR sensor, uint16_t window);
+
+		/**
+		 * @brief Adds a moving average stage to a sensor's cascade.
+		 */
+		int addAverage(SENSOR sensor, uint16_t window);
+
+		/**
+		 * @brief Adds a biquad lowpass stage to a sensor's cascade,
+		 * 	  designed for the rate the stage will run at.
+		 *
+		 * @return 0 on success, 1 if the cutoff is not below half that
+		 * 	   rate or q is not positive.
+		 */
+		int addLowpass(SENSOR sensor, double cutoff_hz, double q = FILTER_DEFAULT_Q);
+
+		/**
+		 * @brief Adds a decimating FIR lowpass stage to a sensor's
+		 * 	  cascade, with its cutoff at the new Nyquist rate.
+		 *
+		 * @param taps the number of taps
+		 * @param decimation keep one output every decimation inputs
+		 */
+		int addFir(SENSOR sensor, uint16_t taps, uint8_t decimation);
+
+		/**
+		 * @brief Replaces the filters with the ones in the config (see the
+		 * 	  format above), after SENSOR_FREQS is final. Problems are
+		 * 	  printed.
+		 *
+		 * @return 0 on success, 1 if a line is malformed; that sensor is
+		 * 	   left unfiltered and the others are still loaded.
+		 */
+		int load(ConfigMapping &config, const calibration_table &calibration);
+
+		/**
+		 * @brief Runs a new sample through its sensor's cascade. Each
+		 * 	  sensor must only be filtered by one thread.
+		 *
+		 * @param sensor the sensor it was read from
+		 * @param reading the raw reading
+		 * @param output set to the calibrated output
+		 *
+		 * @return false if a decimating stage held the sample back and
+		 * 	   there is no new output.
+		 */
+		bool process(SENSOR sensor, uint16_t reading, float *output);
+
+		/**
+		 * @brief Empties every window, as if no samples had been seen.
+		 */
+		void reset();
+
+		/**
+		 * @brief Checks whether a sensor has any stages.
+		 */
+		bool filtered(SENSOR sensor);
+
+		/**
+		 * @brief Gets the number of inputs per output of a sensor.
+		 */
+		uint32_t getDecimation(SENSOR sensor);
+
+		/**
+		 * @brief Gets the rate of a sensor's outputs, in Hz.
+		 */
+		double getRate(SENSOR sensor);
+
+		/**
+		 * @brief Gets what a sensor's cascade does, e.g.
+		 * 	  "median 5, lowpass 50 Hz".
+		 */
+		const char *describe(SENSOR sensor);
+};
+
+#endif
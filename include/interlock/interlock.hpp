@@ -0,0 +1,295 @@
+/**
+ * @file interlock.hpp
+ * @brief Safety rules checked against every sample as it is read.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#ifndef __INTERLOCK_HPP
+#define __INTERLOCK_HPP
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "adc/adc.hpp"
+#include "calibration/calibration.hpp"
+#include "config/config.hpp"
+#include "sequencer/sequencer.hpp"
+#include "sequencer/wakeup.hpp"
+#include "time/time.hpp"
+
+// Most rules, so the tripped ones fit in one word
+#define INTERLOCK_MAX_RULES 32
+
+// Limits used when the config has no [Interlock] rules and [Pressure] leaves
+// some out
+#define INTERLOCK_DEFAULT_PRESSURE_MAX 800
+#define INTERLOCK_DEFAULT_PRESSURE_MIN 300
+
+// Smoothing of the legacy PT1 pressure check
+#define INTERLOCK_LEGACY_EMA 0.05
+
+/*
+ * Format of Rules in Config Files
+ * 	Rules are lines in the [Interlock] section, one of
+ *
+ * 	above=<sensors>,<limit>[,<persist>[,<ema>]]
+ * 	below=<sensors>,<limit>[,<persist>[,<ema>]]
+ * 	rate=<sensors>,<limit>[,<persist>[,<ema>]]
+ *
+ * 	above and below check the reading against limit, and rate checks how
+ * 	fast it changes, in either direction, against limit per second. All are
+ * 	in calibrated units. sensors is a single sensor, e.g. PT1, a list like
+ * 	PT1+PT2, which trips when any of them fails, or a vote like
+ * 	2/PT1+PT2+PT3+PT4, which trips when at least 2 of the 4 fail. A
+ * 	sensor only fails once the check has failed persist samples in a row
+ * 	(default 1). If ema is given, e.g. 0.05, readings are smoothed with that
+ * 	weight before being checked. A sensor written PT1.filtered is checked on
+ * 	the outputs of its [Filter] cascade (see filter_bank.hpp) instead of
+ * 	every raw reading.
+ *
+ * 	Readings are calibrated by the calibration_table the rules are loaded
+ * 	with (see calibration.hpp). Without any rules, pressure_max and
+ * 	pressure_min from [Pressure] are checked against PT1, smoothed by
+ * 	INTERLOCK_LEGACY_EMA, as before.
+ */
+
+/**
+ * @brief What a rule checks.
+ */
+enum INTERLOCK_CHECK: uint8_t {
+	INTERLOCK_ABOVE = 0,
+	INTERLOCK_BELOW,
+	INTERLOCK_RATE
+};
+
+/**
+ * @brief One sensor's check in a rule, with everything needed to evaluate it
+ * 	  in one place. The limit is in raw ADC counts, converted from
+ * 	  calibrated units once when the rule is added, except on filtered
+ * 	  outputs, which are already calibrated.
+ */
+struct interlock_term {
+	/* @brief The limit in the units of the readings, per second for RATE */
+	double limit;
+
+	/* @brief The smoothing weight of a new reading, or 0 for none */
+	double alpha;
+
+	/* @brief The smoothed reading */
+	double value;
+
+	/* @brief The smoothed reading and its time at the previous sample */
+	double last;
+	timestamp_t last_us;
+
+	/* @brief The failing samples in a row needed to fail */
+	uint16_t persist;
+
+	/* @brief The failing samples in a row so far */
+	uint16_t run;
+
+	uint8_t sensor;
+	uint8_t check;
+
+	/* @brief The index of the rule this is part of */
+	uint8_t rule;
+
+	/* @brief Whether the term checks the sensor's filtered outputs */
+	bool filtered;
+
+	/* @brief Whether a reading has been seen yet */
+	bool primed;
+
+	/* @brief Whether the check has failed for persist samples */
+	bool failing;
+};
+
+/**
+ * @brief The vote of one rule's terms.
+ */
+struct interlock_rule {
+	/* @brief The failing terms needed to trip */
+	uint8_t needed;
+
+	/* @brief The terms failing now */
+	uint8_t failing;
+};
+
+/**
+ * @brief Evaluates the safety rules inline, as the acquisition thread reads
+ * 	  each sample.
+ *
+ * The rules are compiled into a flat table of terms sorted by sensor, raw
+ * terms before filtered ones, so a sample only touches the terms of its own
+ * sensor and the check itself is a
+ * few arithmetic operations on the raw reading.
+ *
+ * Trips are published without locks: the tripped rules are an atomic mask,
+ * and while any rule is tripped the shutoff flag is set. The wakeup is
+ * notified as soon as the first rule trips, so the ignition thread acts on it
+ * at once, and any sequence being played is aborted from the evaluating
+ * thread itself, so its safe state is written without waiting on another.
+ * No sequence can start again until every rule clears.
+ */
+class interlock {
+	private:
+		/**
+		 * @brief The terms, sorted by sensor and then filtered.
+		 */
+		std::vector<interlock_term> terms;
+
+		/**
+		 * @brief The raw terms of sensor s are [first[2s], first[2s + 1])
+		 * 	  and its filtered ones [first[2s + 1], first[2s + 2]).
+		 */
+		uint16_t first[2 * SENSOR::NUM_SENSORS + 1];
+
+		std::vector<interlock_rule> rules;
+
+		/**
+		 * @brief What each rule checks, for the log.
+		 */
+		std::vector<std::string> descriptions;
+
+		/**
+		 * @brief The calibration of every sensor, reading * slope + yint.
+		 */
+		double slopes[SENSOR::NUM_SENSORS];
+		double yints[SENSOR::NUM_SENSORS];
+
+		/**
+		 * @brief Bit n is set while rule n is tripped.
+		 */
+		std::atomic<uint32_t> tripped;
+
+		/**
+		 * @brief The number of times any rule has tripped.
+		 */
+		std::atomic<uint32_t> trips;
+
+		/**
+		 * @brief Set while any rule is tripped, or NULL.
+		 */
+		std::atomic<bool> *shutoff;
+
+		/**
+		 * @brief Notified when the first rule trips, or NULL.
+		 */
+		wakeup *wake;
+
+		/**
+		 * @brief Aborted when a rule trips, or NULL.
+		 */
+		std::atomic<sequencer *> runner;
+
+		/**
+		 * @brief Parses and adds one rule line.
+		 *
+		 * @return 0 on success, 1 if it is malformed.
+		 */
+		int parse(INTERLOCK_CHECK check, const char *line);
+
+	public:
+		/**
+		 * @brief The constructor for an interlock with no rules.
+		 *
+		 * @param shutoff set while any rule is tripped, or NULL
+		 * @param wake notified when the first rule trips, or NULL
+		 */
+		interlock(std::atomic<bool> *shutoff = NULL, wakeup *wake = NULL);
+
+		/**
+		 * @brief Sets how a sensor's readings are converted to the units
+		 * 	  of its limits. Only affects rules added afterwards.
+		 */
+		void setCalibration(SENSOR sensor, double slope, double yint);
+
+		/**
+		 * @brief Sets the sequencer whose sequence is aborted whenever a
+		 * 	  rule trips, and which is held from starting another while
+		 * 	  any rule is tripped, or NULL for none. May be called while
+		 * 	  another thread is evaluating samples.
+		 */
+		void setSequencer(sequencer *runner);
+
+		/**
+		 * @brief Adds a rule.
+		 *
+		 * @param check what to check
+		 * @param sensors the sensors to check
+		 * @param num_sensors the number of sensors
+		 * @param needed how many of the sensors must fail to trip
+		 * @param limit the limit in calibrated units, per second for RATE
+		 * @param persist the failing samples in a row for a sensor to fail
+		 * @param alpha the smoothing weight of a new reading, or 0 for none
+		 * @param filtered for each sensor, whether to check its filtered
+		 * 	  outputs, or NULL to check every sensor's raw readings
+		 *
+		 * @return 0 on success, 1 if the rule is invalid or there are
+		 * 	   already INTERLOCK_MAX_RULES.
+		 */
+		int add(INTERLOCK_CHECK check, const SENSOR *sensors, uint8_t num_sensors,
+		    uint8_t needed, double limit, uint16_t persist = 1, double alpha = 0,
+		    const bool *filtered = NULL);
+
+		/**
+		 * @brief Replaces the rules with the ones in the config (see the
+		 * 	  format above). Problems are printed.
+		 *
+		 * @param calibration how readings convert to the units of the
+		 * 	  limits
+		 *
+		 * @return 0 on success, 1 if a line is malformed; the other rules
+		 * 	   are still loaded.
+		 */
+		int load(ConfigMapping &config, const calibration_table &calibration);
+
+		/**
+		 * @brief Checks a new sample against the rules. Only one thread
+		 * 	  may call this.
+		 *
+		 * @param sensor the sensor it was read from
+		 * @param reading the raw reading, or the calibrated output of the
+		 * 	  sensor's filters
+		 * @param timestamp when it was read, in us
+		 * @param filtered whether reading is a filtered output
+		 *
+		 * @return true if whether any rule is tripped changed.
+		 */
+		bool evaluate(SENSOR sensor, float reading, timestamp_t timestamp,
+		    bool filtered = false);
+
+		/**
+		 * @brief Gets the rules tripped now, bit n for rule n.
+		 */
+		uint32_t getTripped();
+
+		/**
+		 * @brief Gets the number of times any rule has tripped.
+		 */
+		uint32_t getTrips();
+
+		/**
+		 * @brief Gets the number of rules.
+		 */
+		size_t size();
+
+		/**
+		 * @brief Gets what a rule checks, e.g. "PT1 above 800, ema 0.05".
+		 */
+		const char *describe(size_t rule);
+};
+
+/**
+ * @brief Looks up a sensor by its name in SENSOR_NAMES, e.g. PT1.
+ *
+ * @return 0 on success, 1 if the name is not a known sensor.
+ */
+int parse_sensor(const char *name, SENSOR *sensor);
+
+#endif
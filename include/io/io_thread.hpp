@@ -0,0 +1,394 @@
+/**
+ * @file io_thread.hpp
+ * @brief Thread that writes sampled data to disk and the network.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#ifndef __IO_THREAD_HPP
+#define __IO_THREAD_HPP
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "adc/adc.hpp"
+#include "circular_buffer/ring_buffer.hpp"
+#include "logger/logger.hpp"
+#include "networking/Udp.hpp"
+#include "recorder/recorder.hpp"
+
+// Largest packet that can be handed to the I/O thread, in bytes
+#define IO_PACKET_SIZE 260
+
+// Number of packets each sampling thread can have waiting for the I/O thread
+#define IO_QUEUE_CAPACITY 256
+
+// Default time the I/O thread lets packets collect between sends, in
+// microseconds
+#define IO_BATCH_WINDOW_US 2000
+
+// Most packets sent by one pass over the queues
+#define IO_MAX_BATCH UDP_MAX_BATCH
+
+// Time between reports of the send counters, in seconds
+#define IO_REPORT_INTERVAL_S 10
+
+// Default number of sent packets kept for retransmission
+#define IO_HISTORY_PACKETS 4096
+
+// Longest time between valve state packets when the valves are not changing,
+// in seconds
+#define IO_VALVE_INTERVAL_S 1
+
+// Most readings of one packet converted to engineering units
+#define IO_CALIBRATED_ITEMS 64
+
+// The recording channel of the valve state packets. Each sensor's packets go
+// in the channel numbered by the sensor.
+#define IO_VALVE_CHANNEL SENSOR::NUM_SENSORS
+
+class calibration_table;
+class retransmit_cache;
+class valve_state;
+
+/**
+ * @brief A finished packet of sensor data waiting to be logged and sent.
+ */
+struct io_packet {
+	SENSOR sensor;
+	uint16_t length;
+	uint8_t data[IO_PACKET_SIZE];
+};
+
+/**
+ * @brief A snapshot of the I/O thread's counters.
+ */
+struct io_stats {
+	/* @brief Packets written to the recording */
+	uint64_t packets_written;
+
+	/* @brief Packets sent over UDP */
+	uint64_t packets_sent;
+
+	/* @brief Packets that could not be sent over UDP */
+	uint64_t send_failures;
+
+	/* @brief Datagrams sent over UDP, which hold one or more packets */
+	uint64_t datagrams_sent;
+
+	/* @brief sendmmsg() syscalls made */
+	uint64_t send_calls;
+
+	/* @brief Bytes sent over UDP */
+	uint64_t bytes_sent;
+
+	/* @brief Packets dropped because a queue was full, over all queues */
+	uint64_t drops;
+
+	/* @brief Packets currently waiting, over all queues */
+	uint32_t depth;
+
+	/* @brief The deepest any single queue has been */
+	uint32_t max_depth;
+};
+
+/**
+ * @brief One sensor's readings in engineering units since the last report.
+ */
+struct io_summary {
+	float min;
+	float max;
+	double total;
+	uint64_t count;
+};
+
+/**
+ * @brief Something with counters of its own, e.g. a sampling thread, that are
+ * 	  logged with the I/O thread's periodic report.
+ */
+class io_reporter {
+	public:
+		virtual ~io_reporter() {}
+
+		/**
+		 * @brief Log the counters. Called from the I/O thread every
+		 * 	  IO_REPORT_INTERVAL_S seconds.
+		 *
+		 * @param elapsed_s the time since the last report
+		 */
+		virtual void report(Logger *log, double elapsed_s) = 0;
+};
+
+/**
+ * @brief A single thread that drains the packet queues of the sampling threads
+ * 	  and performs all of the blocking I/O for them, so a slow disk or
+ * 	  network never delays an ADC read.
+ *
+ * Each sampling thread gets its own ring_buffer from addQueue() before the
+ * I/O thread is started. The sampling thread is the only producer for its
+ * queue and the I/O thread is the only consumer.
+ *
+ * Once per batch window the I/O thread logs everything waiting in the queues
+ * and sends it with a single sendmmsg() syscall, rather than one sendto() per
+ * packet. Optionally, the packets are also packed several to a datagram.
+ *
+ * Sent packets are kept in a bounded history, so the ground station can ask
+ * for the samples it missed again with resend().
+ *
+ * If given a calibration_table, the thread converts every packet's readings to
+ * engineering units, a block at a time, to report each sensor's minimum, mean
+ * and maximum with the send counters, and optionally to send them as
+ * calibrated packets right after the raw ones.
+ *
+ * Every packet is also appended to one recording in the log directory, with a
+ * channel for each sensor and one for the valves. The recorder writes whole
+ * RECORDER_BLOCK_SIZE blocks, so the disk sees one write per block rather than
+ * one per packet per sensor; the partly filled block is written out every
+ * RECORDER_SYNC_INTERVAL_MS so little is lost on a power cut. With
+ * setStorage() the blocks can bypass the page cache and be written by a
+ * writer thread or io_uring, so writeback never stalls the I/O thread.
+ *
+ * If given the valve_state, the thread also sends and records a valve_packet as
+ * soon as it sees the valves change, and every IO_VALVE_INTERVAL_S seconds
+ * otherwise.
+ */
+class IoThread {
+	private:
+		/**
+		 * @brief The actual thread for this instance. Detached from the main
+		 * 		  process.
+		 */
+		std::thread core_thread;
+
+		/**
+		 * @brief The queues registered by the sampling threads.
+		 */
+		std::vector<ring_buffer<io_packet> *> queues;
+
+		/**
+		 * @brief What else is logged with each report.
+		 */
+		std::vector<io_reporter *> reporters;
+
+		/**
+		 * @brief The recording of every packet, one channel per sensor
+		 * 	  plus one for the valves.
+		 */
+		recorder recording;
+
+		/**
+		 * @brief Whether each sensor has a queue, so its packets are
+		 * 	  recorded.
+		 */
+		bool recorded[SENSOR::NUM_SENSORS];
+
+		/**
+		 * @brief How the recording is written, and with how many buffers.
+		 */
+		STORAGE_MODE storage_mode;
+		uint32_t storage_buffers;
+
+		/**
+		 * @brief The UDP output socket through which data will be sent as it
+		 *        is logged.
+		 */
+		Udp::OutSocket *sock;
+
+		/**
+		 * @brief How long packets collect between passes over the queues,
+		 * 	  in microseconds.
+		 */
+		uint32_t batch_window_us;
+
+		/**
+		 * @brief The largest datagram to pack packets into, in bytes, or 0
+		 * 	  to send every packet as its own datagram.
+		 */
+		uint16_t datagram_size;
+
+		/**
+		 * @brief Room for a full batch of datagrams when packing.
+		 */
+		uint8_t *datagrams;
+
+		/**
+		 * @brief Log for the periodic report of the send counters.
+		 */
+		Logger *log;
+
+		/**
+		 * @brief Copies of the most recently sent packets, or NULL if
+		 * 	  none are kept.
+		 */
+		retransmit_cache *history;
+
+		/**
+		 * @brief The valves to report on, or NULL for none.
+		 */
+		valve_state *valves;
+
+		/**
+		 * @brief The number of valve updates at the last valve packet.
+		 */
+		uint32_t valve_changes;
+
+		/**
+		 * @brief How readings convert to engineering units, or NULL to
+		 * 	  leave them raw.
+		 */
+		const calibration_table *calibration;
+
+		/**
+		 * @brief Room for a batch of calibrated packets, or NULL if they
+		 * 	  are not sent.
+		 */
+		uint8_t *calibrated;
+
+		/**
+		 * @brief Each sensor's readings since the last report.
+		 */
+		io_summary summaries[SENSOR::NUM_SENSORS];
+
+		std::atomic<uint64_t> packets_written;
+		std::atomic<uint64_t> packets_sent;
+		std::atomic<uint64_t> send_failures;
+		std::atomic<uint64_t> datagrams_sent;
+		std::atomic<uint64_t> send_calls;
+		std::atomic<uint64_t> bytes_sent;
+
+		/**
+		 * @brief Send a batch of datagrams with as few syscalls as
+		 * 	  possible and count the result.
+		 *
+		 * @param num_packets the number of packets in the datagrams
+		 */
+		void send(uint8_t **bufs, size_t *lens, size_t n, size_t num_packets);
+
+		/**
+		 * @brief Send a batch of packets packed into as few datagrams of at
+		 * 	  most datagram_size bytes as possible.
+		 */
+		void sendPacked(io_packet **packets, size_t n);
+
+		/**
+		 * @brief Convert a batch of packets to engineering units, add them
+		 * 	  to the summaries and send them as calibrated packets if
+		 * 	  asked to.
+		 */
+		void calibrate(io_packet **packets, size_t n);
+
+		/**
+		 * @brief Log and send the valve state, if it has changed since
+		 * 	  the last time or force is set.
+		 */
+		void sendValves(bool force);
+
+		/**
+		 * @brief Log the send rates since the last report, and whatever
+		 * 	  the reporters have to say.
+		 */
+		void report(double elapsed_s, io_stats *last);
+
+		/**
+		 * @brief The body of the thread.
+		 */
+		void run();
+
+	public:
+		/**
+		 * @brief The constructor for an IoThread.
+		 *
+		 * @param sock the socket to send packets through, ideally
+		 * 	  connected
+		 * @param batch_window_us how long packets collect between sends;
+		 * 	  every packet waiting is sent in one sendmmsg() syscall
+		 * @param datagram_size if not 0, packets from all the sensors are
+		 * 	  packed into datagrams of up to this many bytes (see
+		 * 	  frame_writer), instead of one datagram per packet
+		 * @param history_packets the number of sent packets to keep for
+		 * 	  resend(), or 0 to keep none
+		 */
+		IoThread(Udp::OutSocket *sock, uint32_t batch_window_us = IO_BATCH_WINDOW_US,
+		    uint16_t datagram_size = 0,
+		    uint32_t history_packets = IO_HISTORY_PACKETS);
+
+		/**
+		 * @brief Destroy this thread. Frees the queues and closes the
+		 * 	  recording.
+		 */
+		~IoThread();
+
+		/**
+		 * @brief Creates a queue for one sampling thread, whose sensors'
+		 * 	  packets are recorded. Must be called before start().
+		 *
+		 * @param sensors the sensors whose packets will go through the queue
+		 * @param num_sensors the number of sensors
+		 *
+		 * @return The queue the sampling thread should push packets into.
+		 */
+		ring_buffer<io_packet> *addQueue(SENSOR *sensors, uint8_t num_sensors);
+
+		/**
+		 * @brief Logs a reporter's counters with the send counters. Must
+		 * 	  be called before start(), and the reporter must outlive
+		 * 	  the thread.
+		 */
+		void addReporter(io_reporter *reporter);
+
+		/**
+		 * @brief Reports the state of the valves along with the sensor
+		 * 	  data. Must be called before start().
+		 */
+		void setValves(valve_state *valves);
+
+		/**
+		 * @brief Converts the readings to engineering units for the
+		 * 	  reports and, if send is set, a calibrated telemetry
+		 * 	  stream. Must be called before start().
+		 */
+		void setCalibration(const calibration_table *calibration, bool send);
+
+		/**
+		 * @brief Chooses how the recording is written to disk (see
+		 * 	  STORAGE_MODE). Must be called before start().
+		 *
+		 * @param buffers the blocks that may be waiting to be written
+		 */
+		void setStorage(STORAGE_MODE mode, uint32_t buffers = STORAGE_BUFFERS);
+
+		/**
+		 * @brief Start this thread draining the queues, after creating
+		 * 	  the recording.
+		 */
+		void start();
+
+		/**
+		 * @brief Take a snapshot of the I/O counters. Safe to call while
+		 * 	  the thread is running.
+		 *
+		 * @param stats The snapshot to fill in.
+		 */
+		void getStats(io_stats *stats);
+
+		/**
+		 * @brief Finds the packets that were sent with any of a sensor's
+		 * 	  samples in the given range, if they are still kept. Safe
+		 * 	  to call while the thread is running.
+		 *
+		 * @param sensor the sensor
+		 * @param first the number of the first sample wanted
+		 * @param count the number of samples wanted
+		 * @param found the packets are appended here, oldest first
+		 * @param max_packets the most packets to return
+		 *
+		 * @return The number of packets found.
+		 */
+		uint32_t resend(SENSOR sensor, uint32_t first, uint32_t count,
+		    std::vector<io_packet> *found, uint32_t max_packets);
+};
+
+#endif
@@ -0,0 +1,98 @@
+/**
+ * @file retransmit_cache.hpp
+ * @brief Bounded history of sent packets, for resending what the ground
+ * 	  station missed.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#ifndef __RETRANSMIT_CACHE_HPP
+#define __RETRANSMIT_CACHE_HPP
+
+#include <deque>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+#include "adc/adc.hpp"
+#include "io/io_thread.hpp"
+
+/**
+ * @brief Keeps copies of the most recently sent packets, and finds them by
+ * 	  sensor and sample number (see data_item::seq).
+ *
+ * The I/O thread adds every packet it sends. When the cache is full the oldest
+ * packet is forgotten. Lookups come from another thread (the command
+ * connection), so everything is behind a mutex; the I/O thread holds it
+ * for one memcpy per packet.
+ */
+class retransmit_cache {
+	private:
+		/**
+		 * @brief Where a cached packet lives and which samples it holds.
+		 */
+		struct entry {
+			uint32_t first;
+			uint32_t end;
+			uint32_t slot;
+		};
+
+		std::mutex lock;
+
+		/**
+		 * @brief The cached packets, reused oldest first.
+		 */
+		std::vector<io_packet> slots;
+
+		/**
+		 * @brief The slot the next packet goes in.
+		 */
+		uint32_t next_slot;
+
+		/**
+		 * @brief The number of slots in use.
+		 */
+		uint32_t used;
+
+		/**
+		 * @brief The packets of each sensor, oldest first. Since a sensor's
+		 * 	  packets are sent in order, their samples are sorted too.
+		 */
+		std::deque<entry> index[SENSOR::NUM_SENSORS];
+
+	public:
+		/**
+		 * @brief The constructor for a retransmit_cache.
+		 *
+		 * @param capacity The number of packets to keep.
+		 */
+		retransmit_cache(uint32_t capacity);
+
+		/**
+		 * @brief Copies packets into the cache. Packets without sample
+		 * 	  numbers are skipped.
+		 *
+		 * @param packets The packets, in the order they were sent.
+		 * @param n The number of packets.
+		 */
+		void add(io_packet **packets, size_t n);
+
+		/**
+		 * @brief Copies out the cached packets of a sensor that hold any of
+		 * 	  the given samples, oldest first.
+		 *
+		 * @param sensor The sensor.
+		 * @param first The number of the first sample wanted.
+		 * @param count The number of samples wanted.
+		 * @param found The packets found are appended here.
+		 * @param max_packets The most packets to copy out.
+		 *
+		 * @return The number of packets found.
+		 */
+		uint32_t find(SENSOR sensor, uint32_t first, uint32_t count,
+		    std::vector<io_packet> *found, uint32_t max_packets);
+};
+
+#endif
@@ -0,0 +1,287 @@
+/**
+ * @file async_log.hpp
+ * @brief Queue and writer thread behind Logger, so logging does not format
+ * 	  or write on the caller's thread.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#ifndef __ASYNC_LOG_HPP
+#define __ASYNC_LOG_HPP
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+#include <type_traits>
+
+#include "time/time.hpp"
+
+// Records the queue holds, a power of two. Messages are dropped (and counted)
+// when it is full rather than blocking the thread logging them.
+#define LOG_QUEUE_RECORDS 4096
+
+// Most arguments one message may have
+#define LOG_MAX_ARGS 12
+
+// Room in a record for copies of its string arguments, including their NULs.
+// Longer strings are cut short.
+#define LOG_RECORD_TEXT 112
+
+// Time the writer sleeps when the queue is empty, in us
+#define LOG_WRITE_INTERVAL_US 2000
+
+// Bytes of formatted messages the writer collects before writing them
+#define LOG_BATCH_SIZE 65536
+
+/**
+ * @brief How a record's message is written.
+ *
+ * PREFIXED: "[name][level][ms] message", to the file and stdout.
+ * VERBATIM: the message alone, to the file and stdout.
+ */
+enum LOG_KIND: uint8_t {
+	LOG_PREFIXED = 0,
+	LOG_VERBATIM
+};
+
+/**
+ * @brief What a captured argument holds.
+ */
+enum LOG_ARG: uint8_t {
+	LOG_ARG_INT = 0,
+	LOG_ARG_UINT,
+	LOG_ARG_DOUBLE,
+	LOG_ARG_STRING,	/* an offset into log_record::text */
+	LOG_ARG_POINTER
+};
+
+/**
+ * @brief One message, captured but not yet formatted.
+ *
+ * The format string is kept by pointer, so it must outlive the writer, as
+ * string literals do. String arguments are copied, so they may be
+ * temporaries. Records are 256 bytes, four cache lines.
+ */
+struct log_record {
+	/* @brief When the message was logged, in ms since start */
+	timestamp_t time_ms;
+
+	/* @brief The printf format of the message */
+	const char *format;
+
+	/* @brief The name of the Logger, printed before PREFIXED messages */
+	const char *name;
+
+	/* @brief The log file */
+	int fd;
+
+	uint8_t level;
+	uint8_t kind;
+	uint8_t num_args;
+
+	/* @brief Bytes of text in use */
+	uint8_t text_used;
+
+	uint8_t types[LOG_MAX_ARGS];
+	uint64_t args[LOG_MAX_ARGS];
+	char text[LOG_RECORD_TEXT];
+};
+
+static_assert(sizeof(struct log_record) == 256, "Records are four cache lines");
+
+/**
+ * @brief A bounded queue of log records that any number of threads may push
+ * 	  to without locks, and one thread takes from.
+ *
+ * Each slot carries a sequence number saying whose turn it is, so a producer
+ * claims a slot with one compare-and-swap of the tail, fills it in place, and
+ * publishes it by bumping the slot's sequence. (D. Vyukov's bounded queue.)
+ */
+class log_queue {
+	private:
+		struct slot {
+			std::atomic<size_t> seq;
+			log_record record;
+		};
+
+		slot *slots;
+
+		/* @brief Producers and the consumer on separate cache lines */
+		alignas(64) std::atomic<size_t> tail;
+		alignas(64) size_t head;
+
+	public:
+		log_queue();
+
+		~log_queue();
+
+		/**
+		 * @brief Claims the next free record. Must be followed by commit()
+		 * 	  of the same record.
+		 *
+		 * @return The record, or NULL if the queue is full.
+		 */
+		log_record *claim();
+
+		/**
+		 * @brief Hands a claimed record to the consumer.
+		 */
+		void commit(log_record *record);
+
+		/**
+		 * @brief Gets the oldest committed record, without removing it.
+		 * 	  Only the consumer may call this.
+		 *
+		 * @return The record, or NULL if there is none.
+		 */
+		log_record *front();
+
+		/**
+		 * @brief Frees the record from front() for reuse.
+		 */
+		void pop();
+
+		/**
+		 * @brief Gets the number of records ever claimed.
+		 */
+		size_t claimed();
+};
+
+/**
+ * @brief The writer thread shared by every Logger. It formats the records in
+ * 	  the queue and writes them out in batches, so each file and stdout
+ * 	  get one write per batch instead of one per message.
+ */
+class log_backend {
+	private:
+		log_queue queue;
+
+		std::thread writer;
+
+		/* @brief Set to have the writer finish the queue and exit */
+		std::atomic<bool> stopping;
+
+		/* @brief The records written out so far */
+		std::atomic<size_t> written;
+
+		/* @brief Messages dropped because the queue was full */
+		std::atomic<uint32_t> drops;
+
+		log_backend();
+
+		/**
+		 * @brief The writer thread.
+		 */
+		void run();
+
+	public:
+		~log_backend();
+
+		/**
+		 * @brief Gets the backend, starting its writer on first use.
+		 */
+		static log_backend &instance();
+
+		/**
+		 * @brief See log_queue::claim(). Counts a drop if it is full.
+		 */
+		log_record *claim();
+
+		/**
+		 * @brief See log_queue::commit().
+		 */
+		void commit(log_record *record);
+
+		/**
+		 * @brief Waits until every message logged before the call has been
+		 * 	  written.
+		 */
+		void flush();
+
+		/**
+		 * @brief Gets the number of messages dropped because the queue was
+		 * 	  full.
+		 */
+		uint32_t getDrops();
+};
+
+/**
+ * @brief Formats a record's message as printf would have, into buf.
+ *
+ * @return The length of the message, cut short to fit size.
+ */
+size_t log_format(const log_record *record, char *buf, size_t size);
+
+/*
+ * Capturing arguments. Each overload stores one argument in the record; the
+ * variadic log_capture() below applies them in order.
+ */
+static inline void log_capture_arg(log_record *record, const char *value) {
+	size_t room = LOG_RECORD_TEXT - record->text_used, length;
+
+	if (value == NULL)
+		value = "(null)";
+
+	length = strlen(value);
+	if (length >= room)
+		length = room > 0 ? room - 1 : 0;
+
+	record->types[record->num_args] = LOG_ARG_STRING;
+	record->args[record->num_args++] = record->text_used;
+
+	if (room > 0) {
+		memcpy(record->text + record->text_used, value, length);
+		record->text[record->text_used + length] = '\0';
+		record->text_used += length + 1;
+	}
+}
+
+static inline void log_capture_arg(log_record *record, char *value) {
+	log_capture_arg(record, (const char *)value);
+}
+
+static inline void log_capture_arg(log_record *record, double value) {
+	record->types[record->num_args] = LOG_ARG_DOUBLE;
+	memcpy(&record->args[record->num_args++], &value, sizeof(value));
+}
+
+static inline void log_capture_arg(log_record *record, const void *value) {
+	record->types[record->num_args] = LOG_ARG_POINTER;
+	record->args[record->num_args++] = (uintptr_t)value;
+}
+
+template<typename T>
+static inline typename std::enable_if<std::is_integral<T>::value ||
+    std::is_enum<T>::value>::type
+log_capture_arg(log_record *record, T value) {
+	bool is_signed = std::is_signed<T>::value || std::is_enum<T>::value;
+
+	record->types[record->num_args] = is_signed ? LOG_ARG_INT : LOG_ARG_UINT;
+	record->args[record->num_args++] = is_signed ? (uint64_t)(int64_t)value :
+	    (uint64_t)value;
+}
+
+template<typename T>
+static inline typename std::enable_if<std::is_floating_point<T>::value>::type
+log_capture_arg(log_record *record, T value) {
+	log_capture_arg(record, (double)value);
+}
+
+template<typename T>
+static inline void log_capture_arg(log_record *record, T *value) {
+	log_capture_arg(record, (const void *)value);
+}
+
+static inline void log_capture(log_record *) {}
+
+template<typename T, typename... Args>
+static inline void log_capture(log_record *record, T value, Args... args) {
+	log_capture_arg(record, value);
+	log_capture(record, args...);
+}
+
+#endif
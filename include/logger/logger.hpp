@@ -15,8 +15,12 @@
 #define MAX_BUF_LEN 256
 
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdint.h>
 
+#include "logger/async_log.hpp"
+#include "time/time.hpp"
+
 /**
  * @brief The log levels that determine what messages are send to
  * 		  stdout. TODO Should we use the same logger class to log
@@ -45,6 +49,12 @@ const char LogLevelStrings[][7] ={
 /**
  * @brief A logger class that handles different log levels and logging 
  * 		  options.
+ *
+ * Messages are captured as a format and arguments and handed to the
+ * log_backend, whose thread formats and writes them, so logging from a
+ * real-time thread costs a queue push rather than formatting and two syscalls.
+ * The format must be a string literal (or otherwise outlive the logger); string
+ * arguments are copied. If the queue is full the message is dropped.
  * 
  * TODO each instance has only one filename and file descriptor.
  * If we want to use fewer loggers we can provide the file in the
@@ -73,9 +83,9 @@ class Logger {
 		LogLevel log_level;
 
 		/**
-		 * @brief A temporary buffer that is used to format user input
+		 * @brief The writer every message is handed to.
 		 */
-		char buf[MAX_BUF_LEN];
+		log_backend *backend;
 
 		/**
 		 * @brief Attempts to create a log file and any intermediate directories.
@@ -86,6 +96,31 @@ class Logger {
 		 */
 		int create_log_file();
 
+		/**
+		 * @brief Claims a record for a message and fills in everything but
+		 * 	  its arguments.
+		 *
+		 * @return The record, or NULL if the message should not be logged
+		 * 	   or the queue is full.
+		 */
+		log_record *begin(const char *format, LogLevel level, LOG_KIND kind);
+
+		/**
+		 * @brief Logs a message if the logger's log level is at least as high
+		 * 	  	  as the provided log level. 
+		 */
+		template<typename... Args>
+		void log(const char *format, LogLevel level, LOG_KIND kind, Args... args) {
+			static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "Too many arguments to log");
+			log_record *record = begin(format, level, kind);
+
+			if (record == NULL)
+				return;
+
+			log_capture(record, args...);
+			backend->commit(record);
+		}
+
 	public:
 		/**
 		 * @brief Constructor for the logger.
@@ -97,44 +132,55 @@ class Logger {
 		 */
 		char *getFilename();
 
-		/**
-		 * @brief Logs a message if the logger's log level is at least as high
-		 * 	  	  as the provided log level. 
-		 * @msg	  The message to log.
-		 * @param level The log level of the message.
-		 */
-		void log(const char *format, LogLevel level, va_list argList);
-
 		/**
 		 * @brief Logs an ERROR level message.
 		 *
 		 * @format The format string for the message.
 		 */
-		void error(const char *format, ...);
+		template<typename... Args>
+		void error(const char *format, Args... args) {
+			log(format, LogLevel::ERROR, LOG_PREFIXED, args...);
+		}
 
 		/**
 		 * @brief Logs an INFO level message.
 		 *
 		 * @format The format string for the message.
 		 */
-		void info(const char *format, ...);
+		template<typename... Args>
+		void info(const char *format, Args... args) {
+			log(format, LogLevel::INFO, LOG_PREFIXED, args...);
+		}
 
 		/**
 		 * @brief Logs a DEBUG level message.
 		 *
 		 * @format The format string for the message.
 		 */
-		void debug(const char *format, ...);
+		template<typename... Args>
+		void debug(const char *format, Args... args) {
+			log(format, LogLevel::DEBUG, LOG_PREFIXED, args...);
+		}
 
 		/**
 		 * @brief Logs a message without logger info.
 		 *
 		 * @format The format string for the message.
 		 */
-		void verbatim(const char *format, ...);
+		template<typename... Args>
+		void verbatim(const char *format, Args... args) {
+			log(format, LogLevel::SILENT, LOG_VERBATIM, args...);
+		}
+
+		/**
+		 * @brief Waits until every message logged so far, by any logger,
+		 * 	  has been written.
+		 */
+		void flush();
 
 		/**
-		 * @brief Logs raw data.
+		 * @brief Logs raw data. Unlike messages it is written at once, on
+		 * 	  the caller's thread.
 		 *
 		 * @data The data to write.
 		 */
@@ -0,0 +1,94 @@
+/**
+ * @file CommandProtocol.hpp
+ * @brief Wire format of framed, acknowledged commands.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef __COMMAND_PROTOCOL_HPP
+#define __COMMAND_PROTOCOL_HPP
+
+#include <cstddef> // for size_t
+#include <cstdint> // for uint8_t
+
+// First byte of a command frame. Never a valid command byte, so frames and
+// legacy single-byte commands can be mixed on one connection.
+#define CMD_FRAME_START 0xF0
+
+// First byte of an ack
+#define CMD_ACK_START 0xF1
+
+// Version of the framing written by this code
+#define CMD_FRAME_VERSION 1
+
+// Most bytes of commands in one frame
+#define CMD_FRAME_MAX_LENGTH 1024
+
+/**
+ * @brief The header of a command frame.
+ *
+ * The header is followed by length bytes holding one or more commands back
+ * to back, each a command byte and its arguments. The commands are numbered
+ * seq, seq + 1, ... and each is acked separately, in order. A client that
+ * misses an ack can resend the frame with the same seq; commands already
+ * received are acked as CMD_DUPLICATE rather than carried out twice.
+ */
+struct command_frame_header {
+    uint8_t start;
+    uint8_t version;
+    uint16_t length;
+    uint32_t seq;
+};
+
+/**
+ * @brief What became of a framed command.
+ */
+enum CMD_STATUS: uint8_t {
+    CMD_OK = 0,         // Carried out
+    CMD_IGNORED,        // Sent by an observer, so not carried out
+    CMD_UNKNOWN,        // Not a command resfet knows
+    CMD_MALFORMED,      // Arguments missing or the frame is bad
+    CMD_DUPLICATE       // Its seq was already received, so not carried out again
+};
+
+/**
+ * @brief The reply to every framed command.
+ *
+ * The times are in nanoseconds on resfet's clock (get_elapsed_time_ns()), so
+ * differences between them are exact, and the client can compare them with
+ * its own send and receive times to split the round trip.
+ */
+struct command_ack {
+    uint8_t start;
+    uint8_t status;
+    uint8_t command;
+    uint8_t reserved;
+    uint32_t seq;
+
+    /* @brief When the frame holding the command was received */
+    uint64_t received_ns;
+
+    /* @brief When the command was handed to the visitor */
+    uint64_t dispatched_ns;
+
+    /* @brief When the command last wrote an output pin, or 0 if it wrote
+     * 	  none while being dispatched (e.g. ignition, which the ignition
+     * 	  thread carries out) */
+    uint64_t actuated_ns;
+};
+
+/**
+ * @brief Checks for a whole command frame at the start of a buffer.
+ *
+ * @param buf the received bytes, starting with CMD_FRAME_START
+ * @param n the number of bytes
+ * @param header set to the frame's header, when it has arrived
+ * @return the length of the whole frame, 0 if more bytes are needed, or -1
+ *         if the frame is malformed
+ */
+int parse_command_frame(const uint8_t* buf, size_t n, command_frame_header* header);
+
+#endif
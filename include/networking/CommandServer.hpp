@@ -0,0 +1,341 @@
+/**
+ * @file CommandServer.hpp
+ * @brief Event loop that serves commands to several TCP clients at once.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef __COMMAND_SERVER_HPP
+#define __COMMAND_SERVER_HPP
+
+#include <chrono>
+#include <cstddef> // for size_t
+#include <cstdint> // for uint8_t
+#include <string>
+#include <vector>
+
+#include "networking/Tcp.hpp"
+
+// Most clients connected at once; any more are turned away
+#define TCP_MAX_CLIENTS 8
+
+// Size of each client's buffer of received bytes
+#define TCP_RECV_BUFFER_SIZE 4096
+
+// Most bytes a client may leave unread before it is dropped as stuck
+#define TCP_MAX_PENDING_SEND (1 << 20)
+
+// Longest the event loop waits before checking timeouts, in ms
+#define TCP_POLL_INTERVAL_MS 100
+
+// Default longest a command may take to arrive once it has started, in ms
+#define TCP_PARTIAL_TIMEOUT_MS 2000
+
+namespace Tcp {
+    // Forward-declarations of classes
+
+    class Client;
+
+    class CommandHandler;
+
+    class CommandServer;
+
+    /**
+     * @brief One connection to the command server, with its buffers.
+     *
+     * The first client to connect is the operator, and the only one whose
+     * commands should actuate anything. Any others are observers, e.g. a
+     * second dashboard. When the operator disconnects, the observer that has
+     * been connected longest takes over.
+     */
+    class Client {
+        private:
+            /**
+             * @brief The non-blocking connection to the client.
+             */
+            ConnSocket sock;
+
+            /**
+             * @brief Bytes received but not yet handled, from the start.
+             */
+            uint8_t recvBuf[TCP_RECV_BUFFER_SIZE];
+
+            /**
+             * @brief The number of bytes in recvBuf.
+             */
+            size_t recvLen;
+
+            /**
+             * @brief Bytes queued by send() that the socket has not taken
+             *        yet.
+             */
+            std::vector<uint8_t> sendBuf;
+
+            /**
+             * @brief Whether the client is the operator.
+             */
+            bool primary;
+
+            /**
+             * @brief Whether the client should be dropped, and why.
+             */
+            const char* dropReason;
+
+            /**
+             * @brief Whether the connection should close once sendBuf is
+             *        empty.
+             */
+            bool closing;
+
+            /**
+             * @brief When the client last sent anything.
+             */
+            std::chrono::steady_clock::time_point lastRecv;
+
+            /**
+             * @brief When the oldest byte in recvBuf arrived.
+             */
+            std::chrono::steady_clock::time_point partialSince;
+
+            /**
+             * @brief Whether the server is waiting for the socket to take
+             *        more of sendBuf.
+             */
+            bool waitingToSend;
+
+            /**
+             * @brief Pass queued bytes to the socket until it will not take
+             *        more.
+             */
+            void flush();
+
+            // Friends
+
+            /**
+             * @brief CommandServer has private access.
+             *
+             * @relates CommandServer
+             */
+            friend CommandServer;
+
+        public:
+            // Constructors and destructors
+
+            /**
+             * @brief Wrap an accepted, non-blocking connection.
+             */
+            Client(ConnSocket sock, bool primary);
+
+            /**
+             * @brief Destroy this client, closing its connection.
+             */
+            ~Client();
+
+            // Methods
+
+            /**
+             * @brief Queue bytes to be sent to the client. Never blocks; the
+             *        bytes go out as the client reads them. A client that
+             *        lets too much pile up is dropped.
+             *
+             * @param buf the bytes to send
+             * @param n the number of bytes
+             * @return false if the client is being dropped, true otherwise
+             */
+            bool send(const uint8_t* buf, size_t n);
+
+            /**
+             * @brief Close the connection once everything queued is sent.
+             *        Nothing more is handled from this client.
+             */
+            void close();
+
+            // Getters
+
+            /**
+             * @brief Get whether this client is the operator, whose commands
+             *        are carried out.
+             */
+            bool isOperator();
+
+            /**
+             * @brief Get the hostname (address) of the client.
+             */
+            std::string getClientHostname();
+
+            /**
+             * @brief Get the service (port) of the client.
+             */
+            std::string getClientService();
+    };
+
+    /**
+     * @brief Interprets what clients send to the CommandServer. Called only
+     *        from the thread running the server.
+     */
+    class CommandHandler {
+        public:
+            virtual ~CommandHandler() {}
+
+            /**
+             * @brief Handle the first command in what a client has sent.
+             *
+             * @param client the client that sent the bytes
+             * @param buf the bytes received and not yet handled
+             * @param n the number of bytes, at least 1
+             * @return the number of bytes used, or 0 if buf does not hold a
+             *         whole command yet
+             */
+            virtual size_t handle(Client& client, const uint8_t* buf, size_t n) = 0;
+
+            /**
+             * @brief Called when a client connects.
+             */
+            virtual void connected(Client& /* client */) {}
+
+            /**
+             * @brief Called when a client is promoted to operator.
+             */
+            virtual void promoted(Client& /* client */) {}
+
+            /**
+             * @brief Called just before a client's connection is closed.
+             *
+             * @param reason why the connection is closing
+             */
+            virtual void disconnected(Client& /* client */, const char* /* reason */) {}
+    };
+
+    /**
+     * @brief Serves several command connections from one thread with epoll.
+     *
+     * Sockets are non-blocking. Each readable client is read with one recv()
+     * of as much as its buffer has room for, and then every whole command
+     * in the buffer is handed to the CommandHandler. The operator's events
+     * are always handled first, and no client can block the loop: one that
+     * stops reading is dropped once too much is queued for it, one that
+     * stops part way through a command is dropped after a timeout, and
+     * optionally, one that sends nothing at all for too long is dropped.
+     */
+    class CommandServer {
+        private:
+            // Members
+
+            /**
+             * @brief The socket new clients connect to.
+             */
+            ListenSocket liSock;
+
+            /**
+             * @brief The epoll instance watching liSock and every client.
+             */
+            int epollFd;
+
+            /**
+             * @brief The connected clients, longest connected first.
+             */
+            std::vector<Client*> clients;
+
+            /**
+             * @brief What to do with the bytes clients send.
+             */
+            CommandHandler* handler;
+
+            /**
+             * @brief The most clients to serve at once.
+             */
+            size_t maxClients;
+
+            /**
+             * @brief How long a client may send nothing before it is dropped,
+             *        in ms, or 0 to never drop idle clients.
+             */
+            uint32_t idleTimeoutMs;
+
+            /**
+             * @brief How long a command may take to arrive once it has
+             *        started, in ms.
+             */
+            uint32_t partialTimeoutMs;
+
+            /**
+             * @brief Accept every pending connection.
+             */
+            void acceptAll();
+
+            /**
+             * @brief Handle the events epoll reported for one client.
+             */
+            void serve(Client* client, uint32_t events);
+
+            /**
+             * @brief Ask epoll to report whether a client can be written to,
+             *        or stop asking.
+             */
+            void watch(Client* client, bool writable);
+
+            /**
+             * @brief Drop clients that timed out or are finished, and make
+             *        sure there is an operator if anyone is connected.
+             */
+            void reap();
+
+        public:
+            // Constructors and destructors
+
+            /**
+             * @brief Create a server listening on the given port.
+             *
+             * @param port the port to listen on
+             * @param handler interprets what clients send
+             * @param maxClients the most clients to serve at once
+             * @throw OpFailureException if the socket or epoll instance
+             *        could not be created
+             */
+            CommandServer(int port, CommandHandler* handler, size_t maxClients = TCP_MAX_CLIENTS);
+
+            /**
+             * @brief Destroy this server, closing every connection.
+             */
+            ~CommandServer();
+
+            // Methods
+
+            /**
+             * @brief Set how long clients may go quiet.
+             *
+             * @param idleMs how long a client may send nothing at all, or 0
+             *        for no limit
+             * @param partialMs how long a command may take to arrive once
+             *        its first byte has
+             */
+            void setTimeouts(uint32_t idleMs, uint32_t partialMs);
+
+            /**
+             * @brief Wait for and handle one round of events.
+             *
+             * @param timeoutMs the longest to wait for an event, in ms
+             * @throw OpFailureException if epoll fails
+             */
+            void poll(int timeoutMs = TCP_POLL_INTERVAL_MS);
+
+            /**
+             * @brief Serve clients forever.
+             *
+             * @throw OpFailureException if epoll fails
+             */
+            void run();
+
+            // Getters
+
+            /**
+             * @brief Get the number of clients connected.
+             */
+            size_t getNumClients();
+    };
+}
+
+#endif
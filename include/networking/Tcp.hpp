@@ -18,7 +18,7 @@
 #include <string>
 
 // Backlog for pending connections on listening sockets
-#define TCP_BACKLOG 2
+#define TCP_BACKLOG 16
 
 // Size of buffer in which to store client's hostname
 #define CLIENT_HOST_SIZE 128
@@ -110,6 +110,25 @@ namespace Tcp {
              */
             ConnSocket accept();
 
+            /**
+             * @brief Accept an incoming connection if one is pending, without
+             *        blocking. Meant for non-blocking sockets.
+             * 
+             * @param coSock set to the accepted connection, if any
+             * @return true if a connection was accepted
+             * @return false if none was pending
+             * @throw OpFailureException if the accept fails
+             */
+            bool tryAccept(ConnSocket* coSock);
+
+            /**
+             * @brief Make accept() and tryAccept() return immediately rather
+             *        than wait for a connection.
+             * 
+             * @throw OpFailureException if the socket could not be changed
+             */
+            void setNonBlocking();
+
             /**
              * @brief Close this socket. Any unaccepted requests are rejected.
              * 
@@ -244,6 +263,42 @@ namespace Tcp {
              */
             void sendBuf(uint8_t* buf, size_t n);
 
+            /**
+             * @brief Read whatever bytes are available, up to n, without
+             *        waiting for more. Meant for non-blocking sockets.
+             * 
+             * @param buf the buffer in which to store the bytes. Must have
+             *        size at least n
+             * @param n the most bytes to read
+             * @return the number of bytes read, 0 if none were available
+             * @throw BadSocketException if the socket is not open
+             * @throw ClientDisconnectException if the client has disconnected
+             * @throw OpFailureException if there is an error reading
+             */
+            size_t recvSome(uint8_t* buf, size_t n);
+
+            /**
+             * @brief Write as many of n bytes as the socket will take without
+             *        waiting. Meant for non-blocking sockets.
+             * 
+             * @param buf the buffer from which to send. Must be of size at
+             *        least n
+             * @param n the number of bytes to send
+             * @return the number of bytes sent, possibly 0
+             * @throw BadSocketException if the socket is not open
+             * @throw ClientDisconnectException if the client has disconnected
+             * @throw OpFailureException if there is an error sending
+             */
+            size_t sendSome(const uint8_t* buf, size_t n);
+
+            /**
+             * @brief Make reads and writes on this socket return immediately
+             *        rather than wait. Use recvSome() and sendSome() after.
+             * 
+             * @throw OpFailureException if the socket could not be changed
+             */
+            void setNonBlocking();
+
             /**
              * @brief Close this socket. Any unread data from the client is
              *        lost.
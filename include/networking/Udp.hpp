@@ -25,6 +25,9 @@
 // Max bytes for destination services
 #define UDP_DEST_SERV_SIZE 128
 
+// Max datagrams handed to the kernel by one sendBatch() syscall
+#define UDP_MAX_BATCH 64
+
 /**
  * @brief Contains all relevant functions for the UDP side of the engine
  *        controller, used to send data collected from sensors back to the base
@@ -74,6 +77,12 @@ namespace Udp {
              */
             bool open;
 
+            /**
+             * @brief Whether the socket is connected to its destination, so
+             *        sends need not name it.
+             */
+            bool connected;
+
         public:
             /**
              * @brief Create a blank, nonfunctional socket with an empty
@@ -116,6 +125,17 @@ namespace Udp {
              */
             void setDest(char* const addr, int port);
 
+            /**
+             * @brief Connect this socket to its current destination, so the
+             *        kernel resolves the route once instead of on every send.
+             *        Must be called after enable(), and again after any
+             *        setDest().
+             * 
+             * @throw BadOutSocketException if the socket is not open
+             * @throw OpFailureException if the socket could not be connected
+             */
+            void connect();
+
             /**
              * @brief Send a single byte to the current destination.
              * 
@@ -140,6 +160,22 @@ namespace Udp {
              */
             void sendBuf(uint8_t* buf, size_t n);
 
+            /**
+             * @brief Send several buffers to the current destination, one
+             *        datagram each, in as few sendmmsg() syscalls as possible
+             *        (one for up to UDP_MAX_BATCH buffers).
+             * 
+             * @param bufs the buffers to send
+             * @param lens the number of bytes in each buffer
+             * @param n the number of buffers
+             * @return the number of sendmmsg() syscalls made
+             * @throw BadOutSocketException if the socket is not ready for a
+             *        send
+             * @throw OpFailureException if a send fails despite the socket
+             *        being ready
+             */
+            int sendBatch(uint8_t** bufs, size_t* lens, size_t n);
+
             /**
              * @brief Close this socket, rendering it unable to send until
              *        enable() is called again.
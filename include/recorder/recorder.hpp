@@ -0,0 +1,359 @@
+/**
+ * @file recorder.hpp
+ * @brief Records the packets of every sensor into one file of large blocks.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#ifndef __RECORDER_HPP
+#define __RECORDER_HPP
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "recorder/storage.hpp"
+#include "time/time.hpp"
+
+// First word of a recording, of every block and of the trailer
+#define RECORDER_MAGIC 0x44524352		/* "RCRD" */
+#define RECORDER_BLOCK_MAGIC 0x4B4C4252		/* "RBLK" */
+#define RECORDER_TRAILER_MAGIC 0x58444952	/* "RIDX" */
+
+// Version of the layout written by this code
+#define RECORDER_VERSION 1
+
+// Size of the file header, and the alignment of everything after it
+#define RECORDER_HEADER_SIZE 4096
+
+// Size of a block. A multiple of RECORDER_HEADER_SIZE.
+#define RECORDER_BLOCK_SIZE 65536
+
+// Space reserved ahead of the blocks at a time, so the file grows in a few
+// large extents instead of a block at a time
+#define RECORDER_PREALLOCATE_BYTES (64 * 1024 * 1024)
+
+// How often the partly filled block is written out, so at most this much data
+// is lost if the controller loses power
+#define RECORDER_SYNC_INTERVAL_MS 1000
+
+// Most channels in one recording, so the channels of a block fit in a mask
+#define RECORDER_MAX_CHANNELS 32
+
+// Longest channel name, including its NUL
+#define RECORDER_NAME_LENGTH 20
+
+/*
+ * Layout of a Recording
+ * 	A recording_header in the first RECORDER_HEADER_SIZE bytes, then blocks
+ * 	of block_size bytes, each a recording_block followed by records, each a
+ * 	recording_record and then length bytes of data (e.g. one packet).
+ * 	Records never span blocks, and the rest of a block after used bytes is
+ * 	zero. Blocks are only written as far as they are used, so the last
+ * 	block of a recording that was not closed may be cut short.
+ *
+ * 	A recording that was closed ends with an index, a recording_index_entry
+ * 	per block, then a recording_trailer. One that was not (e.g. the power
+ * 	was cut) ends at its last block written, and can still be read by
+ * 	scanning the blocks.
+ */
+
+/**
+ * @brief The start of a recording.
+ */
+struct recording_header {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t header_size;
+	uint32_t block_size;
+	uint32_t num_channels;
+
+	/* @brief When the recording was started, as in the log directory */
+	char started[32];
+
+	/* @brief The name of each channel, e.g. the sensor it carries */
+	char names[RECORDER_MAX_CHANNELS][RECORDER_NAME_LENGTH];
+};
+
+/**
+ * @brief The header of a block.
+ */
+struct recording_block {
+	uint32_t magic;
+
+	/* @brief The number of the block, from 0 */
+	uint32_t seq;
+
+	/* @brief The bytes of the block in use, including this header */
+	uint32_t used;
+
+	/* @brief Bit n is set if the block has records of channel n */
+	uint32_t channels;
+
+	/* @brief The times of the first and last records, in us */
+	timestamp_t first_us;
+	timestamp_t last_us;
+
+	uint32_t num_records;
+	uint32_t reserved;
+};
+
+/**
+ * @brief The header of a record.
+ */
+struct recording_record {
+	uint8_t channel;
+	uint8_t reserved;
+	uint16_t length;
+};
+
+/**
+ * @brief A block's entry in the index.
+ */
+struct recording_index_entry {
+	uint32_t seq;
+	uint32_t channels;
+	uint64_t offset;
+	timestamp_t first_us;
+	timestamp_t last_us;
+};
+
+/**
+ * @brief The end of a closed recording.
+ */
+struct recording_trailer {
+	uint32_t magic;
+	uint32_t num_blocks;
+	uint64_t index_offset;
+};
+
+/**
+ * @brief A snapshot of a recorder's counters.
+ */
+struct recorder_stats {
+	/* @brief The records appended */
+	uint64_t records;
+
+	/* @brief The bytes of records appended, including their headers */
+	uint64_t record_bytes;
+
+	/* @brief The blocks filled and written */
+	uint64_t blocks;
+
+	/* @brief The write syscalls made, including syncs of partial blocks */
+	uint64_t write_calls;
+
+	/* @brief The bytes written, including padding and rewrites */
+	uint64_t bytes_written;
+
+	/* @brief Times appending had to wait for the disk */
+	uint64_t stalls;
+
+	/* @brief Write or preallocation errors */
+	uint64_t errors;
+};
+
+/**
+ * @brief Appends records from any number of channels into one file, a whole
+ * 	  aligned block per write.
+ *
+ * Blocks are filled in the buffers of a storage_engine and written the way
+ * it was opened with, only as far as they are used, rounded up to
+ * STORAGE_ALIGNMENT.
+ *
+ * Only one thread may append; any thread may read the counters.
+ */
+class recorder {
+	private:
+		storage_engine storage;
+
+		/* @brief The block being filled, a buffer of the storage */
+		uint8_t *block;
+
+		/* @brief Where the block being filled goes in the file */
+		uint64_t offset;
+
+		/* @brief How far the file has been preallocated */
+		uint64_t allocated;
+
+		/* @brief Whether the block has records not yet written out */
+		bool dirty;
+
+		/* @brief The index of every block written so far */
+		struct recording_index_entry *index;
+		uint32_t index_size;
+		uint32_t index_capacity;
+
+		uint8_t num_channels;
+
+		std::atomic<uint64_t> records;
+		std::atomic<uint64_t> record_bytes;
+		std::atomic<uint64_t> blocks;
+		std::atomic<uint64_t> errors;
+
+		/**
+		 * @brief Adds or updates the index entry of the block being filled.
+		 */
+		int indexBlock();
+
+		/**
+		 * @brief Starts a new, empty block after the current one, in a
+		 * 	  fresh buffer.
+		 */
+		void nextBlock();
+
+	public:
+		recorder();
+
+		~recorder();
+
+		/**
+		 * @brief Creates a recording, replacing any file at path.
+		 *
+		 * @param names the name of each channel
+		 * @param num_channels the number of channels, at most
+		 * 	  RECORDER_MAX_CHANNELS
+		 * @param started when the recording started, for the header
+		 * @param mode how blocks are written
+		 * @param buffers the blocks that may be waiting to be written
+		 *
+		 * @return 0 on success, -1 if the file could not be created.
+		 */
+		int open(const char *path, const char *const *names, uint8_t num_channels,
+		    const char *started, STORAGE_MODE mode = STORAGE_SYNC,
+		    uint32_t buffers = STORAGE_BUFFERS);
+
+		/**
+		 * @brief Appends a record, starting a new block if it does not fit
+		 * 	  in this one.
+		 *
+		 * @param time_us when the data was recorded, for the block's time
+		 * 	  range
+		 *
+		 * @return 0 on success, -1 if the recording is not open, the
+		 * 	   channel is unknown or the data is larger than a block.
+		 * 	   Write errors are counted instead, as writes may finish
+		 * 	   later.
+		 */
+		int append(uint8_t channel, const uint8_t *data, uint16_t length,
+		    timestamp_t time_us);
+
+		/**
+		 * @brief Writes out a copy of the partly filled block, if it has
+		 * 	  changed. It is written again, in place, as it fills.
+		 */
+		void sync();
+
+		/**
+		 * @brief See storage_engine::poll(). Call it between appends.
+		 */
+		void poll();
+
+		/**
+		 * @brief Waits until everything synced or filled so far is on
+		 * 	  disk.
+		 */
+		void drain();
+
+		/**
+		 * @brief Writes the last block and the index, and closes the file.
+		 *
+		 * @return 0 on success, -1 if anything could not be written.
+		 */
+		int close();
+
+		/**
+		 * @brief Checks whether a recording is open.
+		 */
+		bool isOpen();
+
+		void getStats(recorder_stats *stats);
+
+		/**
+		 * @brief Gets the counters of the storage underneath, e.g. its
+		 * 	  write latencies.
+		 */
+		void getStorageStats(storage_stats *stats);
+
+		/**
+		 * @brief Gets the mode blocks are written with, after any fallback.
+		 */
+		STORAGE_MODE getMode();
+};
+
+/**
+ * @brief Reads the records of a recording back in order.
+ */
+class recording_reader {
+	private:
+		int fd;
+
+		struct recording_header header;
+
+		/* @brief The block being read */
+		uint8_t *block;
+
+		/* @brief The offset of the next block in the file */
+		uint64_t next_offset;
+
+		/* @brief Where the blocks end: the index of a closed recording,
+		 * 	  or the end of the file */
+		uint64_t end;
+
+		/* @brief The offset of the next record in the block */
+		uint32_t position;
+
+		bool closed;
+
+	public:
+		recording_reader();
+
+		~recording_reader();
+
+		/**
+		 * @brief Opens a recording.
+		 *
+		 * @return 0 on success, -1 if the file cannot be read or is not a
+		 * 	   recording.
+		 */
+		int open(const char *path);
+
+		/**
+		 * @brief Gets the next record.
+		 *
+		 * @param channel set to its channel
+		 * @param data set to its data, valid until the next call
+		 * @param length set to the length of the data
+		 * @param block if not NULL, set to the header of its block
+		 *
+		 * @return false at the end of the recording.
+		 */
+		bool next(uint8_t *channel, const uint8_t **data, uint16_t *length,
+		    const recording_block **block = NULL);
+
+		/**
+		 * @brief Gets the header of the recording.
+		 */
+		const recording_header *getHeader();
+
+		/**
+		 * @brief Checks whether the recording was closed, with an index.
+		 */
+		bool wasClosed();
+
+		/**
+		 * @brief Looks up a channel by name.
+		 *
+		 * @return The channel, or -1 if there is none by that name.
+		 */
+		int findChannel(const char *name);
+};
+
+/**
+ * @brief Checks whether a file is a recording, from its first bytes.
+ */
+bool is_recording(const char *path);
+
+#endif
@@ -0,0 +1,257 @@
+/**
+ * @file storage.hpp
+ * @brief Ways of writing a recording's blocks to disk.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#ifndef __STORAGE_HPP
+#define __STORAGE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#include "time/time.hpp"
+
+// Alignment of every buffer, write length and offset, as O_DIRECT needs
+#define STORAGE_ALIGNMENT 4096
+
+// Default number of buffers, which bounds the writes in flight
+#define STORAGE_BUFFERS 8
+
+// Buckets of the write latency histogram. Bucket n counts writes that took
+// less than 2^n us (and at least 2^(n-1)); the last counts all longer ones.
+#define STORAGE_LATENCY_BUCKETS 24
+
+/**
+ * @brief How blocks are written.
+ *
+ * SYNC: pwrite() through the page cache, on the caller's thread.
+ * DIRECT: pwrite() with O_DIRECT, on a writer thread, so the caller only
+ * 	waits when every buffer is in flight and writeback never stalls it.
+ * URING: O_DIRECT writes queued to the kernel through io_uring, with no
+ * 	thread of our own. Falls back to DIRECT where io_uring is missing.
+ *
+ * DIRECT falls back to buffered writes on the writer thread if the
+ * filesystem refuses O_DIRECT (e.g. tmpfs).
+ */
+enum STORAGE_MODE: uint8_t {
+	STORAGE_SYNC = 0,
+	STORAGE_DIRECT,
+	STORAGE_URING
+};
+
+/**
+ * @brief Parses a storage mode from its name in the config: sync, direct or
+ * 	  uring.
+ *
+ * @return 0 on success, -1 if the name is unknown.
+ */
+int parse_storage_mode(const char *name, STORAGE_MODE *mode);
+
+/**
+ * @brief Gets the name of a storage mode, as parse_storage_mode() takes it.
+ */
+const char *storage_mode_name(STORAGE_MODE mode);
+
+/**
+ * @brief A snapshot of a storage engine's counters.
+ */
+struct storage_stats {
+	/* @brief Writes submitted and completed */
+	uint64_t submitted;
+	uint64_t completed;
+
+	/* @brief Syscalls made to write, including retries of short writes */
+	uint64_t write_calls;
+
+	/* @brief Bytes submitted, and bytes the kernel has said are written */
+	uint64_t bytes_submitted;
+	uint64_t bytes_persisted;
+
+	/* @brief Times acquire() had to wait for a buffer to be written */
+	uint64_t stalls;
+
+	uint64_t errors;
+
+	/* @brief Writes in flight now, and the most there have been */
+	uint32_t depth;
+	uint32_t max_depth;
+
+	/* @brief The longest write, from submit to completion, in us */
+	uint64_t max_latency_us;
+
+	/* @brief How long writes took; see STORAGE_LATENCY_BUCKETS */
+	uint64_t latency_us[STORAGE_LATENCY_BUCKETS];
+};
+
+struct storage_uring;
+
+/**
+ * @brief Writes whole aligned buffers to one file, from a fixed ring of
+ * 	  buffers.
+ *
+ * The caller takes a free buffer with acquire(), fills it and hands it back
+ * with submit(), which queues the write and returns at once (except in SYNC
+ * mode). The buffer is free again once written. Writes complete in the order
+ * submitted when they are to the same offset, so a block may be written
+ * partly filled and then again in full.
+ *
+ * Only one thread may acquire and submit; any thread may read the counters.
+ */
+class storage_engine {
+	private:
+		int fd;
+
+		STORAGE_MODE mode;
+
+		uint32_t buffer_size;
+		uint32_t num_buffers;
+
+		/* @brief Every buffer, one after another */
+		uint8_t *buffers;
+
+		/* @brief The buffers not in flight or held by the caller */
+		std::vector<uint32_t> free_buffers;
+
+		/* @brief Where each buffer in flight goes, and when it was sent */
+		std::vector<uint32_t> lengths;
+		std::vector<uint64_t> offsets;
+		std::vector<timestamp_t> submitted_ns;
+
+		/* @brief Writes waiting for the writer thread, in order */
+		std::vector<uint32_t> pending;
+		size_t pending_head;
+
+		/* @brief Guards the buffer lists in DIRECT mode */
+		std::mutex lock;
+		std::condition_variable changed;
+		std::thread writer;
+		bool stopping;
+
+		/* @brief The io_uring in URING mode, or NULL */
+		storage_uring *ring;
+
+		/* @brief The offset of the last write sent to the ring */
+		uint64_t last_offset;
+
+		std::atomic<uint64_t> submitted;
+		std::atomic<uint64_t> completed;
+		std::atomic<uint64_t> write_calls;
+		std::atomic<uint64_t> bytes_submitted;
+		std::atomic<uint64_t> bytes_persisted;
+		std::atomic<uint64_t> stalls;
+		std::atomic<uint64_t> errors;
+		std::atomic<uint32_t> max_depth;
+		std::atomic<uint64_t> max_latency_us;
+		std::atomic<uint64_t> latency_us[STORAGE_LATENCY_BUCKETS];
+
+		storage_engine(const storage_engine&) = delete;
+		storage_engine& operator=(const storage_engine&) = delete;
+
+		/**
+		 * @brief Counts a finished write and frees its buffer. The lock
+		 * 	  must be held in DIRECT mode.
+		 */
+		void complete(uint32_t buffer, int64_t result);
+
+		/**
+		 * @brief Collects finished io_uring writes, waiting for at least
+		 * 	  one if wait is set.
+		 */
+		void reap(bool wait);
+
+		/**
+		 * @brief The writer thread of DIRECT mode.
+		 */
+		void run();
+
+	public:
+		storage_engine();
+
+		~storage_engine();
+
+		/**
+		 * @brief Creates the file, replacing any file at path.
+		 *
+		 * @param mode how to write; see getMode() for the one used
+		 * @param buffer_size the size of each buffer, a multiple of
+		 * 	  STORAGE_ALIGNMENT
+		 * @param num_buffers the number of buffers, and so the most
+		 * 	  writes that can be in flight
+		 *
+		 * @return 0 on success, -1 if the file could not be created.
+		 */
+		int open(const char *path, STORAGE_MODE mode, uint32_t buffer_size,
+		    uint32_t num_buffers = STORAGE_BUFFERS);
+
+		/**
+		 * @brief Gets the mode actually in use, after any fallback.
+		 */
+		STORAGE_MODE getMode();
+
+		/**
+		 * @brief Takes a free buffer, waiting for a write to finish if
+		 * 	  there is none.
+		 *
+		 * @return A buffer of buffer_size bytes, aligned to
+		 * 	   STORAGE_ALIGNMENT, or NULL if the file is not open.
+		 */
+		uint8_t *acquire();
+
+		/**
+		 * @brief Writes the start of a buffer from acquire() at offset.
+		 * 	  The buffer belongs to the engine again.
+		 *
+		 * @param length the bytes to write, rounded up to
+		 * 	  STORAGE_ALIGNMENT
+		 * @param offset a multiple of STORAGE_ALIGNMENT
+		 */
+		void submit(uint8_t *buffer, uint32_t length, uint64_t offset);
+
+		/**
+		 * @brief Gives back a buffer from acquire() without writing it.
+		 */
+		void release(uint8_t *buffer);
+
+		/**
+		 * @brief Collects the io_uring writes that have finished, without
+		 * 	  waiting. Calling it often frees their buffers sooner and
+		 * 	  keeps the latencies measured close to the truth; the other
+		 * 	  modes do not need it.
+		 */
+		void poll();
+
+		/**
+		 * @brief Waits until every write submitted has finished.
+		 */
+		void drain();
+
+		/**
+		 * @brief Reserves space for the file without changing its size.
+		 *
+		 * @return 0 on success, -1 if the filesystem cannot.
+		 */
+		int reserve(uint64_t offset, uint64_t length);
+
+		/**
+		 * @brief Finishes every write, cuts the file to length, flushes
+		 * 	  it to the disk and closes it.
+		 *
+		 * @return 0 on success, -1 if any write failed.
+		 */
+		int close(uint64_t length);
+
+		bool isOpen();
+
+		void getStats(storage_stats *stats);
+};
+
+#endif
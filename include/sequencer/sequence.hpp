@@ -0,0 +1,104 @@
+/**
+ * @file sequence.hpp
+ * @brief Timelines of pin writes, loaded from the config.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#ifndef __SEQUENCE_HPP
+#define __SEQUENCE_HPP
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "config/config.hpp"
+#include "time/time.hpp"
+
+// Most steps in one sequence
+#define SEQUENCE_MAX_STEPS 64
+
+/*
+ * Format of Sequences in Config Files
+ * 	Each sequence has its own section, named Sequence:<name>, e.g.
+ * 	[Sequence:titan_fill]. Each step is a line
+ *
+ * 	step=<offset_us>,<pin>,<high|low>
+ *
+ * 	where offset_us is the time from the start of the sequence in
+ * 	microseconds and pin is a name from rpi_pins.hpp, e.g. DRIVER3 or
+ * 	MAIN_VALVE. Steps may be given in any order; steps with the same
+ * 	offset are written at once, the last given winning if they share a
+ * 	pin. Lines
+ *
+ * 	abort=<pin>,<high|low>
+ *
+ * 	give the safe state written at once if the sequence is aborted.
+ */
+
+/**
+ * @brief One pin write in a sequence.
+ */
+struct sequence_step {
+	/* @brief Time from the start of the sequence, in nanoseconds */
+	timestamp_t offset_ns;
+	uint8_t pin;
+	uint8_t level;
+};
+
+/**
+ * @brief A timeline of pin writes, and the writes that make it safe if it is
+ * 	  aborted.
+ */
+class sequence {
+	public:
+		/**
+		 * @brief The name the sequence was loaded or built as.
+		 */
+		std::string name;
+
+		/**
+		 * @brief The steps, sorted by offset.
+		 */
+		std::vector<sequence_step> steps;
+
+		/**
+		 * @brief The pin writes made at once if the sequence is aborted.
+		 * 	  Their offsets are unused.
+		 */
+		std::vector<sequence_step> abort_steps;
+
+		/**
+		 * @brief Adds a step, keeping the steps sorted by offset.
+		 *
+		 * @return false if the sequence already has SEQUENCE_MAX_STEPS
+		 * 	   steps.
+		 */
+		bool add(timestamp_t offset_ns, uint8_t pin, uint8_t level);
+
+		/**
+		 * @brief Adds a pin write to make if the sequence is aborted.
+		 */
+		void addAbort(uint8_t pin, uint8_t level);
+
+		/**
+		 * @brief Replaces this sequence with the one in the config section
+		 * 	  Sequence:<name>. Problems are printed.
+		 *
+		 * @return 0 on success, 1 if the section is missing, has no steps
+		 * 	   or has a malformed line.
+		 */
+		int load(ConfigMapping &config, const char *name);
+};
+
+/**
+ * @brief Looks up a pin by its name in rpi_pins.hpp, e.g. DRIVER1 or
+ * 	  MAIN_VALVE.
+ *
+ * @return 0 on success, 1 if the name is not a known pin.
+ */
+int parse_pin(const char *name, uint8_t *pin);
+
+#endif
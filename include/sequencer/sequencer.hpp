@@ -0,0 +1,167 @@
+/**
+ * @file sequencer.hpp
+ * @brief Thread that plays sequences of pin writes on time.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#ifndef __SEQUENCER_HPP
+#define __SEQUENCER_HPP
+
+#include <atomic>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#include "logger/logger.hpp"
+#include "sequencer/sequence.hpp"
+#include "sequencer/valve_state.hpp"
+#include "sequencer/wakeup.hpp"
+#include "time/time.hpp"
+
+// Real-time priority of the sequencer thread, above the sampling threads
+#define SEQUENCER_PRIORITY 80
+
+/**
+ * @brief A thread that plays one sequence at a time.
+ *
+ * Each step is written at an absolute deadline from the start of the
+ * sequence, so lateness never accumulates. Steps at the same offset are
+ * written together, in one update of the valve_state. Between steps the thread sleeps
+ * on a wakeup, so abort() takes effect at once: no further step is written,
+ * and the sequence's abort steps are written instead. The planned and actual
+ * time of every step is logged once the sequence is over, so logging never
+ * delays a step.
+ *
+ * The thread asks for SCHED_FIFO priority, which needs root; without it the
+ * deadlines still hold, just with more jitter.
+ */
+class sequencer {
+	private:
+		/**
+		 * @brief The thread playing the sequences.
+		 */
+		std::thread core_thread;
+
+		/**
+		 * @brief Wakes the thread for a new sequence, an abort or to
+		 * 	  exit.
+		 */
+		wakeup wake;
+
+		/**
+		 * @brief The sequence for the thread to play next, if any.
+		 */
+		std::atomic<const sequence *> pending;
+
+		/**
+		 * @brief Whether a sequence is being played.
+		 */
+		std::atomic<bool> running;
+
+		/**
+		 * @brief The number of calls to abort() so far.
+		 */
+		std::atomic<uint32_t> aborts;
+
+		/**
+		 * @brief The number of calls to abort() when the sequence being
+		 * 	  played was started. It is aborted once aborts moves on,
+		 * 	  so an abort racing start() is never lost, and one made
+		 * 	  while idle never carries over to the next sequence.
+		 */
+		uint32_t start_aborts;
+
+		/**
+		 * @brief Whether sequences are kept from starting.
+		 */
+		std::atomic<bool> held;
+
+		/**
+		 * @brief Whether the thread should exit.
+		 */
+		std::atomic<bool> stopping;
+
+		/**
+		 * @brief Where the steps are written.
+		 */
+		valve_state *valves;
+
+		/**
+		 * @brief When each step of the sequence being played was written,
+		 * 	  from its start, in nanoseconds.
+		 */
+		std::vector<timestamp_t> actual_ns;
+
+		Logger log;
+
+		/**
+		 * @brief Whether abort() was called since the sequence being
+		 * 	  played was started.
+		 */
+		bool aborting();
+
+		/**
+		 * @brief Plays one sequence.
+		 *
+		 * @return The number of steps written.
+		 */
+		size_t play(const sequence *seq);
+
+		/**
+		 * @brief The body of the thread.
+		 */
+		void run();
+
+		sequencer(const sequencer&) = delete;
+		sequencer& operator=(const sequencer&) = delete;
+
+	public:
+		/**
+		 * @brief The constructor for a sequencer. Starts its thread.
+		 *
+		 * @param valves where the steps are written
+		 */
+		sequencer(valve_state *valves);
+
+		/**
+		 * @brief Aborts any sequence being played and stops the thread.
+		 */
+		~sequencer();
+
+		/**
+		 * @brief Starts playing a sequence. The sequence must not change
+		 * 	  or be destroyed until it is over.
+		 *
+		 * @return false if another sequence is still being played, or
+		 * 	   sequences are held.
+		 */
+		bool start(const sequence *seq);
+
+		/**
+		 * @brief Stops the sequence being played, if any, and writes its
+		 * 	  abort steps.
+		 */
+		void abort();
+
+		/**
+		 * @brief Keeps sequences from starting, e.g. while an interlock
+		 * 	  rule is tripped, and aborts the one being played; or
+		 * 	  lets them start again.
+		 */
+		void hold(bool held);
+
+		/**
+		 * @brief Gets whether sequences are kept from starting.
+		 */
+		bool isHeld();
+
+		/**
+		 * @brief Gets whether a sequence is being played.
+		 */
+		bool isRunning();
+};
+
+#endif
@@ -0,0 +1,116 @@
+/**
+ * @file valve_state.hpp
+ * @brief The output pins, written a whole preset at a time, and a copy of
+ * 	  their levels for telemetry.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#ifndef __VALVE_STATE_HPP
+#define __VALVE_STATE_HPP
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+
+#include "time/time.hpp"
+
+// First byte of a valve state packet. Never a valid SENSOR, COMPACT_MAGIC or
+// FRAME_MAGIC, so it can share the telemetry stream with sensor data.
+#define VALVE_MAGIC 0xA6
+
+// Version of the valve state packet written by this code
+#define VALVE_VERSION 1
+
+/**
+ * @brief The valve state packet, sent whenever the outputs change and
+ * 	  periodically in between.
+ *
+ * Bit n of levels and outputs is BCM GPIO n (see rpi_pins.hpp). changes counts
+ * every update, so a receiver can tell it missed one even if the levels ended
+ * up the same.
+ */
+struct valve_packet {
+	uint8_t magic;
+	uint8_t version;
+	uint16_t length;
+	uint32_t changes;
+
+	/* @brief When the outputs were last updated, from get_elapsed_time_ns() */
+	timestamp_t changed_ns;
+
+	/* @brief The level of every output pin, 1 for HIGH */
+	uint32_t levels;
+
+	/* @brief The pins that have been written as outputs */
+	uint32_t outputs;
+};
+
+/**
+ * @brief Set and clear masks for an update of several pins. Adding a pin
+ * 	  again replaces its earlier level.
+ */
+struct pin_masks {
+	uint32_t set;
+	uint32_t clear;
+
+	pin_masks();
+
+	void add(uint8_t pin, uint8_t level);
+};
+
+/**
+ * @brief Every write to the output pins goes through here, so the valves move
+ * 	  together and their levels can be read back without touching the
+ * 	  GPIO registers.
+ *
+ * An update is one bcm2835_gpio_clr_multi() and one bcm2835_gpio_set_multi(),
+ * clearing first so valves that close never wait on valves that open. The
+ * visitor, ignition and sequencer threads all write, so updates are serialized
+ * by a mutex that also keeps the shadow levels in the order they hit the pins.
+ */
+class valve_state {
+	private:
+		std::mutex lock;
+
+		/* @brief The levels last written, the shadow of the GPIO registers */
+		std::atomic<uint32_t> levels;
+
+		std::atomic<uint32_t> outputs;
+		std::atomic<uint32_t> changes;
+		std::atomic<timestamp_t> changed_ns;
+
+	public:
+		valve_state();
+
+		/**
+		 * @brief Writes a single pin.
+		 */
+		void write(uint8_t pin, uint8_t level);
+
+		/**
+		 * @brief Writes every pin in the masks at once.
+		 */
+		void apply(const pin_masks& masks);
+
+		/**
+		 * @brief Gets the levels last written, bit n for GPIO n.
+		 */
+		uint32_t read();
+
+		/**
+		 * @brief Gets the number of updates so far.
+		 */
+		uint32_t getChanges();
+
+		/**
+		 * @brief Writes a valve_packet holding the current state.
+		 *
+		 * @return The length of the packet, or 0 if it did not fit.
+		 */
+		uint16_t encode(uint8_t *buf, uint16_t size);
+};
+
+#endif
@@ -0,0 +1,90 @@
+/**
+ * @file wakeup.hpp
+ * @brief A way to wake a thread that sleeps until an absolute deadline.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#ifndef __WAKEUP_HPP
+#define __WAKEUP_HPP
+
+#include <atomic>
+#include <stdint.h>
+
+#include "time/time.hpp"
+
+/**
+ * @brief Lets any thread wake one waiting thread at once, and lets that
+ * 	  thread sleep until an absolute deadline in the meantime.
+ *
+ * Built on an eventfd, which notify() writes to, and a timerfd armed with
+ * the deadline, both waited on with one poll(). Deadlines are absolute
+ * times on CLOCK_MONOTONIC, so they do not drift however often the waiter
+ * wakes. A notify() that comes while nobody is waiting is kept until the
+ * next wait, so no wakeup is lost between checking a flag and waiting.
+ *
+ * notify() is a single write() and safe to call from any thread, including
+ * a sampling thread.
+ */
+class wakeup {
+	private:
+		/**
+		 * @brief The eventfd written by notify().
+		 */
+		int event_fd;
+
+		/**
+		 * @brief The timerfd armed with each deadline.
+		 */
+		int timer_fd;
+
+		/**
+		 * @brief When notify() was last called, from now_ns().
+		 */
+		std::atomic<timestamp_t> notified_ns;
+
+		wakeup(const wakeup&) = delete;
+		wakeup& operator=(const wakeup&) = delete;
+
+	public:
+		/**
+		 * @brief The constructor for a wakeup. Exits the process if the
+		 * 	  file descriptors cannot be created, since nothing that
+		 * 	  depends on being woken can run safely without them.
+		 */
+		wakeup();
+
+		~wakeup();
+
+		/**
+		 * @brief Wakes the waiting thread, or the next one to wait.
+		 */
+		void notify();
+
+		/**
+		 * @brief Sleeps until notified or until the deadline, whichever
+		 * 	  is first.
+		 *
+		 * @param deadline_ns an absolute time from now_ns(), or 0 to wait
+		 * 	  for a notify() however long it takes
+		 *
+		 * @return true if notified, false if the deadline passed.
+		 */
+		bool wait_until(timestamp_t deadline_ns);
+
+		/**
+		 * @brief Gets when notify() was last called, from now_ns(), or 0
+		 * 	  if it never has been.
+		 */
+		timestamp_t last_notified();
+
+		/**
+		 * @brief Gets the current time on the clock deadlines are measured
+		 * 	  on, in nanoseconds.
+		 */
+		static timestamp_t now_ns();
+};
+
+#endif
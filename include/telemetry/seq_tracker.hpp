@@ -0,0 +1,145 @@
+/**
+ * @file seq_tracker.hpp
+ * @brief Receiver-side accounting of lost, reordered and duplicated telemetry.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#ifndef __SEQ_TRACKER_HPP
+#define __SEQ_TRACKER_HPP
+
+#include <deque>
+#include <stdint.h>
+
+#include "adc/adc.hpp"
+#include "circular_buffer/circular_buffer.hpp"
+#include "time/time.hpp"
+
+// Most gaps remembered per sensor, waiting for late packets to fill them
+#define SEQ_MAX_HOLES 64
+
+/**
+ * @brief Counters for the telemetry received from one sensor, or all of them.
+ */
+struct seq_stats {
+	/* @brief Packets received, including duplicates */
+	uint64_t packets;
+
+	/* @brief Distinct samples received */
+	uint64_t samples;
+
+	/* @brief Samples that were skipped over and have not turned up since */
+	uint64_t lost;
+
+	/* @brief Packets that arrived after a later one, filling a gap */
+	uint64_t reordered;
+
+	/* @brief Packets whose samples had all been received already */
+	uint64_t duplicates;
+
+	/* @brief The longest time between two consecutive samples, in us. A gap
+	 * in time with no gap in sequence numbers is a gap in sampling. */
+	timestamp_t max_gap_us;
+
+	/* @brief lost / (samples + lost) */
+	double loss_rate;
+
+	/* @brief reordered / packets */
+	double reorder_rate;
+
+	/* @brief duplicates / packets */
+	double duplicate_rate;
+};
+
+/**
+ * @brief Tracks the sample numbers (see data_item) received for each sensor
+ * 	  to measure how the link behaves.
+ *
+ * Each packet covers a run of consecutive sample numbers. A run that starts
+ * past the next expected number leaves a gap, counted as lost. A run that
+ * starts before it either fills part of a gap, and was reordered, or was
+ * seen before, and is a duplicate.
+ */
+class seq_tracker {
+	private:
+		/**
+		 * @brief What has been received from one sensor.
+		 */
+		struct stream {
+			bool started;
+
+			/* @brief The sample number the stream started from */
+			uint32_t first;
+
+			/* @brief When that sample was read */
+			timestamp_t first_timestamp;
+
+			/* @brief The sample number after the highest received */
+			uint32_t next;
+
+			/* @brief The time of the sample before next */
+			timestamp_t last_timestamp;
+
+			/* @brief Runs of missing sample numbers, [first, end), oldest first */
+			std::deque<std::pair<uint32_t, uint32_t> > holes;
+
+			seq_stats stats;
+		};
+
+		stream streams[SENSOR::NUM_SENSORS];
+
+		/**
+		 * @brief Takes a run of late samples out of the gaps of a stream.
+		 *
+		 * @return The number of samples that filled a gap.
+		 */
+		uint32_t fill(stream &s, uint32_t first, uint32_t end);
+
+		/**
+		 * @brief Starts a stream over from a packet, as when the sender
+		 * 	  first starts or restarts its count.
+		 */
+		void restart(stream &s, const struct data_item *items, uint16_t count);
+
+	public:
+		seq_tracker();
+
+		/**
+		 * @brief Forgets everything received so far.
+		 */
+		void reset();
+
+		/**
+		 * @brief Accounts for one decoded packet.
+		 *
+		 * @param sensor The sensor of the packet.
+		 * @param items The samples of the packet, in order.
+		 * @param count The number of samples.
+		 */
+		void add(SENSOR sensor, const struct data_item *items, uint16_t count);
+
+		/**
+		 * @brief Decodes a received datagram (one packet, or several
+		 * 	  behind a frame_header) and accounts for every packet of
+		 * 	  samples. Valve state, calibrated and filtered packets are
+		 * 	  skipped.
+		 *
+		 * @return The number of packets accounted for, or -1 if the
+		 * 	   datagram was malformed.
+		 */
+		int addDatagram(const uint8_t *buf, uint32_t size);
+
+		/**
+		 * @brief Gets the counters for one sensor.
+		 */
+		void getStats(SENSOR sensor, seq_stats *stats);
+
+		/**
+		 * @brief Gets the counters over every sensor.
+		 */
+		void getTotals(seq_stats *stats);
+};
+
+#endif
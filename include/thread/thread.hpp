@@ -1,7 +1,7 @@
 /**
  * @file thread.hpp
  * @author Tommy Yuan (ty19@rice.edu)
- * @brief Thread that reads and logs sensor data at some frequency.
+ * @brief Thread that reads and logs sensor data on a fixed schedule.
  * @version 0.1
  * @date 2019-07-19
  * 
@@ -12,19 +12,119 @@
 #define __THREAD_HPP
 
 #include <atomic>
+#include <stdint.h>
+#include <string>
 #include <thread>
 #include <vector>
 
 #include "adc/adc.hpp"
 #include "circular_buffer/circular_buffer.hpp"
-#include "logger/logger.hpp"
-#include "networking/Udp.hpp"
+#include "filter/filter_bank.hpp"
+#include "interlock/interlock.hpp"
+#include "io/io_thread.hpp"
+#include "circular_buffer/ring_buffer.hpp"
 
-// Defined in main.cpp
-extern std::atomic<bool> pressureShutoff;
+/**
+ * @brief How a PeriodicThread paces its loop.
+ *
+ * RELATIVE: sleep for one period after each tick's work (the original
+ * 	     behavior). The actual period is the sleep time plus the work time.
+ * DEADLINE: sleep until absolute deadlines on CLOCK_MONOTONIC spaced exactly
+ * 	     one period apart, so the work time does not shift later ticks.
+ */
+enum class SCHED_MODE {
+	RELATIVE = 0,
+	DEADLINE
+};
+
+/**
+ * @brief A snapshot of the timing statistics of a PeriodicThread.
+ *
+ * Jitter is measured as the time between a tick's nominal deadline and the
+ * moment the thread actually started the tick.
+ */
+struct thread_stats {
+	/* @brief The number of ticks run so far */
+	uint64_t ticks;
+
+	/* @brief The number of ticks that started after their deadline had
+	 * 	  already passed, because the previous tick ran too long */
+	uint64_t overruns;
+
+	/* @brief The number of whole periods that were skipped to get back on
+	 * 	  schedule after an overrun */
+	uint64_t missed_periods;
+
+	/* @brief The smallest, largest and mean jitter seen, in nanoseconds */
+	uint64_t min_jitter_ns;
+	uint64_t max_jitter_ns;
+	uint64_t mean_jitter_ns;
+
+	/* @brief The longest time spent doing the work of a single tick, in
+	 * 	  nanoseconds */
+	uint64_t max_work_ns;
+};
+
+/**
+ * @brief The live counters behind a thread_stats snapshot. Written only by
+ * 	  the periodic thread and read by anyone.
+ */
+struct thread_timing {
+	std::atomic<uint64_t> ticks;
+	std::atomic<uint64_t> overruns;
+	std::atomic<uint64_t> missed_periods;
+	std::atomic<uint64_t> min_jitter_ns;
+	std::atomic<uint64_t> max_jitter_ns;
+	std::atomic<uint64_t> total_jitter_ns;
+	std::atomic<uint64_t> max_work_ns;
+
+	thread_timing();
+};
+
+/**
+ * @brief A cyclic-executive schedule of ADC reads.
+ *
+ * The thread runs one minor frame per period of its fastest sensor. Each
+ * sensor is read once every few minor frames (its period) at a fixed offset
+ * (its phase), and the whole pattern repeats every major frame, which is the
+ * least common multiple of the sensor periods. Phases are chosen fastest
+ * sensors first, so that slower sensors fill the least loaded frames.
+ */
+struct frame_schedule {
+	/* @brief The number of minor frames in one major frame */
+	uint32_t num_frames;
 
-class PeriodicThread {
+	/* @brief For each minor frame, the index in batch_starts of its first
+	 * 	  batch. Has num_frames + 1 entries, so frame f is made of batches
+	 * 	  [frame_starts[f], frame_starts[f + 1]) */
+	std::vector<uint32_t> frame_starts;
+
+	/* @brief For each batch, the index in slots of its first read. A batch
+	 * 	  is a run of sensors behind the same chip select, read with one
+	 * 	  adc_reader::read_items() call. Has one extra entry at the end */
+	std::vector<uint32_t> batch_starts;
+
+	/* @brief The indexes in PeriodicThread::buffers to read, frame by frame */
+	std::vector<uint8_t> slots;
+
+	/* @brief The sensor behind each entry of slots */
+	std::vector<uint8_t> sensors;
+};
+
+/**
+ * @brief The acquisition thread. Owns the SPI bus and reads every sensor it is
+ * 	  given at that sensor's rate from SENSOR_FREQS, following a
+ * 	  frame_schedule, so that all reads happen at a deterministic phase.
+ *
+ * Its timing statistics are logged with the I/O thread's periodic report.
+ */
+class PeriodicThread : public io_reporter {
 	private:
+		/**
+		 * @brief The name of the thread, for the log.
+		 */
+		std::string name;
+
 		/**
 		 * @brief The actual thread for this instance. Detached from the main
 		 * 		  process.
@@ -39,90 +139,183 @@ class PeriodicThread {
 		adc_reader reader;
 
 		/**
-		 * @brief List of loggers to which data from corresponding buffers in
-		 * 		  PeriodicThread::buffers will be logged as it is read.
+		 * @brief List of buffers managed by this thread. When a buffer
+		 * 		  fills up its data is packed into a packet and handed to
+		 * 		  the I/O thread through PeriodicThread::queue.
 		 */
-		std::vector<Logger>* loggers;
+		std::vector<circular_buffer *>* buffers;
 
 		/**
-		 * @brief List of buffers managed by this thread. Data will be pulled
-		 * 		  from each one in sequence if it is available, and logged to
-		 * 		  the corresponding logger in PeriodicThread::loggers.
+		 * @brief The queue through which finished packets are handed to
+		 * 		  the I/O thread. This thread is its only producer.
 		 */
-		std::vector<circular_buffer>* buffers;
+		ring_buffer<io_packet> *queue;
 
 		/**
-		 * @brief The time between readings of data from the ADC, in
-		 * 		  nanoseconds. 
+		 * @brief The length of one minor frame, in nanoseconds.
 		 */
 		uint64_t sleep_time_ns;
 
+		/**
+		 * @brief Which sensors to read in each minor frame.
+		 */
+		frame_schedule *schedule;
+
+		/**
+		 * @brief How the thread paces itself, see SCHED_MODE.
+		 */
+		SCHED_MODE mode;
+
+		/**
+		 * @brief Timing counters shared with the running thread.
+		 */
+		thread_timing *timing;
+
+		/**
+		 * @brief The statistics at the last report. Only used by the I/O
+		 * 	  thread.
+		 */
+		thread_stats reported;
+
 		/**
 		 * @brief The total number of sensors connected to the controller.
 		 */
 		uint8_t num_sensors;
-                
-                /**
-                 * @brief Upper limit for pressure values (calibrated, not raw), above which a
-                 *        safety shutoff will occur.
-                 */
-                double pressureMax;
-                
-                /**
-                 * @brief Lower limit for pressure values (calibrated, not raw), above which a
-                 *        safety shutoff will occur.
-                 */
-                double pressureMin;
-                
-                /**
-                 * @brief Slope for the pressure calibration function, used to test for a
-                 *        safety shutoff.
-                 */
-                double pressureSlope;
-                
-                /**
-                 * @brief Y-intercept for the pressure calibration function, used to test
-                 *        for a safety shutoff.
-                 */
-                double pressureYint;
-
-		/**
-		 * @brief The UDP output socket through which data will be sent as it
-		 *        is logged.
-		 */
-		Udp::OutSocket* sock;
+
+		/**
+		 * @brief The safety rules every reading is checked against as it
+		 * 	  is read, or NULL for none.
+		 */
+		interlock *rules;
+
+		/**
+		 * @brief The filters every reading is run through, or NULL for
+		 * 	  none.
+		 */
+		filter_bank *filters;
+
+		/**
+		 * @brief Whether the outputs of the filters are sent as filtered
+		 * 	  packets.
+		 */
+		bool send_filtered;
 
 	public:
 		/**
 		 * @brief The constructor for a Periodic Thread. The thread uses an
-		 * 		  adc_reader() and logger() to periodically read from an ADC
-		 * 	      and save the raw data into a file. Data writes are buffered
-		 * 	  	  using a circular buffer.
+		 * 		  adc_reader() to periodically read from an ADC and hands
+		 * 	      the raw data to an IoThread to be logged and sent. Data
+		 * 	  	  is buffered using a circular buffer.
+		 *
+		 * The minor frame rate is the highest rate in SENSOR_FREQS among
+		 * the given sensors. Every other rate is rounded to a whole
+		 * number of minor frames.
 		 * 	
-		 * @param frequency_hz the frequency to read, in Hertz
 		 * @param sensors the list of sensors to sample
 		 * @param num_sensors the number of sensors to be read
+		 * @param io the I/O thread that will log and send the data
+		 * @param backend where the ADC samples come from
+		 * @param rules the safety rules to check every reading against,
+		 * 	  or NULL for none
+		 * @param format the layout of the packets handed to io
+		 * @param mode how the thread paces its loop
 		 */
 		PeriodicThread(const char *name,
-			       uint16_t frequency_hz,
                                SENSOR *sensors,
                                uint8_t num_sensors,
-                               double pressureMax,
-                               double pressureMin,
-                               double pressureSlope,
-                               double pressureYint,
-                               Udp::OutSocket *sock);
+                               IoThread *io,
+                               adc_backend *backend,
+                               interlock *rules,
+                               PACKET_FORMAT format = PACKET_FORMAT::LEGACY,
+                               SCHED_MODE mode = SCHED_MODE::DEADLINE);
 
 		/**
 		 * @brief Destroy this thread. Frees memory associated with
-		 * 		  PeriodicThread::buffers and PeriodicThread::loggers.
+		 * 		  PeriodicThread::buffers, PeriodicThread::schedule and
+		 * 		  PeriodicThread::timing.
 		 */
 		~PeriodicThread();
 
+		/**
+		 * @brief Bound how long a sensor's readings may wait in its
+		 * 	  circular buffer. Once the oldest reading is that old, a
+		 * 	  partial packet is sent. Must be called before start().
+		 *
+		 * @param sensor the sensor to bound
+		 * @param max_latency_ms the bound in milliseconds, or 0 to only
+		 * 	  send full packets
+		 */
+		void setMaxLatency(SENSOR sensor, uint32_t max_latency_ms);
+
+		/**
+		 * @brief Run every reading through a filter_bank, whose outputs are
+		 * 	  checked by the rules on filtered sensors. Must be called
+		 * 	  before start().
+		 *
+		 * @param filters the filters, or NULL for none
+		 * @param send whether to hand the outputs of filtered sensors to
+		 * 	  the I/O thread as filtered packets
+		 */
+		void setFilters(filter_bank *filters, bool send);
+
 		/**
 		 * @brief Start this thread collecting and sending data autonomously.
 		 */
 		void start();
+
+		/**
+		 * @brief Take a snapshot of this thread's timing statistics. Safe
+		 * 	  to call while the thread is running.
+		 *
+		 * @param stats The snapshot to fill in.
+		 */
+		void getStats(thread_stats *stats);
+
+		/**
+		 * @brief Log the ticks, overruns and missed periods since the last
+		 * 	  report, and the jitter and longest tick so far.
+		 */
+		void report(Logger *log, double elapsed_s);
 };
 
+/**
+ * @brief Sleep until the next absolute deadline, one period after
+ * 	  *deadline_ns, on CLOCK_MONOTONIC.
+ *
+ * If that deadline has already passed it is an overrun, and there is no sleep.
+ * Any whole periods missed are skipped rather than run back to back.
+ *
+ * @param missed set to the number of periods skipped
+ *
+ * @return The deadline of the new tick, also left in *deadline_ns.
+ */
+uint64_t wait_deadline(uint64_t *deadline_ns, uint64_t period_ns,
+    thread_timing *timing, uint64_t *missed);
+
+/**
+ * @brief Record the jitter and work time of a tick that was meant to start at
+ * 	  deadline_ns, started at start_ns and finished at end_ns.
+ */
+void record_tick(thread_timing *timing, uint64_t deadline_ns,
+    uint64_t start_ns, uint64_t end_ns);
+
+/**
+ * @brief The minor frame to run after frame, when missed periods were
+ * 	  skipped. Skipped periods skip their frames too, so each sensor keeps
+ * 	  its slot.
+ */
+uint32_t next_frame(const frame_schedule *schedule, uint32_t frame,
+    uint64_t missed);
+
+/**
+ * @brief Store a reading in a sensor's buffer. If the buffer is full, its
+ * 	  packet is handed to the I/O thread first, or dropped if the queue is
+ * 	  full too, so the new reading itself is never lost.
+ *
+ * @param scratch IO_PACKET_SIZE bytes to empty the buffer into if the queue
+ * 	  is full
+ */
+void store_reading(circular_buffer *buffer, ring_buffer<io_packet> *queue,
+    uint8_t *scratch, uint16_t reading, timestamp_t timestamp);
+
 #endif
@@ -18,10 +18,25 @@
 /* A long time in nanoseconds */
 typedef uint64_t timestamp_t;
 
+/*
+ * Elapsed Time
+ * 	Elapsed times count from an epoch taken once, before any other static
+ * 	initialization, on CLOCK_MONOTONIC_RAW where the kernel has it. That
+ * 	clock is never stepped or slewed by NTP, so times never go backwards
+ * 	and every thread agrees on where zero is. clock_gettime() reads it
+ * 	through the vDSO, without a system call.
+ */
+
 /**
- * @brief Sets the start time if it has not been set already
+ * @brief The elapsed time of one tick of an acquisition loop, in every unit,
+ * 	  from a single reading of the clock.
  */
-void set_start_time();
+struct time_tick {
+	timestamp_t s;
+	timestamp_t ms;
+	timestamp_t us;
+	timestamp_t ns;
+};
 
 /**
  * @brief Gets time formatted according to ISO 8601 
@@ -48,4 +63,10 @@ timestamp_t get_elapsed_time_us();
  */
 timestamp_t get_elapsed_time_ns();
 
+/**
+ * @brief Stamps a tick with the elapsed time, so every reading taken in it
+ * 	  can share one timestamp instead of reading the clock for each.
+ */
+void stamp_tick(struct time_tick *tick);
+
 #endif
@@ -0,0 +1,121 @@
+/**
+ * @file command_dispatcher.hpp
+ * @brief Turns the bytes sent by command clients into visited commands.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#ifndef __COMMAND_DISPATCHER_HPP
+#define __COMMAND_DISPATCHER_HPP
+
+#include <map>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "io/io_thread.hpp"
+#include "logger/logger.hpp"
+#include "networking/CommandProtocol.hpp"
+#include "networking/CommandServer.hpp"
+#include "time/time.hpp"
+#include "visitor/worker_visitor.hpp"
+
+// Most packets sent back for one retransmit request
+#define MAX_RETRANSMIT_PACKETS 256
+
+// Bytes of arguments after a REQUEST_RETRANSMIT: the sensor (u8), then the
+// first sample and count (u32 each, little-endian)
+#define RETRANSMIT_ARGS_SIZE 9
+
+/**
+ * @brief Handles everything the command clients send.
+ *
+ * Commands arrive in one of two forms, which can be mixed:
+ *
+ * 	- Legacy: a single command byte, with no reply. '0' asks to be
+ * 	  disconnected.
+ * 	- Framed: a command_frame_header followed by one or more commands,
+ * 	  each acked with a command_ack saying when it was received,
+ * 	  dispatched and actuated.
+ *
+ * Only the operator's commands reach the visitor; observers can only ask for
+ * retransmissions. The reply to a REQUEST_RETRANSMIT (after its ack, if it
+ * was framed) is the number of packets found (u16), then each packet as a
+ * u16 length and its bytes.
+ */
+class CommandDispatcher : public Tcp::CommandHandler {
+	private:
+		/**
+		 * @brief The visitor that carries out commands, or NULL to only
+		 * 	  log them.
+		 */
+		WorkerVisitor *visitor;
+
+		/**
+		 * @brief Where retransmissions come from.
+		 */
+		IoThread *io_thread;
+
+		Logger *logger;
+
+		/**
+		 * @brief The seq after the last framed command from each client,
+		 * 	  so resent frames are not carried out twice.
+		 */
+		std::map<Tcp::Client *, uint32_t> next_seq;
+
+		/**
+		 * @brief Gets the number of bytes of arguments a command takes.
+		 */
+		static size_t argsSize(uint8_t command);
+
+		/**
+		 * @brief Answers a REQUEST_RETRANSMIT from the cache of sent packets.
+		 *
+		 * @param args the command's arguments
+		 */
+		void retransmit(Tcp::Client &client, const uint8_t *args);
+
+		/**
+		 * @brief Carries out one command.
+		 *
+		 * @param command the command byte, followed by its arguments
+		 * @param ack if not NULL, filled in with the command's status and
+		 * 	  times
+		 */
+		void dispatch(Tcp::Client &client, const uint8_t *command,
+		    command_ack *ack);
+
+		/**
+		 * @brief Handles a whole command frame, sending an ack per command.
+		 *
+		 * Commands with a seq the client already sent are acked as
+		 * CMD_DUPLICATE without being carried out, except retransmit
+		 * requests, which change nothing and whose reply the client is
+		 * waiting for.
+		 */
+		void handleFrame(Tcp::Client &client, const command_frame_header *header,
+		    const uint8_t *commands, timestamp_t received_ns);
+
+	public:
+		/**
+		 * @brief The constructor for a CommandDispatcher.
+		 *
+		 * @param visitor carries out the operator's commands, or NULL to
+		 * 	  only log them (as the mock build does)
+		 * @param io_thread where retransmissions come from
+		 * @param logger where commands and connections are logged
+		 */
+		CommandDispatcher(WorkerVisitor *visitor, IoThread *io_thread, Logger *logger);
+
+		size_t handle(Tcp::Client &client, const uint8_t *buf, size_t n);
+
+		void connected(Tcp::Client &client);
+
+		void promoted(Tcp::Client &client);
+
+		void disconnected(Tcp::Client &client, const char *reason);
+};
+
+#endif
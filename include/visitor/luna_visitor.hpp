@@ -53,6 +53,13 @@ class LunaVisitor : public WorkerVisitor {
 	 */
 	std::vector<uint32_t> gitvc_times_ms;
 
+	/**
+	 * @brief Builds the GITVC sequence from the times above.
+	 *
+	 * @param pin the GITVC valve's pin
+	 */
+	sequence buildGITVC(uint8_t pin);
+
     public:
 		/**
 		 * @brief Visits a command by performing the function associated
@@ -62,6 +69,8 @@ class LunaVisitor : public WorkerVisitor {
 
 		/**
 		 * @brief Perform GITVC actuations according to the data in WorkerVisitor::config.
+		 * 	  They come from [Sequence:gitvc] if there is one, otherwise
+		 * 	  from the [Luna] times and gitvc_pin.
 		 */
 		void doGITVC();
 
@@ -13,6 +13,8 @@
 #define __WORKER_VISITOR_HPP
 
 #include <atomic>
+#include <map>
+#include <string>
 #include <vector>
 #include <time.h>
 #include <stdint.h>
@@ -20,9 +22,10 @@
 #include "time/time.hpp"
 #include "config/config.hpp"
 #include "logger/logger.hpp"
-
-// Time between checks for ignition state, in milliseconds (see WorkerVisitor::doIgn())
-#define IGN_CHECK_MS 50
+#include "sequencer/sequence.hpp"
+#include "sequencer/sequencer.hpp"
+#include "sequencer/valve_state.hpp"
+#include "sequencer/wakeup.hpp"
 
 /**
  * 0 - 13 (inclusive) are reserved for general I/O.
@@ -49,7 +52,7 @@ enum COMMAND: uint8_t {
     TITAN_TAPE_ON,
     TITAN_TAPE_OFF,
     TITAN_DEF,
-	RESERVED20,
+	REQUEST_RETRANSMIT, // Followed by a sensor, first sample and count; see IoThread::resend()
 	RESERVED21,
 	RESERVED22,
 	RESERVED23,
@@ -72,6 +75,12 @@ extern std::atomic<bool> ignitionOn;
 // Defined in main.cpp
 extern std::atomic<bool> pressureShutoff;
 
+// Defined in main.cpp. Wakes the ignition thread when either of the above is set.
+extern wakeup ignitionWakeup;
+
+// Defined in main.cpp. Every write to an output pin goes through it.
+extern valve_state valves;
+
 /**
  * @brief Defines the superclass for the Luna and Titan visitors.
  * 	  A visitor "visits" a received command performs the appropriate
@@ -110,6 +119,59 @@ class WorkerVisitor {
          */
         bool enableShutoff;
 
+		/**
+		 * @brief When a command last wrote a pin, or 0 if none has.
+		 */
+		timestamp_t last_actuation_ns;
+
+		/**
+		 * @brief The sequences this visitor can play, by name.
+		 */
+		std::map<std::string, sequence> sequences;
+
+		/**
+		 * @brief Plays the sequences on time, on its own thread.
+		 */
+		sequencer sequence_runner;
+
+	protected:
+		/**
+		 * @brief Writes an output pin on behalf of a command, noting when
+		 * 	  it was written (see getLastActuation()).
+		 *
+		 * @param pin the pin to write
+		 * @param level HIGH or LOW
+		 */
+		void writePin(uint8_t pin, uint8_t level);
+
+		/**
+		 * @brief Writes several output pins at once on behalf of a
+		 * 	  command, like writePin().
+		 */
+		void writePins(const pin_masks& masks);
+
+		/**
+		 * @brief Loads the sequence in the config section Sequence:<name>,
+		 * 	  if there is one, so runSequence() can play it.
+		 *
+		 * @return true if the sequence was loaded.
+		 */
+		bool loadSequence(ConfigMapping& config, const char *name);
+
+		/**
+		 * @brief Adds a sequence built in code, replacing any loaded with
+		 * 	  the same name.
+		 */
+		void addSequence(const sequence& seq);
+
+		/**
+		 * @brief Starts playing a sequence on the sequencer thread.
+		 *
+		 * @return false if there is no such sequence, or another is still
+		 * 	   playing.
+		 */
+		bool runSequence(const char *name);
+
 	public:
 		/**
 		 * @brief The logger for this worker.
@@ -134,6 +196,19 @@ class WorkerVisitor {
 		 */
         virtual void visitCommand(COMMAND c);
 
+		/**
+		 * @brief Gets when the last pin written by a command was written,
+		 * 	  from get_elapsed_time_ns(), or 0 if none has been. Pins
+		 * 	  written later by the ignition thread are not counted.
+		 */
+		timestamp_t getLastActuation();
+
+		/**
+		 * @brief Gets the sequencer playing this visitor's sequences, so
+		 * 	  safety checks can abort them.
+		 */
+		sequencer *getSequencer();
+
 		/**
 		 * @brief Logger that is used by ignThreadFunc for info messages.
 		 */
@@ -2,7 +2,12 @@ import struct
 
 """
 File for converting binary logs on the Pi into human-readable logs. The format string
-is hard-coded based on the format of the data written to the binary logs.
+is hard-coded based on the format of the data written to the binary logs. Both the
+legacy 260-byte packets and the compact packets (packet_format=compact) are read;
+valve state, calibrated and filtered packets are skipped.
+
+Recordings (Recording_*.rec), and large logs in general, are much faster to decode
+with the resfet_decode tool built next to resfet.
 """
 
 format_string = "h6xQ"
@@ -26,29 +31,94 @@ cals = {"LC1": (0.4321, -304.38),
         }
 
 
+COMPACT_MAGIC = 0xA5
+VALVE_MAGIC = 0xA6
+CALIBRATED_MAGIC = 0xA7
+FILTERED_MAGIC = 0xA8
+COMPACT_IMPLICIT_PERIOD = 0x01
+COMPACT_WIDE_DELTAS = 0x02
+compact_header_format = "<BBBBHHQ"
+
+
+def decode_legacy(data_bytes):
+    """Returns the (timestamp, reading) pairs of a legacy packet."""
+    # TODO do some verification with the header type
+    header = data_bytes[:4]
+    data = data_bytes[4:]
+    # print("data size", len(data))
+    samples = []
+    for i in range(len(data) // 16):
+        d, t = struct.unpack(format_string, bytes(data[i*16:i*16+16]))
+        samples.append((t, d))
+    return samples
+
+
+def decode_compact(data_bytes):
+    """Returns the (timestamp, reading) pairs of a compact packet (see packet.hpp)."""
+    magic, version, sensor, flags, length, count, base = \
+        struct.unpack_from(compact_header_format, data_bytes)
+    offset = struct.calcsize(compact_header_format)
+
+    # Version 2 adds the packet and first sample numbers
+    if version >= 2:
+        offset += 8
+
+    times = [base]
+    if flags & COMPACT_IMPLICIT_PERIOD:
+        period, = struct.unpack_from("<I", data_bytes, offset)
+        offset += 4
+        times += [base + i * period for i in range(1, count)]
+    else:
+        delta_format = "<i" if flags & COMPACT_WIDE_DELTAS else "<H"
+        for _ in range(count - 1):
+            delta, = struct.unpack_from(delta_format, data_bytes, offset)
+            offset += struct.calcsize(delta_format)
+            times.append(times[-1] + delta)
+
+    readings = []
+    for i in range(0, count, 2):
+        b = data_bytes[offset:offset + 3]
+        readings.append(b[0] | ((b[1] & 0x0F) << 8))
+        if i + 1 < count:
+            readings.append((b[1] >> 4) | (b[2] << 4))
+        offset += 3
+
+    return list(zip(times[:count], readings))
+
+
 for i in range(len(filenames)):
     filename = filenames[i]
     # mtype = bytes([9 + i])                                                                              
 
     with open(read_filepath + filename + '.log', 'rb') as f, open(write_filepath + filename + '_Decoded.log', 'w') as p:
 
-        f.seek(0, 2)
-        file_size = f.tell()
-        f.seek(0, 0)
+        log = f.read()
+        offset = 0
 
-        # print("File size", file_size, file_size / 260.0)
+        # print("File size", len(log), len(log) / 260.0)
 
-        for _ in range(int(file_size // 260)):
-            data_line = f.read(260)
-            data_bytes = bytes(data_line)
+        # Logs are legacy or compact packets, told apart by their first byte
+        while offset < len(log):
+            # Partial packets (see *_max_latency_ms) are shorter than 260 bytes
+            if log[offset] in (COMPACT_MAGIC, CALIBRATED_MAGIC, FILTERED_MAGIC):
+                length, = struct.unpack_from("<H", log, offset + 4)
+            else:
+                length, = struct.unpack_from("<H", log, offset + 2)
+            if length == 0 or offset + length > len(log):
+                break
 
-            # TODO do some verification with the header type
-            header = data_bytes[:4]
-            data = data_bytes[4:]
-            # print("data size", len(data))
-            for i in range(256 // 16):
-                d, t = struct.unpack(format_string, bytes(data[i*16:i*16+16]))
+            data_bytes = log[offset:offset + length]
+            if log[offset] == COMPACT_MAGIC:
+                samples = decode_compact(data_bytes)
+            elif log[offset] in (VALVE_MAGIC, CALIBRATED_MAGIC, FILTERED_MAGIC):
+                # Valve states and readings already converted on board have
+                # no raw samples to calibrate here
+                samples = []
+            else:
+                samples = decode_legacy(data_bytes)
+            offset += length
 
+            for t, d in samples:
                 cal = cals[filename][0] * d + cals[filename][1]
 
                 p.write(str(t) + " " + str(d) + " " + str(cal) + "\n")
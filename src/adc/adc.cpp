@@ -9,11 +9,11 @@
  */
 
 #include <bcm2835.h>
-#include <byteswap.h>
 #include <mutex>
 #include <stdint.h>
 
 #include "adc/adc.hpp"
+#include "adc/adc_backend.hpp"
 
 /**
  * @brief Global lock to ensure sequential ADC reads.
@@ -94,53 +94,49 @@ char SENSOR_NAMES[NUM_SENSORS][20] = {
 	"TC4"
 };
 
-adc_reader::adc_reader() {
-}
+adc_reader::adc_reader()
+	: backend(default_backend())
+	{};
+
+adc_reader::adc_reader(adc_backend *backend)
+	: backend(backend)
+	{};
 
 uint16_t adc_reader::read_item(uint8_t sensor_index) {
-	// Lock the mutex.
-	adc_mutex.lock();
-	
-	adc_info info;
+	uint16_t reading;
 
-	if (sensor_index < 0 || sensor_index > SENSOR::NUM_SENSORS)
+	if (read_items(&sensor_index, 1, &reading) != 1)
 		return -1;
-	info = adc_infos[sensor_index];
 
-	/*
-	 * See datasheet for MCP3204 ADC for the SPI interface.
-	 *
-	 * Set on, single mode, channel.
-	 */
-	char channel = 0x01 << 4 | 0x01 << 3 | (char) info.channel;
-	char write_buf[3] = {channel, 0, 0};
-	char read_buf[3] = {0, 0, 0};
+	return reading;
+}
 
-	// bcm2835_spi_chipSelect(info.cs_pin);
-	bcm2835_spi_chipSelect(BCM2835_SPI_CS_NONE);
-	bcm2835_gpio_write(info.cs_pin, LOW);
+uint8_t adc_reader::read_items(const uint8_t *sensor_indexes, uint8_t num,
+    uint16_t *readings)
+{
+	uint8_t index;
 
-	bcm2835_spi_transfernb(write_buf, read_buf, 3);
+	/* Check everything up front so the bus is never held for a bad request */
+	for (index = 0; index < num; index++) {
+		if (sensor_indexes[index] >= SENSOR::NUM_SENSORS)
+			return 0;
+	}
 
-	bcm2835_gpio_write(info.cs_pin, HIGH);
+	// Lock the mutex once for the whole batch.
+	adc_mutex.lock();
 
-	/* Annoying formatting because the return value is split across two bytes. */
-	read_buf[2] = (uint8_t)(((read_buf[2] >> 2) | ((read_buf[1] & 0x03) << 6)) & 0xFF);
-	read_buf[1] = (uint8_t)((read_buf[1] >> 2) & 0xFF);
+	backend->begin();
+	for (index = 0; index < num; index++)
+		readings[index] = backend->convert(sensor_indexes[index],
+		    adc_infos[sensor_indexes[index]]);
 
 	adc_mutex.unlock();
 
-	/* Swap endianness of last two bytes and return */
-	return __bswap_16(*(uint16_t *)(read_buf + 1));
-}
-
-uint16_t adc_reader::count_up() {
-	static uint16_t num = 0;
-	return num++;
+	return num;
 }
 
 void adc_reader::add_adc_info(uint8_t sensor_index, RPiGPIOPin cs_pin, uint8_t channel) {
-	if (sensor_index < 0 || sensor_index > SENSOR::NUM_SENSORS)
+	if (sensor_index >= SENSOR::NUM_SENSORS)
 		return;
 
 	adc_infos[sensor_index] = adc_info(cs_pin, channel);
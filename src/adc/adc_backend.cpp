@@ -0,0 +1,321 @@
+/**
+ * @file adc_backend.cpp
+ * @brief Sources of samples for the adc_reader.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <bcm2835.h>
+#include <byteswap.h>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "adc/adc.hpp"
+#include "adc/adc_backend.hpp"
+#include "circular_buffer/packet.hpp"
+#include "config/config.hpp"
+#include "recorder/recorder.hpp"
+
+// Most samples in one logged packet
+#define REPLAY_MAX_ITEMS	1024
+
+#ifdef MOCK
+/*
+ * Stand-ins for the SPI bus in the mock build, so that everything around the
+ * transfer (locking, framing and decoding) can run and be measured off the Pi.
+ */
+static inline void bus_begin() {}
+
+static inline void bus_select(RPiGPIOPin, uint8_t) {}
+
+static inline void bus_transfer(char *write_buf, char *read_buf) {
+	/* Answer with the channel number as the reading */
+	read_buf[0] = 0;
+	read_buf[1] = 0;
+	read_buf[2] = (write_buf[0] & 0x07) << 2;
+}
+#else
+static inline void bus_begin() {
+	// bcm2835_spi_chipSelect(info.cs_pin);
+	bcm2835_spi_chipSelect(BCM2835_SPI_CS_NONE);
+}
+
+static inline void bus_select(RPiGPIOPin cs_pin, uint8_t level) {
+	bcm2835_gpio_write(cs_pin, level);
+}
+
+static inline void bus_transfer(char *write_buf, char *read_buf) {
+	bcm2835_spi_transfernb(write_buf, read_buf, 3);
+}
+#endif
+
+void bcm2835_backend::begin() {
+	bus_begin();
+}
+
+uint16_t bcm2835_backend::convert(uint8_t, const adc_info &info) {
+	/*
+	 * See datasheet for MCP3204 ADC for the SPI interface.
+	 *
+	 * Set on, single mode, channel.
+	 */
+	char channel = 0x01 << 4 | 0x01 << 3 | (char) info.channel;
+	char write_buf[3] = {channel, 0, 0};
+	char read_buf[3] = {0, 0, 0};
+
+	/*
+	 * The chip select has to be raised after every conversion for the ADC
+	 * to accept the next start bit, so each channel is its own 3-byte
+	 * transfer even when several are read together.
+	 */
+	bus_select(info.cs_pin, LOW);
+	bus_transfer(write_buf, read_buf);
+	bus_select(info.cs_pin, HIGH);
+
+	/* Annoying formatting because the return value is split across two bytes. */
+	read_buf[2] = (uint8_t)(((read_buf[2] >> 2) | ((read_buf[1] & 0x03) << 6)) & 0xFF);
+	read_buf[1] = (uint8_t)((read_buf[1] >> 2) & 0xFF);
+
+	/* Swap endianness of last two bytes and return */
+	return __bswap_16(*(uint16_t *)(read_buf + 1));
+}
+
+static uint64_t monotonic_us() {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+synthetic_backend::synthetic_backend(ConfigMapping& config)
+	: rng(0x2545F491)
+	, start_us(monotonic_us())
+{
+	char value[MAX_CONFIG_LENGTH], type[MAX_CONFIG_LENGTH];
+	uint32_t period_ms;
+	waveform wave;
+
+	for (int index = 0; index < SENSOR::NUM_SENSORS; index++) {
+		/* By default, ramp over the whole range once a second */
+		wave.type = WAVEFORM::RAMP;
+		wave.min = 0;
+		wave.max = ADC_MAX_READING;
+		wave.period_us = 1000000;
+		wave.noise = 0;
+
+		if (config.getString("Mock", SENSOR_NAMES[index], value, MAX_CONFIG_LENGTH) == 0) {
+			if (sscanf(value, "%63[^,],%lf,%lf,%u,%lf", type, &wave.min,
+			    &wave.max, &period_ms, &wave.noise) < 4) {
+				printf("Malformed waveform for %s: %s\n", SENSOR_NAMES[index], value);
+			} else {
+				wave.period_us = (uint64_t)period_ms * 1000;
+
+				if (strcmp(type, "constant") == 0)
+					wave.type = WAVEFORM::CONSTANT;
+				else if (strcmp(type, "ramp") == 0)
+					wave.type = WAVEFORM::RAMP;
+				else if (strcmp(type, "sine") == 0)
+					wave.type = WAVEFORM::SINE;
+				else if (strcmp(type, "noise") == 0)
+					wave.type = WAVEFORM::NOISE;
+				else if (strcmp(type, "pressure") == 0)
+					wave.type = WAVEFORM::PRESSURE;
+				else
+					printf("Unknown waveform for %s: %s\n", SENSOR_NAMES[index], type);
+			}
+		}
+
+		setWaveform(index, wave);
+	}
+}
+
+void synthetic_backend::setWaveform(uint8_t sensor_index, const waveform &wave) {
+	if (sensor_index >= SENSOR::NUM_SENSORS)
+		return;
+
+	waves[sensor_index] = wave;
+	if (waves[sensor_index].period_us == 0)
+		waves[sensor_index].period_us = 1;
+}
+
+/*
+ * The shape of a burn, from 0 (idle) to 1 (full pressure), at a point 0 <= x < 1
+ * through the cycle.
+ */
+static double pressure_profile(double x) {
+	if (x < 0.1)
+		return 0;		// idle before ignition
+	if (x < 0.15)
+		return (x - 0.1) / 0.05;	// fast rise
+	if (x < 0.7)
+		return 1 - 0.1 * (x - 0.15) / 0.55;	// plateau, decaying slightly
+	if (x < 0.8)
+		return 0.9 * (0.8 - x) / 0.1;	// tail-off
+	return 0;			// idle after shutdown
+}
+
+uint16_t synthetic_backend::convert(uint8_t sensor_index, const adc_info &) {
+	const waveform &wave = waves[sensor_index];
+	double x, value, random;
+
+	x = (double)((monotonic_us() - start_us) % wave.period_us) / wave.period_us;
+
+	/* xorshift32, scaled to [0, 1) */
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	random = (double)rng / 4294967296.0;
+
+	switch (wave.type) {
+		case WAVEFORM::RAMP:
+			value = wave.min + (wave.max - wave.min) * x;
+			break;
+		case WAVEFORM::SINE:
+			value = (wave.min + wave.max) / 2 +
+			    (wave.max - wave.min) / 2 * sin(2 * M_PI * x);
+			break;
+		case WAVEFORM::NOISE:
+			value = wave.min + (wave.max - wave.min) * random;
+			break;
+		case WAVEFORM::PRESSURE:
+			value = wave.min + (wave.max - wave.min) * pressure_profile(x);
+			break;
+		case WAVEFORM::CONSTANT:
+		default:
+			value = wave.min;
+			break;
+	}
+
+	value += wave.noise * (2 * random - 1);
+
+	if (value < 0)
+		return 0;
+	if (value > ADC_MAX_READING)
+		return ADC_MAX_READING;
+	return (uint16_t)value;
+}
+
+replay_backend::replay_backend(ConfigMapping& config) {
+	char key[MAX_CONFIG_LENGTH], filename[MAX_CONFIG_LENGTH];
+	int loaded;
+
+	for (int index = 0; index < SENSOR::NUM_SENSORS; index++) {
+		positions[index] = 0;
+
+		if (snprintf(key, MAX_CONFIG_LENGTH, "replay_%s", SENSOR_NAMES[index]) >=
+		    MAX_CONFIG_LENGTH ||
+		    config.getString("Mock", key, filename, MAX_CONFIG_LENGTH) != 0)
+			continue;
+
+		if ((loaded = load(index, filename)) < 0)
+			printf("Could not replay %s from %s\n", SENSOR_NAMES[index], filename);
+		else
+			printf("Replaying %d readings for %s from %s\n", loaded,
+			    SENSOR_NAMES[index], filename);
+	}
+}
+
+int replay_backend::load(uint8_t sensor_index, const char *filename) {
+	std::ifstream file(filename, std::ifstream::binary);
+	std::vector<uint8_t> log;
+	struct data_item items[REPLAY_MAX_ITEMS];
+	uint32_t offset = 0;
+	uint16_t length, count;
+	SENSOR sensor;
+
+	if (sensor_index >= SENSOR::NUM_SENSORS || !file)
+		return -1;
+
+	if (is_recording(filename))
+		return loadRecording(sensor_index, filename);
+
+	log.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+	samples[sensor_index].clear();
+	positions[sensor_index] = 0;
+
+	/* The log is legacy or compact packets back to back; stop at the first bad one */
+	while (offset < log.size() &&
+	       (length = decode_packet(&log[offset], log.size() - offset, &sensor,
+	           items, REPLAY_MAX_ITEMS, &count)) != 0) {
+		for (int index = 0; index < count; index++)
+			samples[sensor_index].push_back(items[index].reading);
+		offset += length;
+	}
+
+	return samples[sensor_index].size();
+}
+
+int replay_backend::loadRecording(uint8_t sensor_index, const char *filename) {
+	struct data_item items[REPLAY_MAX_ITEMS];
+	recording_reader recording;
+	const uint8_t *data;
+	uint16_t length, count;
+	uint8_t channel;
+	SENSOR sensor;
+	int wanted;
+
+	if (recording.open(filename) != 0 ||
+	    (wanted = recording.findChannel(SENSOR_NAMES[sensor_index])) < 0)
+		return -1;
+
+	samples[sensor_index].clear();
+	positions[sensor_index] = 0;
+
+	/* Only this sensor's packets, skipping any that are not readings */
+	while (recording.next(&channel, &data, &length)) {
+		if (channel != wanted ||
+		    decode_packet(data, length, &sensor, items, REPLAY_MAX_ITEMS, &count) == 0)
+			continue;
+
+		for (int index = 0; index < count; index++)
+			samples[sensor_index].push_back(items[index].reading);
+	}
+
+	return samples[sensor_index].size();
+}
+
+uint16_t replay_backend::convert(uint8_t sensor_index, const adc_info &) {
+	std::vector<uint16_t> &recording = samples[sensor_index];
+	uint16_t reading;
+
+	if (recording.empty())
+		return 0;
+
+	reading = recording[positions[sensor_index]];
+	if (++positions[sensor_index] == recording.size())
+		positions[sensor_index] = 0;
+
+	return reading;
+}
+
+adc_backend *default_backend() {
+	static bcm2835_backend backend;
+
+	return &backend;
+}
+
+adc_backend *make_mock_backend(ConfigMapping& config) {
+	char name[MAX_CONFIG_LENGTH];
+
+	if (config.getString("Mock", "backend", name, MAX_CONFIG_LENGTH) != 0)
+		strcpy(name, "synthetic");
+
+	printf("Using the %s ADC backend\n", name);
+
+	if (strcmp(name, "bus") == 0)
+		return new bcm2835_backend();
+	if (strcmp(name, "replay") == 0)
+		return new replay_backend(config);
+	if (strcmp(name, "synthetic") != 0)
+		printf("Unknown ADC backend %s, using synthetic\n", name);
+
+	return new synthetic_backend(config);
+}
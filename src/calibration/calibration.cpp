@@ -0,0 +1,157 @@
+/**
+ * @file calibration.cpp
+ * @brief Conversion of raw ADC readings to engineering units.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define CALIBRATE_NEON
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define CALIBRATE_AVX2
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define CALIBRATE_SSE2
+#endif
+
+#include "adc/adc.hpp"
+#include "calibration/calibration.hpp"
+#include "config/config.hpp"
+
+void calibrate_block_scalar(const uint16_t *raw, float *out, size_t n,
+    float slope, float yint)
+{
+	for (size_t index = 0; index < n; index++)
+		out[index] = (float)raw[index] * slope + yint;
+}
+
+/*
+ * Each kernel widens 8 readings at a time to floats, multiplies then adds
+ * (never fused, so the results match calibrate_block_scalar() exactly), and
+ * leaves the tail to the scalar loop.
+ */
+void calibrate_block(const uint16_t *raw, float *out, size_t n, float slope,
+    float yint)
+{
+	size_t index = 0;
+
+#if defined(CALIBRATE_NEON)
+	float32x4_t vslope = vdupq_n_f32(slope), vyint = vdupq_n_f32(yint);
+
+	for (; index + 8 <= n; index += 8) {
+		uint16x8_t words = vld1q_u16(raw + index);
+		float32x4_t low = vcvtq_f32_u32(vmovl_u16(vget_low_u16(words)));
+		float32x4_t high = vcvtq_f32_u32(vmovl_u16(vget_high_u16(words)));
+
+		vst1q_f32(out + index, vaddq_f32(vmulq_f32(low, vslope), vyint));
+		vst1q_f32(out + index + 4, vaddq_f32(vmulq_f32(high, vslope), vyint));
+	}
+#elif defined(CALIBRATE_AVX2)
+	__m256 vslope = _mm256_set1_ps(slope), vyint = _mm256_set1_ps(yint);
+
+	for (; index + 8 <= n; index += 8) {
+		__m128i words = _mm_loadu_si128((const __m128i *)(raw + index));
+		__m256 values = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(words));
+
+		_mm256_storeu_ps(out + index,
+		    _mm256_add_ps(_mm256_mul_ps(values, vslope), vyint));
+	}
+#elif defined(CALIBRATE_SSE2)
+	__m128 vslope = _mm_set1_ps(slope), vyint = _mm_set1_ps(yint);
+	__m128i zero = _mm_setzero_si128();
+
+	for (; index + 8 <= n; index += 8) {
+		__m128i words = _mm_loadu_si128((const __m128i *)(raw + index));
+		__m128 low = _mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero));
+		__m128 high = _mm_cvtepi32_ps(_mm_unpackhi_epi16(words, zero));
+
+		_mm_storeu_ps(out + index, _mm_add_ps(_mm_mul_ps(low, vslope), vyint));
+		_mm_storeu_ps(out + index + 4, _mm_add_ps(_mm_mul_ps(high, vslope), vyint));
+	}
+#endif
+
+	calibrate_block_scalar(raw + index, out + index, n - index, slope, yint);
+}
+
+const char *calibrate_kernel() {
+#if defined(CALIBRATE_NEON)
+	return "neon";
+#elif defined(CALIBRATE_AVX2)
+	return "avx2";
+#elif defined(CALIBRATE_SSE2)
+	return "sse2";
+#else
+	return "scalar";
+#endif
+}
+
+calibration_table::calibration_table() {
+	for (int index = 0; index < SENSOR::NUM_SENSORS; index++) {
+		slopes[index] = 1;
+		yints[index] = 0;
+	}
+}
+
+void calibration_table::set(SENSOR sensor, float slope, float yint) {
+	slopes[sensor] = slope;
+	yints[sensor] = yint;
+}
+
+float calibration_table::getSlope(SENSOR sensor) const {
+	return slopes[sensor];
+}
+
+float calibration_table::getYint(SENSOR sensor) const {
+	return yints[sensor];
+}
+
+int calibration_table::load(ConfigMapping &config) {
+	double pt_slope = CALIBRATION_DEFAULT_PT_SLOPE, pt_yint = CALIBRATION_DEFAULT_PT_YINT;
+	char value[MAX_CONFIG_LENGTH];
+	float slope, yint;
+	int err = 0;
+
+	/* The PTs share the [Pressure] calibration unless given their own */
+	config.getDouble("Pressure", "pressure_slope", &pt_slope);
+	config.getDouble("Pressure", "pressure_yint", &pt_yint);
+
+	for (int index = 0; index < SENSOR::NUM_SENSORS; index++) {
+		if (strncmp(SENSOR_NAMES[index], "PT", 2) == 0)
+			set((SENSOR)index, pt_slope, pt_yint);
+		else
+			set((SENSOR)index, 1, 0);
+
+		if (config.getString("Calibration", SENSOR_NAMES[index], value,
+		    MAX_CONFIG_LENGTH) != 0)
+			continue;
+
+		if (sscanf(value, "%f,%f", &slope, &yint) != 2 || slope == 0) {
+			printf("[Calibration] malformed %s: %s\n", SENSOR_NAMES[index], value);
+			err = 1;
+			continue;
+		}
+
+		set((SENSOR)index, slope, yint);
+	}
+
+	return err;
+}
+
+float calibration_table::convert(SENSOR sensor, uint16_t raw) const {
+	return (float)raw * slopes[sensor] + yints[sensor];
+}
+
+void calibration_table::convert(SENSOR sensor, const uint16_t *raw, float *out,
+    size_t n) const
+{
+	calibrate_block(raw, out, n, slopes[sensor], yints[sensor]);
+}
@@ -1,5 +1,5 @@
 /**
- * @file circular_buffer.hpp
+ * @file circular_buffer.cpp
  * @author Tommy Yuan (ty19@rice.edu)
  * @brief Circular buffer for storing data and formatting it
  * 	  to be sent.
@@ -9,87 +9,104 @@
  * @copyright Copyright (c) 2019
  */
 
+#include <algorithm>
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
 
 #include "circular_buffer/circular_buffer.hpp"
+#include "circular_buffer/packet.hpp"
 #include "time/time.hpp"
 #include "adc/adc.hpp"
 
-circular_buffer::circular_buffer(SENSOR sensor, uint16_t num_items)
-	: sensor(sensor)
-	{
-		data = new data_item[num_items];
-		end = data + num_items + 1;
-		head = data;
-		tail = data;
-	};
+circular_buffer::circular_buffer(SENSOR sensor, uint16_t num_items,
+    PACKET_FORMAT format)
+	: items(num_items)
+	, format(format)
+	, max_latency_us(0)
+	, packet_seq(0)
+	, sample_seq(0)
+	, sensor(sensor)
+{
+	/* Compact packets are encoded from a copy, taken without allocating */
+	staged = NULL;
+	if (format == PACKET_FORMAT::COMPACT)
+		staged = new struct data_item[items.capacity()];
+}
+
+circular_buffer::~circular_buffer() {
+	delete[] staged;
+}
 
 uint16_t circular_buffer::get_data(uint8_t **bufptr, uint16_t size) {
 	uint8_t *buf = *bufptr;
-	struct data_header *header = (struct data_header *)buf;
-	uint16_t bytes_to_copy, bytes_written = sizeof(struct data_header);
 
-	/* TODO account for struct padding */
-	/* Write the data as long as there is data to add */
-	while (bytes_written + sizeof(struct data_item) <= size && 
-	       pop_data_item(&buf[bytes_written]) != BUFF_STATUS::EMPTY) {
-		bytes_written += sizeof(struct data_item);
+	if (format == PACKET_FORMAT::COMPACT) {
+		uint32_t num_items = std::min<uint32_t>(items.capacity(),
+		    packet_capacity(format, size));
+
+		num_items = items.pop(staged, num_items);
+		return encode_compact(sensor, packet_seq++, staged, num_items, buf, size);
 	}
 
+	struct data_header *header = (struct data_header *)buf;
+	uint32_t num_items = 0;
+
+	/* Copy out as many whole items as fit after the header */
+	if (size >= sizeof(struct data_header))
+		num_items = items.pop((struct data_item *)(buf + sizeof(struct data_header)),
+		    (size - sizeof(struct data_header)) / sizeof(struct data_item));
+
 	/* Write the header */
 	header->sensor = sensor;
-	header->length = bytes_written;
-
-	/* TODO check validity? */
-	header->valid = 0;
+	header->length = sizeof(struct data_header) + num_items * sizeof(struct data_item);
 
-	// printf("Bytes written: %lu\n", bytes_written);
+	header->seq = packet_seq++;
 
-	return bytes_written;
+	return header->length;
 }
 
 BUFF_STATUS circular_buffer::push_data_item(uint16_t reading, timestamp_t timestamp) {
-	struct data_item *next = head + 1;
-
-	/* Check for wrap around */
-	if (next >= end) 
-		next = data;
+	struct data_item *item = items.claim();
 
 	/* Check if the buffer is full */
-	/* TODO log this? */
-	if (next == tail) {
-		// printf("Buffer is full\n");
+	if (item == NULL)
 		return BUFF_STATUS::FULL;
-	}
 
 	/* Write the new reading into the buffer */
-	head->reading = reading;
-	head->timestamp = timestamp;
-
-	head = next;
+	item->reading = reading;
+	item->seq = sample_seq++;
+	item->timestamp = timestamp;
+	items.commit();
 
 	return BUFF_STATUS::JUSTRIGHT;
 }
 
 BUFF_STATUS circular_buffer::pop_data_item(uint8_t *item) {
-	struct data_item *d_item = (struct data_item*)item;
-
 	/* Check if the buffer is empty */
-	if (head == tail) {
-		printf("Buffer is empty\n");
+	if (items.pop((struct data_item *)item, 1) == 0)
 		return BUFF_STATUS::EMPTY;
-	}
 
-	/* Return the information */
-	d_item->reading = tail->reading;
-	d_item->timestamp = tail->timestamp;
+	return BUFF_STATUS::JUSTRIGHT;
+}
 
-	/* Check for wrap around when incrementing */
-	tail++;
-	if (tail >= end)
-		tail = data;
+void circular_buffer::setMaxLatency(timestamp_t max_latency_us) {
+	this->max_latency_us = max_latency_us;
+}
 
-	return BUFF_STATUS::JUSTRIGHT;
+bool circular_buffer::due(timestamp_t now) {
+	struct data_item *oldest;
+
+	if (max_latency_us == 0 || (oldest = items.peek()) == NULL)
+		return false;
+
+	return now - oldest->timestamp >= max_latency_us;
+}
+
+uint32_t circular_buffer::size() {
+	return items.size();
+}
+
+uint32_t circular_buffer::capacity() {
+	return items.capacity();
 }
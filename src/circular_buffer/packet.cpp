@@ -0,0 +1,426 @@
+/**
+ * @file packet.cpp
+ * @brief Encoders and decoders for the packets of sensor data that are sent
+ * 	  and logged.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "circular_buffer/circular_buffer.hpp"
+#include "circular_buffer/packet.hpp"
+
+/* Size of a compact header before sequence numbers were added */
+#define COMPACT_V1_HEADER_SIZE	16
+
+/* Bytes taken by count 12-bit readings */
+static uint32_t packed_size(uint32_t count) {
+	return (count * 3 + 1) / 2;
+}
+
+/* Bytes taken by the sample times of a compact packet with the given flags */
+static uint32_t times_size(uint8_t flags, uint32_t count) {
+	if (flags & COMPACT_IMPLICIT_PERIOD)
+		return sizeof(uint32_t);
+	if (count == 0)
+		return 0;
+	if (flags & COMPACT_WIDE_DELTAS)
+		return (count - 1) * sizeof(uint32_t);
+	return (count - 1) * sizeof(uint16_t);
+}
+
+int parse_packet_format(const char *name, PACKET_FORMAT *format) {
+	if (strcmp(name, "legacy") == 0)
+		*format = PACKET_FORMAT::LEGACY;
+	else if (strcmp(name, "compact") == 0)
+		*format = PACKET_FORMAT::COMPACT;
+	else
+		return 1;
+
+	return 0;
+}
+
+uint16_t packet_capacity(PACKET_FORMAT format, uint16_t size) {
+	uint32_t count = 0;
+
+	if (format == PACKET_FORMAT::LEGACY) {
+		if (size < sizeof(struct data_header))
+			return 0;
+		return (size - sizeof(struct data_header)) / sizeof(struct data_item);
+	}
+
+	/* The worst case is wide deltas */
+	while (sizeof(struct compact_header) +
+	       times_size(COMPACT_WIDE_DELTAS, count + 1) +
+	       packed_size(count + 1) <= size)
+		count++;
+
+	return count;
+}
+
+uint16_t encode_compact(SENSOR sensor, uint32_t seq,
+    const struct data_item *items, uint16_t count, uint8_t *buf, uint16_t size)
+{
+	struct compact_header *header = (struct compact_header *)buf;
+	uint8_t *out;
+	int64_t delta, period = 0;
+	uint32_t length, i;
+	uint8_t flags = 0;
+	bool regular = count > 1, narrow = true;
+
+	/* Find out how the sample times can be stored */
+	for (i = 1; i < count; i++) {
+		delta = items[i].timestamp - items[i - 1].timestamp;
+		if (i == 1)
+			period = delta;
+		regular &= (delta == period);
+		narrow &= (delta >= 0 && delta <= UINT16_MAX);
+
+		/* The clock jumped too far to be stored at all */
+		if (delta < INT32_MIN || delta > INT32_MAX)
+			return 0;
+	}
+
+	if (regular && period >= 0)
+		flags = COMPACT_IMPLICIT_PERIOD;
+	else if (!narrow)
+		flags = COMPACT_WIDE_DELTAS;
+
+	length = sizeof(struct compact_header) + times_size(flags, count) +
+	    packed_size(count);
+	if (length > size)
+		return 0;
+
+	header->magic = COMPACT_MAGIC;
+	header->version = COMPACT_VERSION;
+	header->sensor = sensor;
+	header->flags = flags;
+	header->length = length;
+	header->count = count;
+	header->base = count > 0 ? items[0].timestamp : 0;
+	header->seq = seq;
+	header->first_seq = count > 0 ? items[0].seq : 0;
+
+	out = buf + sizeof(struct compact_header);
+	if (flags & COMPACT_IMPLICIT_PERIOD) {
+		*(uint32_t *)out = period;
+		out += sizeof(uint32_t);
+	} else if (flags & COMPACT_WIDE_DELTAS) {
+		for (i = 1; i < count; i++, out += sizeof(uint32_t))
+			*(int32_t *)out = items[i].timestamp - items[i - 1].timestamp;
+	} else {
+		for (i = 1; i < count; i++, out += sizeof(uint16_t))
+			*(uint16_t *)out = items[i].timestamp - items[i - 1].timestamp;
+	}
+
+	/* Two 12-bit readings in every three bytes */
+	for (i = 0; i + 1 < count; i += 2, out += 3) {
+		uint16_t a = items[i].reading & 0xFFF, b = items[i + 1].reading & 0xFFF;
+
+		out[0] = a;
+		out[1] = (a >> 8) | (b << 4);
+		out[2] = b >> 4;
+	}
+	if (i < count) {
+		out[0] = items[i].reading;
+		out[1] = (items[i].reading >> 8) & 0x0F;
+	}
+
+	return length;
+}
+
+static uint16_t decode_legacy(const uint8_t *buf, uint32_t size, SENSOR *sensor,
+    struct data_item *items, uint16_t max_items, uint16_t *count, uint32_t *seq)
+{
+	const struct data_header *header = (const struct data_header *)buf;
+	uint32_t num_items;
+
+	if (size < sizeof(struct data_header) || header->length > size ||
+	    header->length < sizeof(struct data_header) ||
+	    header->sensor >= SENSOR::NUM_SENSORS)
+		return 0;
+
+	num_items = (header->length - sizeof(struct data_header)) / sizeof(struct data_item);
+	if (num_items > max_items)
+		return 0;
+
+	*sensor = header->sensor;
+	*count = num_items;
+	*seq = header->seq;
+	memcpy(items, buf + sizeof(struct data_header), num_items * sizeof(struct data_item));
+
+	return header->length;
+}
+
+static uint16_t decode_compact(const uint8_t *buf, uint32_t size, SENSOR *sensor,
+    struct data_item *items, uint16_t max_items, uint16_t *count, uint32_t *seq)
+{
+	struct compact_header header;
+	uint32_t header_size = sizeof(struct compact_header);
+	const uint8_t *in;
+	timestamp_t timestamp;
+	uint32_t period = 0, i;
+	int32_t delta;
+
+	/* Version 1 headers stop before the sequence numbers */
+	if (size >= 2 && buf[1] == 1)
+		header_size = COMPACT_V1_HEADER_SIZE;
+
+	if (size < header_size)
+		return 0;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(&header, buf, header_size);
+	if (header.version < 1 || header.version > COMPACT_VERSION ||
+	    header.sensor >= SENSOR::NUM_SENSORS ||
+	    header.count > max_items || header.length > size ||
+	    header.length != header_size +
+	    times_size(header.flags, header.count) + packed_size(header.count))
+		return 0;
+
+	in = buf + header_size;
+	if (header.flags & COMPACT_IMPLICIT_PERIOD) {
+		memcpy(&period, in, sizeof(period));
+		in += sizeof(period);
+	}
+
+	/* Rebuild the sample times */
+	timestamp = header.base;
+	for (i = 0; i < header.count; i++) {
+		if (i > 0 && (header.flags & COMPACT_IMPLICIT_PERIOD)) {
+			timestamp += period;
+		} else if (i > 0 && (header.flags & COMPACT_WIDE_DELTAS)) {
+			memcpy(&delta, in, sizeof(int32_t));
+			in += sizeof(int32_t);
+			timestamp += delta;
+		} else if (i > 0) {
+			uint16_t narrow;
+
+			memcpy(&narrow, in, sizeof(uint16_t));
+			in += sizeof(uint16_t);
+			timestamp += narrow;
+		}
+
+		memset(&items[i], 0, sizeof(struct data_item));
+		items[i].seq = header.first_seq + i;
+		items[i].timestamp = timestamp;
+	}
+
+	/* Unpack the readings */
+	for (i = 0; i + 1 < header.count; i += 2, in += 3) {
+		items[i].reading = in[0] | ((in[1] & 0x0F) << 8);
+		items[i + 1].reading = (in[1] >> 4) | (in[2] << 4);
+	}
+	if (i < header.count)
+		items[i].reading = in[0] | ((in[1] & 0x0F) << 8);
+
+	*sensor = (SENSOR)header.sensor;
+	*count = header.count;
+	*seq = header.seq;
+
+	return header.length;
+}
+
+uint16_t encode_calibrated(SENSOR sensor, uint32_t first_seq,
+    const float *values, uint16_t count, uint8_t *buf, uint16_t size)
+{
+	struct calibrated_header header;
+	uint32_t length = sizeof(header) + (uint32_t)count * sizeof(float);
+
+	if (length > size)
+		return 0;
+
+	header.magic = CALIBRATED_MAGIC;
+	header.version = CALIBRATED_VERSION;
+	header.sensor = sensor;
+	header.reserved = 0;
+	header.length = length;
+	header.count = count;
+	header.first_seq = first_seq;
+
+	memcpy(buf, &header, sizeof(header));
+	memcpy(buf + sizeof(header), values, (size_t)count * sizeof(float));
+
+	return length;
+}
+
+uint16_t encode_filtered(SENSOR sensor, timestamp_t base, uint32_t first_seq,
+    float rate, const float *values, uint16_t count, uint8_t *buf, uint16_t size)
+{
+	struct filtered_header header;
+	uint32_t length = sizeof(header) + (uint32_t)count * sizeof(float);
+
+	if (length > size)
+		return 0;
+
+	memset(&header, 0, sizeof(header));
+	header.magic = FILTERED_MAGIC;
+	header.version = FILTERED_VERSION;
+	header.sensor = sensor;
+	header.length = length;
+	header.count = count;
+	header.base = base;
+	header.first_seq = first_seq;
+	header.rate = rate;
+
+	memcpy(buf, &header, sizeof(header));
+	memcpy(buf + sizeof(header), values, (size_t)count * sizeof(float));
+
+	return length;
+}
+
+uint16_t decode_packet(const uint8_t *buf, uint32_t size, SENSOR *sensor,
+    struct data_item *items, uint16_t max_items, uint16_t *count,
+    uint32_t *seq)
+{
+	uint32_t ignored;
+
+	if (size == 0)
+		return 0;
+
+	if (seq == NULL)
+		seq = &ignored;
+
+	if (buf[0] == COMPACT_MAGIC)
+		return decode_compact(buf, size, sensor, items, max_items, count, seq);
+
+	return decode_legacy(buf, size, sensor, items, max_items, count, seq);
+}
+
+void frame_writer::reset(uint8_t *buf, uint16_t size) {
+	struct frame_header *header = (struct frame_header *)buf;
+
+	this->buf = buf;
+	this->size = size;
+	this->used = sizeof(struct frame_header);
+
+	header->magic = FRAME_MAGIC;
+	header->version = FRAME_VERSION;
+	header->num_sections = 0;
+}
+
+bool frame_writer::add(SENSOR sensor, const uint8_t *packet, uint16_t length) {
+	struct frame_header *header = (struct frame_header *)buf;
+	struct section_header section;
+
+	if ((uint32_t)used + sizeof(struct section_header) + length > size)
+		return false;
+
+	section.sensor = sensor;
+	section.reserved = 0;
+	section.length = length;
+
+	/* Sections are packed, so they are not necessarily aligned */
+	memcpy(buf + used, &section, sizeof(section));
+	memcpy(buf + used + sizeof(section), packet, length);
+
+	used += sizeof(section) + length;
+	header->num_sections++;
+
+	return true;
+}
+
+uint16_t frame_writer::sections() {
+	return ((struct frame_header *)buf)->num_sections;
+}
+
+uint16_t frame_writer::length() {
+	return used;
+}
+
+bool frame_reader::reset(const uint8_t *buf, uint32_t size) {
+	struct frame_header header;
+
+	this->buf = buf;
+	this->size = size;
+
+	if (size > 0 && buf[0] != FRAME_MAGIC) {
+		/* A bare packet, as sent when framing is off */
+		offset = 0;
+		remaining = 1;
+		return true;
+	}
+
+	if (size < sizeof(header))
+		return false;
+
+	memcpy(&header, buf, sizeof(header));
+	if (header.version != FRAME_VERSION)
+		return false;
+
+	offset = sizeof(header);
+	remaining = header.num_sections;
+	return true;
+}
+
+bool frame_reader::next(SENSOR *sensor, const uint8_t **packet, uint16_t *length) {
+	struct section_header section;
+
+	if (remaining == 0)
+		return false;
+	remaining--;
+
+	if (buf[0] != FRAME_MAGIC) {
+		/* Packets that start with a magic keep their sensor after it */
+		if (buf[0] == COMPACT_MAGIC || buf[0] == CALIBRATED_MAGIC ||
+		    buf[0] == FILTERED_MAGIC)
+			*sensor = (SENSOR)buf[2];
+		else
+			*sensor = (SENSOR)buf[0];
+		*packet = buf;
+		*length = size;
+		return true;
+	}
+
+	if (offset + sizeof(section) > size)
+		return false;
+
+	memcpy(&section, buf + offset, sizeof(section));
+	if (offset + sizeof(section) + section.length > size ||
+	    section.sensor >= SENSOR::NUM_SENSORS) {
+		remaining = 0;
+		return false;
+	}
+
+	*sensor = section.sensor;
+	*packet = buf + offset + sizeof(section);
+	*length = section.length;
+
+	offset += sizeof(section) + section.length;
+	return true;
+}
+
+bool packet_range(const uint8_t *buf, uint32_t size, uint32_t *first,
+    uint16_t *count)
+{
+	struct data_header legacy;
+	struct compact_header compact;
+
+	if (size > 0 && buf[0] == COMPACT_MAGIC) {
+		if (size < sizeof(compact) || buf[1] < 2)
+			return false;
+
+		memcpy(&compact, buf, sizeof(compact));
+		*first = compact.first_seq;
+		*count = compact.count;
+		return compact.count > 0;
+	}
+
+	if (size < sizeof(legacy) + sizeof(struct data_item))
+		return false;
+
+	/* Any other magic, e.g. a filtered packet, is never a valid sensor */
+	memcpy(&legacy, buf, sizeof(legacy));
+	if (legacy.sensor >= SENSOR::NUM_SENSORS || legacy.length > size ||
+	    legacy.length < sizeof(legacy) + sizeof(struct data_item))
+		return false;
+
+	memcpy(first, buf + sizeof(legacy) + offsetof(struct data_item, seq), sizeof(*first));
+	*count = (legacy.length - sizeof(legacy)) / sizeof(struct data_item);
+	return true;
+}
@@ -189,3 +189,17 @@ uint8_t ConfigMapping::getVector(const char* section, const char* key, std::vect
 		dest->push_back(atoi(v[index].c_str()));
 	return 0;
 }
+
+uint8_t ConfigMapping::getStrings(const char* section, const char* key, std::vector<std::string>* dest) {
+	// Make sure the provided key is present
+	if (!isPresent(section, key)) {
+		#ifdef __EXTRA_DEBUG_LOG
+			std::cerr << "Key `" << key << "` not found in section `" << section
+					<< "`" << std::endl;
+		#endif
+		return 1;
+	}
+
+	dest->insert(dest->end(), map[section][key].begin(), map[section][key].end());
+	return 0;
+}
@@ -0,0 +1,421 @@
+/**
+ * @file decoder.cpp
+ * @brief Decodes recorded data for analysis after a test.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "adc/adc.hpp"
+#include "calibration/calibration.hpp"
+#include "circular_buffer/circular_buffer.hpp"
+#include "circular_buffer/packet.hpp"
+#include "decoder/decoder.hpp"
+#include "recorder/recorder.hpp"
+#include "sequencer/valve_state.hpp"
+
+decode_options::decode_options()
+	: from_us(0)
+	, to_us(UINT64_MAX)
+	, sensors(UINT32_MAX)
+	, valves(false)
+	, threads(0)
+	, calibration(NULL)
+{}
+
+recorded_log::recorded_log()
+	: fd(-1)
+	, data(NULL)
+	, size(0)
+	, header(NULL)
+{}
+
+recorded_log::~recorded_log() {
+	if (data != NULL)
+		munmap((void *)data, size);
+	if (fd != -1)
+		close(fd);
+}
+
+int recorded_log::open(const char *path) {
+	const struct recording_trailer *trailer;
+	const struct recording_index_entry *index;
+	const struct recording_block *block;
+	struct data_item items[DECODE_MAX_ITEMS];
+	struct stat st;
+	decode_block entry;
+	uint16_t count;
+	uint64_t offset;
+	SENSOR sensor;
+
+	if ((fd = ::open(path, O_RDONLY)) == -1 || fstat(fd, &st) != 0 || st.st_size == 0)
+		return -1;
+
+	size = st.st_size;
+	data = (const uint8_t *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED) {
+		data = NULL;
+		return -1;
+	}
+
+	/* An older log starts with a packet */
+	if (size < sizeof(struct recording_header) ||
+	    ((const recording_header *)data)->magic != RECORDER_MAGIC)
+		return decode_packet(data, size, &sensor, items, DECODE_MAX_ITEMS, &count) != 0 ?
+		    0 : -1;
+
+	header = (const recording_header *)data;
+	if (header->version != RECORDER_VERSION || header->num_channels > RECORDER_MAX_CHANNELS ||
+	    header->block_size < sizeof(struct recording_block))
+		return -1;
+
+	/* Channels are named for their sensors, as the I/O thread records them */
+	for (uint32_t channel = 0; channel < RECORDER_MAX_CHANNELS; channel++) {
+		channel_sensors[channel] = SENSOR::NUM_SENSORS;
+		if (channel >= header->num_channels)
+			continue;
+		if (strncmp(header->names[channel], "Valves", RECORDER_NAME_LENGTH) == 0)
+			channel_sensors[channel] = DECODE_VALVES;
+		for (int index = 0; index < SENSOR::NUM_SENSORS; index++) {
+			if (strncmp(header->names[channel], SENSOR_NAMES[index], RECORDER_NAME_LENGTH) == 0)
+				channel_sensors[channel] = index;
+		}
+	}
+
+	/* A closed recording has an index of its blocks at the end */
+	trailer = (const struct recording_trailer *)(data + size - sizeof(*trailer));
+	if (trailer->magic == RECORDER_TRAILER_MAGIC &&
+	    trailer->index_offset + (uint64_t)trailer->num_blocks * sizeof(*index) <= size) {
+		index = (const struct recording_index_entry *)(data + trailer->index_offset);
+		for (uint32_t n = 0; n < trailer->num_blocks; n++) {
+			block = (const struct recording_block *)(data + index[n].offset);
+			if (index[n].offset + sizeof(*block) > trailer->index_offset ||
+			    block->magic != RECORDER_BLOCK_MAGIC ||
+			    index[n].offset + block->used > trailer->index_offset)
+				break;
+
+			entry.offset = index[n].offset;
+			entry.length = block->used;
+			entry.channels = index[n].channels;
+			entry.first_us = index[n].first_us;
+			entry.last_us = index[n].last_us;
+			blocks.push_back(entry);
+		}
+
+		return 0;
+	}
+
+	/* Otherwise walk the block headers until one was never written */
+	for (offset = header->header_size; offset + sizeof(*block) <= size;
+	    offset += header->block_size) {
+		block = (const struct recording_block *)(data + offset);
+		if (block->magic != RECORDER_BLOCK_MAGIC || offset + block->used > size)
+			break;
+
+		entry.offset = offset;
+		entry.length = block->used;
+		entry.channels = block->channels;
+		entry.first_us = block->first_us;
+		entry.last_us = block->last_us;
+		blocks.push_back(entry);
+	}
+
+	return 0;
+}
+
+bool recorded_log::isRecording() const {
+	return header != NULL;
+}
+
+const std::vector<decode_block> &recorded_log::getBlocks() const {
+	return blocks;
+}
+
+size_t recorded_log::seek(timestamp_t time_us) const {
+	size_t low = 0, high = blocks.size();
+
+	/* Records are appended in time order, so the last times are sorted */
+	while (low < high) {
+		size_t middle = low + (high - low) / 2;
+
+		if (blocks[middle].last_us < time_us)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return low;
+}
+
+/*
+ * Decodes one packet of a sensor, keeping the samples in the window.
+ */
+static void decode_sensor(const uint8_t *packet, uint16_t length, const decode_options &options,
+    std::vector<decoded_sample> *out)
+{
+	struct data_item items[DECODE_MAX_ITEMS];
+	uint16_t raw[DECODE_MAX_ITEMS];
+	float values[DECODE_MAX_ITEMS];
+	decoded_sample sample;
+	uint16_t count;
+	SENSOR sensor;
+
+	if (decode_packet(packet, length, &sensor, items, DECODE_MAX_ITEMS, &count) == 0 ||
+	    sensor >= SENSOR::NUM_SENSORS || !(options.sensors & ((uint32_t)1 << sensor)))
+		return;
+
+	/* A packet at a time, through the vectorized kernel */
+	for (uint16_t index = 0; index < count; index++)
+		raw[index] = items[index].reading;
+	if (options.calibration != NULL)
+		options.calibration->convert(sensor, raw, values, count);
+	else
+		for (uint16_t index = 0; index < count; index++)
+			values[index] = raw[index];
+
+	for (uint16_t index = 0; index < count; index++) {
+		if (items[index].timestamp < options.from_us || items[index].timestamp > options.to_us)
+			continue;
+
+		sample.time_us = items[index].timestamp;
+		sample.seq = items[index].seq;
+		sample.raw = raw[index];
+		sample.value = values[index];
+		sample.sensor = sensor;
+		out->push_back(sample);
+	}
+}
+
+/*
+ * Decodes a valve state packet, if it is in the window.
+ */
+static void decode_valves(const uint8_t *packet, uint16_t length, const decode_options &options,
+    std::vector<decoded_sample> *out)
+{
+	struct valve_packet valves;
+	decoded_sample sample;
+
+	if (!options.valves || length < sizeof(valves))
+		return;
+
+	memcpy(&valves, packet, sizeof(valves));
+	if (valves.magic != VALVE_MAGIC || valves.changed_ns / 1000 < options.from_us ||
+	    valves.changed_ns / 1000 > options.to_us)
+		return;
+
+	sample.time_us = valves.changed_ns / 1000;
+	sample.seq = valves.changes;
+	sample.raw = valves.levels;
+	sample.value = valves.levels;
+	sample.sensor = DECODE_VALVES;
+	out->push_back(sample);
+}
+
+void recorded_log::decodeBlocks(size_t first, size_t last, uint32_t wanted,
+    const decode_options &options, std::vector<decoded_sample> *out) const
+{
+	struct recording_record record;
+	uint32_t position;
+
+	for (size_t n = first; n < last; n++) {
+		const uint8_t *block = data + blocks[n].offset;
+
+		/* The index says which channels a block holds, so most are never read */
+		if (!(blocks[n].channels & wanted))
+			continue;
+
+		position = sizeof(struct recording_block);
+		while (position + sizeof(record) <= blocks[n].length) {
+			memcpy(&record, block + position, sizeof(record));
+			position += sizeof(record);
+			if (position + record.length > blocks[n].length)
+				break;
+
+			if (record.channel < RECORDER_MAX_CHANNELS &&
+			    !(wanted & ((uint32_t)1 << record.channel))) {
+				position += record.length;
+				continue;
+			}
+
+			if (record.channel < RECORDER_MAX_CHANNELS &&
+			    channel_sensors[record.channel] == DECODE_VALVES)
+				decode_valves(block + position, record.length, options, out);
+			else
+				decode_sensor(block + position, record.length, options, out);
+
+			position += record.length;
+		}
+	}
+}
+
+void recorded_log::decodeLegacy(const decode_options &options,
+    std::vector<decoded_sample> *out) const
+{
+	struct data_item items[DECODE_MAX_ITEMS];
+	size_t offset = 0;
+	uint16_t length, count;
+	SENSOR sensor;
+
+	/* Packets back to back; stop at the first bad one */
+	while (offset < size &&
+	       (length = decode_packet(data + offset, size - offset, &sensor, items,
+	           DECODE_MAX_ITEMS, &count)) != 0) {
+		decode_sensor(data + offset, length, options, out);
+		offset += length;
+	}
+}
+
+size_t recorded_log::decode(const decode_options &options, std::vector<decoded_sample> *out) const {
+	std::vector<std::vector<decoded_sample> > parts;
+	std::vector<std::thread> workers;
+	size_t first, last, per_thread, before = out->size();
+	timestamp_t until;
+	unsigned threads;
+	uint32_t wanted;
+
+	if (data == NULL)
+		return 0;
+
+	if (header == NULL) {
+		decodeLegacy(options, out);
+		return out->size() - before;
+	}
+
+	/* The blocks that can hold the window, and have a channel wanted */
+	first = seek(options.from_us);
+	until = options.to_us > UINT64_MAX - DECODE_LATE_US ? UINT64_MAX :
+	    options.to_us + DECODE_LATE_US;
+	last = first;
+	while (last < blocks.size() && blocks[last].first_us <= until)
+		last++;
+
+	wanted = 0;
+	for (uint32_t channel = 0; channel < header->num_channels; channel++) {
+		uint8_t sensor = channel_sensors[channel];
+
+		if ((sensor == DECODE_VALVES && options.valves) ||
+		    (sensor < SENSOR::NUM_SENSORS && (options.sensors & ((uint32_t)1 << sensor))) ||
+		    sensor == SENSOR::NUM_SENSORS)
+			wanted |= (uint32_t)1 << channel;
+	}
+	while (first < last && !(blocks[first].channels & wanted))
+		first++;
+	while (last > first && !(blocks[last - 1].channels & wanted))
+		last--;
+
+	threads = options.threads != 0 ? options.threads : std::thread::hardware_concurrency();
+	if (threads == 0)
+		threads = 1;
+	if (threads > last - first)
+		threads = last - first > 0 ? last - first : 1;
+
+	if (threads == 1) {
+		decodeBlocks(first, last, wanted, options, out);
+		return out->size() - before;
+	}
+
+	/* Contiguous runs of blocks, so joining them in order keeps each sensor in order */
+	parts.resize(threads);
+	per_thread = (last - first + threads - 1) / threads;
+	for (unsigned thread = 0; thread < threads; thread++) {
+		size_t start = first + thread * per_thread;
+		size_t end = start + per_thread < last ? start + per_thread : last;
+
+		if (start >= end)
+			break;
+		workers.push_back(std::thread(&recorded_log::decodeBlocks, this, start, end,
+		    wanted, std::cref(options), &parts[thread]));
+	}
+
+	for (size_t thread = 0; thread < workers.size(); thread++)
+		workers[thread].join();
+
+	for (size_t thread = 0; thread < parts.size(); thread++)
+		out->insert(out->end(), parts[thread].begin(), parts[thread].end());
+
+	return out->size() - before;
+}
+
+int write_csv(FILE *file, const std::vector<decoded_sample> &samples) {
+	fprintf(file, "sensor,seq,time_us,raw,value\n");
+
+	for (size_t index = 0; index < samples.size(); index++) {
+		const decoded_sample &sample = samples[index];
+
+		if (sample.sensor == DECODE_VALVES)
+			fprintf(file, "Valves,%u,%llu,%u,0x%08x\n", sample.seq,
+			    (unsigned long long)sample.time_us, sample.raw, sample.raw);
+		else
+			fprintf(file, "%s,%u,%llu,%u,%.4f\n", SENSOR_NAMES[sample.sensor], sample.seq,
+			    (unsigned long long)sample.time_us, sample.raw, sample.value);
+	}
+
+	return ferror(file) ? -1 : 0;
+}
+
+/*
+ * Writes one field of every sample as a column.
+ */
+template<typename T, typename Field>
+static void write_column(FILE *file, const std::vector<decoded_sample> &samples, Field field) {
+	T column[1024];
+	size_t used = 0;
+
+	for (size_t index = 0; index < samples.size(); index++) {
+		column[used++] = field(samples[index]);
+		if (used == sizeof(column) / sizeof(column[0])) {
+			fwrite(column, sizeof(T), used, file);
+			used = 0;
+		}
+	}
+
+	fwrite(column, sizeof(T), used, file);
+}
+
+static uint8_t sensor_of(const decoded_sample &sample) {
+	return sample.sensor;
+}
+
+static uint32_t seq_of(const decoded_sample &sample) {
+	return sample.seq;
+}
+
+static uint64_t time_of(const decoded_sample &sample) {
+	return sample.time_us;
+}
+
+static uint32_t raw_of(const decoded_sample &sample) {
+	return sample.raw;
+}
+
+static float value_of(const decoded_sample &sample) {
+	return sample.value;
+}
+
+int write_columns(FILE *file, const std::vector<decoded_sample> &samples) {
+	struct decode_columns_header header;
+
+	header.magic = DECODE_COLUMNS_MAGIC;
+	header.version = DECODE_COLUMNS_VERSION;
+	header.num_rows = samples.size();
+	fwrite(&header, sizeof(header), 1, file);
+
+	write_column<uint8_t>(file, samples, sensor_of);
+	write_column<uint32_t>(file, samples, seq_of);
+	write_column<uint64_t>(file, samples, time_of);
+	write_column<uint32_t>(file, samples, raw_of);
+	write_column<float>(file, samples, value_of);
+
+	return ferror(file) ? -1 : 0;
+}
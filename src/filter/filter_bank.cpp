@@ -0,0 +1,403 @@
+/**
+ * @file filter_bank.cpp
+ * @brief Per-sensor cascades of digital filters run on every sample.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <algorithm>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "adc/adc.hpp"
+#include "calibration/calibration.hpp"
+#include "config/config.hpp"
+#include "filter/filter_bank.hpp"
+
+static const char *type_names[] = {"median", "average", "lowpass", "fir"};
+
+static int parse_filter_type(const char *name, FILTER_TYPE *type) {
+	for (size_t index = 0; index < sizeof(type_names) / sizeof(type_names[0]); index++) {
+		if (strcmp(name, type_names[index]) == 0) {
+			*type = (FILTER_TYPE)index;
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+filter_bank::filter_bank() {
+	for (int index = 0; index <= SENSOR::NUM_SENSORS; index++)
+		first[index] = 0;
+
+	for (int index = 0; index < SENSOR::NUM_SENSORS; index++) {
+		rates[index] = SENSOR_FREQS[index];
+		decimations[index] = 1;
+		slopes[index] = 1;
+		yints[index] = 0;
+	}
+}
+
+void filter_bank::setCalibration(SENSOR sensor, float slope, float yint) {
+	slopes[sensor] = slope;
+	yints[sensor] = yint;
+}
+
+filter_stage *filter_bank::push(SENSOR sensor, FILTER_TYPE type, uint16_t length,
+    uint32_t num_state, uint32_t num_coeffs)
+{
+	filter_stage stage;
+	uint16_t at = first[sensor + 1];
+
+	if (at - first[sensor] >= FILTER_MAX_STAGES)
+		return NULL;
+
+	memset(&stage, 0, sizeof(stage));
+	stage.sensor = sensor;
+	stage.type = type;
+	stage.length = length;
+	stage.decimation = 1;
+	stage.state = state.size();
+	stage.coeffs = coeffs.size();
+
+	state.resize(state.size() + num_state, 0);
+	coeffs.resize(coeffs.size() + num_coeffs, 0);
+
+	/* After the sensor's other stages, keeping the table sorted */
+	stages.insert(stages.begin() + at, stage);
+	for (int index = sensor + 1; index <= SENSOR::NUM_SENSORS; index++)
+		first[index]++;
+
+	if (!descriptions[sensor].empty())
+		descriptions[sensor] += ", ";
+
+	return &stages[at];
+}
+
+void filter_bank::clear(SENSOR sensor) {
+	uint16_t removed = first[sensor + 1] - first[sensor];
+
+	/* Their state is left unused in the arrays until the next load */
+	stages.erase(stages.begin() + first[sensor], stages.begin() + first[sensor + 1]);
+	for (int index = sensor + 1; index <= SENSOR::NUM_SENSORS; index++)
+		first[index] -= removed;
+
+	rates[sensor] = SENSOR_FREQS[sensor];
+	decimations[sensor] = 1;
+	descriptions[sensor].clear();
+}
+
+int filter_bank::addMedian(SENSOR sensor, uint16_t window) {
+	char part[MAX_CONFIG_LENGTH];
+
+	if (sensor >= SENSOR::NUM_SENSORS || window == 0 || window % 2 == 0 ||
+	    window > FILTER_MAX_MEDIAN)
+		return 1;
+
+	/* The window in arrival order, then the same samples sorted */
+	if (push(sensor, FILTER_MEDIAN, window, 2 * window, 0) == NULL)
+		return 1;
+
+	snprintf(part, sizeof(part), "median %u", window);
+	descriptions[sensor] += part;
+	return 0;
+}
+
+int filter_bank::addAverage(SENSOR sensor, uint16_t window) {
+	char part[MAX_CONFIG_LENGTH];
+
+	if (sensor >= SENSOR::NUM_SENSORS || window == 0 || window > FILTER_MAX_WINDOW)
+		return 1;
+
+	if (push(sensor, FILTER_AVERAGE, window, window, 0) == NULL)
+		return 1;
+
+	snprintf(part, sizeof(part), "average %u", window);
+	descriptions[sensor] += part;
+	return 0;
+}
+
+int filter_bank::addLowpass(SENSOR sensor, double cutoff_hz, double q) {
+	char part[MAX_CONFIG_LENGTH];
+	filter_stage *stage;
+	double w0, alpha, a0;
+	float *c;
+
+	if (sensor >= SENSOR::NUM_SENSORS || cutoff_hz <= 0 ||
+	    cutoff_hz >= rates[sensor] / 2 || q <= 0)
+		return 1;
+
+	/* Transposed direct form II: two delays, five coefficients */
+	stage = push(sensor, FILTER_LOWPASS, 2, 2, 5);
+	if (stage == NULL)
+		return 1;
+
+	/* The lowpass of the Audio EQ Cookbook, normalized so a0 is 1 */
+	w0 = 2 * M_PI * cutoff_hz / rates[sensor];
+	alpha = sin(w0) / (2 * q);
+	a0 = 1 + alpha;
+
+	c = &coeffs[stage->coeffs];
+	c[0] = (1 - cos(w0)) / 2 / a0;
+	c[1] = (1 - cos(w0)) / a0;
+	c[2] = c[0];
+	c[3] = -2 * cos(w0) / a0;
+	c[4] = (1 - alpha) / a0;
+
+	if (q != FILTER_DEFAULT_Q)
+		snprintf(part, sizeof(part), "lowpass %g Hz q %g", cutoff_hz, q);
+	else
+		snprintf(part, sizeof(part), "lowpass %g Hz", cutoff_hz);
+	descriptions[sensor] += part;
+	return 0;
+}
+
+int filter_bank::addFir(SENSOR sensor, uint16_t taps, uint8_t decimation) {
+	char part[MAX_CONFIG_LENGTH];
+	filter_stage *stage;
+	double cutoff, center, x, total = 0;
+	float *h;
+
+	if (sensor >= SENSOR::NUM_SENSORS || taps == 0 || taps > FILTER_MAX_WINDOW ||
+	    decimation == 0 || decimation > FILTER_MAX_DECIMATION)
+		return 1;
+
+	/* The delay line is written twice, so the window is always contiguous */
+	stage = push(sensor, FILTER_FIR, taps, 2 * taps, taps);
+	if (stage == NULL)
+		return 1;
+	stage->decimation = decimation;
+
+	/* A Hamming-windowed sinc cut off at the Nyquist rate of the output,
+	 * in cycles per input sample */
+	cutoff = 0.5 / decimation;
+	center = (taps - 1) / 2.0;
+	h = &coeffs[stage->coeffs];
+
+	for (uint16_t index = 0; index < taps; index++) {
+		x = index - center;
+		h[index] = x == 0 ? 2 * cutoff : sin(2 * M_PI * cutoff * x) / (M_PI * x);
+		if (taps > 1)
+			h[index] *= 0.54 - 0.46 * cos(2 * M_PI * index / (taps - 1));
+		total += h[index];
+	}
+
+	/* Unity gain at DC */
+	for (uint16_t index = 0; index < taps; index++)
+		h[index] /= total;
+
+	rates[sensor] /= decimation;
+	decimations[sensor] *= decimation;
+
+	snprintf(part, sizeof(part), "fir %u taps /%u", taps, decimation);
+	descriptions[sensor] += part;
+	return 0;
+}
+
+int filter_bank::parse(SENSOR sensor, const char *line) {
+	char name[MAX_CONFIG_LENGTH];
+	double first_arg, second_arg = 0;
+	FILTER_TYPE type;
+	int args;
+
+	args = sscanf(line, "%63[^:]:%lf:%lf", name, &first_arg, &second_arg);
+	if (args < 2 || parse_filter_type(name, &type) != 0 || first_arg < 0 ||
+	    first_arg > UINT16_MAX || second_arg < 0 || second_arg > UINT8_MAX)
+		return 1;
+
+	switch (type) {
+	case FILTER_MEDIAN:
+		return args == 2 ? addMedian(sensor, first_arg) : 1;
+	case FILTER_AVERAGE:
+		return args == 2 ? addAverage(sensor, first_arg) : 1;
+	case FILTER_LOWPASS:
+		return addLowpass(sensor, first_arg, args == 3 ? second_arg : FILTER_DEFAULT_Q);
+	default:
+		return args == 3 ? addFir(sensor, first_arg, second_arg) : 1;
+	}
+}
+
+int filter_bank::load(ConfigMapping &config, const calibration_table &calibration) {
+	char value[MAX_CONFIG_LENGTH], *stage, *next;
+	int err = 0;
+
+	stages.clear();
+	state.clear();
+	coeffs.clear();
+	for (int index = 0; index <= SENSOR::NUM_SENSORS; index++)
+		first[index] = 0;
+
+	for (int index = 0; index < SENSOR::NUM_SENSORS; index++) {
+		SENSOR sensor = (SENSOR)index;
+
+		rates[index] = SENSOR_FREQS[index];
+		decimations[index] = 1;
+		descriptions[index].clear();
+		setCalibration(sensor, calibration.getSlope(sensor), calibration.getYint(sensor));
+
+		if (config.getString("Filter", SENSOR_NAMES[index], value, MAX_CONFIG_LENGTH) != 0)
+			continue;
+
+		for (stage = value; stage != NULL; stage = next) {
+			next = strchr(stage, ',');
+			if (next != NULL)
+				*next++ = '\0';
+
+			if (parse(sensor, stage) != 0) {
+				printf("[Filter] malformed or too many stages for %s: %s\n",
+				    SENSOR_NAMES[index], stage);
+				clear(sensor);
+				err = 1;
+				break;
+			}
+		}
+
+		if (filtered(sensor))
+			printf("[Filter] %s: %s, %g Hz out\n", SENSOR_NAMES[index],
+			    descriptions[index].c_str(), rates[index]);
+	}
+
+	return err;
+}
+
+/*
+ * Each case reads and writes only its own stage's window, so a cascade runs
+ * through a few adjacent lines of state. The stages return early when a
+ * decimating FIR holds the sample back.
+ */
+bool filter_bank::process(SENSOR sensor, uint16_t reading, float *output) {
+	float x = reading;
+
+	for (uint16_t index = first[sensor]; index < first[sensor + 1]; index++) {
+		filter_stage &stage = stages[index];
+		float *window = &state[stage.state];
+
+		switch (stage.type) {
+		case FILTER_MEDIAN: {
+			float *sorted = window + stage.length;
+			uint16_t n = stage.filled, at;
+
+			/* Drop the oldest sample from the sorted copy */
+			if (n == stage.length) {
+				at = std::lower_bound(sorted, sorted + n, window[stage.pos]) - sorted;
+				memmove(sorted + at, sorted + at + 1, (n - at - 1) * sizeof(float));
+				n--;
+			}
+
+			for (at = n; at > 0 && sorted[at - 1] > x; at--)
+				sorted[at] = sorted[at - 1];
+			sorted[at] = x;
+
+			window[stage.pos] = x;
+			stage.pos = stage.pos + 1 == stage.length ? 0 : stage.pos + 1;
+			stage.filled = n + 1;
+			x = sorted[stage.filled / 2];
+			break;
+		}
+		case FILTER_AVERAGE:
+			if (stage.filled == stage.length)
+				stage.sum -= window[stage.pos];
+			else
+				stage.filled++;
+
+			window[stage.pos] = x;
+			stage.sum += x;
+
+			/* Summed again each time round, so rounding cannot build up */
+			if (++stage.pos == stage.length) {
+				stage.pos = 0;
+				stage.sum = 0;
+				for (uint16_t slot = 0; slot < stage.length; slot++)
+					stage.sum += window[slot];
+			}
+
+			x = stage.sum / stage.filled;
+			break;
+		case FILTER_LOWPASS: {
+			const float *c = &coeffs[stage.coeffs];
+			float y;
+
+			/* Start settled at the first sample, as if it had always been there */
+			if (!stage.filled) {
+				window[0] = x * (1 - c[0]);
+				window[1] = x * (c[2] - c[4]);
+				stage.filled = 1;
+			}
+
+			y = c[0] * x + window[0];
+			window[0] = c[1] * x - c[3] * y + window[1];
+			window[1] = c[2] * x - c[4] * y;
+			x = y;
+			break;
+		}
+		default: {
+			const float *h = &coeffs[stage.coeffs];
+			float acc[4] = {0, 0, 0, 0};
+			const float *line;
+			uint16_t tap;
+
+			if (!stage.filled) {
+				std::fill(window, window + 2 * stage.length, x);
+				stage.filled = 1;
+			}
+
+			window[stage.pos] = x;
+			window[stage.pos + stage.length] = x;
+			stage.pos = stage.pos + 1 == stage.length ? 0 : stage.pos + 1;
+
+			if (++stage.phase < stage.decimation)
+				return false;
+			stage.phase = 0;
+
+			/* Oldest to newest; four sums so the adds can overlap */
+			line = window + stage.pos;
+			for (tap = 0; tap + 4 <= stage.length; tap += 4) {
+				acc[0] += h[tap] * line[tap];
+				acc[1] += h[tap + 1] * line[tap + 1];
+				acc[2] += h[tap + 2] * line[tap + 2];
+				acc[3] += h[tap + 3] * line[tap + 3];
+			}
+			for (; tap < stage.length; tap++)
+				acc[0] += h[tap] * line[tap];
+
+			x = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+			break;
+		}
+		}
+	}
+
+	*output = x * slopes[sensor] + yints[sensor];
+	return true;
+}
+
+void filter_bank::reset() {
+	for (size_t index = 0; index < stages.size(); index++) {
+		stages[index].sum = 0;
+		stages[index].pos = 0;
+		stages[index].filled = 0;
+		stages[index].phase = 0;
+	}
+}
+
+bool filter_bank::filtered(SENSOR sensor) {
+	return first[sensor + 1] > first[sensor];
+}
+
+uint32_t filter_bank::getDecimation(SENSOR sensor) {
+	return decimations[sensor];
+}
+
+double filter_bank::getRate(SENSOR sensor) {
+	return rates[sensor];
+}
+
+const char *filter_bank::describe(SENSOR sensor) {
+	return descriptions[sensor].c_str();
+}
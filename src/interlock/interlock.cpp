@@ -0,0 +1,345 @@
+/**
+ * @file interlock.cpp
+ * @brief Safety rules checked against every sample as it is read.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "adc/adc.hpp"
+#include "calibration/calibration.hpp"
+#include "config/config.hpp"
+#include "interlock/interlock.hpp"
+#include "sequencer/sequencer.hpp"
+#include "sequencer/wakeup.hpp"
+
+static const char *check_names[] = {"above", "below", "rate"};
+
+int parse_sensor(const char *name, SENSOR *sensor) {
+	for (int index = 0; index < SENSOR::NUM_SENSORS; index++) {
+		if (strcmp(name, SENSOR_NAMES[index]) == 0) {
+			*sensor = (SENSOR)index;
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+interlock::interlock(std::atomic<bool> *shutoff, wakeup *wake)
+	: tripped(0)
+	, trips(0)
+	, shutoff(shutoff)
+	, wake(wake)
+	, runner(NULL)
+{
+	for (int index = 0; index <= 2 * SENSOR::NUM_SENSORS; index++)
+		first[index] = 0;
+
+	for (int index = 0; index < SENSOR::NUM_SENSORS; index++) {
+		slopes[index] = 1;
+		yints[index] = 0;
+	}
+}
+
+void interlock::setCalibration(SENSOR sensor, double slope, double yint) {
+	slopes[sensor] = slope;
+	yints[sensor] = yint;
+}
+
+void interlock::setSequencer(sequencer *runner) {
+	this->runner.store(runner, std::memory_order_release);
+	if (runner != NULL)
+		runner->hold(getTripped() != 0);
+}
+
+int interlock::add(INTERLOCK_CHECK check, const SENSOR *sensors, uint8_t num_sensors,
+    uint8_t needed, double limit, uint16_t persist, double alpha,
+    const bool *filtered)
+{
+	interlock_rule rule = {needed, 0};
+	std::string description;
+	char part[MAX_CONFIG_LENGTH];
+	uint8_t index;
+
+	if (rules.size() >= INTERLOCK_MAX_RULES || num_sensors == 0 || needed == 0 ||
+	    needed > num_sensors || persist == 0 || alpha < 0 || alpha > 1 ||
+	    check > INTERLOCK_RATE || (check == INTERLOCK_RATE && limit <= 0))
+		return 1;
+
+	for (index = 0; index < num_sensors; index++) {
+		if (sensors[index] >= SENSOR::NUM_SENSORS || slopes[sensors[index]] == 0)
+			return 1;
+	}
+
+	for (index = 0; index < num_sensors; index++) {
+		interlock_term term;
+		double slope = slopes[sensors[index]];
+
+		memset(&term, 0, sizeof(term));
+		term.sensor = sensors[index];
+		term.check = check;
+		term.rule = rules.size();
+		term.persist = persist;
+		term.alpha = alpha;
+		term.filtered = filtered != NULL && filtered[index];
+
+		/* The calibration is linear, so the limit can be moved to raw counts
+		 * instead of converting every reading; a falling slope flips it */
+		if (term.filtered) {
+			term.limit = limit;
+		} else if (check == INTERLOCK_RATE) {
+			term.limit = limit / fabs(slope);
+		} else {
+			term.limit = (limit - yints[sensors[index]]) / slope;
+			if (slope < 0)
+				term.check = check == INTERLOCK_ABOVE ? INTERLOCK_BELOW : INTERLOCK_ABOVE;
+		}
+
+		/* After the sensor's other terms, keeping the table sorted */
+		terms.insert(std::upper_bound(terms.begin(), terms.end(), term,
+		    [](const interlock_term &a, const interlock_term &b) {
+			return 2 * a.sensor + a.filtered < 2 * b.sensor + b.filtered;
+		    }), term);
+
+		if (index > 0)
+			description += "+";
+		description += SENSOR_NAMES[sensors[index]];
+		if (term.filtered)
+			description += ".filtered";
+	}
+
+	for (int key = 0, term = 0; key <= 2 * SENSOR::NUM_SENSORS; key++) {
+		while (term < (int)terms.size() &&
+		    2 * terms[term].sensor + terms[term].filtered < key)
+			term++;
+		first[key] = term;
+	}
+
+	if (num_sensors > 1) {
+		snprintf(part, sizeof(part), "%u of ", needed);
+		description = part + description;
+	}
+
+	snprintf(part, sizeof(part), check == INTERLOCK_RATE ? " %s %g/s" : " %s %g",
+	    check_names[check], limit);
+	description += part;
+
+	if (persist > 1) {
+		snprintf(part, sizeof(part), ", %u samples", persist);
+		description += part;
+	}
+
+	if (alpha != 0) {
+		snprintf(part, sizeof(part), ", ema %g", alpha);
+		description += part;
+	}
+
+	rules.push_back(rule);
+	descriptions.push_back(description);
+	return 0;
+}
+
+int interlock::parse(INTERLOCK_CHECK check, const char *line) {
+	char names[MAX_CONFIG_LENGTH], *name, *next, *suffix;
+	SENSOR sensors[SENSOR::NUM_SENSORS];
+	bool filtered[SENSOR::NUM_SENSORS];
+	unsigned needed = 0, persist = 1;
+	uint8_t num_sensors = 0;
+	double limit, alpha = 0;
+	int used = 0;
+
+	if (sscanf(line, "%63[^,],%lf,%u,%lf", names, &limit, &persist, &alpha) < 2)
+		return 1;
+
+	/* An optional vote, e.g. 2/PT1+PT2+PT3 */
+	name = names;
+	if (sscanf(names, "%u/%n", &needed, &used) == 1 && used > 0)
+		name += used;
+
+	for (; name != NULL; name = next) {
+		next = strchr(name, '+');
+		if (next != NULL)
+			*next++ = '\0';
+
+		if (num_sensors == SENSOR::NUM_SENSORS)
+			return 1;
+
+		/* PT1.filtered checks the outputs of PT1's filters */
+		suffix = strchr(name, '.');
+		filtered[num_sensors] = suffix != NULL;
+		if (suffix != NULL) {
+			if (strcmp(suffix, ".filtered") != 0)
+				return 1;
+			*suffix = '\0';
+		}
+
+		if (parse_sensor(name, &sensors[num_sensors]) != 0)
+			return 1;
+		num_sensors++;
+	}
+
+	/* Without a vote, any one of the sensors trips the rule */
+	if (used == 0)
+		needed = 1;
+
+	if (persist > UINT16_MAX || needed > UINT8_MAX)
+		return 1;
+
+	return add(check, sensors, num_sensors, needed, limit, persist, alpha, filtered);
+}
+
+int interlock::load(ConfigMapping &config, const calibration_table &calibration) {
+	static const INTERLOCK_CHECK checks[] = {INTERLOCK_ABOVE, INTERLOCK_BELOW, INTERLOCK_RATE};
+	double pressure_max = INTERLOCK_DEFAULT_PRESSURE_MAX;
+	double pressure_min = INTERLOCK_DEFAULT_PRESSURE_MIN;
+	std::vector<std::string> lines;
+	SENSOR sensor;
+	int err = 0;
+
+	terms.clear();
+	rules.clear();
+	descriptions.clear();
+	for (int index = 0; index <= 2 * SENSOR::NUM_SENSORS; index++)
+		first[index] = 0;
+	tripped.store(0);
+
+	for (int index = 0; index < SENSOR::NUM_SENSORS; index++)
+		setCalibration((SENSOR)index, calibration.getSlope((SENSOR)index),
+		    calibration.getYint((SENSOR)index));
+
+	for (size_t check = 0; check < sizeof(checks) / sizeof(checks[0]); check++) {
+		lines.clear();
+		config.getStrings("Interlock", check_names[checks[check]], &lines);
+
+		for (size_t index = 0; index < lines.size(); index++) {
+			if (parse(checks[check], lines[index].c_str()) != 0) {
+				printf("[Interlock] malformed or too many rules: %s=%s\n",
+				    check_names[checks[check]], lines[index].c_str());
+				err = 1;
+			}
+		}
+	}
+
+	/* The original check: the smoothed PT1 pressure within [Pressure] limits */
+	if (rules.empty()) {
+		sensor = SENSOR::PT1;
+		if (config.getDouble("Pressure", "pressure_max", &pressure_max) +
+		    config.getDouble("Pressure", "pressure_min", &pressure_min) != 0)
+			printf("[Interlock] WARNING: failed to read pressure shutoff values, using defaults\n");
+
+		add(INTERLOCK_ABOVE, &sensor, 1, 1, pressure_max, 1, INTERLOCK_LEGACY_EMA);
+		add(INTERLOCK_BELOW, &sensor, 1, 1, pressure_min, 1, INTERLOCK_LEGACY_EMA);
+	}
+
+	for (size_t index = 0; index < rules.size(); index++)
+		printf("[Interlock] rule %u: %s\n", (unsigned)index, descriptions[index].c_str());
+
+	return err;
+}
+
+bool interlock::evaluate(SENSOR sensor, float reading, timestamp_t timestamp,
+    bool filtered)
+{
+	uint32_t before = tripped.load(std::memory_order_relaxed), after = before;
+	int key = 2 * sensor + filtered;
+	bool fail, failing;
+
+	for (uint16_t index = first[key]; index < first[key + 1]; index++) {
+		interlock_term &term = terms[index];
+
+		if (!term.primed) {
+			term.value = reading;
+			term.last = reading;
+			term.last_us = timestamp;
+			term.primed = true;
+		} else if (term.alpha != 0) {
+			term.value += term.alpha * (reading - term.value);
+		} else {
+			term.value = reading;
+		}
+
+		switch (term.check) {
+		case INTERLOCK_ABOVE:
+			fail = term.value > term.limit;
+			break;
+		case INTERLOCK_BELOW:
+			fail = term.value < term.limit;
+			break;
+		default:
+			/* |change| / elapsed > limit, without dividing */
+			fail = fabs(term.value - term.last) * 1e6 >
+			    term.limit * (double)(timestamp - term.last_us);
+			term.last = term.value;
+			term.last_us = timestamp;
+			break;
+		}
+
+		if (!fail)
+			term.run = 0;
+		else if (term.run < term.persist)
+			term.run++;
+
+		failing = term.run >= term.persist;
+		if (failing == term.failing)
+			continue;
+
+		term.failing = failing;
+		interlock_rule &rule = rules[term.rule];
+		rule.failing += failing ? 1 : -1;
+		if (rule.failing >= rule.needed)
+			after |= (uint32_t)1 << term.rule;
+		else
+			after &= ~((uint32_t)1 << term.rule);
+	}
+
+	if (after != before) {
+		tripped.store(after, std::memory_order_release);
+		if (after & ~before)
+			trips.fetch_add(__builtin_popcount(after & ~before), std::memory_order_relaxed);
+
+		/* No sequence may go on writing pins past a trip, or start until it clears */
+		sequencer *playing = runner.load(std::memory_order_acquire);
+		if (playing != NULL && (after & ~before))
+			playing->hold(true);
+		else if (playing != NULL && after == 0)
+			playing->hold(false);
+	}
+
+	/* Raised again if someone cleared it (e.g. a new burn) while still tripped */
+	if (after != 0 && shutoff != NULL && !shutoff->load(std::memory_order_relaxed)) {
+		shutoff->store(true);
+		if (wake != NULL)
+			wake->notify();
+	} else if (after == 0 && before != 0 && shutoff != NULL) {
+		shutoff->store(false);
+	}
+
+	return (before == 0) != (after == 0);
+}
+
+uint32_t interlock::getTripped() {
+	return tripped.load(std::memory_order_acquire);
+}
+
+uint32_t interlock::getTrips() {
+	return trips.load(std::memory_order_relaxed);
+}
+
+size_t interlock::size() {
+	return rules.size();
+}
+
+const char *interlock::describe(size_t rule) {
+	return rule < descriptions.size() ? descriptions[rule].c_str() : "";
+}
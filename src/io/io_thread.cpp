@@ -0,0 +1,415 @@
+/**
+ * @file io_thread.cpp
+ * @brief Thread that writes sampled data to disk and the network.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <vector>
+
+#include "calibration/calibration.hpp"
+#include "circular_buffer/packet.hpp"
+#include "io/io_thread.hpp"
+#include "io/retransmit_cache.hpp"
+#include "logger/logger.hpp"
+#include "networking/Udp.hpp"
+#include "recorder/recorder.hpp"
+#include "sequencer/valve_state.hpp"
+
+IoThread::IoThread(Udp::OutSocket *sock, uint32_t batch_window_us,
+    uint16_t datagram_size, uint32_t history_packets)
+	: storage_mode(STORAGE_SYNC)
+	, storage_buffers(STORAGE_BUFFERS)
+	, sock(sock)
+	, batch_window_us(batch_window_us)
+	, datagram_size(datagram_size)
+	, datagrams(NULL)
+	, history(NULL)
+	, valves(NULL)
+	, valve_changes(0)
+	, calibration(NULL)
+	, calibrated(NULL)
+	, packets_written(0)
+	, packets_sent(0)
+	, send_failures(0)
+	, datagrams_sent(0)
+	, send_calls(0)
+	, bytes_sent(0)
+{
+	for (int index = 0; index < SENSOR::NUM_SENSORS; index++) {
+		recorded[index] = false;
+		summaries[index].count = 0;
+		summaries[index].total = 0;
+	}
+
+	/* Also creates the log directory the recording goes in */
+	log = new Logger("I/O Thread", "IoThreadLog", LogLevel::DEBUG);
+
+	/* Every datagram must have room for at least one whole packet */
+	if (datagram_size != 0) {
+		if (this->datagram_size < sizeof(struct frame_header) +
+		    sizeof(struct section_header) + IO_PACKET_SIZE)
+			this->datagram_size = sizeof(struct frame_header) +
+			    sizeof(struct section_header) + IO_PACKET_SIZE;
+
+		datagrams = new uint8_t[IO_MAX_BATCH * this->datagram_size];
+	}
+
+	if (history_packets != 0)
+		history = new retransmit_cache(history_packets);
+}
+
+IoThread::~IoThread() {
+	std::vector<ring_buffer<io_packet> *>::iterator it;
+
+	for (it = queues.begin(); it != queues.end(); ++it)
+		delete *it;
+
+	recording.close();
+
+	delete log;
+	delete[] datagrams;
+	delete[] calibrated;
+	delete history;
+}
+
+ring_buffer<io_packet> *IoThread::addQueue(SENSOR *sensors, uint8_t num_sensors) {
+	ring_buffer<io_packet> *queue = new ring_buffer<io_packet>(IO_QUEUE_CAPACITY);
+
+	for (int index = 0; index < num_sensors; index++)
+		recorded[sensors[index]] = true;
+
+	queues.push_back(queue);
+	return queue;
+}
+
+void IoThread::send(uint8_t **bufs, size_t *lens, size_t n, size_t num_packets) {
+	uint64_t bytes = 0;
+	bool sent = false;
+
+	if (sock != NULL && sock->getFd() != -1) {
+		try {
+			send_calls.fetch_add(sock->sendBatch(bufs, lens, n),
+			    std::memory_order_relaxed);
+			sent = true;
+		} catch (Udp::OpFailureException&) {
+		} catch (Udp::BadOutSocketException&) {
+		}
+	}
+
+	if (!sent) {
+		if (send_failures.fetch_add(num_packets, std::memory_order_relaxed) == 0)
+			printf("Problem with socket, data is only being logged\n");
+		return;
+	}
+
+	for (size_t index = 0; index < n; index++)
+		bytes += lens[index];
+
+	packets_sent.fetch_add(num_packets, std::memory_order_relaxed);
+	datagrams_sent.fetch_add(n, std::memory_order_relaxed);
+	bytes_sent.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void IoThread::sendPacked(io_packet **packets, size_t n) {
+	uint8_t *bufs[IO_MAX_BATCH];
+	size_t lens[IO_MAX_BATCH];
+	frame_writer frame;
+	size_t num_frames = 0, index;
+
+	frame.reset(datagrams, datagram_size);
+	for (index = 0; index < n; index++) {
+		if (frame.add(packets[index]->sensor, packets[index]->data,
+		    packets[index]->length))
+			continue;
+
+		/* This datagram is full, so start the next one */
+		bufs[num_frames] = datagrams + num_frames * datagram_size;
+		lens[num_frames] = frame.length();
+		num_frames++;
+
+		frame.reset(datagrams + num_frames * datagram_size, datagram_size);
+		frame.add(packets[index]->sensor, packets[index]->data,
+		    packets[index]->length);
+	}
+
+	bufs[num_frames] = datagrams + num_frames * datagram_size;
+	lens[num_frames] = frame.length();
+	num_frames++;
+
+	send(bufs, lens, num_frames, n);
+}
+
+void IoThread::calibrate(io_packet **packets, size_t n) {
+	const size_t size = sizeof(struct calibrated_header) + IO_CALIBRATED_ITEMS * sizeof(float);
+	struct data_item items[IO_CALIBRATED_ITEMS];
+	uint16_t raw[IO_CALIBRATED_ITEMS];
+	float values[IO_CALIBRATED_ITEMS];
+	uint8_t *bufs[IO_MAX_BATCH];
+	size_t lens[IO_MAX_BATCH], num_sent = 0;
+	uint16_t count;
+	SENSOR sensor;
+
+	for (size_t index = 0; index < n; index++) {
+		if (decode_packet(packets[index]->data, packets[index]->length, &sensor,
+		    items, IO_CALIBRATED_ITEMS, &count) == 0 || count == 0)
+			continue;
+
+		for (uint16_t item = 0; item < count; item++)
+			raw[item] = items[item].reading;
+		calibration->convert(sensor, raw, values, count);
+
+		io_summary *summary = &summaries[sensor];
+		for (uint16_t item = 0; item < count; item++) {
+			if (summary->count == 0 || values[item] < summary->min)
+				summary->min = values[item];
+			if (summary->count == 0 || values[item] > summary->max)
+				summary->max = values[item];
+			summary->total += values[item];
+			summary->count++;
+		}
+
+		if (calibrated == NULL)
+			continue;
+
+		bufs[num_sent] = calibrated + num_sent * size;
+		lens[num_sent] = encode_calibrated(sensor, items[0].seq, values, count,
+		    bufs[num_sent], size);
+		num_sent++;
+	}
+
+	if (num_sent > 0)
+		send(bufs, lens, num_sent, num_sent);
+}
+
+void IoThread::sendValves(bool force) {
+	struct valve_packet packet;
+	uint8_t *bufs[1] = {(uint8_t *)&packet};
+	size_t lens[1];
+
+	if (!force && valves->getChanges() == valve_changes)
+		return;
+
+	lens[0] = valves->encode((uint8_t *)&packet, sizeof(packet));
+	valve_changes = packet.changes;
+
+	recording.append(IO_VALVE_CHANNEL, bufs[0], lens[0], get_elapsed_time_us());
+	send(bufs, lens, 1, 1);
+}
+
+void IoThread::report(double elapsed_s, io_stats *last) {
+	recorder_stats written;
+	storage_stats storage;
+	io_stats now;
+	uint64_t calls, bytes;
+
+	getStats(&now);
+	recording.getStats(&written);
+	recording.getStorageStats(&storage);
+	calls = now.send_calls - last->send_calls;
+	bytes = now.bytes_sent - last->bytes_sent;
+
+	log->info("%llu packets in %llu datagrams and %llu syscalls: %.1f syscalls/s, "
+	    "%.1f bytes/syscall, %llu send failures, %llu drops, max queue depth %u\n",
+	    (unsigned long long)(now.packets_sent - last->packets_sent),
+	    (unsigned long long)(now.datagrams_sent - last->datagrams_sent),
+	    (unsigned long long)calls, calls / elapsed_s,
+	    calls ? (double)bytes / calls : 0.0,
+	    (unsigned long long)(now.send_failures - last->send_failures),
+	    (unsigned long long)(now.drops - last->drops), now.max_depth);
+
+	log->info("%llu packets recorded in %llu blocks and %llu writes, %llu write errors, "
+	    "%llu stalls, max %u writes in flight, longest write %llu us\n",
+	    (unsigned long long)(now.packets_written - last->packets_written),
+	    (unsigned long long)written.blocks, (unsigned long long)written.write_calls,
+	    (unsigned long long)written.errors, (unsigned long long)written.stalls,
+	    storage.max_depth, (unsigned long long)storage.max_latency_us);
+
+	*last = now;
+
+	for (size_t index = 0; index < reporters.size(); index++)
+		reporters[index]->report(log, elapsed_s);
+
+	if (calibration == NULL)
+		return;
+
+	for (int index = 0; index < SENSOR::NUM_SENSORS; index++) {
+		io_summary *summary = &summaries[index];
+
+		if (summary->count == 0)
+			continue;
+
+		log->info("%s: min %.2f, mean %.2f, max %.2f over %llu readings\n",
+		    SENSOR_NAMES[index], summary->min, summary->total / summary->count,
+		    summary->max, (unsigned long long)summary->count);
+		summary->count = 0;
+		summary->total = 0;
+	}
+}
+
+void IoThread::run() {
+	struct timespec window = {(time_t)(batch_window_us / 1000000),
+	    (long)(batch_window_us % 1000000) * 1000};
+	struct timespec now, last_report, last_valves, last_sync;
+	std::vector<uint32_t> taken(queues.size());
+	uint8_t *bufs[IO_MAX_BATCH];
+	size_t lens[IO_MAX_BATCH];
+	io_packet *packet, *packets[IO_MAX_BATCH];
+	io_stats last;
+	size_t n, q;
+	double elapsed_s;
+	timestamp_t time_us;
+
+	getStats(&last);
+	clock_gettime(CLOCK_MONOTONIC, &last_report);
+	last_valves = last_report;
+	last_sync = last_report;
+
+	// TODO: ever break out of this loop?
+	while (1) {
+		n = 0;
+		time_us = get_elapsed_time_us();
+
+		/* Record everything waiting, leaving it in place to be sent */
+		for (q = 0; q < queues.size(); q++) {
+			taken[q] = 0;
+
+			while (n < IO_MAX_BATCH &&
+			       (packet = queues[q]->peek(taken[q])) != NULL) {
+				if (recorded[packet->sensor] &&
+				    recording.append(packet->sensor, packet->data,
+				    packet->length, time_us) == 0)
+					packets_written.fetch_add(1, std::memory_order_relaxed);
+
+				packets[n] = packet;
+				bufs[n] = packet->data;
+				lens[n] = packet->length;
+				n++;
+				taken[q]++;
+			}
+		}
+
+		// Send the data over UDP, all in one go
+		if (n > 0 && datagram_size != 0)
+			sendPacked(packets, n);
+		else if (n > 0)
+			send(bufs, lens, n, n);
+
+		if (n > 0 && calibration != NULL)
+			calibrate(packets, n);
+
+		if (n > 0 && history != NULL)
+			history->add(packets, n);
+
+		for (q = 0; q < queues.size(); q++)
+			queues[q]->release(taken[q]);
+
+		recording.poll();
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (valves != NULL) {
+			elapsed_s = (now.tv_sec - last_valves.tv_sec) +
+			    (now.tv_nsec - last_valves.tv_nsec) / 1e9;
+			sendValves(elapsed_s >= IO_VALVE_INTERVAL_S);
+			if (elapsed_s >= IO_VALVE_INTERVAL_S)
+				last_valves = now;
+		}
+
+		/* Write out the partly filled block now and then */
+		elapsed_s = (now.tv_sec - last_sync.tv_sec) +
+		    (now.tv_nsec - last_sync.tv_nsec) / 1e9;
+		if (elapsed_s * 1000 >= RECORDER_SYNC_INTERVAL_MS) {
+			recording.sync();
+			last_sync = now;
+		}
+
+		elapsed_s = (now.tv_sec - last_report.tv_sec) +
+		    (now.tv_nsec - last_report.tv_nsec) / 1e9;
+		if (elapsed_s >= IO_REPORT_INTERVAL_S) {
+			report(elapsed_s, &last);
+			last_report = now;
+		}
+
+		/* A full batch means more is waiting, so go straight round again */
+		if (n < IO_MAX_BATCH)
+			nanosleep(&window, NULL);
+	}
+}
+
+void IoThread::addReporter(io_reporter *reporter) {
+	reporters.push_back(reporter);
+}
+
+void IoThread::setValves(valve_state *valves) {
+	this->valves = valves;
+}
+
+void IoThread::setCalibration(const calibration_table *calibration, bool send) {
+	this->calibration = calibration;
+	if (send && calibrated == NULL)
+		calibrated = new uint8_t[IO_MAX_BATCH * (sizeof(struct calibrated_header) +
+		    IO_CALIBRATED_ITEMS * sizeof(float))];
+}
+
+void IoThread::setStorage(STORAGE_MODE mode, uint32_t buffers) {
+	storage_mode = mode;
+	storage_buffers = buffers;
+}
+
+void IoThread::start() {
+	const char *names[SENSOR::NUM_SENSORS + 1];
+	/* Room for the time twice, in the directory and the file name */
+	char time_buf[MAX_TIME_BUF_LEN], path[2 * MAX_TIME_BUF_LEN + 32];
+
+	for (int index = 0; index < SENSOR::NUM_SENSORS; index++)
+		names[index] = SENSOR_NAMES[index];
+	names[IO_VALVE_CHANNEL] = "Valves";
+
+	get_formatted_time(time_buf);
+	snprintf(path, sizeof(path), "logs/%s/Recording_%s.rec", time_buf, time_buf);
+	if (recording.open(path, names, SENSOR::NUM_SENSORS + 1, time_buf, storage_mode,
+	    storage_buffers) != 0)
+		log->error("Could not create the recording %s, data is only being sent\n",
+		    path);
+	else
+		log->info("Recording to %s with %s writes\n", path,
+		    storage_mode_name(recording.getMode()));
+
+	core_thread = std::thread(&IoThread::run, this);
+	core_thread.detach();
+}
+
+void IoThread::getStats(io_stats *stats) {
+	std::vector<ring_buffer<io_packet> *>::iterator it;
+
+	stats->packets_written = packets_written.load(std::memory_order_relaxed);
+	stats->packets_sent = packets_sent.load(std::memory_order_relaxed);
+	stats->send_failures = send_failures.load(std::memory_order_relaxed);
+	stats->datagrams_sent = datagrams_sent.load(std::memory_order_relaxed);
+	stats->send_calls = send_calls.load(std::memory_order_relaxed);
+	stats->bytes_sent = bytes_sent.load(std::memory_order_relaxed);
+	stats->drops = 0;
+	stats->depth = 0;
+	stats->max_depth = 0;
+
+	for (it = queues.begin(); it != queues.end(); ++it) {
+		stats->drops += (*it)->getDrops();
+		stats->depth += (*it)->size();
+		if ((*it)->getMaxDepth() > stats->max_depth)
+			stats->max_depth = (*it)->getMaxDepth();
+	}
+}
+
+uint32_t IoThread::resend(SENSOR sensor, uint32_t first, uint32_t count,
+    std::vector<io_packet> *found, uint32_t max_packets)
+{
+	if (history == NULL)
+		return 0;
+
+	return history->find(sensor, first, count, found, max_packets);
+}
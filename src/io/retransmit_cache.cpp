@@ -0,0 +1,100 @@
+/**
+ * @file retransmit_cache.cpp
+ * @brief Bounded history of sent packets, for resending what the ground
+ * 	  station missed.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <algorithm>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "circular_buffer/packet.hpp"
+#include "io/retransmit_cache.hpp"
+
+retransmit_cache::retransmit_cache(uint32_t capacity)
+	: slots(capacity)
+	, next_slot(0)
+	, used(0)
+	{};
+
+void retransmit_cache::add(io_packet **packets, size_t n) {
+	std::lock_guard<std::mutex> guard(lock);
+	uint32_t first;
+	uint16_t count;
+	entry e;
+
+	if (slots.empty())
+		return;
+
+	for (size_t index = 0; index < n; index++) {
+		if (!packet_range(packets[index]->data, packets[index]->length,
+		    &first, &count))
+			continue;
+
+		/* Forget the packet that was in this slot, its sensor's oldest */
+		if (used == slots.size()) {
+			std::deque<entry> &owner = this->index[slots[next_slot].sensor];
+
+			if (!owner.empty() && owner.front().slot == next_slot)
+				owner.pop_front();
+		}
+
+		memcpy(&slots[next_slot], packets[index],
+		    offsetof(io_packet, data) + packets[index]->length);
+
+		e.first = first;
+		e.end = first + count;
+		e.slot = next_slot;
+		this->index[packets[index]->sensor].push_back(e);
+
+		next_slot = (next_slot + 1) % slots.size();
+		if (used < slots.size())
+			used++;
+	}
+}
+
+uint32_t retransmit_cache::find(SENSOR sensor, uint32_t first, uint32_t count,
+    std::vector<io_packet> *found, uint32_t max_packets)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	std::deque<entry>::iterator it;
+	uint32_t base, start, end, num_found = 0;
+	int32_t skip;
+
+	if (sensor >= SENSOR::NUM_SENSORS || this->index[sensor].empty() || count == 0)
+		return 0;
+
+	std::deque<entry> &entries = this->index[sensor];
+
+	/* Measure from the oldest cached sample, so wrapped numbers still sort */
+	base = entries.front().first;
+	skip = first - base;
+	if (skip < 0) {
+		/* Part of the request is older than anything cached */
+		if ((uint32_t)-skip >= count)
+			return 0;
+		count += skip;
+		skip = 0;
+	}
+	start = skip;
+	end = start + count;
+
+	/* The first packet that ends after the start of the request */
+	it = std::upper_bound(entries.begin(), entries.end(), start,
+	    [base](uint32_t value, const entry &e) { return value < e.end - base; });
+
+	for (; it != entries.end() && it->first - base < end &&
+	     num_found < max_packets; ++it) {
+		found->push_back(slots[it->slot]);
+		num_found++;
+	}
+
+	return num_found;
+}
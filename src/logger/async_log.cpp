@@ -0,0 +1,381 @@
+/**
+ * @file async_log.cpp
+ * @brief Queue and writer thread behind Logger, so logging does not format
+ * 	  or write on the caller's thread.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <atomic>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "logger/async_log.hpp"
+#include "logger/logger.hpp"
+
+static_assert((LOG_QUEUE_RECORDS & (LOG_QUEUE_RECORDS - 1)) == 0,
+    "LOG_QUEUE_RECORDS must be a power of two");
+
+log_queue::log_queue()
+	: tail(0)
+	, head(0)
+{
+	slots = new slot[LOG_QUEUE_RECORDS];
+	for (size_t index = 0; index < LOG_QUEUE_RECORDS; index++)
+		slots[index].seq.store(index, std::memory_order_relaxed);
+}
+
+log_queue::~log_queue() {
+	delete[] slots;
+}
+
+log_record *log_queue::claim() {
+	size_t pos = tail.load(std::memory_order_relaxed);
+	slot *it;
+
+	for (;;) {
+		it = &slots[pos & (LOG_QUEUE_RECORDS - 1)];
+		size_t seq = it->seq.load(std::memory_order_acquire);
+
+		/* The slot is free for this lap: try to take it */
+		if (seq == pos) {
+			if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				return &it->record;
+		/* The consumer has not freed it from the last lap yet */
+		} else if (seq < pos) {
+			return NULL;
+		/* Another producer took it first */
+		} else {
+			pos = tail.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+void log_queue::commit(log_record *record) {
+	slot *it = (slot *)((char *)record - offsetof(slot, record));
+	size_t pos = it->seq.load(std::memory_order_relaxed);
+
+	it->seq.store(pos + 1, std::memory_order_release);
+}
+
+log_record *log_queue::front() {
+	slot *it = &slots[head & (LOG_QUEUE_RECORDS - 1)];
+
+	if (it->seq.load(std::memory_order_acquire) != head + 1)
+		return NULL;
+
+	return &it->record;
+}
+
+void log_queue::pop() {
+	slot *it = &slots[head & (LOG_QUEUE_RECORDS - 1)];
+
+	/* Free for the producers of the next lap */
+	it->seq.store(head + LOG_QUEUE_RECORDS, std::memory_order_release);
+	head++;
+}
+
+size_t log_queue::claimed() {
+	return tail.load(std::memory_order_acquire);
+}
+
+log_backend::log_backend()
+	: stopping(false)
+	, written(0)
+	, drops(0)
+{
+	writer = std::thread(&log_backend::run, this);
+}
+
+log_backend::~log_backend() {
+	stopping.store(true);
+	writer.join();
+}
+
+log_backend &log_backend::instance() {
+	static log_backend backend;
+
+	return backend;
+}
+
+log_record *log_backend::claim() {
+	log_record *record = queue.claim();
+
+	if (record == NULL)
+		drops.fetch_add(1, std::memory_order_relaxed);
+
+	return record;
+}
+
+void log_backend::commit(log_record *record) {
+	queue.commit(record);
+}
+
+void log_backend::flush() {
+	size_t target = queue.claimed();
+	struct timespec wait = {0, LOG_WRITE_INTERVAL_US * 1000 / 4};
+
+	while (written.load(std::memory_order_acquire) < target)
+		nanosleep(&wait, NULL);
+}
+
+uint32_t log_backend::getDrops() {
+	return drops.load(std::memory_order_relaxed);
+}
+
+/*
+ * Write all of a batch, carrying on after short writes.
+ */
+static void write_all(int fd, const std::string &batch) {
+	size_t done = 0;
+	ssize_t n;
+
+	while (done < batch.size()) {
+		n = write(fd, batch.data() + done, batch.size() - done);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return;
+		done += n;
+	}
+}
+
+void log_backend::run() {
+	struct timespec wait = {0, LOG_WRITE_INTERVAL_US * 1000};
+	std::vector<std::pair<int, std::string> > batches;
+	uint32_t reported_drops = 0, now_drops;
+	char message[MAX_BUF_LEN], line[2 * MAX_BUF_LEN];
+	std::string out;
+	log_record *record;
+	size_t count, pending = 0;
+	int length;
+
+	for (;;) {
+		/* Read stopping first, so nothing logged before it is left behind */
+		bool last = stopping.load();
+
+		count = 0;
+		while ((record = queue.front()) != NULL) {
+			log_format(record, message, sizeof(message));
+
+			if (record->kind == LOG_VERBATIM)
+				length = snprintf(line, sizeof(line), "%s", message);
+			else
+				length = snprintf(line, sizeof(line), "[%s][%s][%lu] %s",
+				    record->name, LogLevelStrings[record->level],
+				    (unsigned long)record->time_ms, message);
+			if (length >= (int)sizeof(line))
+				length = sizeof(line) - 1;
+
+			/* One batch per log file, plus stdout */
+			size_t index = 0;
+			while (index < batches.size() && batches[index].first != record->fd)
+				index++;
+			if (index == batches.size())
+				batches.push_back(std::make_pair(record->fd, std::string()));
+
+			batches[index].second.append(line, length);
+			out.append(line, length);
+			pending++;
+
+			queue.pop();
+			count++;
+
+			if (out.size() >= LOG_BATCH_SIZE)
+				break;
+		}
+
+		now_drops = drops.load(std::memory_order_relaxed);
+		if (now_drops != reported_drops) {
+			dprintf(STDERR_FILENO, "[Logger] dropped %u messages, the queue was full\n",
+			    now_drops - reported_drops);
+			reported_drops = now_drops;
+		}
+
+		for (size_t index = 0; index < batches.size(); index++) {
+			write_all(batches[index].first, batches[index].second);
+			batches[index].second.clear();
+		}
+		write_all(STDOUT_FILENO, out);
+		out.clear();
+
+		if (pending > 0) {
+			written.fetch_add(pending, std::memory_order_release);
+			pending = 0;
+		}
+
+		if (count == 0) {
+			if (last)
+				return;
+			nanosleep(&wait, NULL);
+		}
+	}
+}
+
+/*
+ * Formats one conversion of a record. spec is the conversion as written, e.g.
+ * "%-8.3lf", and is rewritten in place for the type the argument was stored
+ * as. Returns the number of characters written, as snprintf does.
+ */
+static int format_arg(char *buf, size_t size, char *spec, size_t spec_len,
+    const log_record *record, uint8_t arg)
+{
+	char conversion = spec[spec_len - 1];
+	uint64_t value = record->args[arg];
+	uint8_t type = record->types[arg];
+	char length[3] = {0};
+	double real;
+	size_t end = spec_len - 1;
+
+	/* Take the length modifier off; the value is cast to match it instead */
+	while (end > 1 && strchr("hlLqjzt", spec[end - 1]) != NULL) {
+		end--;
+		if (spec[end] != 'L' && strlen(length) < 2)
+			length[strlen(length)] = spec[end];
+	}
+	spec[end] = '\0';
+
+	if (type == LOG_ARG_DOUBLE)
+		memcpy(&real, &value, sizeof(real));
+	else
+		real = type == LOG_ARG_INT ? (double)(int64_t)value : (double)value;
+
+	switch (conversion) {
+	case 'd':
+	case 'i': {
+		long long v = (int64_t)value;
+
+		if (type == LOG_ARG_DOUBLE)
+			v = (long long)real;
+		if (strcmp(length, "hh") == 0)
+			v = (signed char)v;
+		else if (strcmp(length, "h") == 0)
+			v = (short)v;
+		else if (length[0] == '\0')
+			v = (int)v;
+
+		strcat(spec, "lld");
+		spec[strlen(spec) - 1] = conversion;
+		return snprintf(buf, size, spec, v);
+	}
+	case 'u':
+	case 'o':
+	case 'x':
+	case 'X': {
+		unsigned long long v = value;
+
+		if (type == LOG_ARG_DOUBLE)
+			v = (unsigned long long)real;
+		if (strcmp(length, "hh") == 0)
+			v = (unsigned char)v;
+		else if (strcmp(length, "h") == 0)
+			v = (unsigned short)v;
+		else if (length[0] == '\0')
+			v = (unsigned int)v;
+
+		strcat(spec, "llu");
+		spec[strlen(spec) - 1] = conversion;
+		return snprintf(buf, size, spec, v);
+	}
+	case 'c':
+		strcat(spec, "c");
+		return snprintf(buf, size, spec, (int)(unsigned char)value);
+	case 'f':
+	case 'F':
+	case 'e':
+	case 'E':
+	case 'g':
+	case 'G':
+	case 'a':
+	case 'A':
+		spec[end] = conversion;
+		spec[end + 1] = '\0';
+		return snprintf(buf, size, spec, real);
+	case 's':
+		strcat(spec, "s");
+		return snprintf(buf, size, spec, type == LOG_ARG_STRING ?
+		    record->text + value : "(?)");
+	case 'p':
+		strcat(spec, "p");
+		return snprintf(buf, size, spec, (void *)(uintptr_t)value);
+	default:
+		return snprintf(buf, size, "%s", "(?)");
+	}
+}
+
+size_t log_format(const log_record *record, char *buf, size_t size) {
+	const char *format = record->format, *start;
+	char spec[32];
+	size_t used = 0, spec_len;
+	uint8_t arg = 0;
+	int n;
+
+	if (size == 0)
+		return 0;
+
+	while (*format != '\0' && used + 1 < size) {
+		if (*format != '%') {
+			buf[used++] = *format++;
+			continue;
+		}
+
+		if (format[1] == '%') {
+			buf[used++] = '%';
+			format += 2;
+			continue;
+		}
+
+		/* Copy the conversion, filling in any * width or precision */
+		start = format++;
+		spec_len = 1;
+		spec[0] = '%';
+		while (*format != '\0' && strchr("diouxXcfFeEgGaAspn", *format) == NULL) {
+			if (*format == '*') {
+				long long star = arg < record->num_args ? (int64_t)record->args[arg] : 0;
+
+				arg++;
+				spec_len += snprintf(spec + spec_len, sizeof(spec) - spec_len,
+				    "%d", (int)star);
+			} else if (spec_len + 1 < sizeof(spec) - 4) {
+				spec[spec_len++] = *format;
+			}
+			format++;
+			if (spec_len >= sizeof(spec) - 4)
+				spec_len = sizeof(spec) - 5;
+		}
+
+		/* A format cut short, printed as is */
+		if (*format == '\0') {
+			n = snprintf(buf + used, size - used, "%s", start);
+			used += n < (int)(size - used) ? n : size - used - 1;
+			break;
+		}
+
+		spec[spec_len++] = *format++;
+		spec[spec_len] = '\0';
+
+		if (spec[spec_len - 1] == 'n')
+			continue;
+
+		if (arg >= record->num_args)
+			n = snprintf(buf + used, size - used, "%s", "(missing)");
+		else
+			n = format_arg(buf + used, size - used, spec, spec_len, record, arg++);
+
+		if (n > 0)
+			used += n < (int)(size - used) ? n : size - used - 1;
+	}
+
+	buf[used] = '\0';
+	return used;
+}
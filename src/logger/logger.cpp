@@ -17,6 +17,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "logger/async_log.hpp"
 #include "logger/logger.hpp"
 #include "time/time.hpp"
 
@@ -24,11 +25,11 @@ Logger::Logger(const char *name, const char *fname, LogLevel log_level)
 	: name(name)
 	, log_level(log_level)
 	, file_fd(-1)
+	, backend(&log_backend::instance())
   	{
 		char time_buf[MAX_TIME_BUF_LEN];
 
-		/* Set start time of RESFET and get the formatted name into time_buf. */
-		set_start_time();
+		/* Get the formatted name into time_buf. */
 		get_formatted_time(time_buf);
 
 		/* Set the name of the file. */
@@ -54,8 +55,7 @@ int Logger::create_log_file() {
 
 	char time_buf[MAX_TIME_BUF_LEN];
 
-        /* Set start time of RESFET and get the formatted name into time_buf. */
-        set_start_time();
+        /* Get the formatted name into time_buf. */
 	get_formatted_time(time_buf);
 
 	/* Create the logs directory if it does not exist */
@@ -93,78 +93,38 @@ char *Logger::getFilename() {
 	return filename;
 }
 
-void Logger::log(const char *format, LogLevel level, va_list argList) {
+log_record *Logger::begin(const char *format, LogLevel level, LOG_KIND kind) {
+	log_record *record;
+
 	/* Check the log file exists */
 	if (file_fd == -1) {
 		dprintf(STDERR_FILENO, "Attempting to log when log file is null\n");
-		return;
+		return NULL;
 	}
 
 	/* Only log messages if the priority is high enough */
 	if (log_level < level)
-		return;
-
-	/* Save the formatted message in the internal buffer */
-	vsnprintf(buf, MAX_BUF_LEN, format, argList);
-
-	/* Null-terminate the buffer, for safety */
-	buf[MAX_BUF_LEN - 1] = '\0';
-
-	/* Write the formatted message, and other information, to the log file */	
-	dprintf(file_fd, "[%s][%s][%lu] %s", name, LogLevelStrings[level], get_elapsed_time_ms(), buf);
-	
-	/* Write to stdout */
-	dprintf(STDOUT_FILENO, "[%s][%s][%lu] %s", name, LogLevelStrings[level], get_elapsed_time_ms(), buf);
-}
-
-void Logger::error(const char *format, ...) {
-	/* Pass in the format string and variable args */
-	va_list argList;
-	va_start(argList, format);
-	log(format, LogLevel::ERROR, argList);
-	va_end(argList);
-}
-
-void Logger::info(const char *format, ...) {
-	/* Pass in the format string and variable args */
-	va_list argList;
-	va_start(argList, format);
-	log(format, LogLevel::INFO, argList);
-	va_end(argList);
-}
-
-void Logger::debug(const char *format, ...) {
-	/* Pass in the format string and variable args */
-	va_list argList;
-	va_start(argList, format);
-	log(format, LogLevel::DEBUG, argList);
-	va_end(argList);
+		return NULL;
+
+	/* Formatted and written later by the backend's thread */
+	record = backend->claim();
+	if (record == NULL)
+		return NULL;
+
+	record->time_ms = get_elapsed_time_ms();
+	record->format = format;
+	record->name = name;
+	record->fd = file_fd;
+	record->level = level;
+	record->kind = kind;
+	record->num_args = 0;
+	record->text_used = 0;
+
+	return record;
 }
 
-void Logger::verbatim(const char *format, ...) {
-	/* Check the log file exists */
-	if (file_fd == -1) {
-		dprintf(STDERR_FILENO, "Attempting to log when log file is null\n");
-		return;
-	}
-
-	/* Pass in the format string and variable args */
-	va_list argList;
-	va_start(argList, format);
-
-	/* Save the formatted message in the internal buffer */
-	vsnprintf(buf, MAX_BUF_LEN, format, argList);
-
-	va_end(argList);
-
-	/* Null-terminate the buffer, for safety */
-	buf[MAX_BUF_LEN - 1] = '\0';
-
-	/* Write the formatted message, and other information, to the log file */	
-	dprintf(file_fd, "%s", buf);
-	
-	/* Write to stdout */
-	dprintf(STDOUT_FILENO, "%s", buf);
+void Logger::flush() {
+	backend->flush();
 }
 
 void Logger::data(uint8_t *data, size_t size) {
@@ -1,17 +1,28 @@
 #include <atomic>
 #include <chrono>
+#include <cctype>
 #include <cstdint>
-#include <mutex>
 #include <iostream>
 #include <string.h>
 #include <thread>
 #include <bcm2835.h>
 
+#include "adc/adc_backend.hpp"
+#include "calibration/calibration.hpp"
+#include "filter/filter_bank.hpp"
+#include "circular_buffer/packet.hpp"
+#include "networking/CommandServer.hpp"
 #include "networking/Udp.hpp"
 #include "networking/Tcp.hpp"
 #include "logger/logger.hpp"
 #include "config/config.hpp"
 #include "thread/thread.hpp"
+#include "interlock/interlock.hpp"
+#include "io/io_thread.hpp"
+#include "recorder/storage.hpp"
+#include "sequencer/valve_state.hpp"
+#include "sequencer/wakeup.hpp"
+#include "visitor/command_dispatcher.hpp"
 #include "visitor/worker_visitor.hpp"
 #include "visitor/luna_visitor.hpp"
 #include "visitor/titan_visitor.hpp"
@@ -21,12 +32,6 @@
 #define LUNA 0
 #define TITAN 1
 
-// Defaults for pressure cutoff
-#define DEFAULT_PRESSURE_MAX 800
-#define DEFAULT_PRESSURE_MIN 300
-#define DEFAULT_PRESSURE_SLOPE -0.3
-#define DEFAULT_PRESSURE_YINT 1108.1
-
 // Global lock for ignition state
 // TODO: move this to a more appropriate place?
 std::atomic<bool> ignitionOn;   
@@ -34,6 +39,12 @@ std::atomic<bool> ignitionOn;
 // Global lock for extreme low/high pressure, for safety shutoff
 std::atomic<bool> pressureShutoff;   
 
+// Wakes the ignition thread as soon as either of the above changes
+wakeup ignitionWakeup;
+
+// The output pins, written through here so their levels can be reported
+valve_state valves;
+
 // Simple send test for UDP interface
 int main(int argc, char **argv) {
     ConfigMapping config_map;
@@ -77,7 +88,6 @@ int main(int argc, char **argv) {
     config_map.getInt("Network", "port", &port);
     Logger network_logger("Networking", "NetworkLog", LogLevel::DEBUG);
     Udp::OutSocket sock;
-    std::mutex sockMtx;
     try {
         sock.setDest(address, port);  
     } catch (Udp::OpFailureException& ofe) {
@@ -85,68 +95,129 @@ int main(int argc, char **argv) {
         return -1;
     }
   
-    // Open the socket up for sending
+    // Open the socket up for sending, connected so the route is looked up once
     try {
         sock.enable();
+        sock.connect();
 	network_logger.info("Successfully started UDP server on %s:%d\n", address, port);
     } catch (Udp::OpFailureException& ofe) {
         network_logger.error("Could not open socket\n");
         return -1;
     }
 
-    SENSOR lcs[5] = {
+    // Every sensor, read by one acquisition thread at its own rate
+    SENSOR sensors[SENSOR::NUM_SENSORS] = {
         SENSOR::LC1,
         SENSOR::LC2,
         SENSOR::LC3,
         SENSOR::LC4,
         SENSOR::LC5,
-    };
-
-    SENSOR pts[4] = {
         SENSOR::PT1,
         SENSOR::PT2,
         SENSOR::PT3,
         SENSOR::PT4,
-     };
-
-    SENSOR tcs[4] = {
         SENSOR::TC1,
         SENSOR::TC2,
         SENSOR::TC3,
         SENSOR::TC4
     };
     
-    // Retrieve pressure cutoff info from the map
-    double pressureMax = DEFAULT_PRESSURE_MAX,
-           pressureMin = DEFAULT_PRESSURE_MIN,
-           pressureSlope = DEFAULT_PRESSURE_SLOPE,
-           pressureYint = DEFAULT_PRESSURE_YINT;
-    int readAll = config_map.getDouble("Pressure", "pressure_max", &pressureMax) +
-                  config_map.getDouble("Pressure", "pressure_min", &pressureMin) +
-                  config_map.getDouble("Pressure", "pressure_slope", &pressureSlope) +
-                  config_map.getDouble("Pressure", "pressure_yint", &pressureYint);
-    if (readAll != 0) {
-        printf("[main] WARNING: failed to read pressure shutoff values, using defaults\n");
+    // The safety rules, checked against every reading, signal a pressure shutoff,
+    // wake the ignition thread and abort any sequence the moment one trips
+    calibration_table calibration;
+    if (calibration.load(config_map) != 0) {
+        printf("[main] WARNING: some sensors were left uncalibrated\n");
+    }
+    printf("[main] Converting readings with the %s kernel\n", calibrate_kernel());
+
+    interlock rules(&pressureShutoff, &ignitionWakeup);
+    if (rules.load(config_map, calibration) != 0) {
+        printf("[main] WARNING: some interlock rules were not loaded\n");
     }
     
-    // TODO only PT thread needs the shutoff
-    PeriodicThread lc_thread("Load Cell Thread", SENSOR_FREQS[SENSOR::LC1], lcs, 5, pressureMax, pressureMin, pressureSlope, pressureYint, &sock);
-    PeriodicThread pt_thread("Pressure Transducer Thread", SENSOR_FREQS[SENSOR::PT1], pts, 4, pressureMax, pressureMin, pressureSlope, pressureYint, &sock);
-    PeriodicThread tc_thread("Thermocouple Thread", SENSOR_FREQS[SENSOR::TC1], tcs, 4, pressureMax, pressureMin, pressureSlope, pressureYint, &sock);
-    lc_thread.start();
-    pt_thread.start();
-    tc_thread.start();
-
-    Tcp::ListenSocket liSock;
-    try {
-	    liSock = Tcp::ListenSocket(1234);
-	    liSock.listen();
-    } catch (Tcp::OpFailureException&) {
-	    network_logger.error("Could not create/open listening socket\n");
-	    return (-1);
+    // All logging and sending is done by one I/O thread, fed by the sampling threads,
+    // which sends whatever collects each batch window in one syscall and keeps the last
+    // history_packets for retransmission
+    uint32_t batch_window_us = IO_BATCH_WINDOW_US, datagram_size = 0, history_packets = IO_HISTORY_PACKETS;
+    config_map.getInt("Telemetry", "batch_window_us", &batch_window_us);
+    config_map.getInt("Telemetry", "datagram_size", &datagram_size);
+    config_map.getInt("Telemetry", "history_packets", &history_packets);
+    IoThread io_thread(&sock, batch_window_us, datagram_size > UINT16_MAX ? UINT16_MAX : datagram_size,
+                       history_packets);
+
+    // Sensor rates can be overridden from the config, e.g. to load-test the mock build
+    for (int index = 0; index < SENSOR::NUM_SENSORS; index++) {
+        uint32_t freq;
+        if (config_map.getInt("Rates", SENSOR_NAMES[index], &freq) == 0 && freq > 0 && freq <= UINT16_MAX)
+            SENSOR_FREQS[index] = freq;
+    }
+
+    // Filters are designed for the final rates, and feed the rules written on PT1.filtered etc.
+    filter_bank filters;
+    if (filters.load(config_map, calibration) != 0) {
+        printf("[main] WARNING: some sensors were left unfiltered\n");
+    }
+
+#ifdef MOCK
+    // The mock build samples a synthetic or recorded source instead of the ADCs
+    adc_backend *backend = make_mock_backend(config_map);
+#else
+    adc_backend *backend = default_backend();
+#endif
+
+    // Packets are sent and logged in the legacy layout unless the config asks for compact ones
+    PACKET_FORMAT format = PACKET_FORMAT::LEGACY;
+    char format_name[MAX_CONFIG_LENGTH];
+    if (config_map.getString("Telemetry", "packet_format", format_name, MAX_CONFIG_LENGTH) == 0 &&
+        parse_packet_format(format_name, &format) != 0) {
+        printf("[main] WARNING: unknown packet_format %s, using legacy\n", format_name);
+    }
+
+    // A single thread owns the SPI bus and reads every sensor on a fixed schedule
+    PeriodicThread acq_thread("Acquisition Thread", sensors, SENSOR::NUM_SENSORS, &io_thread, backend, &rules, format);
+
+    // Slow sensors send partial packets rather than wait to fill one, e.g. tc_max_latency_ms=100
+    for (int index = 0; index < SENSOR::NUM_SENSORS; index++) {
+        char key[MAX_CONFIG_LENGTH];
+        uint32_t max_latency_ms;
+        snprintf(key, MAX_CONFIG_LENGTH, "%c%c_max_latency_ms",
+                 tolower(SENSOR_NAMES[index][0]), tolower(SENSOR_NAMES[index][1]));
+        if (config_map.getInt("Telemetry", key, &max_latency_ms) == 0)
+            acq_thread.setMaxLatency((SENSOR)index, max_latency_ms);
+    }
+
+    // Report the valves along with the sensor data
+    bool report_valves = true;
+    if (config_map.isPresent("Telemetry", "valve_state"))
+        config_map.getBool("Telemetry", "valve_state", &report_valves);
+    if (report_valves)
+        io_thread.setValves(&valves);
+
+    // Summarize readings in engineering units, and send them too if calibrated=1
+    bool send_calibrated = false;
+    if (config_map.isPresent("Telemetry", "calibrated"))
+        config_map.getBool("Telemetry", "calibrated", &send_calibrated);
+    io_thread.setCalibration(&calibration, send_calibrated);
+
+    // The recording goes through the page cache unless the config asks for O_DIRECT or io_uring
+    STORAGE_MODE storage_mode = STORAGE_SYNC;
+    uint32_t storage_buffers = STORAGE_BUFFERS;
+    char storage_name[MAX_CONFIG_LENGTH];
+    if (config_map.getString("Recorder", "storage", storage_name, MAX_CONFIG_LENGTH) == 0 &&
+        parse_storage_mode(storage_name, &storage_mode) != 0) {
+        printf("[main] WARNING: unknown storage %s, using sync\n", storage_name);
     }
+    config_map.getInt("Recorder", "buffers", &storage_buffers);
+    io_thread.setStorage(storage_mode, storage_buffers);
+
+    // Send the outputs of the filters too if filtered=1
+    bool send_filtered = false;
+    if (config_map.isPresent("Telemetry", "filtered"))
+        config_map.getBool("Telemetry", "filtered", &send_filtered);
+    acq_thread.setFilters(&filters, send_filtered);
 
-    Tcp::ConnSocket coSock;
+    io_thread.start();
+    acq_thread.start();
 
     WorkerVisitor *visitor;
     config_map.getBool("Main", "engine_type", &engine_type);
@@ -164,34 +235,38 @@ int main(int argc, char **argv) {
 #endif
     }
 
-    while (true) {
-	    try {
-		    coSock = liSock.accept();
-	    } catch (Tcp::OpFailureException&) {
-		    network_logger.error("Unable to accept a connection\n");
-		    return (-1);
-	    }
-
-	    network_logger.info("Connected to client: %s\n", coSock.getClientHostname().c_str());
+    // From here on a trip also stops the visitor's sequences
+    rules.setSequencer(visitor->getSequencer());
 
-	    uint8_t read;
-	    try {
-		    while ((read = coSock.recvByte()) != '0') {
-			    network_logger.info("Received command: (%d)\n", read);
-#ifndef MOCK
-			    visitor->visitCommand((COMMAND) read);
+    // Commands from any number of clients are served by one event loop. The first
+    // client to connect is the operator and any others can only observe.
+#ifdef MOCK
+    CommandDispatcher dispatcher(NULL, &io_thread, &network_logger);
+#else
+    CommandDispatcher dispatcher(visitor, &io_thread, &network_logger);
 #endif
-		    }
-	    } catch (Tcp::ClientDisconnectException&) {
-		    network_logger.info("Client disconnected prematurely\n");
-	    } catch (Tcp::OpFailureException&) {
-		    network_logger.info("Problem reading, closing connection\n");
-	    }
+    uint32_t max_clients = TCP_MAX_CLIENTS, idle_timeout_ms = 0, partial_timeout_ms = TCP_PARTIAL_TIMEOUT_MS;
+    config_map.getInt("Network", "max_clients", &max_clients);
+    config_map.getInt("Network", "idle_timeout_ms", &idle_timeout_ms);
+    config_map.getInt("Network", "partial_timeout_ms", &partial_timeout_ms);
+
+    Tcp::CommandServer *server;
+    try {
+	    server = new Tcp::CommandServer(1234, &dispatcher, max_clients);
+    } catch (Tcp::OpFailureException&) {
+	    network_logger.error("Could not create/open listening socket\n");
+	    return (-1);
+    }
+    server->setTimeouts(idle_timeout_ms, partial_timeout_ms);
 
-        coSock.close();
+    try {
+	    server->run();
+    } catch (Tcp::OpFailureException&) {
+	    network_logger.error("Command server failed\n");
+	    return (-1);
     }
-    
-    liSock.close();
+
+    delete server;
     sock.close();
 
     return 0;
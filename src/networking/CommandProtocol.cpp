@@ -0,0 +1,34 @@
+/**
+ * @file CommandProtocol.cpp
+ * @brief Implementation of functions in CommandProtocol.hpp.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <cstdint> // for uint8_t
+#include <cstring> // for memcpy()
+
+#include "networking/CommandProtocol.hpp"
+
+int parse_command_frame(const uint8_t* buf, size_t n, command_frame_header* header) {
+    if (n < sizeof(command_frame_header)) {
+        // Header not here yet
+        return 0;
+    }
+
+    memcpy(header, buf, sizeof(command_frame_header));
+    if (header->start != CMD_FRAME_START || header->version != CMD_FRAME_VERSION ||
+        header->length == 0 || header->length > CMD_FRAME_MAX_LENGTH) {
+        return -1;
+    }
+
+    if (n < sizeof(command_frame_header) + header->length) {
+        // Commands not all here yet
+        return 0;
+    }
+
+    return sizeof(command_frame_header) + header->length;
+}
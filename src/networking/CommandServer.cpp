@@ -0,0 +1,340 @@
+/**
+ * @file CommandServer.cpp
+ * @brief Implementation of classes and methods in CommandServer.hpp.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <chrono>
+#include <cerrno> // for errno
+#include <cstdint> // for uint8_t
+#include <cstring> // for memmove()
+#include <string>
+#include <sys/epoll.h> // for epoll_create1(), epoll_ctl(), epoll_wait()
+#include <unistd.h> // for close()
+#include <vector>
+
+#include "networking/CommandServer.hpp"
+#include "networking/Tcp.hpp"
+
+// Most events handled per call to epoll_wait()
+#define TCP_MAX_EVENTS (TCP_MAX_CLIENTS + 1)
+
+// Client methods
+
+Tcp::Client::Client(ConnSocket sock, bool primary)
+    : sock(sock)
+    , recvLen(0)
+    , primary(primary)
+    , dropReason(NULL)
+    , closing(false)
+    , lastRecv(std::chrono::steady_clock::now())
+    , waitingToSend(false)
+{}
+
+Tcp::Client::~Client() {
+    try {
+        sock.close();
+    } catch (OpFailureException&) {
+        // Nothing more can be done with the FD
+    }
+}
+
+bool Tcp::Client::send(const uint8_t* buf, size_t n) {
+    if (dropReason != NULL) {
+        return false;
+    }
+
+    if (sendBuf.size() + n > TCP_MAX_PENDING_SEND) {
+        // The client has stopped reading
+        dropReason = "client is not reading";
+        return false;
+    }
+
+    sendBuf.insert(sendBuf.end(), buf, buf + n);
+    flush();
+
+    return dropReason == NULL;
+}
+
+void Tcp::Client::flush() {
+    size_t numSent = 0, total = 0;
+
+    try {
+        while (total < sendBuf.size() &&
+               (numSent = sock.sendSome(sendBuf.data() + total, sendBuf.size() - total)) > 0) {
+            total += numSent;
+        }
+    } catch (ClientDisconnectException&) {
+        dropReason = "client disconnected";
+    } catch (OpFailureException&) {
+        dropReason = "problem sending";
+    }
+
+    sendBuf.erase(sendBuf.begin(), sendBuf.begin() + total);
+}
+
+void Tcp::Client::close() {
+    closing = true;
+}
+
+bool Tcp::Client::isOperator() {
+    return primary;
+}
+
+std::string Tcp::Client::getClientHostname() {
+    return sock.getClientHostname();
+}
+
+std::string Tcp::Client::getClientService() {
+    return sock.getClientService();
+}
+
+// CommandServer methods
+
+Tcp::CommandServer::CommandServer(int port, CommandHandler* handler, size_t maxClients)
+    : liSock(port)
+    , handler(handler)
+    , maxClients(maxClients)
+    , idleTimeoutMs(0)
+    , partialTimeoutMs(TCP_PARTIAL_TIMEOUT_MS)
+{
+    liSock.listen();
+    liSock.setNonBlocking();
+
+    epollFd = epoll_create1(0);
+    if (epollFd < 0) {
+        liSock.close();
+        throw OpFailureException();
+    }
+
+    // The listening socket is the only one registered without a Client
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, liSock.getFd(), &event) < 0) {
+        ::close(epollFd);
+        liSock.close();
+        throw OpFailureException();
+    }
+}
+
+Tcp::CommandServer::~CommandServer() {
+    std::vector<Client*>::iterator it;
+
+    for (it = clients.begin(); it != clients.end(); ++it) {
+        handler->disconnected(**it, "server shutting down");
+        delete *it;
+    }
+
+    ::close(epollFd);
+    try {
+        liSock.close();
+    } catch (OpFailureException&) {
+        // Nothing more can be done with the FD
+    }
+}
+
+void Tcp::CommandServer::setTimeouts(uint32_t idleMs, uint32_t partialMs) {
+    idleTimeoutMs = idleMs;
+    partialTimeoutMs = partialMs;
+}
+
+void Tcp::CommandServer::acceptAll() {
+    ConnSocket coSock;
+
+    while (true) {
+        try {
+            if (!liSock.tryAccept(&coSock)) {
+                return;
+            }
+        } catch (OpFailureException&) {
+            // e.g. the client gave up before it was accepted
+            return;
+        }
+
+        if (clients.size() >= maxClients) {
+            coSock.close();
+            continue;
+        }
+
+        Client* client;
+        try {
+            coSock.setNonBlocking();
+            client = new Client(coSock, clients.empty());
+        } catch (OpFailureException&) {
+            coSock.close();
+            continue;
+        }
+
+        epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = client;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, coSock.getFd(), &event) < 0) {
+            delete client;
+            continue;
+        }
+
+        clients.push_back(client);
+        handler->connected(*client);
+    }
+}
+
+void Tcp::CommandServer::watch(Client* client, bool writable) {
+    epoll_event event;
+
+    if (client->waitingToSend == writable) {
+        return;
+    }
+
+    event.events = writable ? EPOLLIN | EPOLLOUT : EPOLLIN;
+    event.data.ptr = client;
+    if (epoll_ctl(epollFd, EPOLL_CTL_MOD, client->sock.getFd(), &event) < 0) {
+        client->dropReason = "could not watch socket";
+        return;
+    }
+
+    client->waitingToSend = writable;
+}
+
+void Tcp::CommandServer::serve(Client* client, uint32_t events) {
+    if (client->dropReason != NULL) {
+        return;
+    }
+
+    if (events & EPOLLOUT) {
+        client->flush();
+    }
+
+    if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+        size_t numRead = 0;
+
+        // Read as much as there is room for in one syscall
+        try {
+            numRead = client->sock.recvSome(client->recvBuf + client->recvLen,
+                                            TCP_RECV_BUFFER_SIZE - client->recvLen);
+        } catch (ClientDisconnectException&) {
+            client->dropReason = "client disconnected";
+        } catch (OpFailureException&) {
+            client->dropReason = "problem reading";
+        }
+
+        if (numRead > 0) {
+            client->lastRecv = std::chrono::steady_clock::now();
+            if (client->recvLen == 0) {
+                client->partialSince = client->lastRecv;
+            }
+            client->recvLen += numRead;
+        }
+
+        // Once closing, anything more from the client is thrown away
+        if (client->closing) {
+            client->recvLen = 0;
+        }
+
+        // Handle every whole command received
+        size_t offset = 0, used;
+        while (offset < client->recvLen && !client->closing && client->dropReason == NULL &&
+               (used = handler->handle(*client, client->recvBuf + offset, client->recvLen - offset)) > 0) {
+            offset += used;
+        }
+
+        if (offset > 0) {
+            memmove(client->recvBuf, client->recvBuf + offset, client->recvLen - offset);
+            client->recvLen -= offset;
+            client->partialSince = client->lastRecv;
+        }
+
+        if (client->recvLen == TCP_RECV_BUFFER_SIZE) {
+            client->dropReason = "command too long";
+        }
+    }
+
+    watch(client, !client->sendBuf.empty());
+}
+
+void Tcp::CommandServer::reap() {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::vector<Client*>::iterator it;
+    bool promote = false;
+
+    for (it = clients.begin(); it != clients.end();) {
+        Client* client = *it;
+
+        if (client->dropReason == NULL && idleTimeoutMs > 0 &&
+            now - client->lastRecv > std::chrono::milliseconds(idleTimeoutMs)) {
+            client->dropReason = "idle timeout";
+        }
+
+        if (client->dropReason == NULL && client->recvLen > 0 && partialTimeoutMs > 0 &&
+            now - client->partialSince > std::chrono::milliseconds(partialTimeoutMs)) {
+            client->dropReason = "incomplete command timed out";
+        }
+
+        if (client->dropReason == NULL && client->closing && client->sendBuf.empty()) {
+            client->dropReason = "connection closed";
+        }
+
+        if (client->dropReason == NULL) {
+            ++it;
+            continue;
+        }
+
+        handler->disconnected(*client, client->dropReason);
+        promote |= client->primary;
+
+        // Closing the FD also removes it from the epoll instance
+        delete client;
+        it = clients.erase(it);
+    }
+
+    // The longest connected observer takes over from the operator
+    if (promote && !clients.empty()) {
+        clients.front()->primary = true;
+        handler->promoted(*clients.front());
+    }
+}
+
+void Tcp::CommandServer::poll(int timeoutMs) {
+    epoll_event events[TCP_MAX_EVENTS];
+    int numEvents, index;
+
+    numEvents = epoll_wait(epollFd, events, TCP_MAX_EVENTS, timeoutMs);
+    if (numEvents < 0 && errno != EINTR) {
+        throw OpFailureException();
+    }
+
+    // The operator goes first, so nobody else can hold up its commands
+    for (index = 0; index < numEvents; index++) {
+        Client* client = (Client*) events[index].data.ptr;
+
+        if (client != NULL && client->primary) {
+            serve(client, events[index].events);
+        }
+    }
+
+    for (index = 0; index < numEvents; index++) {
+        Client* client = (Client*) events[index].data.ptr;
+
+        if (client == NULL) {
+            acceptAll();
+        } else if (!client->primary) {
+            serve(client, events[index].events);
+        }
+    }
+
+    reap();
+}
+
+void Tcp::CommandServer::run() {
+    while (true) {
+        poll();
+    }
+}
+
+size_t Tcp::CommandServer::getNumClients() {
+    return clients.size();
+}
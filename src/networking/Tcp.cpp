@@ -11,7 +11,9 @@
 
 #include <arpa/inet.h> // for socket interface functions
 #include <cstdint> // for uint8_t
+#include <cerrno> // for errno
 #include <cstring> // for memset()
+#include <fcntl.h> // for fcntl()
 #include <netdb.h> // for socket interface functions
 #include <string>
 #include <sys/types.h>
@@ -20,6 +22,15 @@
 
 #include "networking/Tcp.hpp"
 
+// Set O_NONBLOCK on a file descriptor
+static void setNonBlockingFd(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        throw Tcp::OpFailureException();
+    }
+}
+
 // ListenSocket methods
 
 Tcp::ListenSocket::ListenSocket() {
@@ -77,6 +88,18 @@ void Tcp::ListenSocket::listen() {
 }
 
 Tcp::ConnSocket Tcp::ListenSocket::accept() {
+    ConnSocket coSock;
+
+    // Wait for a connection request on fd and accept it
+    if (!tryAccept(&coSock)) {
+        // Nothing was pending on a non-blocking socket
+        throw OpFailureException();
+    }
+
+    return coSock;
+}
+
+bool Tcp::ListenSocket::tryAccept(ConnSocket* coSock) {
     if (!listening) {
         // Cannot accept on a socket that is not listening!
         throw BadSocketException();
@@ -85,29 +108,35 @@ Tcp::ConnSocket Tcp::ListenSocket::accept() {
     sockaddr_in clientAddr;
     socklen_t clientSize = sizeof(sockaddr_in);
 
-    // Wait for a connection request on fd and accept it
+    // Accept a connection request on fd, waiting for one if fd is blocking
     int connFd = ::accept(fd, (sockaddr*) &clientAddr, &clientSize);
 
-    if (connFd < 0) {
+    if (connFd < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        // No connection requests pending
+        return false;
+    } else if (connFd < 0) {
         // Accept failure (resistance is futile)
         throw OpFailureException();
     }
 
-    ConnSocket coSock;
-    coSock.fd = connFd;
-    coSock.open = true;
+    coSock->fd = connFd;
+    coSock->open = true;
 
     // Retrieve info about the client
-    int err = getnameinfo((sockaddr*) &clientAddr, sizeof(sockaddr_in), coSock.clientHost,
-                          CLIENT_HOST_SIZE, coSock.clientServ, CLIENT_SERV_SIZE, 0);
+    int err = getnameinfo((sockaddr*) &clientAddr, sizeof(sockaddr_in), coSock->clientHost,
+                          CLIENT_HOST_SIZE, coSock->clientServ, CLIENT_SERV_SIZE, NI_NUMERICHOST);
 
     // In case of error, set both hostname and service to "Unknown"
     if (err != 0) {
-        std::strcpy(coSock.clientHost, "Unknown");
-        std::strcpy(coSock.clientServ, "Unknown");
+        std::strcpy(coSock->clientHost, "Unknown");
+        std::strcpy(coSock->clientServ, "Unknown");
     }
 
-    return coSock;
+    return true;
+}
+
+void Tcp::ListenSocket::setNonBlocking() {
+    setNonBlockingFd(fd);
 }
 
 void Tcp::ListenSocket::close() {
@@ -215,6 +244,59 @@ void Tcp::ConnSocket::sendBuf(uint8_t* buf, size_t n) {
     }
 }
 
+size_t Tcp::ConnSocket::recvSome(uint8_t* buf, size_t n) {
+    // Ensure the socket is ready for a receive
+    if (!open) {
+        // Cannot receive on a socket that is not open!
+        throw BadSocketException();
+    }
+
+    ssize_t numRead = ::recv(fd, (void*) buf, n, 0);
+
+    if (numRead == 0 && n > 0) {
+        // Client has closed the connection
+        open = false;
+        throw ClientDisconnectException();
+    } else if (numRead == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        // Nothing to read yet
+        return 0;
+    } else if (numRead == -1) {
+        // Misc error with ::recv()
+        throw OpFailureException();
+    }
+
+    return numRead;
+}
+
+size_t Tcp::ConnSocket::sendSome(const uint8_t* buf, size_t n) {
+    // Ensure the socket is ready for a send
+    if (!open) {
+        // Cannot send on a socket that is not open!
+        throw BadSocketException();
+    }
+
+    // Don't die of SIGPIPE if the client has gone away
+    ssize_t numSent = ::send(fd, (const void*) buf, n, MSG_NOSIGNAL);
+
+    if (numSent == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        // The socket's send buffer is full
+        return 0;
+    } else if (numSent == -1 && (errno == EPIPE || errno == ECONNRESET)) {
+        // Client has closed the connection
+        open = false;
+        throw ClientDisconnectException();
+    } else if (numSent == -1) {
+        // Misc error with ::send()
+        throw OpFailureException();
+    }
+
+    return numSent;
+}
+
+void Tcp::ConnSocket::setNonBlocking() {
+    setNonBlockingFd(fd);
+}
+
 void Tcp::ConnSocket::close() {
     open = false;
 
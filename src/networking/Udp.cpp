@@ -10,6 +10,7 @@
  */
 
 #include <arpa/inet.h>
+#include <cerrno>
 #include <cstring>
 #include <netdb.h>
 #include <netinet/in.h>
@@ -26,6 +27,7 @@ Udp::OutSocket::OutSocket() {
     this->fd = -1;
     this->dest = { AF_INET, INADDR_ANY, 0 }; // dummy "destination"
     this->open = false;
+    this->connected = false;
     std::strcpy(this->destHost, "");
     std::strcpy(this->destServ, "");
 }
@@ -56,6 +58,21 @@ void Udp::OutSocket::enable() {
     // Set members appropriately before return
     this->fd = sockFd;
     this->open = true;
+    this->connected = false;
+}
+
+void Udp::OutSocket::connect() {
+    // Error if socket is not open
+    if (!open) {
+        throw BadOutSocketException();
+    }
+
+    if (::connect(fd, (sockaddr*) &dest, sizeof(sockaddr_in)) < 0) {
+        // Could not connect to the destination
+        throw OpFailureException();
+    }
+
+    connected = true;
 }
 
 void Udp::OutSocket::setDest(char* const addr, int port) {
@@ -69,6 +86,9 @@ void Udp::OutSocket::setDest(char* const addr, int port) {
     // Set dest variable with given info
     this->dest = { AF_INET, htons(port), ia };
 
+    // A connected socket keeps sending to the old destination until reconnected
+    this->connected = false;
+
     // Get names corresponding to address and port
     int err = getnameinfo((sockaddr*) &dest, sizeof(sockaddr_in), destHost,
                           UDP_DEST_HOST_SIZE, destServ, UDP_DEST_SERV_SIZE, 0);
@@ -97,8 +117,12 @@ void Udp::OutSocket::sendBuf(uint8_t* buf, size_t n) {
 
     // Send until all bytes are sent
     while (numToSend > 0) {
-        numSent = ::sendto(fd, (void*) sendPos, numToSend, 0, (sockaddr*) &dest,
-                           sizeof(sockaddr_in));
+        if (connected) {
+            numSent = ::send(fd, (void*) sendPos, numToSend, 0);
+        } else {
+            numSent = ::sendto(fd, (void*) sendPos, numToSend, 0, (sockaddr*) &dest,
+                               sizeof(sockaddr_in));
+        }
 
         if (numSent == -1) {
             // Misc error with ::sendto()
@@ -110,8 +134,60 @@ void Udp::OutSocket::sendBuf(uint8_t* buf, size_t n) {
     }
 }
 
+int Udp::OutSocket::sendBatch(uint8_t** bufs, size_t* lens, size_t n) {
+    // Error if socket is not open
+    if (!open) {
+        throw BadOutSocketException();
+    }
+
+    mmsghdr msgs[UDP_MAX_BATCH];
+    iovec iovs[UDP_MAX_BATCH];
+    size_t numDone = 0, numBatch, i;
+    int numSent, numCalls = 0;
+    bool retried = false;
+
+    std::memset(msgs, 0, sizeof(msgs));
+
+    // Send up to UDP_MAX_BATCH datagrams per syscall until all are sent
+    while (numDone < n) {
+        numBatch = n - numDone < UDP_MAX_BATCH ? n - numDone : UDP_MAX_BATCH;
+
+        for (i = 0; i < numBatch; i++) {
+            iovs[i].iov_base = (void*) bufs[numDone + i];
+            iovs[i].iov_len = lens[numDone + i];
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+
+            // Only an unconnected socket needs to be told the destination
+            msgs[i].msg_hdr.msg_name = connected ? NULL : (void*) &dest;
+            msgs[i].msg_hdr.msg_namelen = connected ? 0 : sizeof(sockaddr_in);
+        }
+
+        numSent = ::sendmmsg(fd, msgs, numBatch, 0);
+        numCalls++;
+
+        if (numSent == -1) {
+            // A connected socket reports an earlier ICMP port unreachable on
+            // the next send; nobody is listening yet, so just send again
+            if (errno == ECONNREFUSED && connected && !retried) {
+                retried = true;
+                continue;
+            }
+
+            // Misc error with ::sendmmsg()
+            throw OpFailureException();
+        }
+
+        numDone += numSent;
+        retried = false;
+    }
+
+    return numCalls;
+}
+
 void Udp::OutSocket::close() {
     open = false;
+    connected = false;
 
     if (fd > -1) {
         if (::close(fd) < 0) {
@@ -0,0 +1,403 @@
+/**
+ * @file recorder.cpp
+ * @brief Records the packets of every sensor into one file of large blocks.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "recorder/recorder.hpp"
+#include "recorder/storage.hpp"
+
+static_assert(sizeof(struct recording_header) <= RECORDER_HEADER_SIZE,
+    "The header must fit in RECORDER_HEADER_SIZE");
+static_assert(RECORDER_BLOCK_SIZE % RECORDER_HEADER_SIZE == 0 &&
+    RECORDER_HEADER_SIZE % STORAGE_ALIGNMENT == 0, "Blocks must stay aligned");
+
+recorder::recorder()
+	: block(NULL)
+	, offset(0)
+	, allocated(0)
+	, dirty(false)
+	, index(NULL)
+	, index_size(0)
+	, index_capacity(0)
+	, num_channels(0)
+	, records(0)
+	, record_bytes(0)
+	, blocks(0)
+	, errors(0)
+{}
+
+recorder::~recorder() {
+	close();
+}
+
+int recorder::open(const char *path, const char *const *names, uint8_t num_channels,
+    const char *started, STORAGE_MODE mode, uint32_t buffers)
+{
+	struct recording_header *header;
+	uint8_t *buffer;
+
+	if (storage.isOpen() || num_channels > RECORDER_MAX_CHANNELS)
+		return -1;
+
+	/* One buffer is always the block being filled, and one its copy */
+	if (storage.open(path, mode, RECORDER_BLOCK_SIZE, buffers < 2 ? 2 : buffers) != 0)
+		return -1;
+
+	buffer = storage.acquire();
+	memset(buffer, 0, RECORDER_HEADER_SIZE);
+	header = (struct recording_header *)buffer;
+	header->magic = RECORDER_MAGIC;
+	header->version = RECORDER_VERSION;
+	header->header_size = RECORDER_HEADER_SIZE;
+	header->block_size = RECORDER_BLOCK_SIZE;
+	header->num_channels = num_channels;
+	snprintf(header->started, sizeof(header->started), "%s", started);
+	for (uint8_t channel = 0; channel < num_channels; channel++)
+		snprintf(header->names[channel], RECORDER_NAME_LENGTH, "%s", names[channel]);
+	storage.submit(buffer, RECORDER_HEADER_SIZE, 0);
+
+	this->num_channels = num_channels;
+	allocated = RECORDER_HEADER_SIZE;
+	offset = RECORDER_HEADER_SIZE - RECORDER_BLOCK_SIZE;
+	index_size = 0;
+	block = NULL;
+	nextBlock();
+
+	return 0;
+}
+
+void recorder::nextBlock() {
+	struct recording_block *header;
+
+	offset += RECORDER_BLOCK_SIZE;
+
+	/*
+	 * Reserve the next extent before it is needed. Not every filesystem
+	 * can, which only costs fragmentation.
+	 */
+	if (offset + RECORDER_BLOCK_SIZE > allocated) {
+		if (storage.reserve(allocated, RECORDER_PREALLOCATE_BYTES) == 0)
+			allocated += RECORDER_PREALLOCATE_BYTES;
+		else
+			allocated = offset + RECORDER_BLOCK_SIZE;
+	}
+
+	block = storage.acquire();
+	memset(block, 0, RECORDER_BLOCK_SIZE);
+	header = (struct recording_block *)block;
+	header->magic = RECORDER_BLOCK_MAGIC;
+	header->seq = index_size;
+	header->used = sizeof(struct recording_block);
+	dirty = false;
+}
+
+int recorder::indexBlock() {
+	struct recording_block *header = (struct recording_block *)block;
+
+	/* A block is added when first written, and updated as it fills */
+	if (index_size == header->seq) {
+		if (index_size == index_capacity) {
+			uint32_t capacity = index_capacity ? 2 * index_capacity : 256;
+			struct recording_index_entry *grown = (struct recording_index_entry *)
+			    realloc(index, capacity * sizeof(*index));
+
+			if (grown == NULL) {
+				errors.fetch_add(1, std::memory_order_relaxed);
+				return -1;
+			}
+			index = grown;
+			index_capacity = capacity;
+		}
+		index_size++;
+	}
+
+	index[header->seq].seq = header->seq;
+	index[header->seq].channels = header->channels;
+	index[header->seq].offset = offset;
+	index[header->seq].first_us = header->first_us;
+	index[header->seq].last_us = header->last_us;
+
+	return 0;
+}
+
+int recorder::append(uint8_t channel, const uint8_t *data, uint16_t length,
+    timestamp_t time_us)
+{
+	struct recording_block *header = (struct recording_block *)block;
+	struct recording_record record = {channel, 0, length};
+	uint32_t size = sizeof(record) + length;
+
+	if (!storage.isOpen() || channel >= num_channels ||
+	    size > RECORDER_BLOCK_SIZE - sizeof(struct recording_block))
+		return -1;
+
+	/* The block is full: hand it to the storage and start the next */
+	if (header->used + size > RECORDER_BLOCK_SIZE) {
+		indexBlock();
+		storage.submit(block, header->used, offset);
+		blocks.fetch_add(1, std::memory_order_relaxed);
+		nextBlock();
+		header = (struct recording_block *)block;
+	}
+
+	if (header->num_records == 0)
+		header->first_us = time_us;
+	header->last_us = time_us;
+	header->channels |= (uint32_t)1 << channel;
+	header->num_records++;
+
+	memcpy(block + header->used, &record, sizeof(record));
+	memcpy(block + header->used + sizeof(record), data, length);
+	header->used += size;
+	dirty = true;
+
+	records.fetch_add(1, std::memory_order_relaxed);
+	record_bytes.fetch_add(size, std::memory_order_relaxed);
+
+	return 0;
+}
+
+void recorder::sync() {
+	struct recording_block *header = (struct recording_block *)block;
+	uint8_t *copy;
+
+	if (!storage.isOpen() || !dirty)
+		return;
+
+	/* Write a copy, so the block can keep filling while it is written */
+	copy = storage.acquire();
+	memcpy(copy, block, header->used);
+	memset(copy + header->used, 0, RECORDER_BLOCK_SIZE - header->used);
+	indexBlock();
+	storage.submit(copy, header->used, offset);
+	dirty = false;
+}
+
+void recorder::poll() {
+	if (storage.isOpen())
+		storage.poll();
+}
+
+void recorder::drain() {
+	storage.drain();
+}
+
+int recorder::close() {
+	struct recording_block *header = (struct recording_block *)block;
+	struct recording_trailer trailer;
+	uint64_t end, length;
+	uint32_t done = 0, size;
+	uint8_t *buffer, *tail;
+	int err = 0;
+
+	if (!storage.isOpen())
+		return 0;
+
+	if (dirty) {
+		indexBlock();
+		storage.submit(block, header->used, offset);
+	} else {
+		storage.release(block);
+	}
+	block = NULL;
+
+	/* The index and trailer start after the last block with records */
+	end = index_size > 0 ? index[index_size - 1].offset + RECORDER_BLOCK_SIZE :
+	    RECORDER_HEADER_SIZE;
+	length = index_size * sizeof(*index) + sizeof(trailer);
+
+	trailer.magic = RECORDER_TRAILER_MAGIC;
+	trailer.num_blocks = index_size;
+	trailer.index_offset = end;
+
+	tail = (uint8_t *)malloc(length);
+	if (tail != NULL) {
+		memcpy(tail, index, index_size * sizeof(*index));
+		memcpy(tail + index_size * sizeof(*index), &trailer, sizeof(trailer));
+	} else {
+		err = -1;
+		length = 0;
+	}
+
+	/* Through the storage's buffers too, as O_DIRECT needs */
+	while (done < length) {
+		buffer = storage.acquire();
+		size = length - done < RECORDER_BLOCK_SIZE ? length - done : RECORDER_BLOCK_SIZE;
+		memcpy(buffer, tail + done, size);
+		memset(buffer + size, 0, RECORDER_BLOCK_SIZE - size);
+		storage.submit(buffer, size, end + done);
+		done += size;
+	}
+	free(tail);
+
+	/* Gives back the preallocated space past the end */
+	if (storage.close(end + length) != 0)
+		err = -1;
+
+	if (err != 0)
+		errors.fetch_add(1, std::memory_order_relaxed);
+
+	free(index);
+	index = NULL;
+	index_size = index_capacity = 0;
+
+	return err;
+}
+
+bool recorder::isOpen() {
+	return storage.isOpen();
+}
+
+void recorder::getStats(recorder_stats *stats) {
+	storage_stats written;
+
+	storage.getStats(&written);
+	stats->records = records.load(std::memory_order_relaxed);
+	stats->record_bytes = record_bytes.load(std::memory_order_relaxed);
+	stats->blocks = blocks.load(std::memory_order_relaxed);
+	stats->write_calls = written.write_calls;
+	stats->bytes_written = written.bytes_submitted;
+	stats->stalls = written.stalls;
+	stats->errors = errors.load(std::memory_order_relaxed) + written.errors;
+}
+
+void recorder::getStorageStats(storage_stats *stats) {
+	storage.getStats(stats);
+}
+
+STORAGE_MODE recorder::getMode() {
+	return storage.getMode();
+}
+
+recording_reader::recording_reader()
+	: fd(-1)
+	, block(NULL)
+	, next_offset(0)
+	, end(0)
+	, position(0)
+	, closed(false)
+{}
+
+recording_reader::~recording_reader() {
+	if (fd != -1)
+		::close(fd);
+	delete[] block;
+}
+
+int recording_reader::open(const char *path) {
+	struct recording_trailer trailer;
+	off_t size;
+
+	fd = ::open(path, O_RDONLY);
+	if (fd == -1)
+		return -1;
+
+	if (pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+	    header.magic != RECORDER_MAGIC || header.version != RECORDER_VERSION ||
+	    header.block_size < sizeof(struct recording_block) ||
+	    header.num_channels > RECORDER_MAX_CHANNELS) {
+		::close(fd);
+		fd = -1;
+		return -1;
+	}
+
+	block = new uint8_t[header.block_size];
+	next_offset = header.header_size;
+	position = 0;
+
+	/* A closed recording says where its blocks end; otherwise read them all */
+	size = lseek(fd, 0, SEEK_END);
+	end = size;
+	closed = size >= (off_t)sizeof(trailer) &&
+	    pread(fd, &trailer, sizeof(trailer), size - sizeof(trailer)) == sizeof(trailer) &&
+	    trailer.magic == RECORDER_TRAILER_MAGIC && trailer.index_offset <= (uint64_t)size;
+	if (closed)
+		end = trailer.index_offset;
+
+	return 0;
+}
+
+bool recording_reader::next(uint8_t *channel, const uint8_t **data, uint16_t *length,
+    const recording_block **block_header)
+{
+	struct recording_block *current = (struct recording_block *)block;
+	struct recording_record record;
+	ssize_t n;
+
+	if (fd == -1)
+		return false;
+
+	for (;;) {
+		/* The next record in this block */
+		if (position != 0 && position + sizeof(record) <= current->used) {
+			memcpy(&record, block + position, sizeof(record));
+			if (position + sizeof(record) + record.length <= current->used) {
+				*channel = record.channel;
+				*data = block + position + sizeof(record);
+				*length = record.length;
+				if (block_header != NULL)
+					*block_header = current;
+				position += sizeof(record) + record.length;
+				return true;
+			}
+		}
+
+		/*
+		 * Or the next block, stopping at one that was never written. The
+		 * last may be cut short, as blocks are written as far as used.
+		 */
+		if (next_offset >= end)
+			return false;
+		n = pread(fd, block, end - next_offset < header.block_size ?
+		    end - next_offset : header.block_size, next_offset);
+		if (n < (ssize_t)sizeof(struct recording_block) ||
+		    current->magic != RECORDER_BLOCK_MAGIC || current->used > (uint32_t)n)
+			return false;
+
+		next_offset += header.block_size;
+		position = sizeof(struct recording_block);
+	}
+}
+
+const recording_header *recording_reader::getHeader() {
+	return &header;
+}
+
+bool recording_reader::wasClosed() {
+	return closed;
+}
+
+int recording_reader::findChannel(const char *name) {
+	for (uint32_t channel = 0; channel < header.num_channels; channel++) {
+		if (strncmp(header.names[channel], name, RECORDER_NAME_LENGTH) == 0)
+			return channel;
+	}
+
+	return -1;
+}
+
+bool is_recording(const char *path) {
+	uint32_t magic = 0;
+	int fd = ::open(path, O_RDONLY);
+
+	if (fd == -1)
+		return false;
+
+	if (read(fd, &magic, sizeof(magic)) != sizeof(magic))
+		magic = 0;
+	::close(fd);
+
+	return magic == RECORDER_MAGIC;
+}
@@ -0,0 +1,555 @@
+/**
+ * @file storage.cpp
+ * @brief Ways of writing a recording's blocks to disk.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "recorder/storage.hpp"
+#include "time/time.hpp"
+
+/*
+ * io_uring through its syscalls, where the kernel headers know them. Writes
+ * use IORING_OP_WRITEV, which every kernel with io_uring (5.1 on) has.
+ */
+#ifdef __NR_io_uring_setup
+#include <linux/io_uring.h>
+#define STORAGE_HAVE_URING 1
+#ifndef IORING_FEAT_SINGLE_MMAP
+#define IORING_FEAT_SINGLE_MMAP 0
+#endif
+#endif
+
+static const char *mode_names[] = {"sync", "direct", "uring"};
+
+int parse_storage_mode(const char *name, STORAGE_MODE *mode) {
+	for (int index = 0; index <= STORAGE_URING; index++) {
+		if (strcmp(name, mode_names[index]) == 0) {
+			*mode = (STORAGE_MODE)index;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+const char *storage_mode_name(STORAGE_MODE mode) {
+	return mode <= STORAGE_URING ? mode_names[mode] : "unknown";
+}
+
+/*
+ * Write all of buf at offset, carrying on after short writes. Returns the
+ * number of bytes written, and adds the syscalls made to calls.
+ */
+static int64_t write_at(int fd, const uint8_t *buf, size_t size, uint64_t offset,
+    uint64_t *calls)
+{
+	size_t done = 0;
+	ssize_t n;
+
+	while (done < size) {
+		n = pwrite(fd, buf + done, size - done, offset + done);
+		(*calls)++;
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+			return -errno;
+		if (n == 0)
+			return -EIO;
+		done += n;
+	}
+
+	return done;
+}
+
+#ifdef STORAGE_HAVE_URING
+/**
+ * @brief The rings shared with the kernel, mapped as the io_uring_setup(2)
+ * 	  man page describes.
+ */
+struct storage_uring {
+	int fd;
+
+	void *sq_ptr;
+	size_t sq_size;
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+
+	void *cq_ptr;
+	size_t cq_size;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+
+	/* @brief The vector of each buffer's write, which must outlive it */
+	std::vector<struct iovec> vecs;
+};
+
+static void uring_destroy(storage_uring *ring) {
+	if (ring->sqes != MAP_FAILED)
+		munmap(ring->sqes, ring->sqes_size);
+	if (ring->cq_ptr != MAP_FAILED && ring->cq_ptr != ring->sq_ptr)
+		munmap(ring->cq_ptr, ring->cq_size);
+	if (ring->sq_ptr != MAP_FAILED)
+		munmap(ring->sq_ptr, ring->sq_size);
+	if (ring->fd != -1)
+		close(ring->fd);
+	delete ring;
+}
+
+static storage_uring *uring_create(unsigned entries) {
+	struct io_uring_params params;
+	storage_uring *ring = new storage_uring;
+	uint8_t *sq, *cq;
+
+	memset(&params, 0, sizeof(params));
+	ring->sq_ptr = ring->cq_ptr = ring->sqes = (struct io_uring_sqe *)MAP_FAILED;
+	ring->fd = syscall(__NR_io_uring_setup, entries, &params);
+	if (ring->fd < 0) {
+		ring->fd = -1;
+		uring_destroy(ring);
+		return NULL;
+	}
+
+	ring->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		if (ring->cq_size > ring->sq_size)
+			ring->sq_size = ring->cq_size;
+		ring->cq_size = ring->sq_size;
+	}
+
+	ring->sq_ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE,
+	    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+	if (ring->sq_ptr == MAP_FAILED) {
+		uring_destroy(ring);
+		return NULL;
+	}
+
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+		ring->cq_ptr = ring->sq_ptr;
+	else
+		ring->cq_ptr = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE,
+		    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+
+	ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = (struct io_uring_sqe *)mmap(NULL, ring->sqes_size,
+	    PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+	if (ring->cq_ptr == MAP_FAILED || ring->sqes == MAP_FAILED) {
+		uring_destroy(ring);
+		return NULL;
+	}
+
+	sq = (uint8_t *)ring->sq_ptr;
+	ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+	ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+	ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+	ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+
+	cq = (uint8_t *)ring->cq_ptr;
+	ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+	ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+	ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+	return ring;
+}
+#else
+struct storage_uring {};
+
+static void uring_destroy(storage_uring *ring) {
+	delete ring;
+}
+
+static storage_uring *uring_create(unsigned entries) {
+	return NULL;
+}
+#endif
+
+storage_engine::storage_engine()
+	: fd(-1)
+	, mode(STORAGE_SYNC)
+	, buffer_size(0)
+	, num_buffers(0)
+	, buffers(NULL)
+	, pending_head(0)
+	, stopping(false)
+	, ring(NULL)
+	, last_offset(UINT64_MAX)
+	, submitted(0)
+	, completed(0)
+	, write_calls(0)
+	, bytes_submitted(0)
+	, bytes_persisted(0)
+	, stalls(0)
+	, errors(0)
+	, max_depth(0)
+	, max_latency_us(0)
+{
+	for (int index = 0; index < STORAGE_LATENCY_BUCKETS; index++)
+		latency_us[index] = 0;
+}
+
+storage_engine::~storage_engine() {
+	/* Never closed, so keep whatever was written */
+	if (fd != -1) {
+		drain();
+		close(lseek(fd, 0, SEEK_END));
+	}
+}
+
+int storage_engine::open(const char *path, STORAGE_MODE mode, uint32_t buffer_size,
+    uint32_t num_buffers)
+{
+	int flags = O_CREAT | O_RDWR | O_TRUNC;
+
+	if (fd != -1 || buffer_size == 0 || buffer_size % STORAGE_ALIGNMENT != 0 ||
+	    num_buffers == 0)
+		return -1;
+
+	if (posix_memalign((void **)&buffers, STORAGE_ALIGNMENT,
+	    (size_t)buffer_size * num_buffers) != 0) {
+		buffers = NULL;
+		return -1;
+	}
+
+	/* Bypass the page cache where the filesystem allows it */
+	if (mode != STORAGE_SYNC)
+		fd = ::open(path, flags | O_DIRECT, 0666);
+	if (fd == -1)
+		fd = ::open(path, flags, 0666);
+	if (fd == -1) {
+		free(buffers);
+		buffers = NULL;
+		return -1;
+	}
+
+	if (mode == STORAGE_URING) {
+		unsigned entries = 1;
+
+		while (entries < num_buffers)
+			entries <<= 1;
+		if ((ring = uring_create(entries)) == NULL)
+			mode = STORAGE_DIRECT;
+#ifdef STORAGE_HAVE_URING
+		else
+			ring->vecs.resize(num_buffers);
+#endif
+	}
+
+	this->mode = mode;
+	this->buffer_size = buffer_size;
+	this->num_buffers = num_buffers;
+	last_offset = UINT64_MAX;
+
+	free_buffers.clear();
+	for (uint32_t index = num_buffers; index > 0; index--)
+		free_buffers.push_back(index - 1);
+	lengths.assign(num_buffers, 0);
+	offsets.assign(num_buffers, 0);
+	submitted_ns.assign(num_buffers, 0);
+	pending.clear();
+	pending_head = 0;
+
+	if (mode == STORAGE_DIRECT) {
+		stopping = false;
+		writer = std::thread(&storage_engine::run, this);
+	}
+
+	return 0;
+}
+
+STORAGE_MODE storage_engine::getMode() {
+	return mode;
+}
+
+void storage_engine::complete(uint32_t buffer, int64_t result) {
+	timestamp_t elapsed_us = (get_elapsed_time_ns() - submitted_ns[buffer]) / 1000;
+	uint64_t longest = max_latency_us.load(std::memory_order_relaxed);
+	int bucket = 0;
+
+	if (result == (int64_t)lengths[buffer])
+		bytes_persisted.fetch_add(result, std::memory_order_relaxed);
+	else
+		errors.fetch_add(1, std::memory_order_relaxed);
+
+	while (bucket < STORAGE_LATENCY_BUCKETS - 1 && elapsed_us >= ((timestamp_t)1 << bucket))
+		bucket++;
+	latency_us[bucket].fetch_add(1, std::memory_order_relaxed);
+	if (elapsed_us > longest)
+		max_latency_us.store(elapsed_us, std::memory_order_relaxed);
+
+	free_buffers.push_back(buffer);
+	completed.fetch_add(1, std::memory_order_release);
+}
+
+void storage_engine::reap(bool wait) {
+#ifdef STORAGE_HAVE_URING
+	unsigned head, tail;
+
+	if (wait)
+		syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+
+	head = *ring->cq_head;
+	tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+	while (head != tail) {
+		struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+
+		complete(cqe->user_data, cqe->res);
+		head++;
+	}
+	__atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+#endif
+}
+
+uint8_t *storage_engine::acquire() {
+	uint32_t buffer;
+	bool waited = false;
+
+	if (fd == -1)
+		return NULL;
+
+	if (mode == STORAGE_DIRECT) {
+		std::unique_lock<std::mutex> guard(lock);
+
+		while (free_buffers.empty()) {
+			waited = true;
+			changed.wait(guard);
+		}
+		buffer = free_buffers.back();
+		free_buffers.pop_back();
+	} else {
+		if (ring != NULL)
+			reap(false);
+		while (free_buffers.empty()) {
+			waited = true;
+			reap(true);
+		}
+		buffer = free_buffers.back();
+		free_buffers.pop_back();
+	}
+
+	if (waited)
+		stalls.fetch_add(1, std::memory_order_relaxed);
+
+	return buffers + (size_t)buffer * buffer_size;
+}
+
+void storage_engine::submit(uint8_t *data, uint32_t length, uint64_t offset) {
+	uint32_t buffer = (data - buffers) / buffer_size;
+	uint32_t depth;
+	uint64_t calls = 0;
+
+	length = (length + STORAGE_ALIGNMENT - 1) / STORAGE_ALIGNMENT * STORAGE_ALIGNMENT;
+	if (length > buffer_size)
+		length = buffer_size;
+
+	lengths[buffer] = length;
+	offsets[buffer] = offset;
+	submitted_ns[buffer] = get_elapsed_time_ns();
+	depth = submitted.fetch_add(1, std::memory_order_relaxed) + 1 -
+	    completed.load(std::memory_order_acquire);
+	bytes_submitted.fetch_add(length, std::memory_order_relaxed);
+	if (depth > max_depth.load(std::memory_order_relaxed))
+		max_depth.store(depth, std::memory_order_relaxed);
+
+	switch (mode) {
+	case STORAGE_SYNC:
+		complete(buffer, write_at(fd, data, length, offset, &calls));
+		write_calls.fetch_add(calls, std::memory_order_relaxed);
+		break;
+	case STORAGE_DIRECT: {
+		std::lock_guard<std::mutex> guard(lock);
+
+		pending.push_back(buffer);
+		changed.notify_all();
+		break;
+	}
+	case STORAGE_URING: {
+#ifdef STORAGE_HAVE_URING
+		unsigned tail = *ring->sq_tail, index = tail & *ring->sq_mask;
+		struct io_uring_sqe *sqe = &ring->sqes[index];
+
+		ring->vecs[buffer].iov_base = data;
+		ring->vecs[buffer].iov_len = length;
+
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = IORING_OP_WRITEV;
+		sqe->fd = fd;
+		sqe->addr = (uintptr_t)&ring->vecs[buffer];
+		sqe->len = 1;
+		sqe->off = offset;
+		sqe->user_data = buffer;
+
+		/* A rewrite of the same block must not overtake the one before */
+		if (offset == last_offset) {
+#ifdef IOSQE_IO_DRAIN
+			sqe->flags = IOSQE_IO_DRAIN;
+#else
+			while (completed.load(std::memory_order_acquire) + 1 !=
+			    submitted.load(std::memory_order_relaxed))
+				reap(true);
+#endif
+		}
+		last_offset = offset;
+
+		ring->sq_array[index] = index;
+		__atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+		if (syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0, NULL, 0) != 1)
+			errors.fetch_add(1, std::memory_order_relaxed);
+		write_calls.fetch_add(1, std::memory_order_relaxed);
+#endif
+		break;
+	}
+	}
+}
+
+void storage_engine::release(uint8_t *data) {
+	uint32_t buffer = (data - buffers) / buffer_size;
+
+	if (mode == STORAGE_DIRECT) {
+		std::lock_guard<std::mutex> guard(lock);
+
+		free_buffers.push_back(buffer);
+		changed.notify_all();
+	} else {
+		free_buffers.push_back(buffer);
+	}
+}
+
+void storage_engine::run() {
+	std::unique_lock<std::mutex> guard(lock);
+	uint32_t buffer;
+	uint64_t calls;
+	int64_t result;
+
+	for (;;) {
+		while (pending_head == pending.size() && !stopping)
+			changed.wait(guard);
+		if (pending_head == pending.size())
+			return;
+
+		buffer = pending[pending_head++];
+		if (pending_head == pending.size()) {
+			pending.clear();
+			pending_head = 0;
+		}
+
+		/* Write without the lock, so the caller can carry on filling */
+		guard.unlock();
+		calls = 0;
+		result = write_at(fd, buffers + (size_t)buffer * buffer_size, lengths[buffer],
+		    offsets[buffer], &calls);
+		write_calls.fetch_add(calls, std::memory_order_relaxed);
+		guard.lock();
+
+		complete(buffer, result);
+		changed.notify_all();
+	}
+}
+
+void storage_engine::poll() {
+	if (ring != NULL)
+		reap(false);
+}
+
+void storage_engine::drain() {
+	if (fd == -1)
+		return;
+
+	if (mode == STORAGE_DIRECT) {
+		std::unique_lock<std::mutex> guard(lock);
+
+		while (completed.load(std::memory_order_acquire) !=
+		    submitted.load(std::memory_order_relaxed))
+			changed.wait(guard);
+	} else if (ring != NULL) {
+		while (completed.load(std::memory_order_acquire) !=
+		    submitted.load(std::memory_order_relaxed))
+			reap(true);
+	}
+}
+
+int storage_engine::reserve(uint64_t offset, uint64_t length) {
+	if (fd == -1)
+		return -1;
+
+	/* KEEP_SIZE, so a recording cut short does not end in zeros */
+	return fallocate(fd, FALLOC_FL_KEEP_SIZE, offset, length) == 0 ? 0 : -1;
+}
+
+int storage_engine::close(uint64_t length) {
+	int err = 0;
+
+	if (fd == -1)
+		return 0;
+
+	drain();
+
+	if (mode == STORAGE_DIRECT) {
+		{
+			std::lock_guard<std::mutex> guard(lock);
+
+			stopping = true;
+			changed.notify_all();
+		}
+		writer.join();
+	}
+
+	if (ring != NULL) {
+		uring_destroy(ring);
+		ring = NULL;
+	}
+
+	if (ftruncate(fd, length) != 0 || fsync(fd) != 0)
+		err = -1;
+	if (errors.load(std::memory_order_relaxed) != 0)
+		err = -1;
+
+	::close(fd);
+	fd = -1;
+	free(buffers);
+	buffers = NULL;
+
+	return err;
+}
+
+bool storage_engine::isOpen() {
+	return fd != -1;
+}
+
+void storage_engine::getStats(storage_stats *stats) {
+	stats->completed = completed.load(std::memory_order_acquire);
+	stats->submitted = submitted.load(std::memory_order_relaxed);
+	stats->write_calls = write_calls.load(std::memory_order_relaxed);
+	stats->bytes_submitted = bytes_submitted.load(std::memory_order_relaxed);
+	stats->bytes_persisted = bytes_persisted.load(std::memory_order_relaxed);
+	stats->stalls = stalls.load(std::memory_order_relaxed);
+	stats->errors = errors.load(std::memory_order_relaxed);
+	stats->depth = stats->submitted > stats->completed ?
+	    stats->submitted - stats->completed : 0;
+	stats->max_depth = max_depth.load(std::memory_order_relaxed);
+	stats->max_latency_us = max_latency_us.load(std::memory_order_relaxed);
+
+	for (int index = 0; index < STORAGE_LATENCY_BUCKETS; index++)
+		stats->latency_us[index] = latency_us[index].load(std::memory_order_relaxed);
+}
@@ -0,0 +1,161 @@
+/**
+ * @file resfet_decode.cpp
+ * @brief Decodes a recording, or an older log, into CSV or columns for
+ * 	  analysis after a test.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <cstdlib>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#include "adc/adc.hpp"
+#include "calibration/calibration.hpp"
+#include "config/config.hpp"
+#include "decoder/decoder.hpp"
+
+static void usage(const char *name) {
+    printf("Usage: %s [options] <recording>\n"
+           "  -c <config>   Calibrate readings with the config's [Calibration] section\n"
+           "  -s <sensors>  Keep only these sensors, e.g. PT1,LC1\n"
+           "  -f <seconds>  Keep samples from this many seconds after start\n"
+           "  -t <seconds>  Keep samples until this many seconds after start\n"
+           "  -v            Keep the valve states too\n"
+           "  -j <threads>  Decode with this many threads (default one per core)\n"
+           "  -F csv|columns  Output format (default csv)\n"
+           "  -o <file>     Write here instead of stdout\n", name);
+}
+
+/*
+ * Turns a comma separated list of sensor names into a mask of sensors.
+ * Returns 0 if a name is not a sensor.
+ */
+static uint32_t parse_sensors(char *list) {
+    uint32_t mask = 0;
+    char *name, *save;
+    int index;
+
+    for (name = strtok_r(list, ",", &save); name != NULL; name = strtok_r(NULL, ",", &save)) {
+        for (index = 0; index < SENSOR::NUM_SENSORS; index++) {
+            if (strcmp(name, SENSOR_NAMES[index]) == 0)
+                break;
+        }
+
+        if (index == SENSOR::NUM_SENSORS) {
+            fprintf(stderr, "Unknown sensor %s\n", name);
+            return 0;
+        }
+        mask |= (uint32_t)1 << index;
+    }
+
+    return mask;
+}
+
+static uint64_t now_us() {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+int main(int argc, char **argv) {
+    std::vector<decoded_sample> samples;
+    calibration_table calibration;
+    ConfigMapping config;
+    decode_options options;
+    recorded_log log;
+    const char *output = NULL;
+    bool columns = false;
+    uint64_t start;
+    FILE *file;
+    size_t first;
+    int opt, err;
+
+    while ((opt = getopt(argc, argv, "c:s:f:t:vj:F:o:h")) != -1) {
+        switch (opt) {
+            case 'c':
+                if (config.readFrom(optarg) != 0) {
+                    fprintf(stderr, "Error reading config file %s\n", optarg);
+                    return (1);
+                }
+                if (calibration.load(config) != 0)
+                    fprintf(stderr, "WARNING: some sensors were left uncalibrated\n");
+                options.calibration = &calibration;
+                break;
+            case 's':
+                if ((options.sensors = parse_sensors(optarg)) == 0)
+                    return (1);
+                break;
+            case 'f':
+                options.from_us = atof(optarg) * 1e6;
+                break;
+            case 't':
+                options.to_us = atof(optarg) * 1e6;
+                break;
+            case 'v':
+                options.valves = true;
+                break;
+            case 'j':
+                options.threads = atoi(optarg);
+                break;
+            case 'F':
+                if (strcmp(optarg, "columns") == 0) {
+                    columns = true;
+                } else if (strcmp(optarg, "csv") != 0) {
+                    fprintf(stderr, "Unknown format %s\n", optarg);
+                    return (1);
+                }
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return (opt == 'h' ? 0 : 1);
+        }
+    }
+
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return (1);
+    }
+
+    start = now_us();
+    if (log.open(argv[optind]) != 0) {
+        fprintf(stderr, "Could not read %s as a recording or log\n", argv[optind]);
+        return (1);
+    }
+
+    if (log.isRecording()) {
+        first = log.seek(options.from_us);
+        fprintf(stderr, "%zu blocks, starting from block %zu\n", log.getBlocks().size(), first);
+    }
+
+    log.decode(options, &samples);
+    fprintf(stderr, "Decoded %zu samples in %.3f s\n", samples.size(), (now_us() - start) / 1e6);
+
+    if (output == NULL) {
+        file = stdout;
+    } else if ((file = fopen(output, "wb")) == NULL) {
+        fprintf(stderr, "Could not create %s\n", output);
+        return (1);
+    }
+
+    err = columns ? write_columns(file, samples) : write_csv(file, samples);
+    if (file != stdout)
+        err |= fclose(file);
+
+    if (err != 0) {
+        fprintf(stderr, "Could not write all the samples\n");
+        return (1);
+    }
+
+    return (0);
+}
@@ -0,0 +1,127 @@
+/**
+ * @file sequence.cpp
+ * @brief Timelines of pin writes, loaded from the config.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <algorithm>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "commands/rpi_pins.hpp"
+#include "config/config.hpp"
+#include "sequencer/sequence.hpp"
+
+/* Every pin a sequence may write, by the names in rpi_pins.hpp */
+static const struct {
+	const char *name;
+	uint8_t pin;
+} pin_names[] = {
+	{"DRIVER1", DRIVER1},
+	{"DRIVER2", DRIVER2},
+	{"DRIVER3", DRIVER3},
+	{"DRIVER4", DRIVER4},
+	{"DRIVER5", DRIVER5},
+	{"DRIVER6", DRIVER6},
+	{"MAIN_VALVE", MAIN_VALVE},
+	{"PRESSURE_VALVE", PRESSURE_VALVE},
+	{"IGN_START", IGN_START},
+	{"MAIN_FEED_VALVE", MAIN_FEED_VALVE},
+	{"OXI_VALVE", OXI_VALVE},
+	{"GROUND_VENT_VALVE", GROUND_VENT_VALVE},
+};
+
+int parse_pin(const char *name, uint8_t *pin) {
+	for (size_t index = 0; index < sizeof(pin_names) / sizeof(pin_names[0]); index++) {
+		if (strcmp(name, pin_names[index].name) == 0) {
+			*pin = pin_names[index].pin;
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/* Parses "high" or "low" */
+static int parse_level(const char *name, uint8_t *level) {
+	if (strcmp(name, "high") == 0)
+		*level = HIGH;
+	else if (strcmp(name, "low") == 0)
+		*level = LOW;
+	else
+		return 1;
+
+	return 0;
+}
+
+bool sequence::add(timestamp_t offset_ns, uint8_t pin, uint8_t level) {
+	sequence_step step = {offset_ns, pin, level};
+
+	if (steps.size() >= SEQUENCE_MAX_STEPS)
+		return false;
+
+	/* After any steps at the same offset, so they keep their order */
+	steps.insert(std::upper_bound(steps.begin(), steps.end(), step,
+	    [](const sequence_step &a, const sequence_step &b) {
+		return a.offset_ns < b.offset_ns;
+	    }), step);
+
+	return true;
+}
+
+void sequence::addAbort(uint8_t pin, uint8_t level) {
+	sequence_step step = {0, pin, level};
+
+	abort_steps.push_back(step);
+}
+
+int sequence::load(ConfigMapping &config, const char *name) {
+	std::string section = std::string("Sequence:") + name;
+	std::vector<std::string> lines;
+	char pin_name[MAX_CONFIG_LENGTH], level_name[MAX_CONFIG_LENGTH];
+	unsigned long offset_us;
+	uint8_t pin, level;
+
+	this->name = name;
+	steps.clear();
+	abort_steps.clear();
+
+	if (config.getStrings(section.c_str(), "step", &lines) != 0) {
+		printf("[%s] no steps\n", section.c_str());
+		return 1;
+	}
+
+	for (size_t index = 0; index < lines.size(); index++) {
+		if (sscanf(lines[index].c_str(), "%lu,%63[^,],%63s", &offset_us,
+		    pin_name, level_name) != 3 || parse_pin(pin_name, &pin) != 0 ||
+		    parse_level(level_name, &level) != 0) {
+			printf("[%s] malformed step: %s\n", section.c_str(), lines[index].c_str());
+			return 1;
+		}
+
+		if (!add((timestamp_t)offset_us * 1000, pin, level)) {
+			printf("[%s] more than %d steps\n", section.c_str(), SEQUENCE_MAX_STEPS);
+			return 1;
+		}
+	}
+
+	lines.clear();
+	config.getStrings(section.c_str(), "abort", &lines);
+	for (size_t index = 0; index < lines.size(); index++) {
+		if (sscanf(lines[index].c_str(), "%63[^,],%63s", pin_name, level_name) != 2 ||
+		    parse_pin(pin_name, &pin) != 0 || parse_level(level_name, &level) != 0) {
+			printf("[%s] malformed abort: %s\n", section.c_str(), lines[index].c_str());
+			return 1;
+		}
+
+		addAbort(pin, level);
+	}
+
+	return 0;
+}
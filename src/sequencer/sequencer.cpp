@@ -0,0 +1,169 @@
+/**
+ * @file sequencer.cpp
+ * @brief Thread that plays sequences of pin writes on time.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <atomic>
+#include <bcm2835.h> // for HIGH
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+
+#include "logger/logger.hpp"
+#include "sequencer/sequence.hpp"
+#include "sequencer/sequencer.hpp"
+#include "sequencer/valve_state.hpp"
+#include "sequencer/wakeup.hpp"
+
+sequencer::sequencer(valve_state *valves)
+	: pending(NULL)
+	, running(false)
+	, aborts(0)
+	, start_aborts(0)
+	, held(false)
+	, stopping(false)
+	, valves(valves)
+	, actual_ns(SEQUENCE_MAX_STEPS)
+	, log("Sequencer", "SequencerLog", LogLevel::DEBUG)
+{
+	struct sched_param param;
+	int err;
+
+	core_thread = std::thread(&sequencer::run, this);
+
+	memset(&param, 0, sizeof(param));
+	param.sched_priority = SEQUENCER_PRIORITY;
+	err = pthread_setschedparam(core_thread.native_handle(), SCHED_FIFO, &param);
+	if (err != 0)
+		log.info("Could not get real-time priority (%s), sequences will have more jitter\n",
+		    strerror(err));
+}
+
+sequencer::~sequencer() {
+	stopping.store(true);
+	abort();
+	core_thread.join();
+}
+
+bool sequencer::start(const sequence *seq) {
+	uint32_t before = aborts.load();
+	bool idle = false;
+
+	/* Read first, so an abort from here on stops this sequence */
+	if (!running.compare_exchange_strong(idle, true))
+		return false;
+
+	/* Checked after taking running, as hold() aborts after setting held */
+	if (held.load()) {
+		running.store(false);
+		return false;
+	}
+
+	start_aborts = before;
+	pending.store(seq);
+	wake.notify();
+
+	return true;
+}
+
+void sequencer::abort() {
+	aborts.fetch_add(1);
+	wake.notify();
+}
+
+void sequencer::hold(bool held) {
+	this->held.store(held);
+	if (held)
+		abort();
+}
+
+bool sequencer::isHeld() {
+	return held.load();
+}
+
+bool sequencer::aborting() {
+	return aborts.load() != start_aborts;
+}
+
+bool sequencer::isRunning() {
+	return running.load();
+}
+
+size_t sequencer::play(const sequence *seq) {
+	timestamp_t start_ns = wakeup::now_ns(), deadline_ns, written_ns;
+	size_t index = 0, end;
+
+	while (index < seq->steps.size()) {
+		deadline_ns = start_ns + seq->steps[index].offset_ns;
+
+		/* Sleep until the step is due, unless aborted first */
+		while (!aborting() && wakeup::now_ns() < deadline_ns)
+			wake.wait_until(deadline_ns);
+
+		if (aborting())
+			break;
+
+		/* Every step due at the same time goes out in one write */
+		pin_masks masks;
+		for (end = index; end < seq->steps.size() &&
+		     seq->steps[end].offset_ns == seq->steps[index].offset_ns; end++)
+			masks.add(seq->steps[end].pin, seq->steps[end].level);
+
+		valves->apply(masks);
+		written_ns = wakeup::now_ns() - start_ns;
+		for (; index < end; index++)
+			actual_ns[index] = written_ns;
+	}
+
+	if (index < seq->steps.size()) {
+		pin_masks masks;
+		for (size_t step = 0; step < seq->abort_steps.size(); step++)
+			masks.add(seq->abort_steps[step].pin, seq->abort_steps[step].level);
+		valves->apply(masks);
+	}
+
+	return index;
+}
+
+void sequencer::run() {
+	const sequence *seq;
+	timestamp_t reacted_ns;
+	size_t done;
+
+	while (!stopping.load()) {
+		seq = pending.exchange(NULL);
+		if (seq == NULL) {
+			wake.wait_until(0);
+			continue;
+		}
+
+		log.info("Starting sequence %s, %u steps\n", seq->name.c_str(),
+		    (unsigned)seq->steps.size());
+		done = play(seq);
+		reacted_ns = wakeup::now_ns() - wake.last_notified();
+
+		/* Only now is there time to log */
+		for (size_t index = 0; index < done; index++) {
+			log.info("%s step %u: pin %u %s planned at %.3f ms, written at %.3f ms (%lld ns late)\n",
+			    seq->name.c_str(), (unsigned)index, seq->steps[index].pin,
+			    seq->steps[index].level == HIGH ? "high" : "low",
+			    seq->steps[index].offset_ns / 1e6, actual_ns[index] / 1e6,
+			    (long long)(actual_ns[index] - seq->steps[index].offset_ns));
+		}
+
+		if (done < seq->steps.size())
+			log.info("Sequence %s aborted after %u of %u steps, safe state written %llu ns after the abort\n",
+			    seq->name.c_str(), (unsigned)done, (unsigned)seq->steps.size(),
+			    (unsigned long long)reacted_ns);
+		else
+			log.info("Sequence %s finished\n", seq->name.c_str());
+
+		running.store(false);
+	}
+}
@@ -0,0 +1,94 @@
+/**
+ * @file valve_state.cpp
+ * @brief Implementation of the classes in valve_state.hpp.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <bcm2835.h>
+#include <mutex>
+#include <stdint.h>
+#include <string.h>
+
+#include "sequencer/valve_state.hpp"
+#include "time/time.hpp"
+
+pin_masks::pin_masks()
+	: set(0)
+	, clear(0)
+{}
+
+void pin_masks::add(uint8_t pin, uint8_t level) {
+	uint32_t bit = (uint32_t)1 << pin;
+
+	if (level == HIGH) {
+		set |= bit;
+		clear &= ~bit;
+	} else {
+		clear |= bit;
+		set &= ~bit;
+	}
+}
+
+valve_state::valve_state()
+	: levels(0)
+	, outputs(0)
+	, changes(0)
+	, changed_ns(0)
+{}
+
+void valve_state::write(uint8_t pin, uint8_t level) {
+	pin_masks masks;
+
+	masks.add(pin, level);
+	apply(masks);
+}
+
+void valve_state::apply(const pin_masks& masks) {
+	std::lock_guard<std::mutex> guard(lock);
+
+	if (masks.clear != 0)
+		bcm2835_gpio_clr_multi(masks.clear);
+	if (masks.set != 0)
+		bcm2835_gpio_set_multi(masks.set);
+
+	levels.store((levels.load() & ~masks.clear) | masks.set);
+	outputs.store(outputs.load() | masks.clear | masks.set);
+	changed_ns.store(get_elapsed_time_ns());
+	changes.fetch_add(1);
+}
+
+uint32_t valve_state::read() {
+	return levels.load();
+}
+
+uint32_t valve_state::getChanges() {
+	return changes.load();
+}
+
+uint16_t valve_state::encode(uint8_t *buf, uint16_t size) {
+	struct valve_packet packet;
+
+	if (size < sizeof(packet))
+		return 0;
+
+	memset(&packet, 0, sizeof(packet));
+	packet.magic = VALVE_MAGIC;
+	packet.version = VALVE_VERSION;
+	packet.length = sizeof(packet);
+
+	/* Hold off updates so the fields agree with each other */
+	{
+		std::lock_guard<std::mutex> guard(lock);
+
+		packet.changes = changes.load();
+		packet.changed_ns = changed_ns.load();
+		packet.levels = levels.load();
+		packet.outputs = outputs.load();
+	}
+
+	memcpy(buf, &packet, sizeof(packet));
+	return sizeof(packet);
+}
@@ -0,0 +1,96 @@
+/**
+ * @file wakeup.cpp
+ * @brief A way to wake a thread that sleeps until an absolute deadline.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sequencer/wakeup.hpp"
+
+wakeup::wakeup()
+	: notified_ns(0)
+{
+	event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+	if (event_fd < 0 || timer_fd < 0) {
+		perror("wakeup");
+		exit(1);
+	}
+}
+
+wakeup::~wakeup() {
+	close(event_fd);
+	close(timer_fd);
+}
+
+void wakeup::notify() {
+	uint64_t one = 1;
+
+	notified_ns.store(now_ns(), std::memory_order_release);
+	if (write(event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+		perror("wakeup notify");
+}
+
+bool wakeup::wait_until(timestamp_t deadline_ns) {
+	struct itimerspec timer = {{0, 0}, {0, 0}};
+	struct pollfd fds[2];
+	uint64_t count;
+
+	/* A deadline of 0 disarms the timer */
+	timer.it_value.tv_sec = deadline_ns / 1000000000;
+	timer.it_value.tv_nsec = deadline_ns % 1000000000;
+	if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &timer, NULL) < 0) {
+		perror("wakeup timer");
+		return false;
+	}
+
+	fds[0].fd = event_fd;
+	fds[0].events = POLLIN;
+	fds[1].fd = timer_fd;
+	fds[1].events = POLLIN;
+
+	while (true) {
+		if (poll(fds, 2, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("wakeup poll");
+			return false;
+		}
+
+		/* Being notified wins over a deadline that passed at the same time */
+		if (fds[0].revents & POLLIN) {
+			if (read(event_fd, &count, sizeof(count)) == sizeof(count))
+				return true;
+		}
+
+		if (fds[1].revents & POLLIN) {
+			if (read(timer_fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+				perror("wakeup timer");
+			return false;
+		}
+	}
+}
+
+timestamp_t wakeup::last_notified() {
+	return notified_ns.load(std::memory_order_acquire);
+}
+
+timestamp_t wakeup::now_ns() {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (timestamp_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
@@ -0,0 +1,228 @@
+/**
+ * @file seq_tracker.cpp
+ * @brief Receiver-side accounting of lost, reordered and duplicated telemetry.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+
+#include "circular_buffer/packet.hpp"
+#include "sequencer/valve_state.hpp"
+#include "telemetry/seq_tracker.hpp"
+
+// A packet this far behind the newest means the sender restarted its count
+#define SEQ_RESTART_DISTANCE 65536
+
+// Most samples in one received packet
+#define SEQ_MAX_ITEMS 1024
+
+seq_tracker::seq_tracker() {
+	reset();
+}
+
+void seq_tracker::reset() {
+	for (int index = 0; index < SENSOR::NUM_SENSORS; index++) {
+		streams[index].started = false;
+		streams[index].first = 0;
+		streams[index].first_timestamp = 0;
+		streams[index].next = 0;
+		streams[index].last_timestamp = 0;
+		streams[index].holes.clear();
+		memset(&streams[index].stats, 0, sizeof(seq_stats));
+	}
+}
+
+uint32_t seq_tracker::fill(stream &s, uint32_t first, uint32_t end) {
+	std::deque<std::pair<uint32_t, uint32_t> >::iterator it = s.holes.begin();
+	/* Work in distances from next, which are all negative, so wrapping
+	 * sample numbers compare correctly */
+	int64_t lo, hi, from = (int32_t)(first - s.next), to = (int32_t)(end - s.next);
+	uint32_t filled = 0;
+
+	while (it != s.holes.end()) {
+		int64_t hole_from = (int32_t)(it->first - s.next);
+		int64_t hole_to = (int32_t)(it->second - s.next);
+
+		lo = std::max(from, hole_from);
+		hi = std::min(to, hole_to);
+		if (lo >= hi) {
+			++it;
+			continue;
+		}
+
+		filled += hi - lo;
+
+		if (hole_from < lo && hi < hole_to) {
+			/* Filled the middle, so the hole splits in two */
+			uint32_t rest = it->second;
+
+			it->second = s.next + lo;
+			it = s.holes.insert(it + 1, std::make_pair(s.next + (uint32_t)hi, rest));
+			++it;
+		} else if (hole_from < lo) {
+			it->second = s.next + lo;
+			++it;
+		} else if (hi < hole_to) {
+			it->first = s.next + hi;
+			++it;
+		} else {
+			it = s.holes.erase(it);
+		}
+	}
+
+	return filled;
+}
+
+void seq_tracker::restart(stream &s, const struct data_item *items, uint16_t count) {
+	s.started = true;
+	s.holes.clear();
+	s.first = items[0].seq;
+	s.first_timestamp = items[0].timestamp;
+	s.next = items[0].seq + count;
+	s.last_timestamp = items[count - 1].timestamp;
+	s.stats.samples += count;
+}
+
+void seq_tracker::add(SENSOR sensor, const struct data_item *items, uint16_t count) {
+	uint32_t first, end, fresh, filled;
+	int32_t ahead;
+
+	if (count == 0 || sensor >= SENSOR::NUM_SENSORS)
+		return;
+
+	stream &s = streams[sensor];
+	first = items[0].seq;
+	end = first + count;
+
+	s.stats.packets++;
+
+	/* Gaps in time between samples of the same packet */
+	for (int index = 1; index < count; index++)
+		s.stats.max_gap_us = std::max(s.stats.max_gap_us,
+		    items[index].timestamp - items[index - 1].timestamp);
+
+	ahead = first - s.next;
+	if (!s.started || ahead < -SEQ_RESTART_DISTANCE) {
+		restart(s, items, count);
+		return;
+	}
+
+	if (ahead >= 0) {
+		if (ahead > 0) {
+			/* Skipped over some samples; they may still turn up */
+			s.holes.push_back(std::make_pair(s.next, first));
+			s.stats.lost += ahead;
+			if (s.holes.size() > SEQ_MAX_HOLES)
+				s.holes.pop_front();
+		} else {
+			s.stats.max_gap_us = std::max(s.stats.max_gap_us,
+			    items[0].timestamp - s.last_timestamp);
+		}
+
+		s.next = end;
+		s.last_timestamp = items[count - 1].timestamp;
+		s.stats.samples += count;
+		return;
+	}
+
+	/* A late packet, which may also run past next */
+	fresh = (int32_t)(end - s.next) > 0 ? end - s.next : 0;
+	filled = fill(s, first, fresh ? s.next : end);
+
+	/*
+	 * Counting from zero again without filling a gap is a sender that
+	 * restarted too soon after its last start to be caught above, but only
+	 * if sample 0 was read at another time than the one received already.
+	 * The same sample again is a duplicate, e.g. from a retransmit.
+	 */
+	if (!fresh && !filled && first == 0 &&
+	    (s.first != 0 || items[0].timestamp != s.first_timestamp)) {
+		restart(s, items, count);
+		return;
+	}
+
+	if (fresh) {
+		s.next = end;
+		s.last_timestamp = items[count - 1].timestamp;
+		s.stats.samples += fresh;
+	}
+
+	if (filled) {
+		s.stats.reordered++;
+		s.stats.lost -= filled;
+		s.stats.samples += filled;
+	} else if (!fresh) {
+		s.stats.duplicates++;
+	}
+}
+
+/*
+ * Valve states, calibrated readings and filter outputs share the link with
+ * the samples, but carry no sample numbers of their own.
+ */
+static bool has_samples(const uint8_t *packet, uint16_t length) {
+	return length == 0 || (packet[0] != VALVE_MAGIC &&
+	    packet[0] != CALIBRATED_MAGIC && packet[0] != FILTERED_MAGIC);
+}
+
+int seq_tracker::addDatagram(const uint8_t *buf, uint32_t size) {
+	struct data_item items[SEQ_MAX_ITEMS];
+	const uint8_t *packet;
+	frame_reader reader;
+	uint16_t length, count;
+	SENSOR sensor;
+	int num_packets = 0;
+
+	if (!reader.reset(buf, size))
+		return -1;
+
+	while (reader.next(&sensor, &packet, &length)) {
+		if (!has_samples(packet, length))
+			continue;
+
+		if (decode_packet(packet, length, &sensor, items, SEQ_MAX_ITEMS, &count) == 0)
+			return -1;
+
+		add(sensor, items, count);
+		num_packets++;
+	}
+
+	return num_packets;
+}
+
+/* Fill in the rates from the counters */
+static void compute_rates(seq_stats *stats) {
+	stats->loss_rate = stats->samples + stats->lost ?
+	    (double)stats->lost / (stats->samples + stats->lost) : 0;
+	stats->reorder_rate = stats->packets ?
+	    (double)stats->reordered / stats->packets : 0;
+	stats->duplicate_rate = stats->packets ?
+	    (double)stats->duplicates / stats->packets : 0;
+}
+
+void seq_tracker::getStats(SENSOR sensor, seq_stats *stats) {
+	*stats = streams[sensor].stats;
+	compute_rates(stats);
+}
+
+void seq_tracker::getTotals(seq_stats *stats) {
+	memset(stats, 0, sizeof(seq_stats));
+
+	for (int index = 0; index < SENSOR::NUM_SENSORS; index++) {
+		seq_stats &s = streams[index].stats;
+
+		stats->packets += s.packets;
+		stats->samples += s.samples;
+		stats->lost += s.lost;
+		stats->reordered += s.reordered;
+		stats->duplicates += s.duplicates;
+		stats->max_gap_us = std::max(stats->max_gap_us, s.max_gap_us);
+	}
+
+	compute_rates(stats);
+}
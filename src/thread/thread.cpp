@@ -1,48 +1,179 @@
 /**
  * @file thread.cpp
  * @author Tommy Yuan (ty19@rice.edu)
- * @brief Thread that reads and logs sensor data at some frequency.
+ * @brief Thread that reads and logs sensor data on a fixed schedule.
  * @version 0.1
  * @date 2019-07-22
  * 
  * @copyright Copyright (c) 2019
  */
 
+#include <algorithm>
 #include <bcm2835.h>
+#include <errno.h>
 #include <mutex>
 #include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 #include <vector>
 
 #include "adc/adc.hpp"
+#include "circular_buffer/packet.hpp"
 #include "commands/rpi_pins.hpp"
-#include "logger/logger.hpp"
+#include "filter/filter_bank.hpp"
+#include "io/io_thread.hpp"
 #include "thread/thread.hpp"
 #include "time/time.hpp"
-#include "networking/Udp.hpp"
 
-/* TODO this has to be 16n + 4 */
+/*
+ * Largest packet made from one circular buffer. Only whole samples are taken,
+ * and the I/O thread can pack several packets into one datagram.
+ */
 #define BUFF_SIZE	260
 
+/* Samples per compact packet; all of them fit in BUFF_SIZE with room to spare */
+#define COMPACT_ITEMS	32
+
+/* Filter outputs per filtered packet */
+#define FILTERED_ITEMS	32
+
+static_assert(BUFF_SIZE <= IO_PACKET_SIZE, "Packets must fit in an io_packet");
+static_assert(sizeof(struct filtered_header) + FILTERED_ITEMS * sizeof(float) <= BUFF_SIZE,
+    "Filtered packets must fit in BUFF_SIZE");
+
+#define NS_PER_SEC	1000000000ULL
+
+thread_timing::thread_timing()
+	: ticks(0)
+	, overruns(0)
+	, missed_periods(0)
+	, min_jitter_ns(UINT64_MAX)
+	, max_jitter_ns(0)
+	, total_jitter_ns(0)
+	, max_work_ns(0)
+	{};
+
+static uint32_t gcd(uint32_t a, uint32_t b) {
+	while (b != 0) {
+		uint32_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/*
+ * Build the cyclic schedule for the given sensors, with minor frames at
+ * minor_hz. Phases are assigned rate-monotonically: the fastest sensors are
+ * placed first, and each sensor takes the phase whose frames are least loaded.
+ */
+static frame_schedule *build_schedule(const char *name, SENSOR *sensors,
+    uint8_t num_sensors, uint16_t minor_hz)
+{
+	frame_schedule *schedule = new frame_schedule();
+	std::vector<uint32_t> periods(num_sensors), phases(num_sensors);
+	std::vector<uint8_t> order(num_sensors);
+	std::vector<uint32_t> load;
+	uint32_t num_frames = 1;
+
+	for (int i = 0; i < num_sensors; i++) {
+		uint16_t freq = SENSOR_FREQS[sensors[i]];
+
+		periods[i] = freq ? (minor_hz + freq / 2) / freq : 1;
+		if (periods[i] == 0)
+			periods[i] = 1;
+
+		if (periods[i] * freq != minor_hz)
+			printf("%s: %s rounded from %d Hz to %.2f Hz\n", name,
+			    SENSOR_NAMES[sensors[i]], freq, (double)minor_hz / periods[i]);
+
+		num_frames = num_frames / gcd(num_frames, periods[i]) * periods[i];
+		order[i] = i;
+	}
+
+	/* Fastest (shortest period) first, keeping the given order on ties */
+	std::stable_sort(order.begin(), order.end(),
+	    [&periods](uint8_t a, uint8_t b) { return periods[a] < periods[b]; });
+
+	load.assign(num_frames, 0);
+	for (int i = 0; i < num_sensors; i++) {
+		uint8_t s = order[i];
+		uint32_t best_phase = 0, best_load = UINT32_MAX;
+
+		for (uint32_t phase = 0; phase < periods[s]; phase++) {
+			uint32_t worst = 0;
+
+			for (uint32_t f = phase; f < num_frames; f += periods[s])
+				worst = std::max(worst, load[f]);
+
+			if (worst < best_load) {
+				best_load = worst;
+				best_phase = phase;
+			}
+		}
+
+		phases[s] = best_phase;
+		for (uint32_t f = best_phase; f < num_frames; f += periods[s])
+			load[f]++;
+	}
+
+	/* Lay out each frame's reads grouped by chip select, one batch per group */
+	schedule->num_frames = num_frames;
+	for (uint32_t f = 0; f < num_frames; f++) {
+		std::vector<uint8_t> frame;
+
+		for (int i = 0; i < num_sensors; i++) {
+			if (f % periods[i] == phases[i])
+				frame.push_back(i);
+		}
+
+		std::stable_sort(frame.begin(), frame.end(),
+		    [sensors](uint8_t a, uint8_t b) {
+			return SENSOR_PINS[sensors[a]] < SENSOR_PINS[sensors[b]];
+		});
+
+		schedule->frame_starts.push_back(schedule->batch_starts.size());
+		for (uint32_t i = 0; i < frame.size(); i++) {
+			if (i == 0 || SENSOR_PINS[sensors[frame[i]]] !=
+			    SENSOR_PINS[sensors[frame[i - 1]]])
+				schedule->batch_starts.push_back(schedule->slots.size());
+
+			schedule->slots.push_back(frame[i]);
+			schedule->sensors.push_back(sensors[frame[i]]);
+		}
+	}
+	schedule->frame_starts.push_back(schedule->batch_starts.size());
+	schedule->batch_starts.push_back(schedule->slots.size());
+
+	printf("%s: %d Hz minor frames, %u frames per major frame\n", name,
+	    minor_hz, num_frames);
+	for (int i = 0; i < num_sensors; i++)
+		printf("%s: %s every %u frames at phase %u\n", name,
+		    SENSOR_NAMES[sensors[i]], periods[i], phases[i]);
+
+	return schedule;
+}
+
 PeriodicThread::PeriodicThread(const char *name,
-			       uint16_t frequency_hz,
                                SENSOR *sensors,
                                uint8_t num_sensors,
-                               double pressureMax,
-                               double pressureMin,
-                               double pressureSlope,
-                               double pressureYint,
-                               Udp::OutSocket *sock)
+                               IoThread *io,
+                               adc_backend *backend,
+                               interlock *rules,
+                               PACKET_FORMAT format,
+                               SCHED_MODE mode)
 {
-        // Set pressure cutoff info
-        this->pressureMax = pressureMax;
-        this->pressureMin = pressureMin;
-        this->pressureSlope = pressureSlope;
-        this->pressureYint = pressureYint;
-        
+        this->name = name;
+
+        // Every reading is checked against the safety rules
+        this->rules = rules;
+        this->filters = NULL;
+        this->send_filtered = false;
+
         // Set up ADC block
-	this->reader = adc_reader();
+	this->reader = adc_reader(backend);
 
 	// Register each sensor with the ADC reader
 	for (int i = 0; i < num_sensors; i++) {
@@ -50,140 +181,348 @@ PeriodicThread::PeriodicThread(const char *name,
                     SENSOR_CHANNELS[sensors[i]]);
 	}
 
-	// TODO assume we don't sleep for more than 1s
-	// TODO sleep time seems to be twice as long as it should be
-	this->sleep_time_ns = (1.0 / (double)frequency_hz) * 1000000000;
+	// The minor frame runs at the rate of the fastest sensor
+	uint16_t minor_hz = 1;
+	for (int i = 0; i < num_sensors; i++)
+		minor_hz = std::max(minor_hz, SENSOR_FREQS[sensors[i]]);
+
+	this->sleep_time_ns = (1.0 / (double)minor_hz) * NS_PER_SEC;
+	this->schedule = build_schedule(name, sensors, num_sensors, minor_hz);
+	this->mode = mode;
+	this->timing = new thread_timing();
 
-	this->buffers = new std::vector<circular_buffer>;
-	this->loggers = new std::vector<Logger>;
+	this->buffers = new std::vector<circular_buffer *>;
+
+	/* Size each buffer so that a full buffer makes one packet */
+	uint16_t num_items = format == PACKET_FORMAT::COMPACT ? COMPACT_ITEMS :
+	    packet_capacity(format, BUFF_SIZE);
 
 	for (int index = 0; index < num_sensors; index++) {
-	        this->buffers->push_back(circular_buffer(sensors[index], 16));
-	        this->loggers->push_back(Logger(SENSOR_NAMES[sensors[index]],
-                    SENSOR_NAMES[sensors[index]], LogLevel::DEBUG));
+	        this->buffers->push_back(new circular_buffer(sensors[index],
+	            num_items, format));
 	}
 
 	this->num_sensors = num_sensors;
-	this->sock = sock;
+	this->queue = io->addQueue(sensors, num_sensors);
+
+	// The timing statistics go out with the I/O thread's report
+	memset(&this->reported, 0, sizeof(this->reported));
+	io->addReporter(this);
 	
 	printf("%s starting with %d sensors\n", name, num_sensors);
 }
 
 PeriodicThread::~PeriodicThread() {
+	for (size_t index = 0; index < this->buffers->size(); index++)
+		delete (*this->buffers)[index];
 	delete this->buffers;
-	delete this->loggers;
+	delete this->schedule;
+	delete this->timing;
+}
+
+static uint64_t monotonic_ns() {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * NS_PER_SEC + (uint64_t)now.tv_nsec;
+}
+
+static void ns_to_timespec(uint64_t ns, struct timespec *spec) {
+	spec->tv_sec = ns / NS_PER_SEC;
+	spec->tv_nsec = ns % NS_PER_SEC;
 }
 
-// Perform a conversion from a raw ADC reading value to a calibrated value
-//static double convertReading(uint16_t reading, double slope, double yint) {
-//        return slope * reading + yint;
-//}
+/*
+ * Sleep for one period after the previous tick's work, like the original loop.
+ * Returns the time the new tick was meant to start.
+ */
+static uint64_t wait_relative(uint64_t period_ns) {
+	struct timespec rem, spec;
+
+	ns_to_timespec(period_ns, &spec);
+
+	// Sleep multiple times if we get interrupted while sleeping
+	while (nanosleep(&spec, &rem) == -1)
+		spec = rem;
+
+	return monotonic_ns();
+}
+
+/*
+ * If the previous tick ran past the next deadline the new tick starts
+ * immediately, and if we fell more than a whole period behind, the missed
+ * periods are skipped so the thread stays in phase with its nominal schedule.
+ */
+uint64_t wait_deadline(uint64_t *deadline_ns, uint64_t period_ns,
+    thread_timing *timing, uint64_t *missed)
+{
+	struct timespec spec;
+	uint64_t now_ns;
+
+	*missed = 0;
+	*deadline_ns += period_ns;
+	now_ns = monotonic_ns();
+
+	if (now_ns >= *deadline_ns) {
+		timing->overruns.fetch_add(1, std::memory_order_relaxed);
+
+		*missed = (now_ns - *deadline_ns) / period_ns;
+		if (*missed > 0) {
+			*deadline_ns += *missed * period_ns;
+			timing->missed_periods.fetch_add(*missed, std::memory_order_relaxed);
+		}
+	} else {
+		ns_to_timespec(*deadline_ns, &spec);
+
+		// An absolute sleep can simply be restarted if interrupted
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &spec, NULL) == EINTR);
+	}
+
+	return *deadline_ns;
+}
+
+void record_tick(thread_timing *timing, uint64_t deadline_ns,
+    uint64_t start_ns, uint64_t end_ns)
+{
+	uint64_t jitter_ns = start_ns > deadline_ns ? start_ns - deadline_ns : 0;
+	uint64_t work_ns = end_ns - start_ns;
+
+	timing->ticks.fetch_add(1, std::memory_order_relaxed);
+	timing->total_jitter_ns.fetch_add(jitter_ns, std::memory_order_relaxed);
+
+	/* Only this thread writes the counters, so load/store is enough */
+	if (jitter_ns < timing->min_jitter_ns.load(std::memory_order_relaxed))
+		timing->min_jitter_ns.store(jitter_ns, std::memory_order_relaxed);
+	if (jitter_ns > timing->max_jitter_ns.load(std::memory_order_relaxed))
+		timing->max_jitter_ns.store(jitter_ns, std::memory_order_relaxed);
+	if (work_ns > timing->max_work_ns.load(std::memory_order_relaxed))
+		timing->max_work_ns.store(work_ns, std::memory_order_relaxed);
+}
+
+uint32_t next_frame(const frame_schedule *schedule, uint32_t frame,
+    uint64_t missed)
+{
+	return (frame + 1 + missed) % schedule->num_frames;
+}
+
+/*
+ * Hand the data waiting in a circular buffer to the I/O thread. If its queue is
+ * full the data is dropped (and counted) into scratch rather than waiting on
+ * the disk or network.
+ */
+static void flush(circular_buffer *it, ring_buffer<io_packet> *queue,
+    uint8_t *scratch)
+{
+	io_packet *packet = queue->claim();
+
+	if (packet != NULL) {
+		uint8_t *data = packet->data;
+
+		packet->sensor = it->sensor;
+		packet->length = it->get_data(&data, BUFF_SIZE);
+		queue->commit();
+	} else {
+		it->get_data(&scratch, BUFF_SIZE);
+	}
+}
+
+void store_reading(circular_buffer *buffer, ring_buffer<io_packet> *queue,
+    uint8_t *scratch, uint16_t reading, timestamp_t timestamp)
+{
+	/* A full buffer rejects the reading, so make room and store it again */
+	if (buffer->push_data_item(reading, timestamp) == BUFF_STATUS::FULL) {
+		flush(buffer, queue, scratch);
+		buffer->push_data_item(reading, timestamp);
+	}
+}
+
+/*
+ * The filter outputs of one sensor waiting to fill a filtered packet.
+ */
+struct filtered_run {
+	float values[FILTERED_ITEMS];
+	timestamp_t base;
+	uint32_t seq;
+	uint16_t count;
+};
+
+/*
+ * Hand a sensor's waiting filter outputs to the I/O thread, or drop them if
+ * its queue is full.
+ */
+static void flush_filtered(SENSOR sensor, filtered_run *run, filter_bank *filters,
+    ring_buffer<io_packet> *queue)
+{
+	io_packet *packet;
+
+	if (run->count == 0)
+		return;
+
+	packet = queue->claim();
+	if (packet != NULL) {
+		packet->sensor = sensor;
+		packet->length = encode_filtered(sensor, run->base, run->seq,
+		    filters->getRate(sensor), run->values, run->count, packet->data,
+		    BUFF_SIZE);
+		queue->commit();
+	}
+
+	run->seq += run->count;
+	run->count = 0;
+}
 
 // The function that is run by each thread
-static void *threadFunc(adc_reader reader, std::vector<Logger>* loggers,
-    std::vector<circular_buffer>* buffers, uint64_t sleep_time_ns, 
-    uint8_t num_sensors, double pressureMax, double pressureMin, 
-    double pressureSlope, double pressureYint, Udp::OutSocket* sock)
+static void *threadFunc(adc_reader reader,
+    std::vector<circular_buffer *>* buffers, uint64_t sleep_time_ns, 
+    frame_schedule *schedule, uint8_t num_sensors, interlock *rules,
+    filter_bank *filters, bool send_filtered, ring_buffer<io_packet> *queue,
+    SCHED_MODE mode, thread_timing *timing)
 {
-	struct timespec rem, spec;
-	std::vector<circular_buffer>::iterator it;
-	std::vector<Logger>::iterator it_log;
+	uint64_t deadline_ns, start_ns, missed = 0;
+	uint32_t frame, batch, first, count, i;
+	circular_buffer *it;
+	struct time_tick tick;
 	timestamp_t timestamp, old_timestamp = 0;
-	uint16_t reading;
+	uint16_t reading, readings[SENSOR::NUM_SENSORS];
 	uint8_t *b = new uint8_t[BUFF_SIZE];
-	BUFF_STATUS status;
-        
-        // Running average for PT_COMB
-        double combAvg = 700; // initialize to a reasonable value
-	
+	filtered_run *runs = new filtered_run[SENSOR::NUM_SENSORS]();
+	bool changed;
+	float value;
+
+	deadline_ns = monotonic_ns();
+
+	/* The frame run last, so the first tick runs frame 0 */
+	frame = schedule->num_frames - 1;
+
 	// TODO: ever break out of this loop?
 	while(1) {
-	        spec.tv_sec = 0;
-	        spec.tv_nsec = sleep_time_ns;
+		if (mode == SCHED_MODE::DEADLINE)
+			wait_deadline(&deadline_ns, sleep_time_ns, timing, &missed);
+		else
+			deadline_ns = wait_relative(sleep_time_ns);
 
-		// Sleep multiple times if we get interrupted while sleeping
-		while (nanosleep(&spec, &rem) == -1) {
-		        printf("New wait time: %lu\n", rem.tv_nsec);
-			spec.tv_nsec = rem.tv_nsec;
-		}
+		frame = next_frame(schedule, frame, missed);
 
-		it_log = loggers->begin();
-		for (it = buffers->begin(); it != buffers->end(); ++it) {
-#ifdef MOCK
-			reading = reader.count_up();
-#else
-			reading = reader.read_item(it->sensor);
-#endif
-                        // Include the reading in the running average
-			if (it->sensor == PT1) {
-			        double converted = pressureSlope * 
-                                    reading + pressureYint;
-				combAvg = combAvg * 0.95 + converted * 0.05;
-
-				// If the average is beyond the cutoff 
-                                // threshold, signal the cutoff
-				
-                                //printf("Running avg: %f\n", (float) combAvg);
-				if (combAvg > pressureMax || 
-                                    combAvg < pressureMin) {
-				        if (!pressureShutoff.load())
-                                                printf("Stored pressure shutoff: %d\n", (int)
-                                                    pressureShutoff.load());
-
-                                        pressureShutoff.store(true);
-				} else {
-					if (pressureShutoff.load())
-						printf("Pressure returned to nominal.\n");
+		start_ns = monotonic_ns();
 
-					pressureShutoff.store(false);
-				}
-			}
-                        
-			timestamp = get_elapsed_time_us();
-			status = it->push_data_item(reading, timestamp);
-
-			/* If the circular buffer is full, send the available data */
-			if (status == BUFF_STATUS::FULL) {
-				it->get_data(&b, BUFF_SIZE);
-				it_log->data(b, BUFF_SIZE);
-				
-				// Send the data over UDP
-				if (sock != NULL && sock->getFd() != -1)
-					try {
-						sock->sendBuf(b, BUFF_SIZE);
-					} catch (Udp::OpFailureException&) {
-						printf("Op failure!\n");
-					} catch (Udp::BadOutSocketException&) {
-						printf("Bad socket!\n");
-					} catch (...) {
-						printf("Unknown error!\n");
+		/* Every reading in the tick shares its timestamp */
+		stamp_tick(&tick);
+		timestamp = tick.us;
+
+		for (batch = schedule->frame_starts[frame];
+		     batch < schedule->frame_starts[frame + 1]; batch++) {
+			first = schedule->batch_starts[batch];
+			count = schedule->batch_starts[batch + 1] - first;
+
+			/* Every sensor in a batch shares a chip select */
+			reader.read_items(&schedule->sensors[first], count, readings);
+
+			for (i = 0; i < count; i++) {
+				it = (*buffers)[schedule->slots[first + i]];
+				reading = readings[i];
+
+				/* The rules signal a shutoff themselves; printing waits for a change */
+				changed = rules != NULL && rules->evaluate(it->sensor, reading, timestamp);
+
+				if (filters != NULL && filters->process(it->sensor, reading, &value)) {
+					/* Two changes in one sample cancel out */
+					if (rules != NULL)
+						changed ^= rules->evaluate(it->sensor, value, timestamp, true);
+
+					if (send_filtered && filters->filtered(it->sensor)) {
+						filtered_run *run = &runs[it->sensor];
+
+						if (run->count == 0)
+							run->base = timestamp;
+						run->values[run->count++] = value;
+						if (run->count == FILTERED_ITEMS)
+							flush_filtered(it->sensor, run, filters, queue);
 					}
-				else {
-					printf("Problem with socket\n");
-					return NULL;
 				}
+
+				if (changed) {
+					if (rules->getTripped() != 0)
+						printf("Stored pressure shutoff, rules 0x%x tripped\n",
+						    rules->getTripped());
+					else
+						printf("Pressure returned to nominal.\n");
+				}
+
+				store_reading(it, queue, b, reading, timestamp);
+
+				old_timestamp = timestamp;
+			}
+		}
+
+		/* Send partial packets for slow sensors whose data is getting stale */
+		for (i = 0; i < buffers->size(); i++) {
+			if ((*buffers)[i]->due(timestamp)) {
+				flush((*buffers)[i], queue, b);
+				if (send_filtered)
+					flush_filtered((*buffers)[i]->sensor,
+					    &runs[(*buffers)[i]->sensor], filters, queue);
 			}
-                        
-			old_timestamp = timestamp;
-			it_log++;
 		}
+
+		record_tick(timing, deadline_ns, start_ns, monotonic_ns());
 	}
 
 	// Clean up
 	delete b;
+	delete[] runs;
+}
+
+void PeriodicThread::setMaxLatency(SENSOR sensor, uint32_t max_latency_ms) {
+	for (size_t index = 0; index < this->buffers->size(); index++) {
+		if ((*this->buffers)[index]->sensor == sensor)
+			(*this->buffers)[index]->setMaxLatency(max_latency_ms * 1000ULL);
+	}
+}
+
+void PeriodicThread::setFilters(filter_bank *filters, bool send) {
+	this->filters = filters;
+	this->send_filtered = filters != NULL && send;
 }
 
 void PeriodicThread::start() {
 	core_thread = std::thread(threadFunc,
                                   this->reader,
-                                  this->loggers,
                                   this->buffers,
                                   this->sleep_time_ns,
+                                  this->schedule,
                                   this->num_sensors,
-                                  this->pressureMax,
-                                  this->pressureMin,
-                                  this->pressureSlope,
-                                  this->pressureYint,
-                                  this->sock);
+                                  this->rules,
+                                  this->filters,
+                                  this->send_filtered,
+                                  this->queue,
+                                  this->mode,
+                                  this->timing);
 	core_thread.detach();
 }
+
+void PeriodicThread::getStats(thread_stats *stats) {
+	stats->ticks = timing->ticks.load(std::memory_order_relaxed);
+	stats->overruns = timing->overruns.load(std::memory_order_relaxed);
+	stats->missed_periods = timing->missed_periods.load(std::memory_order_relaxed);
+	stats->min_jitter_ns = stats->ticks ? timing->min_jitter_ns.load(std::memory_order_relaxed) : 0;
+	stats->max_jitter_ns = timing->max_jitter_ns.load(std::memory_order_relaxed);
+	stats->mean_jitter_ns = stats->ticks ?
+	    timing->total_jitter_ns.load(std::memory_order_relaxed) / stats->ticks : 0;
+	stats->max_work_ns = timing->max_work_ns.load(std::memory_order_relaxed);
+}
+
+void PeriodicThread::report(Logger *log, double elapsed_s) {
+	thread_stats now;
+
+	getStats(&now);
+	log->info("%s: %llu ticks (%.1f/s), %llu overruns, %llu missed periods; "
+	    "jitter min %llu ns, mean %llu ns, max %llu ns, longest tick %llu ns\n",
+	    name.c_str(), (unsigned long long)(now.ticks - reported.ticks),
+	    (now.ticks - reported.ticks) / elapsed_s,
+	    (unsigned long long)(now.overruns - reported.overruns),
+	    (unsigned long long)(now.missed_periods - reported.missed_periods),
+	    (unsigned long long)now.min_jitter_ns, (unsigned long long)now.mean_jitter_ns,
+	    (unsigned long long)now.max_jitter_ns, (unsigned long long)now.max_work_ns);
+
+	reported = now;
+}
@@ -13,12 +13,50 @@
 
 #include "time/time.hpp"
 
-static timestamp_t start_time = 0;
+// The clock elapsed times are read from
+#ifdef CLOCK_MONOTONIC_RAW
+#define ELAPSED_CLOCK CLOCK_MONOTONIC_RAW
+#else
+#define ELAPSED_CLOCK CLOCK_MONOTONIC
+#endif
 
-void set_start_time() {
-	if (start_time == 0) {
-		start_time = get_elapsed_time_ns();
+/**
+ * @brief The time elapsed times count from, taken when the program starts.
+ */
+struct time_epoch {
+	struct timespec start;
+
+	time_epoch() {
+		clock_gettime(ELAPSED_CLOCK, &start);
+	}
+};
+
+/*
+ * Constructed ahead of the default priority, so the loggers and threads other
+ * files set up during static initialization already see it, and never
+ * written again, so it is read without locking.
+ */
+static time_epoch epoch __attribute__((init_priority(101)));
+
+/*
+ * Reads the clock as whole seconds and nanoseconds since the epoch. Keeping
+ * them apart lets each unit be made with one 32 bit division by a constant,
+ * which the compiler turns into a multiply, rather than 64 bit divisions,
+ * which are library calls on the Pi.
+ */
+static inline void elapsed(timestamp_t *s, uint32_t *ns) {
+	struct timespec now;
+	long nsec;
+
+	clock_gettime(ELAPSED_CLOCK, &now);
+
+	nsec = now.tv_nsec - epoch.start.tv_nsec;
+	*s = now.tv_sec - epoch.start.tv_sec;
+	if (nsec < 0) {
+		nsec += 1000000000;
+		(*s)--;
 	}
+	*ns = nsec;
 }
 
 void get_formatted_time(char *time_buf) {
@@ -36,20 +74,44 @@ void get_formatted_time(char *time_buf) {
 }
 
 timestamp_t get_elapsed_time_s() {
-	return get_elapsed_time_ms() / 1000;
+	timestamp_t s;
+	uint32_t ns;
+
+	elapsed(&s, &ns);
+	return s;
 }
 
 timestamp_t get_elapsed_time_ms() {
-	return get_elapsed_time_us() / 1000;
+	timestamp_t s;
+	uint32_t ns;
+
+	elapsed(&s, &ns);
+	return s * 1000 + ns / 1000000;
 }
 
 timestamp_t get_elapsed_time_us() {
-	return get_elapsed_time_ns() / 1000;
+	timestamp_t s;
+	uint32_t ns;
+
+	elapsed(&s, &ns);
+	return s * 1000000 + ns / 1000;
 }
 
 timestamp_t get_elapsed_time_ns() {
-	struct timespec tp;
+	timestamp_t s;
+	uint32_t ns;
 
-	clock_gettime(CLOCK_REALTIME, &tp);
-	return (uint64_t)tp.tv_sec * 1000000000 + (uint64_t)tp.tv_nsec - start_time;
+	elapsed(&s, &ns);
+	return s * 1000000000 + ns;
+}
+
+void stamp_tick(struct time_tick *tick) {
+	timestamp_t s;
+	uint32_t ns;
+
+	elapsed(&s, &ns);
+	tick->s = s;
+	tick->ms = s * 1000 + ns / 1000000;
+	tick->us = s * 1000000 + ns / 1000;
+	tick->ns = s * 1000000000 + ns;
 }
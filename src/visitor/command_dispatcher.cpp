@@ -0,0 +1,211 @@
+/**
+ * @file command_dispatcher.cpp
+ * @brief Turns the bytes sent by command clients into visited commands.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <string.h>
+#include <vector>
+
+#include "io/io_thread.hpp"
+#include "networking/CommandProtocol.hpp"
+#include "networking/CommandServer.hpp"
+#include "time/time.hpp"
+#include "visitor/command_dispatcher.hpp"
+#include "visitor/worker_visitor.hpp"
+
+CommandDispatcher::CommandDispatcher(WorkerVisitor *visitor, IoThread *io_thread, Logger *logger)
+    : visitor(visitor)
+    , io_thread(io_thread)
+    , logger(logger)
+{}
+
+size_t CommandDispatcher::argsSize(uint8_t command) {
+    if (command == COMMAND::REQUEST_RETRANSMIT)
+        return RETRANSMIT_ARGS_SIZE;
+
+    return 0;
+}
+
+void CommandDispatcher::retransmit(Tcp::Client &client, const uint8_t *args) {
+    std::vector<io_packet> found;
+    uint32_t first, count;
+    uint16_t num_packets, length;
+
+    memcpy(&first, args + 1, sizeof(first));
+    memcpy(&count, args + 5, sizeof(count));
+
+    num_packets = io_thread->resend((SENSOR)args[0], first, count, &found, MAX_RETRANSMIT_PACKETS);
+    logger->info("Resending %u packets of sensor %u from sample %u\n", num_packets, args[0], first);
+
+    client.send((uint8_t *)&num_packets, sizeof(num_packets));
+    for (uint16_t index = 0; index < num_packets; index++) {
+        length = found[index].length;
+        client.send((uint8_t *)&length, sizeof(length));
+        client.send(found[index].data, length);
+    }
+}
+
+void CommandDispatcher::dispatch(Tcp::Client &client, const uint8_t *command,
+    command_ack *ack)
+{
+    timestamp_t before = visitor != NULL ? visitor->getLastActuation() : 0;
+
+    if (ack != NULL) {
+        ack->status = CMD_OK;
+        ack->dispatched_ns = get_elapsed_time_ns();
+        ack->actuated_ns = 0;
+    }
+
+    if (command[0] == COMMAND::REQUEST_RETRANSMIT) {
+        // Ack first, so the client knows the packets that follow are its reply
+        if (ack != NULL)
+            client.send((uint8_t *)ack, sizeof(*ack));
+        retransmit(client, command + 1);
+        return;
+    }
+
+    if (command[0] >= COMMAND::NUM_COMMANDS) {
+        logger->error("Unknown command: (%d)\n", command[0]);
+        if (ack != NULL)
+            ack->status = CMD_UNKNOWN;
+        return;
+    }
+
+    if (!client.isOperator()) {
+        logger->info("Ignoring command (%d) from observer %s\n", command[0], client.getClientHostname().c_str());
+        if (ack != NULL)
+            ack->status = CMD_IGNORED;
+        return;
+    }
+
+    logger->info("Received command: (%d)\n", command[0]);
+    if (visitor == NULL)
+        return;
+
+    visitor->visitCommand((COMMAND) command[0]);
+    if (ack != NULL && visitor->getLastActuation() != before)
+        ack->actuated_ns = visitor->getLastActuation();
+}
+
+void CommandDispatcher::handleFrame(Tcp::Client &client, const command_frame_header *header,
+    const uint8_t *commands, timestamp_t received_ns)
+{
+    std::map<Tcp::Client *, uint32_t>::iterator last = next_seq.find(&client);
+    std::vector<command_ack> acks;
+    command_ack ack;
+    size_t offset = 0, size;
+    uint32_t seq = header->seq;
+
+    memset(&ack, 0, sizeof(ack));
+    ack.start = CMD_ACK_START;
+    ack.received_ns = received_ns;
+
+    while (offset < header->length) {
+        ack.command = commands[offset];
+        ack.seq = seq++;
+        size = 1 + argsSize(commands[offset]);
+
+        if (offset + size > header->length) {
+            // The last command's arguments run off the end of the frame
+            ack.status = CMD_MALFORMED;
+            ack.dispatched_ns = 0;
+            ack.actuated_ns = 0;
+            acks.push_back(ack);
+            break;
+        }
+
+        if (last != next_seq.end() && (int32_t)(ack.seq - last->second) < 0 &&
+            commands[offset] != COMMAND::REQUEST_RETRANSMIT) {
+            // Resent after a lost ack, and already carried out
+            ack.status = CMD_DUPLICATE;
+            ack.dispatched_ns = 0;
+            ack.actuated_ns = 0;
+            acks.push_back(ack);
+        } else if (commands[offset] == COMMAND::REQUEST_RETRANSMIT) {
+            // Its ack goes out right before its reply, so send any before it
+            if (!acks.empty())
+                client.send((uint8_t *)acks.data(), acks.size() * sizeof(command_ack));
+            acks.clear();
+            dispatch(client, commands + offset, &ack);
+        } else {
+            dispatch(client, commands + offset, &ack);
+            acks.push_back(ack);
+        }
+
+        offset += size;
+    }
+
+    if (last == next_seq.end())
+        next_seq[&client] = seq;
+    else if ((int32_t)(seq - last->second) > 0)
+        last->second = seq;
+
+    // Every ack of a pipelined frame in one send
+    if (!acks.empty())
+        client.send((uint8_t *)acks.data(), acks.size() * sizeof(command_ack));
+}
+
+size_t CommandDispatcher::handle(Tcp::Client &client, const uint8_t *buf, size_t n) {
+    timestamp_t received_ns = get_elapsed_time_ns();
+    command_frame_header header;
+    int length;
+
+    if (buf[0] == CMD_FRAME_START) {
+        length = parse_command_frame(buf, n, &header);
+        if (length == 0)
+            return 0;
+
+        if (length < 0) {
+            command_ack ack;
+
+            memset(&ack, 0, sizeof(ack));
+            ack.start = CMD_ACK_START;
+            ack.status = CMD_MALFORMED;
+            ack.seq = header.seq;
+            ack.received_ns = received_ns;
+            client.send((uint8_t *)&ack, sizeof(ack));
+
+            // There is no telling where the next command starts
+            logger->error("Malformed command frame from %s\n", client.getClientHostname().c_str());
+            client.close();
+            return n;
+        }
+
+        handleFrame(client, &header, buf + sizeof(header), received_ns);
+        return length;
+    }
+
+    if (buf[0] == '0') {
+        client.close();
+        return 1;
+    }
+
+    // Legacy commands are unacknowledged
+    if (n < 1 + argsSize(buf[0]))
+        return 0;
+    dispatch(client, buf, NULL);
+    return 1 + argsSize(buf[0]);
+}
+
+void CommandDispatcher::connected(Tcp::Client &client) {
+    logger->info("Connected to %s: %s:%s\n", client.isOperator() ? "operator" : "observer",
+                 client.getClientHostname().c_str(), client.getClientService().c_str());
+}
+
+void CommandDispatcher::promoted(Tcp::Client &client) {
+    logger->info("%s:%s is now the operator\n", client.getClientHostname().c_str(),
+                 client.getClientService().c_str());
+}
+
+void CommandDispatcher::disconnected(Tcp::Client &client, const char *reason) {
+    next_seq.erase(&client);
+    logger->info("Disconnected %s:%s (%s)\n", client.getClientHostname().c_str(),
+                 client.getClientService().c_str(), reason);
+}
@@ -12,6 +12,7 @@
 
 #include "config/config.hpp"
 #include "commands/rpi_pins.hpp"
+#include "sequencer/sequence.hpp"
 #include "visitor/luna_visitor.hpp"
 
 LunaVisitor::LunaVisitor()
@@ -39,28 +40,61 @@ LunaVisitor::LunaVisitor(ConfigMapping& config)
 
 	for (int index = 0; index < gitvc_times_ms.size(); index++)
 		logger.debug("gitvc_times_ms: %d\n", gitvc_times_ms[index]);
+
+	// A [Sequence:gitvc] section overrides the times above
+	char pin_name[MAX_CONFIG_LENGTH];
+	uint8_t pin;
+	if (!loadSequence(config, "gitvc") &&
+	    config.getString("Luna", "gitvc_pin", pin_name, MAX_CONFIG_LENGTH) == 0) {
+		if (parse_pin(pin_name, &pin) == 0)
+			addSequence(buildGITVC(pin));
+		else
+			logger.error("Unknown gitvc_pin %s\n", pin_name);
+	}
+}
+
+sequence LunaVisitor::buildGITVC(uint8_t pin) {
+	sequence seq;
+	timestamp_t offset_ms = time_between_gitvc_ms;
+
+	seq.name = "gitvc";
+	for (int index = 0; index < gitvc_times_ms.size(); index++) {
+		seq.add(offset_ms * 1000000, pin, HIGH);
+		offset_ms += gitvc_times_ms[index];
+		seq.add(offset_ms * 1000000, pin, LOW);
+		offset_ms += gitvc_wait_time_ms;
+	}
+	seq.addAbort(pin, LOW);
+
+	return seq;
 }
 
 void LunaVisitor::visitCommand(COMMAND c) {
     switch (c) {
         case UNSET_DRIVER1: {
 	    logger.info("Writing main valve off using pin %d\n", MAIN_VALVE);
-            bcm2835_gpio_write(MAIN_VALVE, LOW);
+            writePin(MAIN_VALVE, LOW);
             break;
         }
         case SET_DRIVER1: {
 	    logger.info("Writing main valve on using pin %d\n", MAIN_VALVE);
-            bcm2835_gpio_write(MAIN_VALVE, HIGH);
+            writePin(MAIN_VALVE, HIGH);
             break;
         }
         case UNSET_DRIVER2: {
 	    logger.info("Writing pressurization valve off using pin %d\n", PRESSURE_VALVE);
-            bcm2835_gpio_write(PRESSURE_VALVE, LOW);
+            writePin(PRESSURE_VALVE, LOW);
             break;
         }
         case SET_DRIVER2: {
 	    logger.info("Writing pressurization valve on using pin %d\n", PRESSURE_VALVE);
-            bcm2835_gpio_write(PRESSURE_VALVE, HIGH);
+            writePin(PRESSURE_VALVE, HIGH);
+            break;
+        }
+        case START_IGNITION: {
+            WorkerVisitor::visitCommand(c);
+            if (use_gitvc)
+                doGITVC();
             break;
         }
         default: {
@@ -72,5 +106,6 @@ void LunaVisitor::visitCommand(COMMAND c) {
 }
 
 void LunaVisitor::doGITVC() {
-    // TODO
+    logger.info("Starting GITVC\n");
+    runSequence("gitvc");
 }
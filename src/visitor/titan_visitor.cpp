@@ -22,67 +22,63 @@ TitanVisitor::TitanVisitor()
 TitanVisitor::TitanVisitor(ConfigMapping& config)
     : WorkerVisitor(config)
 {
-
+    // The presets are sequences, e.g. [Sequence:titan_fill]
+    loadSequence(config, "titan_leak_check");
+    loadSequence(config, "titan_fill");
+    loadSequence(config, "titan_fill_idle");
+    loadSequence(config, "titan_def");
 }
 
 void TitanVisitor::visitCommand(COMMAND c) {
     switch (c) {
         case UNSET_DRIVER1: {
 	    logger.info("Writing main feed line fill valve off using pin %d\n", MAIN_FEED_VALVE);
-            bcm2835_gpio_write(MAIN_FEED_VALVE, LOW);
+            writePin(MAIN_FEED_VALVE, LOW);
             break;
         }
         case SET_DRIVER1: {
 	    logger.info("Writing main feed line fill valve on using pin %d\n", MAIN_FEED_VALVE);
-            bcm2835_gpio_write(MAIN_FEED_VALVE, HIGH);
+            writePin(MAIN_FEED_VALVE, HIGH);
             break;
         }
         case UNSET_DRIVER2: {
             logger.info("Turning oxidizer tank valve off using pin %d\n", OXI_VALVE);
-            bcm2835_gpio_write(OXI_VALVE, LOW);
+            writePin(OXI_VALVE, LOW);
             break;
         }
         case SET_DRIVER2: {
             logger.info("Turning oxidizer tank valve on using pin %d\n", OXI_VALVE);
-            bcm2835_gpio_write(OXI_VALVE, HIGH);
+            writePin(OXI_VALVE, HIGH);
             break;
         }
         case UNSET_DRIVER3: {
 	    logger.info("Writing ground vent valve off using pin %d\n", GROUND_VENT_VALVE);
-            bcm2835_gpio_write(GROUND_VENT_VALVE, LOW);
+            writePin(GROUND_VENT_VALVE, LOW);
             break;
         }
         case SET_DRIVER3: {
 	    logger.info("Writing ground vent valve on using pin %d\n", GROUND_VENT_VALVE);
-            bcm2835_gpio_write(GROUND_VENT_VALVE, HIGH);
+            writePin(GROUND_VENT_VALVE, HIGH);
             break;
         }
         case TITAN_LEAK_CHECK: {
             logger.info("Entering leak check preset\n");
-            // bcm2835_gpio_write(MAIN_VALVE, HIGH);
-            // bcm2835_gpio_write(VENT_VALVE, HIGH);
-            // bcm2835_gpio_write(TANK_VALVE, HIGH);
+            runSequence("titan_leak_check");
             break;
         }
         case TITAN_FILL: {
             logger.info("Entering fill preset\n");
-            // bcm2835_gpio_write(MAIN_VALVE, HIGH);
-            // bcm2835_gpio_write(VENT_VALVE, HIGH);
-            // bcm2835_gpio_write(TANK_VALVE, LOW);
+            runSequence("titan_fill");
             break;
         }
         case TITAN_FILL_IDLE: {
             logger.info("Entering fill idle preset\n");
-            // bcm2835_gpio_write(MAIN_VALVE, LOW);
-            // bcm2835_gpio_write(VENT_VALVE, HIGH);
-            // bcm2835_gpio_write(TANK_VALVE, HIGH);
+            runSequence("titan_fill_idle");
             break;
         }
         case TITAN_DEF: {
             logger.info("Entering default preset\n");
-            // bcm2835_gpio_write(MAIN_VALVE, LOW);
-            // bcm2835_gpio_write(VENT_VALVE, LOW);
-            // bcm2835_gpio_write(TANK_VALVE, HIGH);
+            runSequence("titan_def");
             break;
         }
         default: {
@@ -14,16 +14,20 @@
 #include <cstdio>
 #include <stdint.h>
 #include <time.h>
+#include <string>
 #include <thread>
 
 #include "config/config.hpp"
 #include "commands/rpi_pins.hpp"
 #include "logger/logger.hpp"
+#include "sequencer/sequence.hpp"
+#include "sequencer/sequencer.hpp"
+#include "sequencer/valve_state.hpp"
 #include "time/time.hpp"
 #include "visitor/worker_visitor.hpp"
 
 // Forward declaration for use in constructor
-static void ignThreadFunc(timestamp_t, timestamp_t, timestamp_t, bool);
+static void ignThreadFunc(timestamp_t, timestamp_t, timestamp_t, bool, sequencer *);
 
 const char *command_names[NUM_COMMANDS] = {
     "UNSET_DRIVER1",
@@ -46,7 +50,7 @@ const char *command_names[NUM_COMMANDS] = {
     "TITAN_TAPE_ON",
     "TITAN_TAPE_OFF",
     "TITAN_DEF",
-	"RESERVED",
+	"REQUEST_RETRANSMIT",
 	"RESERVED",
 	"RESERVED",
 	"RESERVED",
@@ -62,6 +66,8 @@ const char *command_names[NUM_COMMANDS] = {
 
 WorkerVisitor::WorkerVisitor()
     : config(ConfigMapping())
+    , last_actuation_ns(0)
+    , sequence_runner(&valves)
     , logger("Visitor Logger", "Visitor_Logger", LogLevel::DEBUG)
 {
     // TODO have this at all?
@@ -69,6 +75,8 @@ WorkerVisitor::WorkerVisitor()
 
 WorkerVisitor::WorkerVisitor(ConfigMapping& config)
     : config(config)
+    , last_actuation_ns(0)
+    , sequence_runner(&valves)
     , logger("Visitor Logger", "Visitor_Logger", LogLevel::DEBUG)
 {
 	config.getInt("Worker", "preignite_ms", &preignite_ms);
@@ -84,70 +92,101 @@ WorkerVisitor::WorkerVisitor(ConfigMapping& config)
     ignitionOn.store(false);
 
     // Create a persistent ignition monitor thread
-    std::thread t(ignThreadFunc, hotflow_ms, preignite_ms, pressureshutoff_ms, enableShutoff);
+    std::thread t(ignThreadFunc, hotflow_ms, preignite_ms, pressureshutoff_ms, enableShutoff, &sequence_runner);
     t.detach();
 }
 
 static Logger ignThreadLogger = Logger("Ign Thread", "IgnThreadLog", LogLevel::DEBUG);
 
-static void ignThreadFunc(timestamp_t time, timestamp_t preigniteTime, timestamp_t pressureShutoffDelay, bool enableShutoff) {
+static void ignThreadFunc(timestamp_t time, timestamp_t preigniteTime, timestamp_t pressureShutoffDelay, bool enableShutoff,
+                          sequencer *sequenceRunner) {
     ignThreadLogger.info("Ignition monitor thread started\n");
-    set_start_time();
 
-    bool mainOpen; // will flip true once preigniteTime elapses
-    timestamp_t initTime, timeElapsed;
+    bool mainOpen, armed, pressureStop;
+    timestamp_t initTime, openAt, armAt, endAt, now, next, signalled, closedAt;
+    pin_masks shutdown;
+
+    // The main valve and igniter go off together
+    shutdown.add(MAIN_VALVE, LOW);
+    shutdown.add(IGN_START, LOW);
 
     // Main thread loop, runs forever
     while (true) {
         ignThreadLogger.info("Monitor thread waiting for burn...\n");
 
-        // Wait until the main worker thread indicates the start of a burn
+        // Sleep until the main worker thread indicates the start of a burn
         while (!ignitionOn.load()) {
-            // Sleep for a bit so we're not checking every cycle
-            std::this_thread::sleep_for(std::chrono::milliseconds(IGN_CHECK_MS));
+            ignitionWakeup.wait_until(0);
         }
 
-        ignThreadLogger.info("Received burn signal, starting burn\n");
-
-        // Keep track of ignition time
-        initTime = get_elapsed_time_ms();
-        timeElapsed = 0;
+        // Every step of the burn has an absolute deadline from the start
+        initTime = wakeup::now_ns();
+        openAt = initTime + preigniteTime * 1000000;
+        armAt = initTime + pressureShutoffDelay * 1000000;
+        endAt = initTime + time * 1000000;
+        mainOpen = false;
+        armed = false;
+        pressureStop = false;
 
         // Write HIGH to the ignition pin
-        bcm2835_gpio_write(IGN_START, HIGH);
+        valves.write(IGN_START, HIGH);
+        ignThreadLogger.info("Received burn signal, starting burn %llu ns after it was sent\n",
+                             (unsigned long long)(wakeup::now_ns() - ignitionWakeup.last_notified()));
 
-        // Loop while there is time left for ignition
-        while (timeElapsed < time) {
+        // Sleep until the next deadline, unless woken by a stop or a pressure shutoff
+        while ((now = wakeup::now_ns()) < endAt) {
             // Check if the main valve should be opened
-            if (!mainOpen && timeElapsed > preigniteTime) {
-                bcm2835_gpio_write(MAIN_VALVE, HIGH);
+            if (!mainOpen && now >= openAt) {
+                valves.write(MAIN_VALVE, HIGH);
                 mainOpen = true;
-                ignThreadLogger.info("Preignite time elapsed, opening main valve.\n");
+                ignThreadLogger.info("Preignite time elapsed, opened main valve %llu ns late.\n",
+                                     (unsigned long long)(wakeup::now_ns() - openAt));
             }
-            
+
+            armed = enableShutoff && now >= armAt;
+
             // Check if pressure shutoff has been indicated from the sensor thread
-            if (timeElapsed > pressureShutoffDelay && enableShutoff && pressureShutoff.load()) {
-                ignThreadLogger.info("Pressure shutoff indicated, closing valve and ending burn.\n");
+            if (armed && pressureShutoff.load()) {
+                pressureStop = true;
                 break;
             }
 
             // Check ignitionOn to see if we should stop the burn
             if (!ignitionOn.load()) {
-                // Main thread has indicated an ignition stop, so close everything
-                ignThreadLogger.info("Emergency stop indicated, closing valve and ending burn.\n");
                 break;
             }
 
-            // Sleep for a bit so we're not checking every cycle
-            std::this_thread::sleep_for(std::chrono::milliseconds(IGN_CHECK_MS));
-            timeElapsed = get_elapsed_time_ms() - initTime;
+            next = endAt;
+            if (!mainOpen && openAt < next)
+                next = openAt;
+            if (enableShutoff && !armed && armAt < next)
+                next = armAt;
+
+            ignitionWakeup.wait_until(next);
         }
 
-        // Burn time has elapsed, shut it off and indicate
-        bcm2835_gpio_write(MAIN_VALVE, LOW);
-        bcm2835_gpio_write(IGN_START, LOW);
+        // Burn time has elapsed or the burn was stopped, shut it off and indicate.
+        // A sequence still playing could open the valves again, so stop it too.
+        valves.apply(shutdown);
+        sequenceRunner->abort();
+        closedAt = wakeup::now_ns();
         ignitionOn.store(false);
-        mainOpen = false;
+
+        // A trip from before the shutoff was armed is only acted on once it is
+        signalled = ignitionWakeup.last_notified();
+        if (pressureStop && signalled < armAt)
+            signalled = armAt;
+
+        if (pressureStop) {
+            ignThreadLogger.info("Pressure shutoff indicated, closed valve %llu ns after the trip.\n",
+                                 (unsigned long long)(closedAt - signalled));
+        } else if (now < endAt) {
+            ignThreadLogger.info("Emergency stop indicated, closed valve %llu ns after the stop.\n",
+                                 (unsigned long long)(closedAt - signalled));
+        } else {
+            ignThreadLogger.info("Burn time elapsed, closed valve %llu ns late.\n",
+                                 (unsigned long long)(closedAt - endAt));
+        }
         ignThreadLogger.info("Burn has ended.\n");
     }
 
@@ -159,62 +198,62 @@ void WorkerVisitor::visitCommand(COMMAND c) {
     switch (c) {
         case UNSET_DRIVER1: {
 	    logger.info("Writing driver 1 off using pin %d\n", DRIVER1);
-            bcm2835_gpio_write(DRIVER1, LOW);
+            writePin(DRIVER1, LOW);
             break;
         }
         case SET_DRIVER1: {
 	    logger.info("Writing driver 1 on using pin %d\n", DRIVER1);
-            bcm2835_gpio_write(DRIVER1, HIGH);
+            writePin(DRIVER1, HIGH);
             break;
         }
         case UNSET_DRIVER2: {
 	    logger.info("Writing driver 2 off using pin %d\n", DRIVER2);
-            bcm2835_gpio_write(DRIVER2, LOW);
+            writePin(DRIVER2, LOW);
             break;
         }
         case SET_DRIVER2: {
 	    logger.info("Writing driver 2 on using pin %d\n", DRIVER2);
-            bcm2835_gpio_write(DRIVER2, HIGH);
+            writePin(DRIVER2, HIGH);
             break;
         }
         case UNSET_DRIVER3: {
 	    logger.info("Writing driver 3 off using pin %d\n", DRIVER3);
-            bcm2835_gpio_write(DRIVER3, LOW);
+            writePin(DRIVER3, LOW);
             break;
         }
         case SET_DRIVER3: {
 	    logger.info("Writing driver 3 on using pin %d\n", DRIVER3);
-            bcm2835_gpio_write(DRIVER3, HIGH);
+            writePin(DRIVER3, HIGH);
             break;
         }
         case UNSET_DRIVER4: {
 	    logger.info("Writing driver 4 off using pin %d\n", DRIVER4);
-            bcm2835_gpio_write(DRIVER4, LOW);
+            writePin(DRIVER4, LOW);
             break;
         }
         case SET_DRIVER4: {
 	    logger.info("Writing driver 4 on using pin %d\n", DRIVER4);
-            bcm2835_gpio_write(DRIVER4, HIGH);
+            writePin(DRIVER4, HIGH);
             break;
         }
         case UNSET_DRIVER5: {
 	    logger.info("Writing driver 5 off using pin %d\n", DRIVER5);
-            bcm2835_gpio_write(DRIVER5, LOW);
+            writePin(DRIVER5, LOW);
             break;
         }
         case SET_DRIVER5: {
 	    logger.info("Writing driver 5 on using pin %d\n", DRIVER5);
-            bcm2835_gpio_write(DRIVER5, HIGH);
+            writePin(DRIVER5, HIGH);
             break;
         }
         case UNSET_DRIVER6: {
 	    logger.info("Writing driver 6 off using pin %d\n", DRIVER6);
-            bcm2835_gpio_write(DRIVER6, LOW);
+            writePin(DRIVER6, LOW);
             break;
         }
         case SET_DRIVER6: {
 	    logger.info("Writing driver 6 on using pin %d\n", DRIVER6);
-            bcm2835_gpio_write(DRIVER6, HIGH);
+            writePin(DRIVER6, HIGH);
             break;
         }
         case START_IGNITION: {
@@ -225,11 +264,15 @@ void WorkerVisitor::visitCommand(COMMAND c) {
         case STOP_IGNITION: {
             logger.info("Stopping ignition\n");
             ignitionOn.store(false);
+            ignitionWakeup.notify();
+            sequence_runner.abort();
 
             // NOTE: in theory, we don't need to do this, because it happens in the thread,
             // but better safe than sorry
-            bcm2835_gpio_write(MAIN_VALVE, LOW);
-            bcm2835_gpio_write(IGN_START, LOW);
+            pin_masks masks;
+            masks.add(MAIN_VALVE, LOW);
+            masks.add(IGN_START, LOW);
+            writePins(masks);
 
             break;
         }
@@ -240,7 +283,65 @@ void WorkerVisitor::visitCommand(COMMAND c) {
     }
 }
 
+void WorkerVisitor::writePin(uint8_t pin, uint8_t level) {
+    valves.write(pin, level);
+    last_actuation_ns = get_elapsed_time_ns();
+}
+
+void WorkerVisitor::writePins(const pin_masks& masks) {
+    valves.apply(masks);
+    last_actuation_ns = get_elapsed_time_ns();
+}
+
+bool WorkerVisitor::loadSequence(ConfigMapping& config, const char *name) {
+    sequence seq;
+
+    if (!config.isPresent((std::string("Sequence:") + name).c_str(), "step"))
+        return false;
+
+    if (seq.load(config, name) != 0) {
+        logger.error("Sequence %s is malformed, not loaded\n", name);
+        return false;
+    }
+
+    logger.debug("Loaded sequence %s, %u steps\n", name, (unsigned)seq.steps.size());
+    sequences[name] = seq;
+    return true;
+}
+
+void WorkerVisitor::addSequence(const sequence& seq) {
+    sequences[seq.name] = seq;
+}
+
+bool WorkerVisitor::runSequence(const char *name) {
+    std::map<std::string, sequence>::iterator it = sequences.find(name);
+
+    if (it == sequences.end()) {
+        logger.error("No sequence %s configured\n", name);
+        return false;
+    }
+
+    if (!sequence_runner.start(&it->second)) {
+        if (sequence_runner.isHeld())
+            logger.error("Sequence %s not started, an interlock rule is tripped\n", name);
+        else
+            logger.error("Sequence %s not started, another is still running\n", name);
+        return false;
+    }
+
+    return true;
+}
+
+timestamp_t WorkerVisitor::getLastActuation() {
+    return last_actuation_ns;
+}
+
+sequencer *WorkerVisitor::getSequencer() {
+    return &sequence_runner;
+}
+
 void WorkerVisitor::doIgn() {
-    ignitionOn.store(true);
     pressureShutoff.store(false);
+    ignitionOn.store(true);
+    ignitionWakeup.notify();
 }
@@ -0,0 +1,70 @@
+/**
+ * @file adc_bench.cpp
+ * @brief Compares per-sensor and batched ADC reads against the mock SPI bus.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <cstdlib>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "adc/adc.hpp"
+
+// Number of ticks of the load cell group to time for each method
+#define DEFAULT_TICKS 1000000
+
+static uint64_t now_ns() {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+static void report(const char *method, uint64_t elapsed_ns, uint32_t ticks,
+    uint8_t num_sensors)
+{
+	double ns_per_tick = (double)elapsed_ns / ticks;
+
+	printf("%-12s %8.1f ns/tick %8.1f ns/reading %10.0f readings/s max\n",
+	    method, ns_per_tick, ns_per_tick / num_sensors,
+	    1e9 / (ns_per_tick / num_sensors));
+}
+
+int main(int argc, char **argv) {
+	uint8_t lcs[5] = {LC1, LC2, LC3, LC4, LC5};
+	uint16_t readings[5];
+	uint32_t ticks = argc > 1 ? std::atoi(argv[1]) : DEFAULT_TICKS;
+	uint64_t start, single_ns, batch_ns, checksum = 0;
+	adc_reader reader;
+
+	for (int i = 0; i < 5; i++)
+		reader.add_adc_info(lcs[i], SENSOR_PINS[lcs[i]], SENSOR_CHANNELS[lcs[i]]);
+
+	printf("Reading %d load cells for %u ticks (mock SPI bus)\n", 5, ticks);
+
+	start = now_ns();
+	for (uint32_t t = 0; t < ticks; t++) {
+		for (int i = 0; i < 5; i++)
+			checksum += reader.read_item(lcs[i]);
+	}
+	single_ns = now_ns() - start;
+
+	start = now_ns();
+	for (uint32_t t = 0; t < ticks; t++) {
+		reader.read_items(lcs, 5, readings);
+		for (int i = 0; i < 5; i++)
+			checksum -= readings[i];
+	}
+	batch_ns = now_ns() - start;
+
+	report("read_item", single_ns, ticks, 5);
+	report("read_items", batch_ns, ticks, 5);
+	printf("Speedup: %.2fx\n", (double)single_ns / batch_ns);
+
+	/* Both methods read the same values, so the checksum cancels out */
+	return checksum == 0 ? 0 : 1;
+}
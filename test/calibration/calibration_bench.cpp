@@ -0,0 +1,53 @@
+/**
+ * @file calibration_bench.cpp
+ * @brief Times the calibration kernel against the scalar loop, per reading.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <cstdlib>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+#include "calibration/calibration.hpp"
+#include "time/time.hpp"
+
+// Readings converted per round, one of every ADC count
+#define BENCH_READINGS 4096
+
+// Number of rounds to convert
+#define DEFAULT_ROUNDS 1000
+
+int main(int argc, char **argv) {
+	uint32_t rounds = argc > 1 ? std::atoi(argv[1]) : DEFAULT_ROUNDS;
+	std::vector<uint16_t> raw(BENCH_READINGS);
+	std::vector<float> out(BENCH_READINGS);
+	timestamp_t start, fast, slow;
+	double checksum = 0;
+
+	for (size_t index = 0; index < raw.size(); index++)
+		raw[index] = index % 4096;
+
+	start = get_elapsed_time_ns();
+	for (uint32_t round = 0; round < rounds; round++) {
+		calibrate_block(raw.data(), out.data(), raw.size(), 0.378, -250.33);
+		checksum += out[round % raw.size()];
+	}
+	fast = get_elapsed_time_ns() - start;
+
+	start = get_elapsed_time_ns();
+	for (uint32_t round = 0; round < rounds; round++) {
+		calibrate_block_scalar(raw.data(), out.data(), raw.size(), 0.378, -250.33);
+		checksum += out[round % raw.size()];
+	}
+	slow = get_elapsed_time_ns() - start;
+
+	printf("%s: %.2f ns per reading, scalar: %.2f ns per reading (checksum %.1f)\n",
+	    calibrate_kernel(), (double)fast / rounds / raw.size(),
+	    (double)slow / rounds / raw.size(), checksum);
+
+	return (0);
+}
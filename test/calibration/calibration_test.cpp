@@ -0,0 +1,67 @@
+/**
+ * @file calibration_test.cpp
+ * @brief Basic functionality test for calibration.hpp.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "calibration/calibration.hpp"
+#include "libtest/libtest.hpp"
+
+int test_kernel_matches_scalar(void *args) {
+    std::vector<uint16_t> raw(80);
+    std::vector<float> fast(80), slow(80);
+    bool match = true;
+
+    for (size_t index = 0; index < raw.size(); index++)
+        raw[index] = rand() % 4096;
+
+    /* Every length and misalignment, so each tail case is covered */
+    for (size_t offset = 0; offset < 4; offset++) {
+        for (size_t n = 0; n + offset <= raw.size(); n++) {
+            calibrate_block(&raw[offset], &fast[offset], n, -0.2834, 1020.2);
+            calibrate_block_scalar(&raw[offset], &slow[offset], n, -0.2834, 1020.2);
+
+            for (size_t index = offset; index < offset + n; index++)
+                match &= fast[index] == slow[index];
+        }
+    }
+
+    printf("Kernel: %s\n", calibrate_kernel());
+    assert_true(match, "Kernel matches scalar");
+
+    return (0);
+}
+
+int test_table(void *args) {
+    calibration_table table;
+    uint16_t raw[] = {0, 1000, 4095};
+    float values[3];
+
+    assert_true(table.convert(SENSOR::TC1, 1234) == 1234, "Raw counts by default");
+
+    table.set(SENSOR::PT1, 0.5, -10);
+    assert_true(table.getSlope(SENSOR::PT1) == 0.5 && table.getYint(SENSOR::PT1) == -10, "Set");
+    assert_true(table.convert(SENSOR::PT1, 100) == 40, "Single reading");
+
+    table.convert(SENSOR::PT1, raw, values, 3);
+    assert_true(values[0] == -10 && values[1] == 490 && values[2] == 2037.5, "Block of readings");
+
+    return (0);
+}
+
+int main() {
+    testlib_init("Calibration");
+
+    test("Kernel matches scalar", &test_kernel_matches_scalar, NULL);
+    test("Table", &test_table, NULL);
+
+    return (testlib_shutdown());
+}
@@ -0,0 +1,322 @@
+/**
+ * @file circular_buffer_test.cpp
+ * @brief Basic functionality test for ring_buffer.hpp, circular_buffer.hpp and
+ *        packet.hpp.
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ */
+
+#include <stdint.h>
+#include <thread>
+
+#include "circular_buffer/circular_buffer.hpp"
+#include "circular_buffer/packet.hpp"
+#include "circular_buffer/ring_buffer.hpp"
+#include "libtest/libtest.hpp"
+
+// Number of items passed between threads in the concurrency test
+#define NUM_THREADED_ITEMS 100000
+
+int test_capacity(void *args) {
+    ring_buffer<uint32_t> ring(10);
+
+    assert_equals(ring.capacity(), 16, "Capacity rounds up to a power of two");
+    assert_equals(ring.size(), 0, "New ring is empty");
+    assert_null(ring.peek(), "Nothing to peek in an empty ring");
+
+    return (0);
+}
+
+int test_bulk_wrap(void *args) {
+    ring_buffer<uint32_t> ring(16);
+    uint32_t in[32], out[32];
+    int in_order = 1;
+
+    for (int i = 0; i < 32; i++)
+        in[i] = i;
+
+    assert_equals(ring.push(in, 12), 12, "Push 12 items");
+    assert_equals(ring.pop(out, 10), 10, "Pop 10 items");
+    assert_equals(out[9], 9, "Popped items are in order");
+
+    /* These 12 wrap around the end of the storage */
+    assert_equals(ring.push(in + 12, 12), 12, "Push 12 items across the end");
+    assert_equals(ring.size(), 14, "14 items waiting");
+    assert_equals(ring.pop(out, 32), 14, "Pop everything");
+    for (int i = 0; i < 14; i++)
+        in_order &= (out[i] == (uint32_t)(i + 10));
+    assert_true(in_order, "Wrapped items come out in order");
+
+    assert_equals(ring.push(in, 20), 16, "Only 16 items fit");
+    assert_equals(ring.getDrops(), 4, "The other 4 are counted as drops");
+    assert_equals(ring.getMaxDepth(), 16, "Max depth is the capacity");
+    assert_false(ring.push(in[0]), "Single push into a full ring fails");
+
+    return (0);
+}
+
+int test_packets(void *args) {
+    circular_buffer buffer(SENSOR::PT1, 16);
+    uint8_t packet[260];
+    uint8_t *bufptr = packet;
+    struct data_header *header = (struct data_header *)packet;
+    struct data_item item;
+    int in_order = 1;
+
+    for (int i = 0; i < 16; i++)
+        buffer.push_data_item(i, 1000 + i);
+
+    assert_equals((int)buffer.push_data_item(16, 1016), (int)BUFF_STATUS::FULL,
+            "Pushing into a full buffer reports FULL");
+
+    assert_equals(buffer.get_data(&bufptr, 260), 260, "A full packet is 260 bytes");
+    assert_equals(header->sensor, SENSOR::PT1, "Header has the sensor");
+    assert_equals(header->length, 260, "Header has the length");
+
+    for (int i = 0; i < 16; i++) {
+        struct data_item *d = (struct data_item *)(packet + 4 + 16 * i);
+        in_order &= (d->reading == i && d->timestamp == (timestamp_t)(1000 + i));
+    }
+    assert_true(in_order, "Packet items are in order");
+
+    assert_equals((int)buffer.pop_data_item((uint8_t *)&item), (int)BUFF_STATUS::EMPTY,
+            "Buffer is empty after get_data");
+    assert_equals(buffer.get_data(&bufptr, 260), 4, "Empty packet is just a header");
+
+    return (0);
+}
+
+/* Encode items as a compact packet and check that they decode unchanged */
+static int roundtrip(struct data_item *items, uint16_t count, uint8_t flags) {
+    uint8_t packet[260];
+    struct data_item decoded[64];
+    uint16_t length, decoded_count = 0;
+    SENSOR sensor;
+    int same = 1;
+
+    uint32_t seq = 0;
+
+    length = encode_compact(SENSOR::TC2, 77, items, count, packet, 260);
+    assert_true(length > 0, "Packet encoded");
+    assert_equals(((struct compact_header *)packet)->flags, flags, "Expected time encoding");
+
+    assert_equals(decode_packet(packet, length, &sensor, decoded, 64, &decoded_count, &seq),
+            length, "Packet decoded");
+    assert_equals(sensor, SENSOR::TC2, "Sensor survives");
+    assert_equals(seq, 77, "Packet number survives");
+    assert_equals(decoded_count, count, "Sample count survives");
+    for (int i = 0; i < count; i++)
+        same &= (decoded[i].reading == items[i].reading &&
+                 decoded[i].seq == items[i].seq &&
+                 decoded[i].timestamp == items[i].timestamp);
+    assert_true(same, "Readings and timestamps survive");
+
+    assert_equals(decode_packet(packet, length - 1, &sensor, decoded, 64, &decoded_count),
+            0, "Truncated packet is rejected");
+
+    return (length);
+}
+
+int test_compact(void *args) {
+    struct data_item items[32];
+    uint16_t capacity = packet_capacity(PACKET_FORMAT::COMPACT, 260);
+
+    assert_true(capacity >= 32, "32 samples always fit in 260 bytes");
+
+    for (int i = 0; i < 32; i++) {
+        items[i].reading = (i * 131) & 0xFFF;
+        items[i].seq = 1000 + i;
+        items[i].timestamp = 5000000 + i * 500;
+    }
+    assert_equals(roundtrip(items, 32, COMPACT_IMPLICIT_PERIOD), 24 + 4 + 48,
+            "Evenly spaced samples only store the period");
+
+    items[7].timestamp += 3;
+    assert_equals(roundtrip(items, 31, 0), 24 + 30 * 2 + 47,
+            "Jittery samples store 16-bit deltas");
+
+    items[20].timestamp += 100000;
+    roundtrip(items, 32, COMPACT_WIDE_DELTAS);
+
+    /* A step back of the clock still encodes */
+    items[3].timestamp -= 2000;
+    roundtrip(items, 32, COMPACT_WIDE_DELTAS);
+    roundtrip(items, 1, 0);
+
+    return (0);
+}
+
+int test_compact_buffer(void *args) {
+    circular_buffer buffer(SENSOR::LC3, 32, PACKET_FORMAT::COMPACT);
+    uint8_t packet[260], legacy[260];
+    uint8_t *bufptr = packet, *legacyptr = legacy;
+    struct data_item decoded[64];
+    uint16_t length, count = 0;
+    uint32_t seq;
+    SENSOR sensor;
+
+    for (int i = 0; i < 32; i++)
+        buffer.push_data_item(4095 - i, 100 + i * 50);
+
+    length = buffer.get_data(&bufptr, 260);
+    assert_equals(length, 24 + 4 + 48, "Full compact packet");
+    assert_equals(buffer.size(), 0, "All the samples were taken");
+    assert_equals(decode_packet(packet, length, &sensor, decoded, 64, &count), length,
+            "Compact packet decodes");
+    assert_equals(decoded[31].reading, 4064, "Last reading survives");
+    assert_equals(decoded[31].timestamp, 100 + 31 * 50, "Last timestamp survives");
+    assert_equals(decoded[31].seq, 31, "Samples are numbered from 0");
+
+    for (int i = 0; i < 3; i++)
+        buffer.push_data_item(i, 2000 + i);
+    bufptr = packet;
+    length = buffer.get_data(&bufptr, 260);
+    assert_equals(decode_packet(packet, length, &sensor, decoded, 64, &count, &seq), length,
+            "Second compact packet decodes");
+    assert_equals(seq, 1, "Packets are numbered");
+    assert_equals(decoded[0].seq, 32, "Sample numbers carry on across packets");
+
+    /* Legacy packets go through the same decoder */
+    circular_buffer old(SENSOR::LC3, 16);
+    for (int i = 0; i < 16; i++)
+        old.push_data_item(i, i);
+    length = old.get_data(&legacyptr, 260);
+    assert_equals(decode_packet(legacy, length, &sensor, decoded, 64, &count), 260,
+            "Legacy packet decodes");
+    assert_equals(count, 16, "Legacy packet has 16 samples");
+    assert_equals(decoded[15].seq, 15, "Legacy samples are numbered");
+
+    return (0);
+}
+
+int test_latency(void *args) {
+    circular_buffer buffer(SENSOR::TC1, 16);
+
+    assert_false(buffer.due(1000000), "Empty buffer is never due");
+
+    buffer.push_data_item(1, 1000);
+    assert_false(buffer.due(1000000), "No latency bound by default");
+
+    buffer.setMaxLatency(100000);
+    assert_false(buffer.due(100999), "Not due before the bound");
+    assert_true(buffer.due(101000), "Due once the oldest item is old enough");
+
+    return (0);
+}
+
+int test_frames(void *args) {
+    uint8_t datagram[FRAME_ETHERNET_PAYLOAD];
+    uint8_t packet[260];
+    const uint8_t *section;
+    uint16_t length;
+    frame_writer writer;
+    frame_reader reader;
+    SENSOR sensor;
+    int added = 0;
+
+    for (int i = 0; i < 260; i++)
+        packet[i] = i;
+
+    writer.reset(datagram, FRAME_ETHERNET_PAYLOAD);
+    while (writer.add((SENSOR)added, packet, 260 - added))
+        added++;
+    assert_equals(added, 5, "Five 260-byte packets fit in 1472 bytes");
+    assert_equals(writer.sections(), 5, "Five sections");
+    assert_true(writer.length() <= FRAME_ETHERNET_PAYLOAD, "Datagram fits");
+
+    assert_true(reader.reset(datagram, writer.length()), "Datagram is well formed");
+    for (int i = 0; i < 5; i++) {
+        assert_true(reader.next(&sensor, &section, &length), "Section is readable");
+        assert_equals(sensor, i, "Sections keep their sensor");
+        assert_equals(length, 260 - i, "Sections keep their length");
+        assert_equals(section[length - 1], (uint8_t)(length - 1), "Sections keep their bytes");
+    }
+    assert_false(reader.next(&sensor, &section, &length), "No sixth section");
+
+    assert_true(reader.reset(datagram, writer.length() - 1), "Header of a truncated datagram");
+    for (int i = 0; i < 4; i++)
+        reader.next(&sensor, &section, &length);
+    assert_false(reader.next(&sensor, &section, &length), "Truncated section is rejected");
+
+    /* A bare packet reads as a single section */
+    packet[0] = SENSOR::PT3;
+    assert_true(reader.reset(packet, 260), "Bare packet");
+    assert_true(reader.next(&sensor, &section, &length), "Bare packet is one section");
+    assert_equals(sensor, SENSOR::PT3, "Bare packet's sensor");
+    assert_equals(length, 260, "Bare packet's length");
+
+    return (0);
+}
+
+static void produce(ring_buffer<uint32_t> *ring) {
+    for (uint32_t i = 0; i < NUM_THREADED_ITEMS; ) {
+        if (ring->push(i))
+            i++;
+        else
+            std::this_thread::yield();
+    }
+}
+
+int test_threads(void *args) {
+    ring_buffer<uint32_t> *ring = new ring_buffer<uint32_t>(64);
+    uint32_t out[16], expected = 0, n;
+    int in_order = 1;
+
+    std::thread producer(produce, ring);
+
+    while (expected < NUM_THREADED_ITEMS) {
+        n = ring->pop(out, 16);
+        if (n == 0)
+            std::this_thread::yield();
+        for (uint32_t i = 0; i < n; i++)
+            in_order &= (out[i] == expected++);
+    }
+
+    producer.join();
+
+    assert_true(in_order, "Every item arrives once and in order");
+    assert_equals(ring->size(), 0, "Ring is empty at the end");
+
+    delete ring;
+    return (0);
+}
+
+int test_alignment(void *args) {
+    ring_buffer<uint32_t> *ring = new ring_buffer<uint32_t>(64);
+    circular_buffer *buffer = new circular_buffer(SENSOR::PT1, 16);
+    bool aligned = true;
+
+    /* Allocate a few, since any one may land on a line by chance */
+    for (int i = 0; i < 8; i++) {
+        circular_buffer *other = new circular_buffer(SENSOR::PT1, 16);
+
+        aligned &= (uintptr_t)other % CACHE_LINE_SIZE == 0;
+        delete other;
+    }
+
+    assert_true((uintptr_t)ring % CACHE_LINE_SIZE == 0, "Ring buffer on a cache line");
+    assert_true((uintptr_t)buffer % CACHE_LINE_SIZE == 0 && aligned, "Circular buffer on a cache line");
+
+    delete ring;
+    delete buffer;
+    return (0);
+}
+
+int main() {
+    testlib_init("Circular Buffer");
+
+    test("Capacity", &test_capacity, NULL);
+    test("Bulk push/pop with wrap-around", &test_bulk_wrap, NULL);
+    test("Packets", &test_packets, NULL);
+    test("Compact packet roundtrip", &test_compact, NULL);
+    test("Compact packets from a buffer", &test_compact_buffer, NULL);
+    test("Maximum latency", &test_latency, NULL);
+    test("Multi-sensor datagrams", &test_frames, NULL);
+    test("Producer/consumer threads", &test_threads, NULL);
+    test("Cache line alignment", &test_alignment, NULL);
+
+    return (testlib_shutdown());
+}
@@ -12,6 +12,8 @@
 
 #include <cstring>
 #include <iostream>
+#include <string>
+#include <vector>
 
 #include "config/config.hpp"
 #include "libtest/libtest.hpp"
@@ -59,12 +61,24 @@ int test_get_int(void *args) {
     return (0);
 }
 
+int test_get_strings(void *args) {
+    std::vector<std::string> steps;
+
+    assert_equals(config.getStrings("Sequence:test", "step", &steps), 0,
+		    "Get repeated key step from Sequence:test");
+    assert_equals(steps.size(), 2, "Every value kept");
+    assert_equals(steps[1].compare("1500,DRIVER1,low"), 0, "Values in file order");
+
+    return (0);
+}
+
 int main() {
     testlib_init("Config Parser");
 
     test ("readFrom", &test_bad_config, NULL);
     test("Get String", &test_get_string, NULL);
     test("Get Int", &test_get_int, NULL);
+    test("Get Strings", &test_get_strings, NULL);
 
     return (testlib_shutdown());
 }
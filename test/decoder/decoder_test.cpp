@@ -0,0 +1,205 @@
+/**
+ * @file decoder_test.cpp
+ * @brief Basic functionality test for decoder.hpp.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "calibration/calibration.hpp"
+#include "circular_buffer/circular_buffer.hpp"
+#include "decoder/decoder.hpp"
+#include "libtest/libtest.hpp"
+#include "recorder/recorder.hpp"
+#include "sequencer/valve_state.hpp"
+
+#define RECORDING "decoder_test.rec"
+#define LEGACY_LOG "decoder_test.log"
+#define CHANNELS 3
+#define ITEMS 16
+#define PACKETS 4000
+
+static const char *names[CHANNELS] = {"LC1", "PT1", "Valves"};
+
+/*
+ * Builds a legacy packet of a sensor whose sample n is taken at n ms and
+ * reads n % 4096.
+ */
+static uint16_t fill(uint8_t *packet, SENSOR sensor, uint32_t index) {
+    struct data_header header;
+    struct data_item item;
+
+    header.sensor = sensor;
+    header.seq = index;
+    header.length = sizeof(header) + ITEMS * sizeof(item);
+    memcpy(packet, &header, sizeof(header));
+
+    memset(&item, 0, sizeof(item));
+    for (uint32_t n = 0; n < ITEMS; n++) {
+        item.seq = index * ITEMS + n;
+        item.reading = item.seq % 4096;
+        item.timestamp = (timestamp_t)item.seq * 1000;
+        memcpy(packet + sizeof(header) + n * sizeof(item), &item, sizeof(item));
+    }
+
+    return header.length;
+}
+
+/*
+ * Records LC1 and PT1 packets as the I/O thread would, after their last
+ * samples, with a valve state every 100 packets.
+ */
+static void record() {
+    struct valve_packet valves;
+    uint8_t packet[sizeof(struct data_header) + ITEMS * sizeof(struct data_item)];
+    timestamp_t appended;
+    recorder recording;
+    uint16_t length;
+
+    recording.open(RECORDING, names, CHANNELS, "test");
+    for (uint32_t index = 0; index < PACKETS; index++) {
+        appended = ((timestamp_t)(index + 1) * ITEMS - 1) * 1000;
+
+        length = fill(packet, SENSOR::LC1, index);
+        recording.append(0, packet, length, appended);
+        length = fill(packet, SENSOR::PT1, index);
+        recording.append(1, packet, length, appended);
+
+        if (index % 100 == 0) {
+            memset(&valves, 0, sizeof(valves));
+            valves.magic = VALVE_MAGIC;
+            valves.length = sizeof(valves);
+            valves.changes = index / 100;
+            valves.changed_ns = appended * 1000;
+            valves.levels = index / 100;
+            recording.append(2, (uint8_t *)&valves, sizeof(valves), appended);
+        }
+    }
+    recording.close();
+}
+
+int test_seek(void *args) {
+    recorded_log log;
+    size_t middle;
+
+    record();
+    assert_true(log.open(RECORDING) == 0 && log.isRecording(), "Opened");
+
+    const std::vector<decode_block> &blocks = log.getBlocks();
+    printf("%zu blocks\n", blocks.size());
+    assert_true(blocks.size() > 4, "Every block found");
+
+    middle = log.seek(30000000);
+    assert_true(log.seek(0) == 0, "Seek to the start");
+    assert_true(middle > 0 && middle < blocks.size(), "Seek to the middle");
+    assert_true(blocks[middle].last_us >= 30000000 && blocks[middle - 1].last_us < 30000000,
+                "First block reaching the time");
+    assert_true(log.seek(UINT64_MAX) == blocks.size(), "Seek past the end");
+
+    return (0);
+}
+
+int test_window(void *args) {
+    calibration_table calibration;
+    decode_options options;
+    std::vector<decoded_sample> samples;
+    recorded_log log;
+    bool ordered = true;
+
+    calibration.set(SENSOR::PT1, 0.5, -10);
+    options.from_us = 20000000;
+    options.to_us = 29999000;
+    options.sensors = 1 << SENSOR::PT1;
+    options.calibration = &calibration;
+
+    log.open(RECORDING);
+    log.decode(options, &samples);
+
+    assert_true(samples.size() == 10000, "Only the window");
+    for (size_t index = 0; index < samples.size(); index++) {
+        ordered &= samples[index].sensor == SENSOR::PT1 &&
+                   samples[index].seq == 20000 + index &&
+                   samples[index].time_us == (20000 + index) * 1000 &&
+                   samples[index].value == samples[index].raw * 0.5f - 10;
+    }
+    assert_true(ordered, "In order and calibrated");
+
+    return (0);
+}
+
+int test_threads(void *args) {
+    decode_options options;
+    std::vector<decoded_sample> one, many;
+    recorded_log log;
+    bool same = true;
+    int valves = 0;
+
+    options.valves = true;
+    log.open(RECORDING);
+
+    options.threads = 1;
+    log.decode(options, &one);
+    options.threads = 4;
+    log.decode(options, &many);
+
+    assert_true(one.size() == 2 * PACKETS * ITEMS + PACKETS / 100, "Every sample");
+    assert_true(one.size() == many.size(), "Same samples");
+    for (size_t index = 0; index < one.size(); index++) {
+        same &= memcmp(&one[index], &many[index], sizeof(decoded_sample)) == 0;
+        valves += one[index].sensor == DECODE_VALVES;
+    }
+    assert_true(same, "Same order");
+    assert_true(valves == PACKETS / 100, "Valve states");
+
+    /* Only the valve channel, so most blocks are skipped */
+    options.sensors = 0;
+    many.clear();
+    log.decode(options, &many);
+    same = many.size() == PACKETS / 100;
+    for (size_t index = 0; same && index < many.size(); index++)
+        same = many[index].sensor == DECODE_VALVES && many[index].raw == index;
+    assert_true(same, "Only the wanted channel");
+
+    remove(RECORDING);
+
+    return (0);
+}
+
+int test_legacy(void *args) {
+    uint8_t packet[sizeof(struct data_header) + ITEMS * sizeof(struct data_item)];
+    decode_options options;
+    std::vector<decoded_sample> samples;
+    recorded_log log;
+    FILE *file;
+
+    file = fopen(LEGACY_LOG, "wb");
+    for (uint32_t index = 0; index < 10; index++)
+        fwrite(packet, fill(packet, SENSOR::TC1, index), 1, file);
+    fclose(file);
+
+    options.from_us = 32000;
+    assert_true(log.open(LEGACY_LOG) == 0 && !log.isRecording(), "Opened an older log");
+    assert_true(log.decode(options, &samples) == 10 * ITEMS - 32, "Older log decoded");
+    assert_true(samples[0].sensor == SENSOR::TC1 && samples[0].seq == 32, "From the window");
+
+    remove(LEGACY_LOG);
+
+    return (0);
+}
+
+int main() {
+    testlib_init("Decoder");
+
+    test("Seek", &test_seek, NULL);
+    test("Window", &test_window, NULL);
+    test("Threads", &test_threads, NULL);
+    test("Older log", &test_legacy, NULL);
+
+    return (testlib_shutdown());
+}
@@ -0,0 +1,85 @@
+/**
+ * @file filter_bench.cpp
+ * @brief Times each kind of filter stage, and a typical cascade, per sample.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <cstdlib>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "adc/adc.hpp"
+#include "filter/filter_bank.hpp"
+
+// Number of samples to run through each filter
+#define DEFAULT_SAMPLES 4000000
+
+static uint64_t now_ns() {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+/*
+ * Runs noisy samples through the filters of one sensor, and prints the time
+ * per sample. Returns a sum of the outputs so they are not optimized away.
+ */
+static double run(const char *name, filter_bank *filters, SENSOR sensor,
+    uint32_t samples)
+{
+	uint64_t start, elapsed_ns;
+	uint32_t seed = 1, outputs = 0;
+	double total = 0;
+	float value;
+
+	start = now_ns();
+	for (uint32_t index = 0; index < samples; index++) {
+		seed = seed * 1103515245 + 12345;
+		if (filters->process(sensor, 2048 + (seed >> 16) % 64, &value)) {
+			total += value;
+			outputs++;
+		}
+	}
+	elapsed_ns = now_ns() - start;
+
+	printf("%-28s %8.1f ns/sample %12.0f samples/s max %10u outputs\n",
+	    name, (double)elapsed_ns / samples, 1e9 * samples / elapsed_ns, outputs);
+	return total;
+}
+
+int main(int argc, char **argv) {
+	uint32_t samples = argc > 1 ? std::atoi(argv[1]) : DEFAULT_SAMPLES;
+	filter_bank filters;
+	double checksum = 0;
+
+	/* One sensor per filter, so each runs on its own state */
+	filters.addMedian(SENSOR::LC1, 5);
+	filters.addMedian(SENSOR::LC2, 15);
+	filters.addAverage(SENSOR::LC3, 16);
+	filters.addLowpass(SENSOR::LC4, 50);
+	filters.addFir(SENSOR::LC5, 32, 1);
+	filters.addFir(SENSOR::PT1, 32, 4);
+	filters.addMedian(SENSOR::PT2, 5);
+	filters.addLowpass(SENSOR::PT2, 50);
+	filters.addFir(SENSOR::PT3, 64, 8);
+	filters.addLowpass(SENSOR::PT3, 20);
+
+	printf("Filtering %u samples per filter\n", samples);
+
+	checksum += run("none", &filters, SENSOR::PT4, samples);
+	checksum += run("median 5", &filters, SENSOR::LC1, samples);
+	checksum += run("median 15", &filters, SENSOR::LC2, samples);
+	checksum += run("average 16", &filters, SENSOR::LC3, samples);
+	checksum += run("lowpass 50 Hz", &filters, SENSOR::LC4, samples);
+	checksum += run("fir 32 taps", &filters, SENSOR::LC5, samples);
+	checksum += run("fir 32 taps /4", &filters, SENSOR::PT1, samples);
+	checksum += run("median 5, lowpass 50 Hz", &filters, SENSOR::PT2, samples);
+	checksum += run("fir 64 taps /8, lowpass 20 Hz", &filters, SENSOR::PT3, samples);
+
+	return checksum > 0 ? 0 : 1;
+}
@@ -0,0 +1,157 @@
+/**
+ * @file filter_test.cpp
+ * @brief Basic functionality test for filter_bank.hpp.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "calibration/calibration.hpp"
+#include "config/config.hpp"
+#include "filter/filter_bank.hpp"
+#include "libtest/libtest.hpp"
+
+int test_passthrough(void *args) {
+    filter_bank filters;
+    float value;
+
+    assert_true(filters.process(SENSOR::PT1, 1234, &value) && value == 1234, "Raw counts by default");
+
+    filters.setCalibration(SENSOR::PT1, 0.5, -10);
+    filters.process(SENSOR::PT1, 100, &value);
+    assert_true(value == 40, "Calibrated");
+    assert_false(filters.filtered(SENSOR::PT1), "No stages");
+
+    return (0);
+}
+
+int test_median(void *args) {
+    filter_bank filters;
+    uint16_t readings[] = {100, 102, 101, 4000, 4000, 99, 100, 0, 101};
+    bool spiked = false;
+    float value;
+
+    assert_true(filters.addMedian(SENSOR::PT1, 4) != 0, "Even windows rejected");
+    assert_true(filters.addMedian(SENSOR::PT1, 5) == 0, "Median added");
+
+    for (size_t index = 0; index < sizeof(readings) / sizeof(readings[0]); index++) {
+        filters.process(SENSOR::PT1, readings[index], &value);
+        spiked |= value < 99 || value > 102;
+    }
+
+    assert_false(spiked, "Spikes of two samples rejected");
+    assert_true(value == 100, "Median of the last five");
+
+    return (0);
+}
+
+int test_average(void *args) {
+    filter_bank filters;
+    float values[5];
+
+    filters.addAverage(SENSOR::LC1, 4);
+    for (int index = 0; index < 5; index++)
+        filters.process(SENSOR::LC1, index * 4, &values[index]);
+
+    assert_true(values[0] == 0 && values[1] == 2 && values[3] == 6, "Filling window");
+    assert_true(values[4] == 10, "Full window");
+
+    return (0);
+}
+
+int test_lowpass(void *args) {
+    filter_bank filters;
+    float value, peak = 0;
+
+    assert_true(filters.addLowpass(SENSOR::PT1, SENSOR_FREQS[SENSOR::PT1]) != 0,
+                "Cutoff above Nyquist rejected");
+    assert_true(filters.addLowpass(SENSOR::PT1, SENSOR_FREQS[SENSOR::PT1] / 100.0) == 0,
+                "Lowpass added");
+
+    filters.process(SENSOR::PT1, 2000, &value);
+    assert_true(fabs(value - 2000) < 0.01, "Starts settled");
+
+    /* A tone at a quarter of the rate, far above the cutoff */
+    for (int index = 0; index < 4000; index++) {
+        filters.process(SENSOR::PT1, 2000 + (index % 4 == 1 ? 500 : index % 4 == 3 ? -500 : 0), &value);
+        if (index > 2000)
+            peak = fmax(peak, fabs(value - 2000));
+    }
+
+    printf("Tone attenuated to %.3f of 500\n", peak);
+    assert_true(peak < 5, "Tone attenuated");
+
+    return (0);
+}
+
+int test_fir(void *args) {
+    filter_bank filters;
+    int outputs = 0;
+    float value;
+    bool settled = true;
+
+    assert_true(filters.addFir(SENSOR::LC2, 16, 4) == 0, "FIR added");
+    assert_true(filters.getDecimation(SENSOR::LC2) == 4, "Decimation");
+    assert_true(filters.getRate(SENSOR::LC2) == SENSOR_FREQS[SENSOR::LC2] / 4.0, "Output rate");
+
+    for (int index = 0; index < 400; index++) {
+        if (filters.process(SENSOR::LC2, 3000, &value)) {
+            outputs++;
+            settled &= fabs(value - 3000) < 0.05;
+        }
+    }
+
+    assert_true(outputs == 100, "One output per four inputs");
+    assert_true(settled, "Unity gain at DC");
+
+    return (0);
+}
+
+int test_load(void *args) {
+    char path[] = "/tmp/filter_testXXXXXX";
+    calibration_table calibration;
+    ConfigMapping config;
+    filter_bank filters;
+    FILE *file;
+    int fd;
+
+    fd = mkstemp(path);
+    file = fdopen(fd, "w");
+    fprintf(file, "[Filter]\nPT1=median:5,lowpass:50\nLC1=fir:32:4,average:3\nPT2=median:5,bogus:3\n");
+    fclose(file);
+
+    config.readFrom(path);
+    unlink(path);
+
+    calibration.set(SENSOR::PT1, 2, 0);
+    assert_true(filters.load(config, calibration) == 1, "Bad line reported");
+    assert_true(filters.filtered(SENSOR::PT1) && filters.filtered(SENSOR::LC1), "Filters loaded");
+    assert_false(filters.filtered(SENSOR::PT2), "Bad line left unfiltered");
+    assert_true(filters.getDecimation(SENSOR::LC1) == 4, "Cascade decimated");
+
+    float value;
+    filters.process(SENSOR::PT1, 100, &value);
+    assert_true(fabs(value - 200) < 0.01, "Outputs calibrated");
+
+    return (0);
+}
+
+int main() {
+    testlib_init("Filter");
+
+    test("Passthrough", &test_passthrough, NULL);
+    test("Median", &test_median, NULL);
+    test("Moving average", &test_average, NULL);
+    test("Lowpass", &test_lowpass, NULL);
+    test("Decimating FIR", &test_fir, NULL);
+    test("Config", &test_load, NULL);
+
+    return (testlib_shutdown());
+}
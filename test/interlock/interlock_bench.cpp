@@ -0,0 +1,42 @@
+/**
+ * @file interlock_bench.cpp
+ * @brief Times the interlock rules per sample, with a typical set of rules
+ * 	  on the pressure transducers.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <cstdlib>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "adc/adc.hpp"
+#include "interlock/interlock.hpp"
+#include "sequencer/wakeup.hpp"
+
+// Number of samples to check
+#define DEFAULT_SAMPLES 4000000
+
+int main(int argc, char **argv) {
+	uint32_t samples = argc > 1 ? std::atoi(argv[1]) : DEFAULT_SAMPLES;
+	SENSOR sensors[] = {SENSOR::PT1, SENSOR::PT2, SENSOR::PT3, SENSOR::PT4};
+	interlock rules;
+	uint64_t start, elapsed_ns;
+
+	/* A vote, a smoothed redline and a rate limit, none of which trip */
+	rules.add(INTERLOCK_ABOVE, sensors, 4, 2, 4000, 3);
+	rules.add(INTERLOCK_BELOW, sensors, 1, 1, 10, 1, 0.05);
+	rules.add(INTERLOCK_RATE, sensors, 4, 1, 100000);
+
+	start = wakeup::now_ns();
+	for (uint32_t index = 0; index < samples; index++)
+		rules.evaluate(sensors[index % 4], 2000 + index % 7, (timestamp_t)index * 250);
+	elapsed_ns = wakeup::now_ns() - start;
+
+	printf("%u samples against %zu rules: %.1f ns/sample, %u trips\n", samples,
+	    rules.size(), (double)elapsed_ns / samples, rules.getTrips());
+
+	return (0);
+}
@@ -0,0 +1,180 @@
+/**
+ * @file interlock_test.cpp
+ * @brief Basic functionality test for interlock.hpp.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+#include <bcm2835.h>
+
+#include "interlock/interlock.hpp"
+#include "libtest/libtest.hpp"
+#include "sequencer/sequence.hpp"
+#include "sequencer/sequencer.hpp"
+#include "sequencer/valve_state.hpp"
+#include "sequencer/wakeup.hpp"
+
+#define MS 1000000ULL
+
+int test_redline(void *args) {
+    std::atomic<bool> shutoff(false);
+    wakeup wake;
+    interlock rules(&shutoff, &wake);
+    SENSOR sensor = SENSOR::PT1;
+
+    rules.setCalibration(SENSOR::PT1, 1, 0);
+    assert_true(rules.add(INTERLOCK_ABOVE, &sensor, 1, 1, 100, 3) == 0, "Rule added");
+
+    assert_false(rules.evaluate(SENSOR::PT1, 50, 0), "Nominal");
+    assert_false(rules.evaluate(SENSOR::PT2, 500, 0), "Other sensors ignored");
+    assert_false(rules.evaluate(SENSOR::PT1, 150, 1000), "First high sample persists");
+    assert_false(rules.evaluate(SENSOR::PT1, 150, 2000), "Second high sample persists");
+    assert_true(rules.evaluate(SENSOR::PT1, 150, 3000), "Third high sample trips");
+    assert_true(rules.getTripped() == 1 && shutoff.load(), "Trip published");
+    assert_true(wake.wait_until(wakeup::now_ns() + MS), "Wakeup notified");
+
+    /* Raised again if cleared while still tripped */
+    shutoff.store(false);
+    assert_false(rules.evaluate(SENSOR::PT1, 150, 4000), "Still tripped");
+    assert_true(shutoff.load(), "Shutoff raised again");
+
+    assert_true(rules.evaluate(SENSOR::PT1, 50, 5000), "Clears");
+    assert_true(rules.getTripped() == 0 && !shutoff.load(), "Clear published");
+    assert_true(rules.getTrips() == 1, "One trip counted");
+
+    return (0);
+}
+
+int test_calibration(void *args) {
+    interlock rules;
+    SENSOR sensor = SENSOR::PT1;
+
+    /* A falling slope turns "above 800" into raw readings below 1027 */
+    rules.setCalibration(SENSOR::PT1, -0.3, 1108.1);
+    rules.add(INTERLOCK_ABOVE, &sensor, 1, 1, 800);
+
+    assert_false(rules.evaluate(SENSOR::PT1, 1100, 0), "Below the limit");
+    assert_true(rules.evaluate(SENSOR::PT1, 1000, 1000), "Above the limit");
+
+    return (0);
+}
+
+int test_vote(void *args) {
+    interlock rules;
+    SENSOR sensors[] = {SENSOR::PT1, SENSOR::PT2, SENSOR::PT3, SENSOR::PT4};
+
+    for (int index = 0; index < 4; index++)
+        rules.setCalibration(sensors[index], 1, 0);
+    rules.add(INTERLOCK_ABOVE, sensors, 4, 2, 100);
+
+    assert_false(rules.evaluate(SENSOR::PT3, 150, 0), "One of four fails");
+    assert_true(rules.evaluate(SENSOR::PT1, 150, 0), "Two of four trip");
+    assert_false(rules.evaluate(SENSOR::PT4, 150, 0), "Three of four stay tripped");
+    assert_false(rules.evaluate(SENSOR::PT1, 50, 1000), "Two of four still tripped");
+    assert_true(rules.evaluate(SENSOR::PT3, 50, 1000), "One of four clears");
+
+    return (0);
+}
+
+int test_rate(void *args) {
+    interlock rules;
+    SENSOR sensor = SENSOR::PT2;
+
+    /* 1000 counts per second */
+    rules.add(INTERLOCK_RATE, &sensor, 1, 1, 1000);
+
+    assert_false(rules.evaluate(SENSOR::PT2, 500, 0), "First sample");
+    assert_false(rules.evaluate(SENSOR::PT2, 501, 2000), "500 counts per second");
+    assert_true(rules.evaluate(SENSOR::PT2, 496, 3000), "5000 counts per second, falling");
+    assert_true(rules.evaluate(SENSOR::PT2, 496, 4000), "Steady again");
+
+    return (0);
+}
+
+int test_filtered(void *args) {
+    interlock rules;
+    SENSOR sensor = SENSOR::PT1;
+    bool filtered = true;
+
+    /* Filtered outputs are already calibrated, so the limit is not moved */
+    rules.setCalibration(SENSOR::PT1, -0.3, 1108.1);
+    rules.add(INTERLOCK_ABOVE, &sensor, 1, 1, 800, 1, 0, &filtered);
+
+    assert_false(rules.evaluate(SENSOR::PT1, 100, 0), "Raw readings ignored");
+    assert_false(rules.evaluate(SENSOR::PT1, 750, 0, true), "Below the limit");
+    assert_true(rules.evaluate(SENSOR::PT1, 850, 1000, true), "Above the limit");
+    assert_true(strcmp(rules.describe(0), "PT1.filtered above 800") == 0, "Described");
+
+    return (0);
+}
+
+int test_sequencer(void *args) {
+    valve_state valves;
+    sequencer runner(&valves);
+    interlock rules;
+    SENSOR sensor = SENSOR::PT1;
+    sequence seq;
+    timestamp_t tripped;
+
+    rules.setCalibration(SENSOR::PT1, 1, 0);
+    rules.add(INTERLOCK_ABOVE, &sensor, 1, 1, 100);
+    rules.setSequencer(&runner);
+
+    seq.name = "fill";
+    seq.add(0, 3, HIGH);
+    seq.add(1000 * MS, 5, HIGH);
+    seq.addAbort(3, LOW);
+    seq.addAbort(7, HIGH);
+
+    runner.start(&seq);
+    while (valves.read() == 0 && runner.isRunning())
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    assert_false(rules.evaluate(SENSOR::PT1, 50, 0), "Nominal leaves it playing");
+    assert_true(runner.isRunning(), "Still playing");
+
+    tripped = wakeup::now_ns();
+    assert_true(rules.evaluate(SENSOR::PT1, 150, 1000), "Trips");
+    while (runner.isRunning() && wakeup::now_ns() < tripped + 500 * MS)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    assert_false(runner.isRunning(), "Sequence aborted");
+    assert_true(valves.read() == (1 << 7), "Safe state written");
+
+    /* Nothing starts again until the rule clears */
+    assert_false(runner.start(&seq), "Not started while tripped");
+    assert_false(rules.evaluate(SENSOR::PT1, 150, 2000), "Still tripped");
+    assert_false(runner.start(&seq), "Still not started");
+    assert_true(rules.evaluate(SENSOR::PT1, 50, 3000), "Clears");
+    assert_true(runner.start(&seq), "Started once clear");
+    runner.abort();
+
+    /* A sequencer set while a rule is tripped is held at once */
+    sequencer later(&valves);
+    rules.evaluate(SENSOR::PT1, 150, 4000);
+    rules.setSequencer(&later);
+    assert_false(later.start(&seq), "Held when set");
+
+    return (0);
+}
+
+int main() {
+    testlib_init("Interlock");
+
+    test("Redline", &test_redline, NULL);
+    test("Calibration", &test_calibration, NULL);
+    test("Vote", &test_vote, NULL);
+    test("Rate", &test_rate, NULL);
+    test("Filtered", &test_filtered, NULL);
+    test("Sequencer", &test_sequencer, NULL);
+
+    return (testlib_shutdown());
+}
@@ -0,0 +1,76 @@
+/**
+ * @file io_test.cpp
+ * @brief Basic functionality test for retransmit_cache.hpp.
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ */
+
+#include <stdint.h>
+#include <vector>
+
+#include "circular_buffer/circular_buffer.hpp"
+#include "io/io_thread.hpp"
+#include "io/retransmit_cache.hpp"
+#include "libtest/libtest.hpp"
+
+/* Sends 16-sample legacy packets of a sensor, numbered from 0 */
+static void send(retransmit_cache *cache, SENSOR sensor, int num_packets) {
+    circular_buffer buffer(sensor, 16);
+    io_packet packet, *packets[1] = {&packet};
+    uint8_t *bufptr;
+
+    for (int p = 0; p < num_packets; p++) {
+        for (int i = 0; i < 16; i++)
+            buffer.push_data_item(i, (p * 16 + i) * 500);
+
+        bufptr = packet.data;
+        packet.sensor = sensor;
+        packet.length = buffer.get_data(&bufptr, IO_PACKET_SIZE);
+        cache->add(packets, 1);
+    }
+}
+
+int test_find(void *args) {
+    retransmit_cache cache(16);
+    std::vector<io_packet> found;
+
+    send(&cache, SENSOR::LC1, 4);
+    send(&cache, SENSOR::PT1, 4);
+
+    assert_equals(cache.find(SENSOR::LC1, 20, 8, &found, 16), 1, "Range inside one packet");
+    assert_equals(found[0].sensor, SENSOR::LC1, "Packet of the right sensor");
+    found.clear();
+
+    assert_equals(cache.find(SENSOR::PT1, 8, 40, &found, 16), 3, "Range across packets");
+    assert_equals(cache.find(SENSOR::PT1, 0, 64, &found, 2), 2, "Bounded by max_packets");
+    assert_equals(cache.find(SENSOR::PT1, 64, 16, &found, 16), 0, "Samples not sent yet");
+    assert_equals(cache.find(SENSOR::TC1, 0, 16, &found, 16), 0, "Sensor never sent");
+
+    return (0);
+}
+
+int test_eviction(void *args) {
+    retransmit_cache cache(4);
+    std::vector<io_packet> found;
+
+    send(&cache, SENSOR::LC1, 3);
+    send(&cache, SENSOR::TC1, 3);
+
+    assert_equals(cache.find(SENSOR::LC1, 0, 48, &found, 16), 1, "Oldest packets forgotten");
+    found.clear();
+    assert_equals(cache.find(SENSOR::TC1, 0, 48, &found, 16), 3, "Newest packets kept");
+
+    return (0);
+}
+
+int main() {
+    testlib_init("I/O");
+
+    test("Find", &test_find, NULL);
+    test("Eviction", &test_eviction, NULL);
+
+    return (testlib_shutdown());
+}
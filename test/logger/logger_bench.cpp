@@ -0,0 +1,55 @@
+/**
+ * @file logger_bench.cpp
+ * @brief Times what logging costs the calling thread: claiming a record,
+ * 	  capturing a typical summary line's arguments and committing it.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <cstdlib>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "logger/async_log.hpp"
+#include "time/time.hpp"
+
+// Number of messages to log
+#define DEFAULT_MESSAGES 1000000
+
+// Messages between drains of the queue, well inside its capacity
+#define BENCH_BATCH (LOG_QUEUE_RECORDS / 2)
+
+int main(int argc, char **argv) {
+	uint32_t messages = argc > 1 ? std::atoi(argv[1]) : DEFAULT_MESSAGES;
+	timestamp_t start, elapsed = 0;
+	log_record *record;
+	log_queue queue;
+	uint32_t logged = 0, batch;
+
+	while (logged < messages) {
+		batch = messages - logged < BENCH_BATCH ? messages - logged : BENCH_BATCH;
+
+		start = get_elapsed_time_ns();
+		for (uint32_t index = 0; index < batch; index++) {
+			record = queue.claim();
+			record->time_ms = get_elapsed_time_ms();
+			record->format = "%s: min %.2f, mean %.2f, max %.2f over %llu readings\n";
+			record->num_args = 0;
+			record->text_used = 0;
+			log_capture(record, "PT1", 1.0, 2.0, 3.0, (unsigned long long)index);
+			queue.commit(record);
+		}
+		elapsed += get_elapsed_time_ns() - start;
+		logged += batch;
+
+		/* The writer thread's side, not timed */
+		while (queue.front() != NULL)
+			queue.pop();
+	}
+
+	printf("%u messages: %.1f ns per message\n", messages, (double)elapsed / messages);
+
+	return (0);
+}
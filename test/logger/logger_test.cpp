@@ -0,0 +1,135 @@
+/**
+ * @file logger_test.cpp
+ * @brief Basic functionality test for logger.hpp and async_log.hpp.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "libtest/libtest.hpp"
+#include "logger/async_log.hpp"
+#include "logger/logger.hpp"
+
+#define PRODUCERS 4
+#define RECORDS_PER_PRODUCER 100000
+
+template<typename... Args>
+static bool formats_like_printf(const char *format, Args... args) {
+    log_record record;
+    char expected[MAX_BUF_LEN], result[MAX_BUF_LEN];
+
+    memset(&record, 0, sizeof(record));
+    record.format = format;
+    log_capture(&record, args...);
+
+    snprintf(expected, sizeof(expected), format, args...);
+    log_format(&record, result, sizeof(result));
+
+    if (strcmp(expected, result) != 0)
+        printf("Expected \"%s\" but formatted \"%s\"\n", expected, result);
+    return strcmp(expected, result) == 0;
+}
+
+int test_format(void *args) {
+    std::string temporary = "temporary";
+    unsigned char small = 200;
+    int x = 5;
+
+    assert_true(formats_like_printf("plain 100%%\n"), "No arguments");
+    assert_true(formats_like_printf("%d %i %u %x %X %o", -42, 17, 4000000000u, 255, 255, 8), "Integers");
+    assert_true(formats_like_printf("%lld %llu %lu %zu", -(1LL << 40), 1ULL << 63, 123456789UL,
+                                    sizeof(log_record)), "Long integers");
+    assert_true(formats_like_printf("%hhu %hd %c", small, (short)-3, 'R'), "Short integers");
+    assert_true(formats_like_printf("%.2f %8.3e %g %-6.1f|", 3.14159, 12345.678, 0.0001, 2.5f), "Floats");
+    assert_true(formats_like_printf("[%s][%-8s][%.*s]", "name", "pad", 3, "truncated"), "Strings");
+    assert_true(formats_like_printf("%s", temporary.c_str()), "String copied");
+    assert_true(formats_like_printf("%p %05d", (void *)&x, x), "Pointers and flags");
+
+    return (0);
+}
+
+int test_queue(void *args) {
+    log_queue queue;
+    std::vector<std::thread> producers;
+    uint32_t next[PRODUCERS] = {0};
+    uint64_t received = 0;
+    bool ordered = true;
+    log_record *record;
+
+    for (int producer = 0; producer < PRODUCERS; producer++) {
+        producers.push_back(std::thread([&queue, producer]() {
+            for (uint32_t index = 0; index < RECORDS_PER_PRODUCER; index++) {
+                log_record *record;
+
+                /* Retry when full, so every record arrives */
+                while ((record = queue.claim()) == NULL)
+                    std::this_thread::yield();
+
+                record->num_args = 0;
+                record->text_used = 0;
+                log_capture(record, producer, index);
+                queue.commit(record);
+            }
+        }));
+    }
+
+    while (received < PRODUCERS * RECORDS_PER_PRODUCER) {
+        if ((record = queue.front()) == NULL) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        int producer = record->args[0];
+        ordered &= record->args[1] == next[producer]++;
+        queue.pop();
+        received++;
+    }
+
+    for (size_t index = 0; index < producers.size(); index++)
+        producers[index].join();
+
+    assert_true(ordered, "Each producer's records in order");
+    assert_true(queue.front() == NULL, "Drained");
+
+    return (0);
+}
+
+int test_logger(void *args) {
+    Logger logger("Async Logger", "AsyncLoggerTest", LogLevel::INFO);
+    char contents[256] = {0};
+    FILE *file;
+
+    logger.info("reading %d of %s\n", 42, "PT1");
+    logger.debug("not logged at INFO\n");
+    logger.flush();
+
+    file = fopen(logger.getFilename(), "r");
+    if (file != NULL) {
+        fread(contents, 1, sizeof(contents) - 1, file);
+        fclose(file);
+    }
+
+    assert_true(strstr(contents, "[Async Logger][INFO][") != NULL, "Prefixed");
+    assert_true(strstr(contents, "reading 42 of PT1\n") != NULL, "Formatted and written");
+    assert_true(strstr(contents, "not logged") == NULL, "Level respected");
+
+    return (0);
+}
+
+int main() {
+    testlib_init("Logger");
+
+    test("Format", &test_format, NULL);
+    test("Multiple producers", &test_queue, NULL);
+    test("Logger", &test_logger, NULL);
+
+    return (testlib_shutdown());
+}
@@ -0,0 +1,291 @@
+/**
+ * @file networking_test.cpp
+ * @brief Basic functionality test for CommandServer.hpp, with clients
+ *        connected over loopback.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+#include "libtest/libtest.hpp"
+#include "networking/CommandProtocol.hpp"
+#include "networking/CommandServer.hpp"
+
+#define TEST_PORT 18230
+
+// Bytes a "flood" command queues for the client that sent it
+#define FLOOD_BYTES (8 << 20)
+
+/*
+ * Handles newline-terminated commands, and remembers what happened to each
+ * client in the order it happened.
+ */
+class recording_handler : public Tcp::CommandHandler {
+    public:
+        std::vector<std::string> events;
+        std::vector<std::string> commands;
+
+        size_t handle(Tcp::Client& client, const uint8_t* buf, size_t n) {
+            const uint8_t* end = (const uint8_t*) memchr(buf, '\n', n);
+            std::vector<uint8_t> chunk(64 * 1024, 'x');
+
+            if (end == NULL) {
+                return 0;
+            }
+
+            commands.push_back(std::string((const char*) buf, end - buf));
+            if (commands.back() == "flood") {
+                for (size_t sent = 0; sent < FLOOD_BYTES; sent += chunk.size()) {
+                    if (!client.send(chunk.data(), chunk.size())) {
+                        break;
+                    }
+                }
+            }
+
+            return end - buf + 1;
+        }
+
+        void connected(Tcp::Client& client) {
+            events.push_back(client.isOperator() ? "operator" : "observer");
+        }
+
+        void promoted(Tcp::Client& /* client */) {
+            events.push_back("promoted");
+        }
+
+        void disconnected(Tcp::Client& /* client */, const char* reason) {
+            events.push_back(reason);
+        }
+
+        bool saw(const char* event) {
+            for (size_t i = 0; i < events.size(); i++) {
+                if (events[i] == event) {
+                    return true;
+                }
+            }
+            return false;
+        }
+};
+
+/* Connects a blocking client over loopback, optionally with a small receive buffer */
+static int connect_client(int rcvbuf = 0) {
+    sockaddr_in addr;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (rcvbuf > 0) {
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(TEST_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (sockaddr*) &addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/* Runs the event loop for about ms milliseconds */
+static void serve_for(Tcp::CommandServer& server, int ms) {
+    std::chrono::steady_clock::time_point end =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+
+    while (std::chrono::steady_clock::now() < end) {
+        server.poll(10);
+    }
+}
+
+/* Writes a frame header for length bytes of commands into buf */
+static void frame(uint8_t* buf, uint8_t version, uint16_t length, uint32_t seq) {
+    command_frame_header header;
+
+    header.start = CMD_FRAME_START;
+    header.version = version;
+    header.length = length;
+    header.seq = seq;
+    memcpy(buf, &header, sizeof(header));
+}
+
+int test_parse_frame(void* args) {
+    uint8_t buf[sizeof(command_frame_header) + CMD_FRAME_MAX_LENGTH + 8] = {0};
+    command_frame_header header;
+    int whole = sizeof(command_frame_header) + 3;
+
+    frame(buf, CMD_FRAME_VERSION, 3, 42);
+    assert_equals(parse_command_frame(buf, 5, &header), 0, "Truncated header waits");
+    assert_equals(parse_command_frame(buf, whole - 1, &header), 0, "Truncated commands wait");
+    assert_equals(parse_command_frame(buf, whole, &header), whole, "Whole frame");
+    assert_equals(parse_command_frame(buf, whole + 5, &header), whole, "Frame before more bytes");
+    assert_true(header.seq == 42 && header.length == 3, "Header read");
+
+    frame(buf, CMD_FRAME_VERSION + 1, 3, 42);
+    assert_equals(parse_command_frame(buf, whole, &header), -1, "Unknown version");
+
+    frame(buf, CMD_FRAME_VERSION, 0, 42);
+    assert_equals(parse_command_frame(buf, whole, &header), -1, "Empty frame");
+
+    /* Too long is malformed as soon as the header arrives */
+    frame(buf, CMD_FRAME_VERSION, CMD_FRAME_MAX_LENGTH + 1, 42);
+    assert_equals(parse_command_frame(buf, sizeof(header), &header), -1, "Length too long");
+
+    frame(buf, CMD_FRAME_VERSION, CMD_FRAME_MAX_LENGTH, 42);
+    assert_equals(parse_command_frame(buf, sizeof(header) + CMD_FRAME_MAX_LENGTH, &header),
+                  (int) sizeof(header) + CMD_FRAME_MAX_LENGTH, "Longest frame");
+
+    buf[0] = CMD_ACK_START;
+    assert_equals(parse_command_frame(buf, whole, &header), -1, "Bad start byte");
+
+    return (0);
+}
+
+int test_commands(void* args) {
+    recording_handler handler;
+    Tcp::CommandServer server(TEST_PORT, &handler);
+    int fd = connect_client();
+
+    serve_for(server, 50);
+    assert_equals(server.getNumClients(), 1, "Client accepted");
+
+    /* Two commands, the second split across sends */
+    send(fd, "one\ntw", 6, 0);
+    serve_for(server, 50);
+    send(fd, "o\n", 2, 0);
+    serve_for(server, 50);
+
+    assert_equals(handler.commands.size(), 2, "Both commands handled");
+    assert_true(handler.commands.size() == 2 && handler.commands[1] == "two", "Split command joined");
+
+    close(fd);
+    serve_for(server, 50);
+    assert_equals(server.getNumClients(), 0, "Disconnect noticed");
+    assert_true(handler.saw("client disconnected"), "Disconnect reported");
+
+    return (0);
+}
+
+int test_promotion(void* args) {
+    recording_handler handler;
+    Tcp::CommandServer server(TEST_PORT, &handler, 2);
+    int first, second, third;
+    char byte;
+
+    first = connect_client();
+    serve_for(server, 50);
+    second = connect_client();
+    serve_for(server, 50);
+
+    assert_true(handler.events.size() == 2 && handler.events[0] == "operator" &&
+                handler.events[1] == "observer", "First client is the operator");
+
+    /* Over maxClients, so it is closed straight away */
+    third = connect_client();
+    serve_for(server, 50);
+    assert_equals(server.getNumClients(), 2, "Third client turned away");
+    assert_equals(recv(third, &byte, 1, 0), 0, "Third client closed");
+
+    close(first);
+    serve_for(server, 50);
+    assert_equals(server.getNumClients(), 1, "Operator dropped");
+    assert_true(handler.events.back() == "promoted", "Observer promoted");
+
+    close(second);
+    close(third);
+
+    return (0);
+}
+
+int test_idle_timeout(void* args) {
+    recording_handler handler;
+    Tcp::CommandServer server(TEST_PORT, &handler);
+    int quiet, chatty;
+
+    server.setTimeouts(150, TCP_PARTIAL_TIMEOUT_MS);
+    quiet = connect_client();
+    chatty = connect_client();
+
+    /* One client keeps talking, the other says nothing */
+    for (int i = 0; i < 6; i++) {
+        send(chatty, "ping\n", 5, 0);
+        serve_for(server, 50);
+    }
+
+    assert_equals(server.getNumClients(), 1, "Quiet client dropped");
+    assert_true(handler.saw("idle timeout"), "Dropped for being idle");
+    assert_true(handler.events.back() == "promoted", "Chatty client took over");
+
+    close(quiet);
+    close(chatty);
+
+    return (0);
+}
+
+int test_partial_timeout(void* args) {
+    recording_handler handler;
+    Tcp::CommandServer server(TEST_PORT, &handler);
+    int fd;
+
+    server.setTimeouts(0, 100);
+    fd = connect_client();
+    serve_for(server, 50);
+
+    /* Quiet but between commands is fine */
+    serve_for(server, 200);
+    assert_equals(server.getNumClients(), 1, "Idle client kept");
+
+    send(fd, "unfinished", 10, 0);
+    serve_for(server, 250);
+    assert_equals(server.getNumClients(), 0, "Stalled command dropped");
+    assert_true(handler.saw("incomplete command timed out"), "Dropped for the partial command");
+
+    close(fd);
+
+    return (0);
+}
+
+int test_backlog(void* args) {
+    recording_handler handler;
+    Tcp::CommandServer server(TEST_PORT, &handler);
+    int fd;
+
+    /* A small window, so the server's queue fills long before the flood ends */
+    fd = connect_client(4096);
+    serve_for(server, 50);
+
+    send(fd, "flood\n", 6, 0);
+    serve_for(server, 50);
+
+    assert_equals(server.getNumClients(), 0, "Non-reading client dropped");
+    assert_true(handler.saw("client is not reading"), "Dropped for the backlog");
+
+    close(fd);
+
+    return (0);
+}
+
+int main() {
+    testlib_init("Networking");
+
+    test("Parse frames", &test_parse_frame, NULL);
+    test("Commands", &test_commands, NULL);
+    test("Operator promotion", &test_promotion, NULL);
+    test("Idle timeout", &test_idle_timeout, NULL);
+    test("Partial command timeout", &test_partial_timeout, NULL);
+    test("Send backlog", &test_backlog, NULL);
+
+    return (testlib_shutdown());
+}
@@ -0,0 +1,198 @@
+/**
+ * @file recorder_test.cpp
+ * @brief Basic functionality test for recorder.hpp.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "libtest/libtest.hpp"
+#include "recorder/recorder.hpp"
+
+#define RECORDING "recorder_test.rec"
+#define CHANNELS 3
+#define PACKET_SIZE 260
+#define PACKETS 2000
+
+static const char *names[CHANNELS] = {"LC1", "PT1", "Valves"};
+
+/*
+ * Fills a packet with bytes that say which channel and packet it is.
+ */
+static void fill(uint8_t *packet, uint8_t channel, uint32_t index) {
+    for (int byte = 0; byte < PACKET_SIZE; byte++)
+        packet[byte] = (uint8_t)(channel * 31 + index + byte);
+}
+
+/*
+ * Reads a recording back and checks each channel's packets are all there, in
+ * order and unchanged.
+ */
+static bool reads_back(uint32_t packets) {
+    recording_reader reader;
+    uint32_t next[CHANNELS] = {0};
+    uint8_t expected[PACKET_SIZE], channel;
+    const uint8_t *data;
+    uint16_t length;
+    bool matches = true;
+
+    if (reader.open(RECORDING) != 0)
+        return false;
+
+    while (reader.next(&channel, &data, &length)) {
+        if (channel >= CHANNELS || length != PACKET_SIZE)
+            return false;
+
+        fill(expected, channel, next[channel]++);
+        matches &= memcmp(data, expected, PACKET_SIZE) == 0;
+    }
+
+    for (int index = 0; index < CHANNELS; index++)
+        matches &= next[index] == packets;
+
+    return matches;
+}
+
+int test_round_trip(void *args) {
+    STORAGE_MODE mode = *(STORAGE_MODE *)args;
+    recorder recording;
+    recorder_stats stats;
+    storage_stats storage;
+    uint8_t packet[PACKET_SIZE];
+    uint64_t timed = 0;
+    struct stat st;
+
+    assert_true(recording.open(RECORDING, names, CHANNELS, "test", mode, 4) == 0, "Opened");
+    printf("Writing with %s\n", storage_mode_name(recording.getMode()));
+
+    for (uint32_t index = 0; index < PACKETS; index++) {
+        for (uint8_t channel = 0; channel < CHANNELS; channel++) {
+            fill(packet, channel, index);
+            recording.append(channel, packet, PACKET_SIZE, index * 1000);
+        }
+    }
+
+    assert_true(recording.append(CHANNELS, packet, PACKET_SIZE, 0) != 0, "Unknown channel rejected");
+
+    recording.getStats(&stats);
+    assert_true(recording.close() == 0, "Closed");
+    recording.getStorageStats(&storage);
+
+    printf("%llu records in %llu blocks and %llu writes\n", (unsigned long long)stats.records,
+           (unsigned long long)stats.blocks, (unsigned long long)stats.write_calls);
+    assert_true(stats.records == CHANNELS * PACKETS, "Every record counted");
+    assert_true(stats.blocks > 1, "Records span blocks");
+    assert_true(stats.write_calls * 100 < stats.records, "One write per block, not per record");
+
+    for (int bucket = 0; bucket < STORAGE_LATENCY_BUCKETS; bucket++)
+        timed += storage.latency_us[bucket];
+    assert_true(storage.completed == storage.submitted && timed == storage.completed, "Every write timed");
+    assert_true(storage.bytes_persisted == storage.bytes_submitted && storage.errors == 0, "Every byte written");
+    assert_true(storage.max_depth >= 1 && storage.max_depth <= 4, "Depth bounded by the buffers");
+
+    stat(RECORDING, &st);
+    assert_true(st.st_size % RECORDER_BLOCK_SIZE != 0, "Preallocation given back");
+
+    assert_true(is_recording(RECORDING), "Recognised");
+    assert_true(reads_back(PACKETS), "Every channel read back");
+
+    return (0);
+}
+
+int test_index(void *args) {
+    recorder recording;
+    recording_reader reader;
+    struct recording_trailer trailer;
+    struct recording_index_entry first, last;
+    uint8_t packet[PACKET_SIZE] = {0};
+    FILE *file;
+
+    recording.open(RECORDING, names, CHANNELS, "test");
+    for (uint32_t index = 0; index < PACKETS; index++)
+        recording.append(index % 2, packet, PACKET_SIZE, 1000 + index);
+    recording.close();
+
+    file = fopen(RECORDING, "rb");
+    fseek(file, -(long)sizeof(trailer), SEEK_END);
+    fread(&trailer, sizeof(trailer), 1, file);
+    fseek(file, trailer.index_offset, SEEK_SET);
+    fread(&first, sizeof(first), 1, file);
+    fseek(file, trailer.index_offset + (trailer.num_blocks - 1) * sizeof(last), SEEK_SET);
+    fread(&last, sizeof(last), 1, file);
+    fclose(file);
+
+    assert_true(trailer.magic == RECORDER_TRAILER_MAGIC, "Trailer written");
+    assert_true(trailer.index_offset % RECORDER_BLOCK_SIZE == RECORDER_HEADER_SIZE, "Index after the blocks");
+    assert_true(first.offset == RECORDER_HEADER_SIZE && first.first_us == 1000, "First block indexed");
+    assert_true(last.seq == trailer.num_blocks - 1 && last.last_us == 1000 + PACKETS - 1,
+                "Last block indexed");
+    assert_true(first.channels == 3, "Channels of a block");
+
+    assert_true(reader.open(RECORDING) == 0 && reader.wasClosed(), "Read as closed");
+    assert_true(reader.findChannel("Valves") == 2 && reader.findChannel("PT2") == -1, "Channels by name");
+
+    return (0);
+}
+
+int test_unclosed(void *args) {
+    STORAGE_MODE mode = *(STORAGE_MODE *)args;
+    recorder recording;
+    uint8_t packet[PACKET_SIZE];
+    recording_reader reader;
+    uint8_t channel;
+    const uint8_t *data;
+    uint16_t length;
+    int count = 0;
+
+    recording.open(RECORDING, names, CHANNELS, "test", mode);
+    for (uint32_t index = 0; index < 10; index++) {
+        for (uint8_t channel = 0; channel < CHANNELS; channel++) {
+            fill(packet, channel, index);
+            recording.append(channel, packet, PACKET_SIZE, index);
+        }
+    }
+    recording.sync();
+
+    /* As if the power was cut before close() */
+    recording.drain();
+    assert_true(reads_back(10), "Synced records read back");
+
+    fill(packet, 0, 10);
+    recording.append(0, packet, PACKET_SIZE, 10);
+    recording.sync();
+    recording.append(0, packet, PACKET_SIZE, 10);
+    recording.sync();
+    recording.drain();
+
+    reader.open(RECORDING);
+    while (reader.next(&channel, &data, &length))
+        count++;
+    assert_false(reader.wasClosed(), "Read as not closed");
+    assert_true(count == 32, "Block rewritten in place");
+
+    recording.close();
+    remove(RECORDING);
+
+    return (0);
+}
+
+int main() {
+    STORAGE_MODE sync = STORAGE_SYNC, direct = STORAGE_DIRECT, uring = STORAGE_URING;
+
+    testlib_init("Recorder");
+
+    test("Round trip", &test_round_trip, &sync);
+    test("Round trip, O_DIRECT", &test_round_trip, &direct);
+    test("Round trip, io_uring", &test_round_trip, &uring);
+    test("Index", &test_index, NULL);
+    test("Unclosed", &test_unclosed, &sync);
+    test("Unclosed, io_uring", &test_unclosed, &uring);
+
+    return (testlib_shutdown());
+}
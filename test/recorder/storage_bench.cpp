@@ -0,0 +1,143 @@
+/**
+ * @file storage_bench.cpp
+ * @brief Measures the write throughput each storage mode sustains against
+ * 	  the worst case data rate of the sensors.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <cstdlib>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "circular_buffer/circular_buffer.hpp"
+#include "recorder/recorder.hpp"
+#include "recorder/storage.hpp"
+
+// Seconds to write flat out with each mode
+#define DEFAULT_SECONDS 5
+
+// Highest rate the [Rates] section accepts for a sensor, in Hz
+#define WORST_RATE_HZ 65535
+
+// Readings in a full legacy packet, the largest per reading
+#define PACKET_ITEMS 16
+
+static uint64_t now_ns() {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+/*
+ * Gets the latency below which a fraction of the writes finished, from the
+ * histogram.
+ */
+static uint64_t percentile_us(const storage_stats *stats, double fraction) {
+	uint64_t wanted = stats->completed * fraction, seen = 0;
+
+	for (int bucket = 0; bucket < STORAGE_LATENCY_BUCKETS; bucket++) {
+		seen += stats->latency_us[bucket];
+		if (seen >= wanted && seen > 0)
+			return (uint64_t)1 << bucket;
+	}
+
+	return stats->max_latency_us;
+}
+
+/*
+ * Records packets of every sensor as fast as possible for the given time,
+ * syncing once a second as the I/O thread does. Returns the worst one second
+ * window's throughput in bytes/s: the rate the mode can be relied on for.
+ */
+static double run(const char *path, STORAGE_MODE mode, uint32_t seconds) {
+	const char *names[SENSOR::NUM_SENSORS];
+	uint8_t packet[sizeof(struct data_header) + PACKET_ITEMS * sizeof(struct data_item)];
+	uint64_t start, window_start, now, window_bytes = 0, total_bytes = 0;
+	double worst = 0, rate;
+	storage_stats stats;
+	recorder recording;
+	uint32_t index = 0;
+	uint8_t channel;
+
+	for (int sensor = 0; sensor < SENSOR::NUM_SENSORS; sensor++)
+		names[sensor] = "sensor";
+	memset(packet, 0x5A, sizeof(packet));
+
+	if (recording.open(path, names, SENSOR::NUM_SENSORS, "bench", mode) != 0) {
+		printf("Could not create %s\n", path);
+		return 0;
+	}
+
+	start = window_start = now_ns();
+	for (;;) {
+		channel = index++ % SENSOR::NUM_SENSORS;
+		recording.append(channel, packet, sizeof(packet), index);
+		window_bytes += sizeof(packet) + sizeof(struct recording_record);
+
+		if (index % 256 != 0)
+			continue;
+
+		recording.poll();
+		now = now_ns();
+		if (now - window_start < 1000000000)
+			continue;
+
+		recording.sync();
+		rate = window_bytes * 1e9 / (now - window_start);
+		if (worst == 0 || rate < worst)
+			worst = rate;
+		total_bytes += window_bytes;
+		window_bytes = 0;
+		window_start = now;
+
+		if (now - start >= (uint64_t)seconds * 1000000000)
+			break;
+	}
+
+	recording.getStorageStats(&stats);
+	recording.close();
+	remove(path);
+
+	printf("%-7s %8.1f MB/s mean %8.1f MB/s worst second, %6llu writes, "
+	    "p50 %6llu us, p99 %6llu us, max %6llu us, max depth %u, %llu stalls\n",
+	    storage_mode_name(recording.getMode()),
+	    total_bytes / 1e6 / ((now - start) / 1e9), worst / 1e6,
+	    (unsigned long long)stats.completed,
+	    (unsigned long long)percentile_us(&stats, 0.5),
+	    (unsigned long long)percentile_us(&stats, 0.99),
+	    (unsigned long long)stats.max_latency_us, stats.max_depth,
+	    (unsigned long long)stats.stalls);
+
+	return worst;
+}
+
+int main(int argc, char **argv) {
+	const char *path = argc > 1 ? argv[1] : "storage_bench.rec";
+	uint32_t seconds = argc > 2 ? std::atoi(argv[2]) : DEFAULT_SECONDS;
+	uint32_t rate_hz = argc > 3 ? std::atoi(argv[3]) : WORST_RATE_HZ;
+	double needed, worst;
+	int err = 0;
+
+	/* Every sensor at the rate, in full legacy packets, each with a record header */
+	needed = (double)SENSOR::NUM_SENSORS * rate_hz / PACKET_ITEMS *
+	    (sizeof(struct data_header) + PACKET_ITEMS * sizeof(struct data_item) +
+	    sizeof(struct recording_record));
+
+	printf("Worst case: %d sensors at %u Hz need %.2f MB/s\n", SENSOR::NUM_SENSORS,
+	    rate_hz, needed / 1e6);
+
+	for (int mode = STORAGE_SYNC; mode <= STORAGE_URING; mode++) {
+		worst = run(path, (STORAGE_MODE)mode, seconds);
+		printf("        %.1fx the worst case\n", worst / needed);
+		if (worst < needed)
+			err = 1;
+	}
+
+	return err;
+}
@@ -0,0 +1,253 @@
+/**
+ * @file sequencer_test.cpp
+ * @brief Basic functionality test for wakeup.hpp, valve_state.hpp, sequence.hpp
+ *        and sequencer.hpp.
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <unistd.h>
+
+#include <bcm2835.h>
+#include <string.h>
+
+#include "commands/rpi_pins.hpp"
+#include "config/config.hpp"
+#include "libtest/libtest.hpp"
+#include "sequencer/sequence.hpp"
+#include "sequencer/sequencer.hpp"
+#include "sequencer/valve_state.hpp"
+#include "sequencer/wakeup.hpp"
+
+#define MS 1000000ULL
+
+int test_deadline(void *args) {
+    wakeup wake;
+    timestamp_t deadline = wakeup::now_ns() + 20 * MS;
+
+    assert_false(wake.wait_until(deadline), "Not notified");
+    assert_true(wakeup::now_ns() >= deadline, "Did not wake early");
+    assert_true(wakeup::now_ns() < deadline + 10 * MS, "Woke near the deadline");
+
+    return (0);
+}
+
+int test_notify(void *args) {
+    wakeup wake;
+    timestamp_t start = wakeup::now_ns();
+
+    /* A notify before the wait is not lost */
+    wake.notify();
+    assert_true(wake.wait_until(start + 1000 * MS), "Early notify kept");
+    assert_true(wakeup::now_ns() - start < 100 * MS, "Did not wait for the deadline");
+    assert_false(wake.wait_until(wakeup::now_ns() + MS), "Notify only counted once");
+
+    /* And one from another thread ends the wait at once */
+    std::thread notifier([&wake]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        wake.notify();
+    });
+    assert_true(wake.wait_until(0), "Woken from another thread");
+    assert_true(wakeup::now_ns() >= wake.last_notified(), "Woken after the notify");
+    notifier.join();
+
+    return (0);
+}
+
+int test_valve_state(void *args) {
+    valve_state valves;
+    pin_masks masks;
+    struct valve_packet packet;
+
+    /* A pin added twice keeps its last level */
+    masks.add(3, HIGH);
+    masks.add(5, HIGH);
+    masks.add(3, LOW);
+    assert_true(masks.set == (1 << 5), "Set mask");
+    assert_true(masks.clear == (1 << 3), "Clear mask");
+
+    valves.apply(masks);
+    assert_true(valves.read() == (1 << 5), "Levels after the masks");
+    valves.write(7, HIGH);
+    valves.write(5, LOW);
+    assert_true(valves.read() == (1 << 7), "Levels after single writes");
+    assert_true(valves.getChanges() == 3, "Every update counted");
+
+    assert_true(valves.encode((uint8_t *)&packet, sizeof(packet) - 1) == 0, "Short buffer");
+    assert_true(valves.encode((uint8_t *)&packet, sizeof(packet)) == sizeof(packet), "Packet length");
+    assert_true(packet.magic == VALVE_MAGIC && packet.length == sizeof(packet), "Packet header");
+    assert_true(packet.levels == (1 << 7), "Packet levels");
+    assert_true(packet.outputs == ((1 << 3) | (1 << 5) | (1 << 7)), "Packet outputs");
+    assert_true(packet.changes == 3, "Packet changes");
+
+    return (0);
+}
+
+/* Loads Sequence:<name> from a config file holding contents */
+static int load(sequence *seq, const char *contents, const char *name) {
+    char path[] = "/tmp/sequencer_testXXXXXX";
+    ConfigMapping config;
+    FILE *file;
+
+    file = fdopen(mkstemp(path), "w");
+    fputs(contents, file);
+    fclose(file);
+    config.readFrom(path);
+    unlink(path);
+
+    return seq->load(config, name);
+}
+
+int test_load(void *args) {
+    sequence seq;
+
+    assert_equals(load(&seq, "[Sequence:fill]\n"
+                             "step=5000,DRIVER2,high\n"
+                             "step=0,DRIVER1,high\n"
+                             "step=5000,DRIVER3,low\n"
+                             "abort=DRIVER1,low\n"
+                             "abort=DRIVER2,low\n", "fill"), 0, "Loaded");
+    assert_true(seq.name == "fill" && seq.steps.size() == 3, "Every step");
+    assert_true(seq.steps[0].offset_ns == 0 && seq.steps[0].pin == DRIVER1, "Sorted by offset");
+    assert_true(seq.steps[1].offset_ns == 5000000 && seq.steps[1].pin == DRIVER2 &&
+                seq.steps[2].pin == DRIVER3 && seq.steps[2].level == LOW, "Ties kept in order");
+    assert_true(seq.abort_steps.size() == 2 && seq.abort_steps[1].pin == DRIVER2, "Abort steps");
+
+    assert_equals(load(&seq, "[Sequence:other]\nstep=0,DRIVER1,high\n", "fill"), 1, "Missing section");
+    assert_equals(load(&seq, "[Sequence:fill]\nabort=DRIVER1,low\n", "fill"), 1, "No steps");
+    assert_equals(load(&seq, "[Sequence:fill]\nstep=0,DRIVER9,high\n", "fill"), 1, "Unknown pin");
+    assert_equals(load(&seq, "[Sequence:fill]\nstep=0,DRIVER1,open\n", "fill"), 1, "Unknown level");
+    assert_equals(load(&seq, "[Sequence:fill]\nstep=DRIVER1,high\n", "fill"), 1, "No offset");
+    assert_equals(load(&seq, "[Sequence:fill]\nstep=0,DRIVER1,high\n"
+                             "abort=DRIVER1\n", "fill"), 1, "Malformed abort");
+
+    return (0);
+}
+
+/*
+ * Plays steps given out of order, checking the pins at points between their
+ * deadlines.
+ */
+int test_order(void *args) {
+    valve_state valves;
+    sequencer runner(&valves);
+    sequence seq;
+    timestamp_t start;
+
+    seq.name = "order";
+    seq.add(60 * MS, DRIVER3, HIGH);
+    seq.add(20 * MS, DRIVER1, HIGH);
+    seq.add(40 * MS, DRIVER2, HIGH);
+    seq.add(40 * MS, DRIVER1, LOW);
+
+    start = wakeup::now_ns();
+    assert_true(runner.start(&seq), "Started");
+    assert_false(runner.start(&seq), "Only one at a time");
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    assert_true(valves.read() == 0, "Nothing before the first step");
+    while (wakeup::now_ns() < start + 30 * MS)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    assert_true(valves.read() == (1u << DRIVER1), "First step only");
+    while (wakeup::now_ns() < start + 50 * MS)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    assert_true(valves.read() == (1u << DRIVER2), "Same offset written together");
+    while (runner.isRunning() && wakeup::now_ns() < start + 1000 * MS)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    assert_true(wakeup::now_ns() >= start + 60 * MS, "Not finished early");
+    assert_true(valves.read() == ((1u << DRIVER2) | (1u << DRIVER3)), "Every step written");
+    assert_true(valves.getChanges() == 3, "One write per offset");
+
+    return (0);
+}
+
+int test_abort(void *args) {
+    valve_state valves;
+    sequencer runner(&valves);
+    sequence seq;
+    timestamp_t aborted;
+
+    seq.name = "abort";
+    seq.add(0, DRIVER1, HIGH);
+    seq.add(0, DRIVER2, HIGH);
+    seq.add(1000 * MS, DRIVER3, HIGH);
+    seq.addAbort(DRIVER1, LOW);
+    seq.addAbort(DRIVER4, HIGH);
+
+    runner.start(&seq);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    assert_true(valves.read() == ((1u << DRIVER1) | (1u << DRIVER2)), "First steps written");
+
+    aborted = wakeup::now_ns();
+    runner.abort();
+    while (runner.isRunning() && wakeup::now_ns() < aborted + 500 * MS)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    assert_false(runner.isRunning(), "Stopped");
+    assert_true(wakeup::now_ns() - aborted < 100 * MS, "Stopped at once");
+    assert_true(valves.read() == ((1u << DRIVER2) | (1u << DRIVER4)), "Safe state written");
+
+    /* And it can play again after */
+    assert_true(runner.start(&seq), "Restarted");
+    runner.abort();
+
+    return (0);
+}
+
+/*
+ * An abort with nothing playing is not kept for the next sequence, and one
+ * straight after start() is not lost.
+ */
+int test_abort_start(void *args) {
+    valve_state valves;
+    sequencer runner(&valves);
+    sequence seq;
+    timestamp_t start;
+    bool started = true;
+
+    seq.name = "late";
+    seq.add(20 * MS, DRIVER1, HIGH);
+    seq.addAbort(DRIVER2, HIGH);
+
+    runner.abort();
+    start = wakeup::now_ns();
+    assert_true(runner.start(&seq), "Started after an idle abort");
+    while (runner.isRunning() && wakeup::now_ns() < start + 500 * MS)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    assert_true(valves.read() == (1u << DRIVER1), "Played to the end");
+
+    valves.write(DRIVER1, LOW);
+    start = wakeup::now_ns();
+    for (int index = 0; index < 20; index++) {
+        started &= runner.start(&seq);
+        runner.abort();
+        while (runner.isRunning() && wakeup::now_ns() < start + 500 * MS)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    assert_true(started, "Started every time");
+    assert_true(valves.read() == (1u << DRIVER2), "Every start aborted");
+
+    return (0);
+}
+
+int main() {
+    testlib_init("Sequencer");
+
+    test("Deadline", &test_deadline, NULL);
+    test("Notify", &test_notify, NULL);
+    test("Valve state", &test_valve_state, NULL);
+    test("Load", &test_load, NULL);
+    test("Deadline order", &test_order, NULL);
+    test("Abort", &test_abort, NULL);
+    test("Abort around a start", &test_abort_start, NULL);
+
+    return (testlib_shutdown());
+}
@@ -0,0 +1,255 @@
+/**
+ * @file telemetry_test.cpp
+ * @brief Basic functionality test for seq_tracker.hpp.
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2026
+ * 
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "circular_buffer/circular_buffer.hpp"
+#include "circular_buffer/packet.hpp"
+#include "libtest/libtest.hpp"
+#include "sequencer/valve_state.hpp"
+#include "telemetry/seq_tracker.hpp"
+
+struct data_item items[64];
+
+/* Make a packet's worth of samples numbered from first, 500 us apart */
+static struct data_item *run(uint32_t first, uint16_t count) {
+    for (int i = 0; i < count; i++) {
+        items[i].reading = i;
+        items[i].seq = first + i;
+        items[i].timestamp = (timestamp_t)(first + i) * 500;
+    }
+    return items;
+}
+
+int test_in_order(void *args) {
+    seq_tracker tracker;
+    seq_stats stats;
+
+    for (uint32_t p = 0; p < 10; p++)
+        tracker.add(SENSOR::LC1, run(p * 16, 16), 16);
+    tracker.getStats(SENSOR::LC1, &stats);
+
+    assert_equals(stats.packets, 10, "All packets counted");
+    assert_equals(stats.samples, 160, "All samples counted");
+    assert_equals(stats.lost + stats.reordered + stats.duplicates, 0, "Nothing lost, late or repeated");
+    assert_equals(stats.max_gap_us, 500, "No gap in sampling");
+
+    return (0);
+}
+
+int test_loss_and_reorder(void *args) {
+    seq_tracker tracker;
+    seq_stats stats;
+
+    tracker.add(SENSOR::PT1, run(0, 16), 16);
+    tracker.add(SENSOR::PT1, run(48, 16), 16);
+    tracker.getStats(SENSOR::PT1, &stats);
+    assert_equals(stats.lost, 32, "Two packets missing");
+    assert_true(stats.loss_rate > 0.49 && stats.loss_rate < 0.51, "Half the samples missing");
+
+    /* One of them turns up late, and then again */
+    tracker.add(SENSOR::PT1, run(32, 16), 16);
+    tracker.add(SENSOR::PT1, run(32, 16), 16);
+    tracker.getStats(SENSOR::PT1, &stats);
+    assert_equals(stats.lost, 16, "Late packet is no longer lost");
+    assert_equals(stats.reordered, 1, "Late packet was reordered");
+    assert_equals(stats.duplicates, 1, "Second copy is a duplicate");
+    assert_equals(stats.samples, 48, "Duplicates are not counted twice");
+
+    /* Part of the remaining gap, splitting it */
+    tracker.add(SENSOR::PT1, run(20, 4), 4);
+    tracker.add(SENSOR::PT1, run(16, 4), 4);
+    tracker.add(SENSOR::PT1, run(24, 8), 8);
+    tracker.getStats(SENSOR::PT1, &stats);
+    assert_equals(stats.lost, 0, "Every gap filled");
+    assert_equals(stats.reordered, 4, "Every late piece counted");
+
+    seq_stats totals;
+    tracker.getTotals(&totals);
+    assert_equals(totals.packets, stats.packets, "Totals over one sensor");
+
+    return (0);
+}
+
+int test_wrap_and_restart(void *args) {
+    seq_tracker tracker;
+    seq_stats stats;
+
+    tracker.add(SENSOR::TC1, run(UINT32_MAX - 15, 16), 16);
+    tracker.add(SENSOR::TC1, run(16, 16), 16);
+    tracker.getStats(SENSOR::TC1, &stats);
+    assert_equals(stats.lost, 16, "Gap across the wrap of the sample numbers");
+
+    tracker.add(SENSOR::TC1, run(0, 16), 16);
+    tracker.getStats(SENSOR::TC1, &stats);
+    assert_equals(stats.lost, 0, "Late packet across the wrap");
+
+    /* Restarting the sender starts the count again */
+    tracker.add(SENSOR::TC1, run(UINT32_MAX / 2, 16), 16);
+    tracker.add(SENSOR::TC1, run(0, 16), 16);
+    tracker.add(SENSOR::TC1, run(16, 16), 16);
+    tracker.getStats(SENSOR::TC1, &stats);
+    assert_equals(stats.duplicates, 0, "Restart is not a duplicate");
+
+    return (0);
+}
+
+int test_early_restart(void *args) {
+    seq_tracker tracker;
+    seq_stats stats;
+
+    for (uint32_t p = 0; p < 3; p++)
+        tracker.add(SENSOR::TC2, run(p * 16, 16), 16);
+
+    /* Restarted well within SEQ_RESTART_DISTANCE of its first start, so
+     * its first sample was read at another time */
+    run(0, 16);
+    for (int i = 0; i < 16; i++)
+        items[i].timestamp += 200;
+    tracker.add(SENSOR::TC2, items, 16);
+    tracker.add(SENSOR::TC2, run(16, 16), 16);
+    tracker.getStats(SENSOR::TC2, &stats);
+
+    assert_equals(stats.duplicates, 0, "Early restart is not a duplicate");
+    assert_equals(stats.samples, 80, "Samples after restart counted");
+    assert_equals(stats.lost, 0, "Nothing lost across the restart");
+
+    /* A late copy of the second packet is still a duplicate */
+    tracker.add(SENSOR::TC2, run(16, 16), 16);
+    tracker.getStats(SENSOR::TC2, &stats);
+    assert_equals(stats.duplicates, 1, "Repeated packet is a duplicate");
+
+    return (0);
+}
+
+int test_repeated_first(void *args) {
+    seq_tracker tracker;
+    seq_stats stats;
+
+    for (uint32_t p = 0; p < 4; p++)
+        tracker.add(SENSOR::TC3, run(p * 16, 16), 16);
+
+    /* The same first packet again, e.g. resent, is not a restart */
+    tracker.add(SENSOR::TC3, run(0, 16), 16);
+    tracker.add(SENSOR::TC3, run(64, 16), 16);
+    tracker.getStats(SENSOR::TC3, &stats);
+
+    assert_equals(stats.duplicates, 1, "Repeated first packet");
+    assert_equals(stats.lost, 0, "Nothing lost after it");
+    assert_equals(stats.samples, 80, "Samples counted once");
+
+    return (0);
+}
+
+int test_sampling_gap(void *args) {
+    seq_tracker tracker;
+    seq_stats stats;
+
+    tracker.add(SENSOR::LC2, run(0, 16), 16);
+    run(16, 16);
+    for (int i = 0; i < 16; i++)
+        items[i].timestamp += 100000;
+    tracker.add(SENSOR::LC2, items, 16);
+    tracker.getStats(SENSOR::LC2, &stats);
+
+    assert_equals(stats.lost, 0, "A pause in sampling loses nothing");
+    assert_equals(stats.max_gap_us, 100500, "But shows up as a gap in time");
+
+    return (0);
+}
+
+int test_datagrams(void *args) {
+    circular_buffer lc(SENSOR::LC3, 16), pt(SENSOR::PT2, 32, PACKET_FORMAT::COMPACT);
+    uint8_t packet[260], datagram[FRAME_ETHERNET_PAYLOAD];
+    uint8_t *bufptr;
+    uint16_t length;
+    frame_writer writer;
+    seq_tracker tracker;
+    seq_stats stats;
+
+    writer.reset(datagram, FRAME_ETHERNET_PAYLOAD);
+    for (int p = 0; p < 3; p++) {
+        for (int i = 0; i < 16; i++)
+            lc.push_data_item(i, p * 16 + i);
+        for (int i = 0; i < 32; i++)
+            pt.push_data_item(i, p * 32 + i);
+
+        bufptr = packet;
+        length = lc.get_data(&bufptr, 260);
+        if (p != 1)
+            writer.add(SENSOR::LC3, packet, length);
+
+        bufptr = packet;
+        length = pt.get_data(&bufptr, 260);
+        writer.add(SENSOR::PT2, packet, length);
+    }
+
+    assert_equals(tracker.addDatagram(datagram, writer.length()), 5, "Five packets in the datagram");
+    tracker.getStats(SENSOR::LC3, &stats);
+    assert_equals(stats.lost, 16, "Missing legacy packet is lost");
+    tracker.getStats(SENSOR::PT2, &stats);
+    assert_equals(stats.samples, 96, "Every compact sample arrived");
+    assert_equals(tracker.addDatagram(datagram, 3), -1, "Truncated datagram is malformed");
+
+    return (0);
+}
+
+int test_other_packets(void *args) {
+    uint8_t datagram[FRAME_ETHERNET_PAYLOAD], packet[260];
+    float values[4] = {1, 2, 3, 4};
+    struct valve_packet valves;
+    const uint8_t *section;
+    frame_writer writer;
+    frame_reader reader;
+    seq_tracker tracker;
+    seq_stats stats;
+    uint16_t length;
+    SENSOR sensor;
+
+    memset(&valves, 0, sizeof(valves));
+    valves.magic = VALVE_MAGIC;
+    valves.version = VALVE_VERSION;
+    valves.length = sizeof(valves);
+    assert_equals(tracker.addDatagram((uint8_t *)&valves, sizeof(valves)), 0, "Valve state skipped");
+
+    length = encode_calibrated(SENSOR::PT1, 0, values, 4, packet, sizeof(packet));
+    reader.reset(packet, length);
+    assert_true(reader.next(&sensor, &section, &length) && sensor == SENSOR::PT1, "Calibrated sensor read");
+    assert_equals(tracker.addDatagram(packet, length), 0, "Calibrated skipped");
+
+    /* Filter outputs framed with the samples, as the I/O thread sends them */
+    writer.reset(datagram, FRAME_ETHERNET_PAYLOAD);
+    length = encode_filtered(SENSOR::PT1, 0, 100, 250, values, 4, packet, sizeof(packet));
+    writer.add(SENSOR::PT1, packet, length);
+    length = encode_compact(SENSOR::PT1, 0, run(0, 16), 16, packet, sizeof(packet));
+    writer.add(SENSOR::PT1, packet, length);
+
+    assert_equals(tracker.addDatagram(datagram, writer.length()), 1, "Only samples counted");
+    tracker.getTotals(&stats);
+    assert_true(stats.samples == 16 && stats.lost == 0 && stats.duplicates == 0, "Counters untouched");
+
+    return (0);
+}
+
+int main() {
+    testlib_init("Telemetry");
+
+    test("In order", &test_in_order, NULL);
+    test("Loss and reordering", &test_loss_and_reorder, NULL);
+    test("Wrap-around and restart", &test_wrap_and_restart, NULL);
+    test("Early restart", &test_early_restart, NULL);
+    test("Repeated first packet", &test_repeated_first, NULL);
+    test("Sampling gap", &test_sampling_gap, NULL);
+    test("Datagrams", &test_datagrams, NULL);
+    test("Other packets", &test_other_packets, NULL);
+
+    return (testlib_shutdown());
+}
@@ -0,0 +1,126 @@
+/**
+ * @file thread_test.cpp
+ * @brief Basic functionality test for thread.hpp.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "circular_buffer/circular_buffer.hpp"
+#include "circular_buffer/packet.hpp"
+#include "circular_buffer/ring_buffer.hpp"
+#include "io/io_thread.hpp"
+#include "libtest/libtest.hpp"
+#include "thread/thread.hpp"
+
+#define ITEMS 16
+#define PACKETS 4
+#define PERIOD_NS 10000000ULL
+
+static uint64_t now_ns() {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+int test_store_full(void *args) {
+    circular_buffer buffer(SENSOR::PT1, ITEMS);
+    ring_buffer<io_packet> queue(PACKETS);
+    struct data_item items[ITEMS];
+    uint8_t scratch[IO_PACKET_SIZE];
+    uint16_t expected = 0, count;
+    io_packet packet;
+    SENSOR sensor;
+    bool contiguous = true;
+
+    for (uint16_t reading = 0; reading < PACKETS * ITEMS; reading++)
+        store_reading(&buffer, &queue, scratch, reading, reading);
+
+    /* The reading that found the buffer full starts the next packet */
+    while (queue.pop(&packet, 1) == 1) {
+        decode_packet(packet.data, packet.length, &sensor, items, ITEMS, &count);
+        for (uint16_t index = 0; index < count; index++)
+            contiguous &= items[index].reading == expected++;
+    }
+
+    assert_true(contiguous && expected == (PACKETS - 1) * ITEMS, "No reading lost at a flush");
+    assert_true(buffer.size() == ITEMS, "Last packet still buffered");
+
+    return (0);
+}
+
+int test_wait_deadline(void *args) {
+    thread_timing timing;
+    uint64_t deadline, start, missed;
+
+    /* On time, so it sleeps until the next deadline */
+    start = now_ns();
+    deadline = start;
+    assert_true(wait_deadline(&deadline, PERIOD_NS, &timing, &missed) == start + PERIOD_NS,
+                "Next deadline");
+    assert_true(now_ns() >= deadline && missed == 0, "Slept until it");
+    assert_equals(timing.overruns.load(), 0, "No overrun");
+
+    /* Half a period late, so the tick starts at once */
+    start = now_ns();
+    deadline = start - PERIOD_NS - PERIOD_NS / 2;
+    wait_deadline(&deadline, PERIOD_NS, &timing, &missed);
+    assert_true(deadline == start - PERIOD_NS / 2 && missed == 0, "Late tick not skipped");
+    assert_true(now_ns() - start < PERIOD_NS / 2, "Did not sleep");
+    assert_equals(timing.overruns.load(), 1, "Overrun counted");
+
+    /* Two and a half periods late, so two periods are skipped */
+    start = now_ns();
+    deadline = start - 3 * PERIOD_NS - PERIOD_NS / 2;
+    wait_deadline(&deadline, PERIOD_NS, &timing, &missed);
+    assert_true(deadline == start - PERIOD_NS / 2 && missed == 2, "Missed periods skipped");
+    assert_equals(timing.overruns.load(), 2, "Overruns counted");
+    assert_equals(timing.missed_periods.load(), 2, "Missed periods counted");
+
+    return (0);
+}
+
+int test_record_tick(void *args) {
+    thread_timing timing;
+
+    record_tick(&timing, 1000, 1500, 2500);
+    record_tick(&timing, 2000, 1900, 2000);
+    record_tick(&timing, 3000, 3300, 6300);
+
+    assert_equals(timing.ticks.load(), 3, "Every tick counted");
+    assert_equals(timing.min_jitter_ns.load(), 0, "Early start is no jitter");
+    assert_equals(timing.max_jitter_ns.load(), 500, "Largest jitter");
+    assert_equals(timing.total_jitter_ns.load(), 800, "Total jitter");
+    assert_equals(timing.max_work_ns.load(), 3000, "Longest tick");
+
+    return (0);
+}
+
+int test_next_frame(void *args) {
+    frame_schedule schedule;
+
+    schedule.num_frames = 4;
+    assert_equals(next_frame(&schedule, 0, 0), 1, "Next frame");
+    assert_equals(next_frame(&schedule, 3, 0), 0, "Wraps around");
+    assert_equals(next_frame(&schedule, 1, 2), 0, "Skips the missed frames");
+    assert_equals(next_frame(&schedule, 2, 5), 0, "Skips whole major frames");
+
+    return (0);
+}
+
+int main() {
+    testlib_init("Thread");
+
+    test("Storing into a full buffer", &test_store_full, NULL);
+    test("Waiting for a deadline", &test_wait_deadline, NULL);
+    test("Recording a tick", &test_record_tick, NULL);
+    test("Next frame", &test_next_frame, NULL);
+
+    return (testlib_shutdown());
+}
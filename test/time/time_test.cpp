@@ -0,0 +1,97 @@
+/**
+ * @file time_test.cpp
+ * @brief Basic functionality test for time.hpp.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ */
+
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+#include "libtest/libtest.hpp"
+#include "time/time.hpp"
+
+#define THREADS 4
+#define READS 200000
+
+// Elapsed time read during static initialization, before main()
+static timestamp_t static_ns = get_elapsed_time_ns();
+
+int test_epoch(void *args) {
+    timestamp_t now = get_elapsed_time_ns();
+
+    printf("%llu ns at static initialization, %llu ns at the test\n",
+           (unsigned long long)static_ns, (unsigned long long)now);
+    assert_true(static_ns < 1000000000, "Epoch set before static init");
+    assert_true(now >= static_ns && get_elapsed_time_s() < 60, "Counting from the start");
+
+    return (0);
+}
+
+int test_tick(void *args) {
+    struct time_tick tick;
+    timestamp_t before, after;
+    bool agree = true;
+
+    for (int index = 0; index < 1000; index++) {
+        before = get_elapsed_time_ns();
+        stamp_tick(&tick);
+        after = get_elapsed_time_ns();
+
+        agree &= tick.ns >= before && tick.ns <= after;
+        agree &= tick.us == tick.ns / 1000 && tick.ms == tick.ns / 1000000 &&
+                 tick.s == tick.ns / 1000000000;
+    }
+    assert_true(agree, "Every unit from one reading");
+
+    return (0);
+}
+
+/*
+ * Checks the time never goes backwards, reading it from several threads at
+ * once.
+ */
+int test_monotonic(void *args) {
+    std::vector<std::thread> threads;
+    std::atomic<int> backwards(0);
+    uint64_t start = get_elapsed_time_ns();
+
+    for (int thread = 0; thread < THREADS; thread++) {
+        threads.push_back(std::thread([&backwards]() {
+            timestamp_t last_ns = 0, last_us = 0, now_ns, now_us;
+
+            for (int index = 0; index < READS; index++) {
+                now_ns = get_elapsed_time_ns();
+                now_us = get_elapsed_time_us();
+                if (now_ns < last_ns || now_us < last_us)
+                    backwards++;
+                last_ns = now_ns;
+                last_us = now_us;
+            }
+        }));
+    }
+
+    for (size_t thread = 0; thread < threads.size(); thread++)
+        threads[thread].join();
+
+    printf("%.1f ns per read\n",
+           (double)(get_elapsed_time_ns() - start) / (2.0 * READS));
+    assert_true(backwards.load() == 0, "Never backwards");
+
+    return (0);
+}
+
+int main() {
+    testlib_init("Time");
+
+    test("Epoch", &test_epoch, NULL);
+    test("Tick", &test_tick, NULL);
+    test("Monotonic", &test_monotonic, NULL);
+
+    return (testlib_shutdown());
+}
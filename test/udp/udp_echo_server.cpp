@@ -21,11 +21,19 @@
 #include <unistd.h>
 
 #include "circular_buffer/circular_buffer.hpp"
+#include "circular_buffer/packet.hpp"
+#include "sequencer/valve_state.hpp"
+#include "telemetry/seq_tracker.hpp"
 
 /**
  * @brief Size of the buffer used when receiving bytes to echo. 
  */
-#define TEST_RECV_BUF_SIZE 1024
+#define TEST_RECV_BUF_SIZE 2048
+
+/**
+ * @brief Number of datagrams between reports of the link statistics.
+ */
+#define TEST_REPORT_INTERVAL 1000
 
 int main(int argc, char** argv) {
     // Get user's requested port number
@@ -54,9 +62,14 @@ int main(int argc, char** argv) {
     // Receive bytes and print them, forever
     int num;
     uint8_t *buf = new uint8_t[TEST_RECV_BUF_SIZE];
-    struct data_header header;
-    struct data_item item;
-    uint8_t *recv_ptr;
+    struct data_item items[TEST_RECV_BUF_SIZE];
+    uint16_t count, length;
+    SENSOR sensor;
+    frame_reader reader;
+    const uint8_t *packet;
+    seq_tracker tracker;
+    seq_stats stats;
+    uint64_t received = 0;
     std::cout << "Starting recv loop" << std::endl;
     while (true) {
         num = ::recv(fd, (void*) buf, TEST_RECV_BUF_SIZE, 0);
@@ -64,13 +77,69 @@ int main(int argc, char** argv) {
         if (num < 0) {
             std::cerr << "Error receiving" << std::endl;
         } else {
-	    recv_ptr = buf;
-	    printf("Header: %lu %lu\n", ((struct data_header *)recv_ptr)->sensor,
-			    		((struct data_header *)recv_ptr)->length);
-	    recv_ptr += sizeof(struct data_header);
-	    for(;recv_ptr - buf < num; recv_ptr += sizeof(struct data_item)) {
-		    printf("Data: %lu %lu\n", ((struct data_item *)recv_ptr)->reading,
-						((struct data_item *)recv_ptr)->timestamp);
+	    // Keep count of what the link loses, reorders and duplicates
+	    tracker.addDatagram(buf, num);
+	    if (++received % TEST_REPORT_INTERVAL == 0) {
+		    tracker.getTotals(&stats);
+		    printf("Link: %.3f%% lost, %.3f%% reordered, %.3f%% duplicated, "
+			   "longest sampling gap %lu us\n", stats.loss_rate * 100,
+			   stats.reorder_rate * 100, stats.duplicate_rate * 100,
+			   (unsigned long)stats.max_gap_us);
+	    }
+
+	    // A datagram holds one packet, or several behind a frame_header
+	    if (!reader.reset(buf, num)) {
+		    std::cerr << "Malformed datagram" << std::endl;
+		    continue;
+	    }
+
+	    // Legacy and compact packets are both understood by decode_packet
+	    while (reader.next(&sensor, &packet, &length)) {
+		    if (length >= sizeof(struct valve_packet) && packet[0] == VALVE_MAGIC) {
+			    struct valve_packet valves;
+
+			    memcpy(&valves, packet, sizeof(valves));
+			    printf("Valves: levels 0x%08x, %u changes\n", valves.levels, valves.changes);
+			    continue;
+		    }
+
+		    // Calibrated and filtered packets are floats after their header
+		    if (length >= sizeof(struct calibrated_header) && packet[0] == CALIBRATED_MAGIC) {
+			    struct calibrated_header header;
+			    float value;
+
+			    memcpy(&header, packet, sizeof(header));
+			    printf("Calibrated: %u from sample %u\n", header.sensor, header.first_seq);
+			    for (int i = 0; i < header.count && sizeof(header) + (i + 1) * sizeof(float) <= length; i++) {
+				    memcpy(&value, packet + sizeof(header) + i * sizeof(float), sizeof(float));
+				    printf("Value: %f\n", value);
+			    }
+			    continue;
+		    }
+
+		    if (length >= sizeof(struct filtered_header) && packet[0] == FILTERED_MAGIC) {
+			    struct filtered_header header;
+			    float value;
+
+			    memcpy(&header, packet, sizeof(header));
+			    printf("Filtered: %u from output %u at %.1f Hz\n", header.sensor, header.first_seq, header.rate);
+			    for (int i = 0; i < header.count && sizeof(header) + (i + 1) * sizeof(float) <= length; i++) {
+				    memcpy(&value, packet + sizeof(header) + i * sizeof(float), sizeof(float));
+				    printf("Value: %f\n", value);
+			    }
+			    continue;
+		    }
+
+		    if (decode_packet(packet, length, &sensor, items, TEST_RECV_BUF_SIZE, &count) == 0) {
+			    std::cerr << "Malformed packet" << std::endl;
+			    continue;
+		    }
+
+		    printf("Header: %u %u\n", sensor, length);
+		    for (int i = 0; i < count; i++) {
+			    printf("Data: %u %lu\n", items[i].reading,
+							(unsigned long)items[i].timestamp);
+		    }
 	    }
 
             // buf[num] = '\0'; // null-terminate for printing
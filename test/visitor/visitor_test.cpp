@@ -0,0 +1,306 @@
+/**
+ * @file visitor_test.cpp
+ * @brief Basic functionality test for command_dispatcher.hpp, with clients
+ *        sending frames over loopback.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "commands/rpi_pins.hpp"
+#include "config/config.hpp"
+#include "libtest/libtest.hpp"
+#include "logger/logger.hpp"
+#include "networking/CommandProtocol.hpp"
+#include "networking/CommandServer.hpp"
+#include "sequencer/sequence.hpp"
+#include "visitor/command_dispatcher.hpp"
+#include "visitor/worker_visitor.hpp"
+
+#define TEST_PORT 18231
+
+// The ignition state shared with the visitors, which main.cpp defines
+std::atomic<bool> ignitionOn;
+std::atomic<bool> pressureShutoff;
+wakeup ignitionWakeup;
+valve_state valves;
+
+/* A visitor whose sequences can be started from the test */
+class sequence_visitor : public WorkerVisitor {
+    public:
+        sequence_visitor(ConfigMapping& config) : WorkerVisitor(config) {}
+
+        using WorkerVisitor::addSequence;
+        using WorkerVisitor::runSequence;
+};
+
+static int connect_client() {
+    sockaddr_in addr;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(TEST_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (sockaddr*) &addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/* Runs the event loop for about ms milliseconds */
+static void serve_for(Tcp::CommandServer& server, int ms) {
+    std::chrono::steady_clock::time_point end =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+
+    while (std::chrono::steady_clock::now() < end) {
+        server.poll(10);
+    }
+}
+
+/*
+ * Sends a frame of commands, with the length in the header given separately
+ * so it can disagree with the bytes sent.
+ */
+static void send_frame(int fd, uint32_t seq, const std::vector<uint8_t>& commands,
+                       uint16_t length, uint8_t version = CMD_FRAME_VERSION) {
+    std::vector<uint8_t> buf(sizeof(command_frame_header) + commands.size());
+    command_frame_header header;
+
+    header.start = CMD_FRAME_START;
+    header.version = version;
+    header.length = length;
+    header.seq = seq;
+    memcpy(buf.data(), &header, sizeof(header));
+    memcpy(buf.data() + sizeof(header), commands.data(), commands.size());
+    send(fd, buf.data(), buf.size(), 0);
+}
+
+static void send_frame(int fd, uint32_t seq, const std::vector<uint8_t>& commands) {
+    send_frame(fd, seq, commands, commands.size());
+}
+
+/* Reads up to count acks that have already arrived */
+static std::vector<command_ack> read_acks(int fd, size_t count) {
+    std::vector<command_ack> acks(count);
+    ssize_t n = recv(fd, acks.data(), count * sizeof(command_ack), MSG_DONTWAIT);
+
+    acks.resize(n > 0 ? n / sizeof(command_ack) : 0);
+    return acks;
+}
+
+int test_acks(void* args) {
+    Logger logger("Dispatcher", "DispatcherTest", LogLevel::INFO);
+    CommandDispatcher dispatcher(NULL, NULL, &logger);
+    Tcp::CommandServer server(TEST_PORT, &dispatcher);
+    std::vector<command_ack> acks;
+    int fd = connect_client();
+    bool ordered = true;
+
+    serve_for(server, 50);
+    send_frame(fd, 10, {COMMAND::SET_DRIVER1, 200, COMMAND::UNSET_DRIVER1});
+    serve_for(server, 50);
+    acks = read_acks(fd, 4);
+
+    assert_equals(acks.size(), 3, "One ack per command");
+    for (size_t index = 0; index < acks.size(); index++) {
+        ordered &= acks[index].start == CMD_ACK_START && acks[index].seq == 10 + index;
+        ordered &= acks[index].received_ns == acks[0].received_ns;
+    }
+    assert_true(ordered, "Acks numbered in order");
+    assert_true(acks.size() == 3 && acks[0].status == CMD_OK && acks[2].status == CMD_OK, "Commands carried out");
+    assert_true(acks.size() == 3 && acks[1].status == CMD_UNKNOWN && acks[1].command == 200, "Unknown command");
+    assert_true(acks.size() == 3 && acks[0].dispatched_ns >= acks[0].received_ns, "Dispatched after received");
+
+    /* A retransmit request short of its arguments */
+    send_frame(fd, 13, {COMMAND::SET_DRIVER1, COMMAND::REQUEST_RETRANSMIT, 0, 0, 0});
+    serve_for(server, 50);
+    acks = read_acks(fd, 4);
+
+    assert_equals(acks.size(), 2, "Acks up to the truncation");
+    assert_true(acks.size() == 2 && acks[1].status == CMD_MALFORMED && acks[1].seq == 14, "Truncated command");
+    assert_equals(server.getNumClients(), 1, "Still connected");
+
+    close(fd);
+    serve_for(server, 50);
+
+    return (0);
+}
+
+int test_duplicates(void* args) {
+    Logger logger("Dispatcher", "DispatcherTest", LogLevel::INFO);
+    CommandDispatcher dispatcher(NULL, NULL, &logger);
+    Tcp::CommandServer server(TEST_PORT, &dispatcher);
+    std::vector<command_ack> acks;
+    int fd = connect_client();
+
+    serve_for(server, 50);
+    send_frame(fd, 20, {COMMAND::SET_DRIVER1, COMMAND::SET_DRIVER2});
+    serve_for(server, 50);
+    acks = read_acks(fd, 4);
+    assert_true(acks.size() == 2 && acks[1].status == CMD_OK, "First send carried out");
+
+    /* Resent as if the acks were lost, with one new command on the end */
+    send_frame(fd, 20, {COMMAND::SET_DRIVER1, COMMAND::SET_DRIVER2, COMMAND::SET_DRIVER3});
+    serve_for(server, 50);
+    acks = read_acks(fd, 4);
+
+    assert_equals(acks.size(), 3, "Every command acked");
+    assert_true(acks.size() == 3 && acks[0].status == CMD_DUPLICATE &&
+                acks[1].status == CMD_DUPLICATE, "Resent commands not rerun");
+    assert_true(acks.size() == 3 && acks[0].dispatched_ns == 0, "Duplicate not dispatched");
+    assert_true(acks.size() == 3 && acks[2].status == CMD_OK && acks[2].seq == 22, "New command carried out");
+
+    close(fd);
+    serve_for(server, 50);
+
+    /* A new connection starts its own count */
+    fd = connect_client();
+    serve_for(server, 50);
+    send_frame(fd, 20, {COMMAND::SET_DRIVER1});
+    serve_for(server, 50);
+    acks = read_acks(fd, 4);
+    assert_true(acks.size() == 1 && acks[0].status == CMD_OK, "Fresh client not a duplicate");
+
+    close(fd);
+    serve_for(server, 50);
+
+    return (0);
+}
+
+int test_observer(void* args) {
+    Logger logger("Dispatcher", "DispatcherTest", LogLevel::INFO);
+    CommandDispatcher dispatcher(NULL, NULL, &logger);
+    Tcp::CommandServer server(TEST_PORT, &dispatcher);
+    std::vector<command_ack> acks;
+    int op, observer;
+
+    op = connect_client();
+    serve_for(server, 50);
+    observer = connect_client();
+    serve_for(server, 50);
+
+    send_frame(observer, 1, {COMMAND::SET_DRIVER1});
+    serve_for(server, 50);
+    acks = read_acks(observer, 4);
+    assert_true(acks.size() == 1 && acks[0].status == CMD_IGNORED, "Observer ignored");
+
+    close(op);
+    close(observer);
+    serve_for(server, 50);
+
+    return (0);
+}
+
+int test_bad_frame(void* args) {
+    Logger logger("Dispatcher", "DispatcherTest", LogLevel::INFO);
+    CommandDispatcher dispatcher(NULL, NULL, &logger);
+    Tcp::CommandServer server(TEST_PORT, &dispatcher);
+    std::vector<command_ack> acks;
+    uint8_t byte;
+    int fd = connect_client();
+
+    serve_for(server, 50);
+    send_frame(fd, 30, {COMMAND::SET_DRIVER1}, CMD_FRAME_MAX_LENGTH + 1);
+    serve_for(server, 50);
+    acks = read_acks(fd, 4);
+
+    assert_true(acks.size() == 1 && acks[0].status == CMD_MALFORMED && acks[0].seq == 30, "Bad length acked");
+    assert_equals(server.getNumClients(), 0, "Bad frame disconnects");
+    assert_equals(recv(fd, &byte, 1, 0), 0, "Connection closed");
+
+    close(fd);
+
+    return (0);
+}
+
+/*
+ * Starts a burn with a sequence playing that would still be writing pins
+ * long after the burn, ends the burn with end(), and checks the sequence's
+ * safe state was written and its later step never was.
+ */
+static bool burn_aborts_sequence(sequence_visitor& visitor, void (*end)(sequence_visitor&)) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint32_t levels;
+
+    valves.write(DRIVER3, LOW);
+    valves.write(DRIVER4, LOW);
+    if (!visitor.runSequence("late")) {
+        return false;
+    }
+    visitor.visitCommand(COMMAND::START_IGNITION);
+
+    end(visitor);
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(300)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    levels = valves.read();
+    return (levels & (1 << DRIVER4)) && (levels & (1 << DRIVER3)) && !ignitionOn.load();
+}
+
+int test_burn_end(void* args) {
+    char path[] = "/tmp/visitor_testXXXXXX";
+    ConfigMapping config;
+    sequence seq;
+    FILE* file;
+
+    /* A 100 ms burn, whose pressure shutoff is armed from the start */
+    file = fdopen(mkstemp(path), "w");
+    fprintf(file, "[Worker]\npreignite_ms=20\nhotflow_ms=100\n"
+                  "[Pressure]\npressureshutoff_ms=0\nshutoff_enabled=1\n");
+    fclose(file);
+    config.readFrom(path);
+    unlink(path);
+
+    /* Static, as its detached ignition thread outlives the test */
+    static sequence_visitor visitor(config);
+
+    seq.name = "late";
+    seq.add(0, DRIVER3, HIGH);
+    seq.add(2000000000ULL, DRIVER3, LOW);
+    seq.addAbort(DRIVER4, HIGH);
+    visitor.addSequence(seq);
+
+    assert_true(burn_aborts_sequence(visitor, [](sequence_visitor&) {}), "Aborted when the burn ends");
+    assert_true(burn_aborts_sequence(visitor, [](sequence_visitor&) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        pressureShutoff.store(true);
+        ignitionWakeup.notify();
+    }), "Aborted on pressure shutoff");
+    assert_true(burn_aborts_sequence(visitor, [](sequence_visitor& stopped) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        stopped.visitCommand(COMMAND::STOP_IGNITION);
+    }), "Aborted on a stop");
+
+    return (0);
+}
+
+int main() {
+    testlib_init("Visitor");
+
+    test("Command acks", &test_acks, NULL);
+    test("Duplicate commands", &test_duplicates, NULL);
+    test("Observer commands", &test_observer, NULL);
+    test("Bad frame", &test_bad_frame, NULL);
+    test("Burn end", &test_burn_end, NULL);
+
+    return (testlib_shutdown());
+}